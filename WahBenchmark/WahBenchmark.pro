@@ -0,0 +1,31 @@
+#-------------------------------------------------
+#
+# Benchmarks for map-to-mesh conversion on synthetic maps.
+# Prints its results as JSON so that builds can be compared.
+# With --check, runs the consistency checks instead.
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+TARGET = wahbenchmark
+TEMPLATE = app
+
+CONFIG += c++14 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../WallsAndHoles/wahcore.pri)
+
+
+SOURCES += \
+    main.cpp \
+    syntheticmaps.cpp \
+    benchmarks.cpp \
+    checks.cpp
+
+HEADERS += \
+    syntheticmaps.h \
+    benchmarks.h \
+    checks.h
@@ -0,0 +1,529 @@
+#include "benchmarks.h"
+
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QScopedPointer>
+#include <QSet>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QtMath>
+
+#include <algorithm>
+#include <random>
+
+#include "map2mesh.h"
+#include "objtools.h"
+#include "occlusionculler.h"
+#include "packedmesh.h"
+#include "polygon.h"
+#include "triangulator.h"
+
+
+namespace {
+
+double toMs(qint64 ns)
+{
+    return ns / 1e6;
+}
+
+/// Summarizes repeated measurements.
+QJsonObject summarize(QVector<qint64> ns)
+{
+    QJsonObject summary;
+    if (ns.isEmpty())
+        return summary;
+
+    std::sort(ns.begin(), ns.end());
+
+    qint64 total = 0;
+    for (qint64 t : ns)
+        total += t;
+
+    summary["count"] = ns.size();
+    summary["minMs"] = toMs(ns.first());
+    summary["medianMs"] = toMs(ns[ns.size() / 2]);
+    summary["meanMs"] = toMs(total / ns.size());
+    summary["maxMs"] = toMs(ns.last());
+
+    return summary;
+}
+
+QJsonObject cacheStatsToJson(const M2M::MeshCache::Stats &stats)
+{
+    QJsonObject json;
+    json["hits"] = double(stats.hits);
+    json["misses"] = double(stats.misses);
+    json["hitRate"] = stats.hitRate();
+    json["entries"] = stats.entries;
+    json["bytes"] = double(stats.bytes);
+    json["evictionRounds"] = double(stats.evictionRounds);
+    json["evictedEntries"] = double(stats.evictedEntries);
+    return json;
+}
+
+/// A regular polygon with the same orientation as the tile squares used by the meshers.
+BetterPolygon regularPolygon(QPointF center, double radius, int numPoints)
+{
+    QVector<QPointF> points;
+    for (int i = 0; i < numPoints; ++i) {
+        double angle = -2 * M_PI * i / numPoints;
+        points.append(center + radius * QPointF(qCos(angle), qSin(angle)));
+    }
+
+    return BetterPolygon(points);
+}
+
+/// A comb with numTeeth thin teeth, like the long polygons that bridged walls produce.
+BetterPolygon combPolygon(int numTeeth)
+{
+    QVector<QPointF> points = {QPointF(0, 0), QPointF(0, 1)};
+    for (int i = 0; i < numTeeth; ++i) {
+        qreal x = qreal(i) / numTeeth;
+        qreal w = 1.0 / numTeeth;
+
+        points << QPointF(x + 0.25 * w, 1) << QPointF(x + 0.25 * w, 2)
+               << QPointF(x + 0.75 * w, 2) << QPointF(x + 0.75 * w, 1);
+    }
+    points << QPointF(1, 1) << QPointF(1, 0);
+
+    return BetterPolygon(points);
+}
+
+/// The recursive chord-splitting triangulation that BetterPolygon used before Triangulator.
+QList<Triplet<QPointF, QPointF, QPointF>> triangulateByChords(const BetterPolygon &polygon)
+{
+    const QVector<QPointF> &points = polygon.points();
+
+    if (points.size() == 3)
+        return { {points[0], points[1], points[2]} };
+
+    QPair<BetterPolygon, BetterPolygon> split = polygon.splitPolygon();
+
+    // No clear chord; the old code would recurse forever.
+    if (split.second.points().isEmpty())
+        return {};
+
+    QList<Triplet<QPointF, QPointF, QPointF>> trigs = triangulateByChords(split.first);
+    trigs.append(triangulateByChords(split.second));
+
+    return trigs;
+}
+
+/// A star with numPoints points (half of them inner), which is simple but far from convex.
+BetterPolygon starPolygon(QPointF center, double radius, int numPoints)
+{
+    QVector<QPointF> points;
+    for (int i = 0; i < numPoints; ++i) {
+        double angle = -2 * M_PI * i / numPoints;
+        double r = i % 2 == 0 ? radius : radius / 2;
+        points.append(center + r * QPointF(qCos(angle), qSin(angle)));
+    }
+
+    return BetterPolygon(points);
+}
+
+/// Whether any two edges of the polygon that are not neighbors cross, testing every pair.
+bool edgesCrossBruteForce(const BetterPolygon &polygon)
+{
+    const QVector<QPointF> &points = polygon.points();
+    int n = points.size();
+
+    for (int i = 0; i < n; ++i) {
+        QLineF line(points[i], points[(i + 1) % n]);
+
+        for (int a = i + 2; a < n; ++a) {
+            if (i == 0 && a == n - 1)
+                continue;
+
+            if (line.intersect(QLineF(points[a], points[(a + 1) % n]), nullptr) == QLineF::BoundedIntersection)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+/// Whether any edges of a and b cross, testing every pair.
+bool overlapsBruteForce(const BetterPolygon &a, const BetterPolygon &b)
+{
+    const QVector<QPointF> &p = a.points();
+    const QVector<QPointF> &q = b.points();
+
+    for (int i = 0; i < p.size(); ++i) {
+        QLineF line(p[i], p[(i + 1) % p.size()]);
+
+        for (int j = 0; j < q.size(); ++j)
+            if (line.intersect(QLineF(q[j], q[(j + 1) % q.size()]), nullptr) == QLineF::BoundedIntersection)
+                return true;
+    }
+
+    return false;
+}
+
+}
+
+
+Benchmarks::Benchmarks(const Options &options)
+    : mOptions(options) {}
+
+QJsonObject Benchmarks::run()
+{
+    QTextStream err(stderr);
+
+    QJsonArray maps;
+    for (int size : mOptions.sizes) {
+        for (SyntheticMaps::Density density : mOptions.densities) {
+            err << "map " << size << "x" << size << " " << SyntheticMaps::densityName(density) << endl;
+            maps.append(benchmarkMap(size, density));
+        }
+    }
+
+    err << "polygons" << endl;
+    QJsonObject polygons = benchmarkPolygons();
+    polygons["predicates"] = benchmarkPolygonPredicates();
+
+    QJsonObject results;
+    results["qtVersion"] = QString(qVersion());
+    results["meshThreads"] = mOptions.meshThreads;
+    results["chunkSize"] = mOptions.chunkSize;
+    results["mergeTopFaces"] = mOptions.mergeTopFaces;
+    results["removeHiddenWalls"] = mOptions.removeHiddenWalls;
+    results["maps"] = maps;
+    results["polygons"] = polygons;
+
+    return results;
+}
+
+QJsonObject Benchmarks::benchmarkMap(int size, SyntheticMaps::Density density)
+{
+    QJsonObject result;
+    result["size"] = size;
+    result["density"] = SyntheticMaps::densityName(density);
+
+    QScopedPointer<TileMap> map(mMaps.makeMap(size, density));
+
+    QElapsedTimer timer;
+
+    /* BEGIN remakeAll */
+    double numTiles = double(size) * size;
+
+    // The first remesh starts with an empty mesh cache.
+    int allocations = M2M::PartialMeshData::bufferAllocations();
+    timer.start();
+
+    Map2Mesh map2Mesh(map.data());
+    map2Mesh.setMeshingThreadCount(mOptions.meshThreads);
+    map2Mesh.setChunkSize(mOptions.chunkSize);
+    map2Mesh.setMergeTopFaces(mOptions.mergeTopFaces);
+    map2Mesh.setRemoveHiddenWalls(mOptions.removeHiddenWalls);
+    map2Mesh.finishSceneUpdate();
+
+    result["remakeAllColdMs"] = toMs(timer.nsecsElapsed());
+    result["cacheAfterCold"] = cacheStatsToJson(map2Mesh.meshCacheStats());
+    result["meshAllocationsPerTileCold"] = (M2M::PartialMeshData::bufferAllocations() - allocations) / numTiles;
+
+    allocations = M2M::PartialMeshData::bufferAllocations();
+
+    QVector<qint64> warmTimes;
+    for (int i = 0; i < mOptions.repeats; ++i) {
+        timer.start();
+
+        map2Mesh.remakeAll();
+        map2Mesh.finishSceneUpdate();
+
+        warmTimes.append(timer.nsecsElapsed());
+    }
+
+    result["remakeAllWarm"] = summarize(warmTimes);
+
+    // With a warm cache, meshing only combines cached tile meshes into chunks.
+    if (mOptions.repeats > 0)
+        result["meshAllocationsPerTileWarm"] = (M2M::PartialMeshData::bufferAllocations() - allocations) / (numTiles * mOptions.repeats);
+    /* END remakeAll */
+
+
+    SharedSimpleTexturedScene scene = map2Mesh.getScene();
+
+    int numObjects = 0;
+    int numTriangles = 0;
+    int numVertices = 0;
+    for (const SimpleTexturedObject &obj : *scene) {
+        numObjects += 1;
+        numTriangles += obj.getTriangles().size();
+        numVertices += obj.getNumVertices();
+    }
+
+    result["objects"] = numObjects;
+    result["triangles"] = numTriangles;
+    result["vertices"] = numVertices;
+
+
+    /* BEGIN vertex packing */
+    // What SimpleTexturedRenderer uploads, without the GL calls.
+    qint64 gpuBytes = 0;
+    timer.start();
+
+    QVector<PackedMesh> packed;
+    for (const SimpleTexturedObject &obj : *scene) {
+        packed.append(PackedMesh::pack(obj));
+        gpuBytes += packed.last().vertices.size() * qint64(sizeof(PackedVertex)) + packed.last().indices.size();
+    }
+
+    result["packMs"] = toMs(timer.nsecsElapsed());
+    result["gpuBytes"] = double(gpuBytes);
+    result["gpuBytesPerVertex"] = numVertices > 0 ? gpuBytes / double(numVertices) : 0.0;
+
+    // Objects that SimpleTexturedRenderer would draw as instances of another object's
+    // mesh. Textures are not compared here.
+    QSet<QByteArray> shapes;
+    int numInstanced = 0;
+    for (const PackedMesh &mesh : packed) {
+        if (shapes.contains(mesh.shapeDigest))
+            numInstanced += 1;
+        else
+            shapes.insert(mesh.shapeDigest);
+    }
+
+    result["instancedObjects"] = numInstanced;
+    /* END vertex packing */
+
+
+    /* BEGIN occlusion culling */
+    // The per-frame work of SimpleTexturedRenderer::cullRenderList(), from cameras at
+    // eye height on empty tiles. The synthetic maps are outdoor maps, for which the
+    // scene has no occluders, so they are taken from the map directly.
+    QVector<BoundingBox> occluders = M2M::MapSnapshot(map.data()).occluders();
+
+    OcclusionCuller culler;
+    culler.setOccluders(occluders);
+
+    QMatrix4x4 projection;
+    projection.perspective(90, 1, 0.1f, 100);
+
+    std::mt19937 cameraRandom(size);
+
+    QVector<qint64> cullTimes;
+    qint64 numTested = 0;
+    qint64 numOutside = 0;
+    qint64 numOccluded = 0;
+    for (int i = 0; i < 64; ++i) {
+        int x = cameraRandom() % size;
+        int y = cameraRandom() % size;
+        if (map->cTileAt(x, y).hasTileTemplate())
+            continue;
+
+        QVector3D eye(x + 0.5f, 1, y + 0.5f);
+        float angle = float(M_PI / 2) * (i % 4);
+
+        QMatrix4x4 mvp = projection;
+        mvp.lookAt(eye, eye + QVector3D(qCos(angle), 0, qSin(angle)), QVector3D(0, 1, 0));
+
+        timer.start();
+
+        ViewFrustum frustum(mvp);
+        culler.render(mvp, eye);
+
+        for (const PackedMesh &mesh : packed) {
+            const BoundingBox &bounds = mesh.bounds;
+
+            if (!frustum.intersects(bounds))
+                numOutside += 1;
+            else if (culler.isOccluded(bounds))
+                numOccluded += 1;
+        }
+
+        cullTimes.append(timer.nsecsElapsed());
+        numTested += packed.size();
+    }
+
+    result["occluders"] = occluders.size();
+    result["cullFrame"] = summarize(cullTimes);
+    result["culledOutsideFraction"] = numTested > 0 ? numOutside / double(numTested) : 0.0;
+    result["culledOccludedFraction"] = numTested > 0 ? numOccluded / double(numTested) : 0.0;
+    /* END occlusion culling */
+
+
+    /* BEGIN single-tile edits */
+    std::mt19937 random(size);
+
+    QVector<qint64> editTimes;
+    for (int i = 0; i < mOptions.singleTileEdits; ++i) {
+        int x = random() % size;
+        int y = random() % size;
+
+        TileTemplate *newTemplate = map->cTileAt(x, y).hasTileTemplate() ? nullptr : mMaps.blockTemplate();
+
+        timer.start();
+
+        map->setTile(x, y, newTemplate);
+        map2Mesh.finishSceneUpdate();
+
+        editTimes.append(timer.nsecsElapsed());
+    }
+
+    result["singleTileEdit"] = summarize(editTimes);
+    /* END single-tile edits */
+
+    result["cache"] = cacheStatsToJson(map2Mesh.meshCacheStats());
+
+
+    /* BEGIN OBJ export */
+    if (mOptions.timeSave) {
+        QTemporaryDir dir;
+        QString path = dir.filePath("benchmark.obj");
+
+        timer.start();
+
+        SharedOBJModel obj = scene->exportOBJ();
+        obj->save(path);
+
+        result["objSaveMs"] = toMs(timer.nsecsElapsed());
+        result["objBytes"] = double(QFileInfo(path).size());
+    }
+    /* END OBJ export */
+
+    return result;
+}
+
+QJsonObject Benchmarks::benchmarkPolygons()
+{
+    // The same shapes as a ground tile next to a thin wall.
+    BetterPolygon tile({QPointF(0, 0), QPointF(0, 1), QPointF(1, 1), QPointF(1, 0)});
+    BetterPolygon wall({QPointF(0.65, 0.35), QPointF(0.35, 0.35), QPointF(0.35, 0.65), QPointF(0.65, 0.65)});
+    BetterPolygon diagonal({QPointF(-0.2, 0.5), QPointF(0.5, 1.2), QPointF(1.2, 0.5), QPointF(0.5, -0.2)});
+    BetterPolygon circle = regularPolygon(QPointF(0.5, 0.5), 0.5, 32);
+    BetterPolygon comb = combPolygon(16);
+
+    QVector<BetterPolygon> ground = tile.subtract(wall);
+
+    QElapsedTimer timer;
+    int iterations = qMax(1, mOptions.polygonIterations);
+    int sink = 0;
+
+    // The chord-splitting reference is far slower, so it runs fewer times.
+    int referenceIterations = qMax(1, iterations / 100);
+
+    auto nsPerOp = [&timer] (int count) {
+        return double(timer.nsecsElapsed()) / count;
+    };
+
+    QJsonObject result;
+    result["iterations"] = iterations;
+    result["referenceIterations"] = referenceIterations;
+
+    timer.start();
+    for (int i = 0; i < iterations; ++i)
+        sink += tile.subtract(wall).size();
+    result["subtractSquareNs"] = nsPerOp(iterations);
+
+    timer.start();
+    for (int i = 0; i < iterations; ++i)
+        sink += tile.subtract(diagonal).size();
+    result["subtractDiagonalNs"] = nsPerOp(iterations);
+
+    /* BEGIN triangulation */
+    timer.start();
+    for (int i = 0; i < iterations; ++i)
+        for (const BetterPolygon &p : ground)
+            sink += p.triangulate().size();
+    result["triangulateGroundNs"] = nsPerOp(iterations);
+
+    timer.start();
+    for (int i = 0; i < referenceIterations; ++i)
+        for (const BetterPolygon &p : ground)
+            sink += triangulateByChords(p).size();
+    result["triangulateGroundChordsNs"] = nsPerOp(referenceIterations);
+
+    // The ground as a single polygon with a hole, which the old code could not triangulate.
+    QVector<QVector<QPointF>> holes = {wall.points()};
+
+    timer.start();
+    for (int i = 0; i < iterations; ++i)
+        sink += Triangulator::triangulate(tile.points(), holes).size();
+    result["triangulateGroundWithHoleNs"] = nsPerOp(iterations);
+
+    timer.start();
+    for (int i = 0; i < iterations; ++i)
+        sink += circle.triangulate().size();
+    result["triangulate32gonNs"] = nsPerOp(iterations);
+
+    timer.start();
+    for (int i = 0; i < referenceIterations; ++i)
+        sink += triangulateByChords(circle).size();
+    result["triangulate32gonChordsNs"] = nsPerOp(referenceIterations);
+
+    timer.start();
+    for (int i = 0; i < iterations; ++i)
+        sink += comb.triangulate().size();
+    result["triangulateCombNs"] = nsPerOp(iterations);
+
+    timer.start();
+    for (int i = 0; i < referenceIterations; ++i)
+        sink += triangulateByChords(comb).size();
+    result["triangulateCombChordsNs"] = nsPerOp(referenceIterations);
+    /* END triangulation */
+
+    // Keeps the loops from being optimized away.
+    result["checksum"] = sink;
+
+    return result;
+}
+
+QJsonArray Benchmarks::benchmarkPolygonPredicates()
+{
+    QJsonArray results;
+
+    for (int numPoints : {4, 8, 16, 32, 64, 128, 250, 500}) {
+        BetterPolygon star = starPolygon(QPointF(0.5, 0.5), 0.5, numPoints);
+
+        // A smaller copy inside the star, so that overlaps() has to look at every edge.
+        BetterPolygon inner = starPolygon(QPointF(0.5, 0.5), 0.2, numPoints);
+
+        // Keep the total work roughly the same for every size.
+        int iterations = qMax(1, mOptions.polygonIterations * 4 / numPoints);
+        int sink = 0;
+
+        QElapsedTimer timer;
+        auto nsPerOp = [&timer, iterations] () {
+            return double(timer.nsecsElapsed()) / iterations;
+        };
+
+        QJsonObject result;
+        result["points"] = numPoints;
+        result["iterations"] = iterations;
+
+        timer.start();
+        for (int i = 0; i < iterations; ++i)
+            sink += star.isValid();
+        result["isValidNs"] = nsPerOp();
+
+        timer.start();
+        for (int i = 0; i < iterations; ++i)
+            sink += edgesCrossBruteForce(star);
+        result["edgesCrossBruteForceNs"] = nsPerOp();
+
+        timer.start();
+        for (int i = 0; i < iterations; ++i)
+            sink += star.overlaps(inner);
+        result["overlapsNs"] = nsPerOp();
+
+        timer.start();
+        for (int i = 0; i < iterations; ++i)
+            sink += overlapsBruteForce(star, inner);
+        result["overlapsBruteForceNs"] = nsPerOp();
+
+        // A chord between two inner points of the star, which is clear.
+        timer.start();
+        for (int i = 0; i < iterations; ++i)
+            sink += star.chordIsClear(1, 3);
+        result["chordIsClearNs"] = nsPerOp();
+
+        // Keeps the loops from being optimized away.
+        result["checksum"] = sink;
+
+        results.append(result);
+    }
+
+    return results;
+}
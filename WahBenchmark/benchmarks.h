@@ -0,0 +1,80 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <QVector>
+#include <QJsonArray>
+#include <QJsonObject>
+
+#include "syntheticmaps.h"
+
+/**
+ * @brief Times map-to-mesh conversion and the polygon operations it relies on.
+ *
+ * All times are wall-clock times reported in milliseconds (or nanoseconds per
+ * operation for the polygon micro-benchmarks).
+ */
+class Benchmarks
+{
+public:
+    struct Options {
+        /// Side lengths of the synthetic maps.
+        QVector<int> sizes;
+        QVector<SyntheticMaps::Density> densities;
+
+        /// How many times each full remesh is repeated after the first one.
+        int repeats;
+
+        /// How many single-tile edits are timed per map.
+        int singleTileEdits;
+
+        /// How many times each polygon operation is repeated.
+        int polygonIterations;
+
+        int meshThreads;
+        int chunkSize;
+
+        /// Passed to Map2Mesh::setMergeTopFaces().
+        bool mergeTopFaces;
+
+        /// Passed to Map2Mesh::setRemoveHiddenWalls().
+        bool removeHiddenWalls;
+
+        /// Whether to time OBJModel::save().
+        bool timeSave;
+    };
+
+    explicit Benchmarks(const Options &options);
+
+    /**
+     * @brief Runs all benchmarks and returns the results. Progress is printed to stderr.
+     */
+    QJsonObject run();
+
+    /**
+     * @brief Times Map2Mesh::remakeAll(), vertex packing, single-tile edits and OBJ export
+     * on one map, and counts the mesh buffer allocations per tile during remakeAll() and
+     * the bytes that the renderer would upload. Also times frustum and occlusion culling
+     * of the map's objects from cameras inside the map.
+     */
+    QJsonObject benchmarkMap(int size, SyntheticMaps::Density density);
+
+    /**
+     * @brief Times BetterPolygon::subtract() and triangulate() on shapes that
+     * the meshers produce. Triangulation is compared against the old recursive
+     * chord-splitting implementation.
+     */
+    QJsonObject benchmarkPolygons();
+
+    /**
+     * @brief Times BetterPolygon::isValid(), overlaps() and chordIsClear() on
+     * polygons with 4 to 500 points, next to testing every pair of edges.
+     */
+    QJsonArray benchmarkPolygonPredicates();
+
+private:
+    Options mOptions;
+
+    SyntheticMaps mMaps;
+};
+
+#endif // BENCHMARKS_H
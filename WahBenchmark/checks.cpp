@@ -0,0 +1,792 @@
+#include "checks.h"
+
+#include <QPair>
+#include <QScopedPointer>
+#include <QStringList>
+
+#include "blockymeshertables.h"
+#include "blockypolygontilemesher.h"
+#include "groundblockypolygontilemesher.h"
+#include "map2mesh.h"
+#include "m2mmapsnapshot.h"
+#include "m2mtilemesher.h"
+#include "polygonclipper.h"
+#include "simpletexturedrenderer.h"
+#include "simpletexturedscene.h"
+#include "tilemap.h"
+#include "tiletemplateset.h"
+
+using namespace M2M;
+
+
+namespace {
+
+/* BEGIN legacy blocky mesher decisions */
+// The decisions of the blocky meshers before they used BlockyTables, copied
+// unchanged apart from being split into functions. The parameters are named
+// like the meshers' member so that the bodies stay the same.
+
+/// first is the inner diagonal, second is the outer diagonal
+void legacyLeftDiagonals(const TileNeighborhoodInfo &mTileNeighborhood,
+                         QPair<bool, bool> &topLeft, QPair<bool, bool> &bottomLeft)
+{
+    if (mTileNeighborhood(-1, 0) != nullptr
+            && mTileNeighborhood(-1, 0)->hasTileTemplate()
+            && mTileNeighborhood(-1, 0)->connectDiagonals()) {
+        if (mTileNeighborhood(0, -1) != nullptr
+                && mTileNeighborhood(0, -1)->tileTemplate() == mTileNeighborhood(-1, 0)->tileTemplate()) {
+            //Left and Top have the same tile template
+            //Now check if the inner diagonal should be made;
+
+            bool botDiff = mTileNeighborhood(0, 1) == nullptr
+                    || mTileNeighborhood(0, 1)->tileTemplate() != mTileNeighborhood(-1, 0)->tileTemplate();
+            bool rightDiff = mTileNeighborhood(1, 0) == nullptr
+                    || mTileNeighborhood(1, 0)->tileTemplate() != mTileNeighborhood(-1, 0)->tileTemplate();
+
+            if (botDiff && rightDiff)
+                topLeft.first = true;
+
+            //Now see if the outer diagonal should be made;
+
+            bool farTopDiff = mTileNeighborhood(-1, -2) == nullptr
+                    || mTileNeighborhood(-1, -2)->tileTemplate() != mTileNeighborhood(-1, 0)->tileTemplate();
+            bool farLeftDiff = mTileNeighborhood(-2, -1) == nullptr
+                    || mTileNeighborhood(-2, -1)->tileTemplate() != mTileNeighborhood(-1, 0)->tileTemplate();
+            bool centerClear = mTileNeighborhood(-1, -1) == nullptr
+                    || !mTileNeighborhood(-1, -1)->hasTileTemplate();
+
+            if (farTopDiff && farLeftDiff && centerClear)
+                topLeft.second = true;
+        }
+
+        if (!topLeft.first && !topLeft.second
+                && mTileNeighborhood(0, 1) != nullptr
+                && mTileNeighborhood(0, 1)->tileTemplate() == mTileNeighborhood(-1, 0)->tileTemplate()) {
+            //Left and top did not connect a diagonal
+            //Try between Left and Bottom
+
+            bool topDiff = mTileNeighborhood(0, -1) == nullptr
+                    || mTileNeighborhood(0, -1)->tileTemplate() != mTileNeighborhood(-1, 0)->tileTemplate();
+            bool rightDiff = mTileNeighborhood(1, 0) == nullptr
+                    || mTileNeighborhood(1, 0)->tileTemplate() != mTileNeighborhood(-1, 0)->tileTemplate();
+
+            if (topDiff && rightDiff)
+                bottomLeft.first = true;
+
+            //Now see if outer diagonal should be made
+
+            bool farBottomDiff = mTileNeighborhood(-1, 2) == nullptr
+                    || mTileNeighborhood(-1, 2)->tileTemplate() != mTileNeighborhood(-1, 0)->tileTemplate();
+            bool farLeftDiff = mTileNeighborhood(-2, 1) == nullptr
+                    || mTileNeighborhood(-2, 1)->tileTemplate() != mTileNeighborhood(-1, 0)->tileTemplate();
+            bool centerClear = mTileNeighborhood(-1, 1) == nullptr
+                    || !mTileNeighborhood(-1, 1)->hasTileTemplate();
+
+            if (farBottomDiff && farLeftDiff && centerClear)
+                bottomLeft.second = true;
+        }
+    }
+}
+
+void legacyRightDiagonals(const TileNeighborhoodInfo &mTileNeighborhood,
+                          QPair<bool, bool> topLeft, QPair<bool, bool> bottomLeft,
+                          QPair<bool, bool> &topRight, QPair<bool, bool> &bottomRight)
+{
+    if (mTileNeighborhood(1, 0) != nullptr
+            && mTileNeighborhood(1, 0)->hasTileTemplate()
+            && mTileNeighborhood(1, 0)->connectDiagonals()) {
+        if (!topLeft.first && !topLeft.second
+                && mTileNeighborhood(0, -1) != nullptr
+                && mTileNeighborhood(0, -1)->tileTemplate() == mTileNeighborhood(1, 0)->tileTemplate()) {
+            //Right and top have the same template
+            //Now check if the inner diagonal should be made
+
+            bool botDiff = mTileNeighborhood(0, 1) == nullptr
+                    || mTileNeighborhood(0, 1)->tileTemplate() != mTileNeighborhood(1, 0)->tileTemplate();
+            bool leftDiff = mTileNeighborhood(-1, 0) == nullptr
+                    || mTileNeighborhood(-1, 0)->tileTemplate() != mTileNeighborhood(1, 0)->tileTemplate();
+
+            if (botDiff && leftDiff)
+                topRight.first = true;
+
+            //Now see if outer diagonal should be made
+
+            bool farTopDiff = mTileNeighborhood(1, -2) == nullptr
+                    || mTileNeighborhood(1, -2)->tileTemplate() != mTileNeighborhood(1, 0)->tileTemplate();
+            bool farRightDiff = mTileNeighborhood(2, -1) == nullptr
+                    || mTileNeighborhood(2, -1)->tileTemplate() != mTileNeighborhood(1, 0)->tileTemplate();
+            bool centerClear = mTileNeighborhood(1, -1) == nullptr
+                    || !mTileNeighborhood(1, -1)->hasTileTemplate();
+
+            if (farTopDiff && farRightDiff && centerClear)
+                topRight.second = true;
+        }
+
+        if (!bottomLeft.first && !bottomLeft.second && !topRight.first && !topRight.second
+                && mTileNeighborhood(0, 1) != nullptr
+                && mTileNeighborhood(0, 1)->tileTemplate() == mTileNeighborhood(1, 0)->tileTemplate()) {
+            //Right and bottom have same template, and no other diagonal conflicts
+            //Now check if the inner diagonal should be made
+
+            bool topDiff = mTileNeighborhood(0, -1) == nullptr
+                    || mTileNeighborhood(0, -1)->tileTemplate() != mTileNeighborhood(1, 0)->tileTemplate();
+            bool leftDiff = mTileNeighborhood(-1, 0) == nullptr
+                    || mTileNeighborhood(-1, 0)->tileTemplate() != mTileNeighborhood(1, 0)->tileTemplate();
+
+            if (topDiff && leftDiff)
+                bottomRight.first = true;
+
+            //Now see if the outer diagonal should be made
+
+            bool farBottomDiff = mTileNeighborhood(1, 2) == nullptr
+                    || mTileNeighborhood(1, 2)->tileTemplate() != mTileNeighborhood(1, 0)->tileTemplate();
+            bool farLeftDiff = mTileNeighborhood(2, 1) == nullptr
+                    || mTileNeighborhood(2, 1)->tileTemplate() != mTileNeighborhood(1, 0)->tileTemplate();
+            bool centerClear = mTileNeighborhood(1, 1) == nullptr
+                    || !mTileNeighborhood(1, 1)->hasTileTemplate();
+
+            if (farBottomDiff && farLeftDiff && centerClear)
+                bottomRight.second = true;
+        }
+    }
+}
+
+//0 NO
+//1 Left
+//2 Right
+int shouldDiagonal(const TileInfo *me, const TileInfo *center, const TileInfo *far, const TileInfo *left, const TileInfo *right)
+{
+    if (center != nullptr && center->hasTileTemplate()) return false;
+
+    if (far == nullptr || far->tileTemplate() != me->tileTemplate()) {
+        //If the tile two cells in front of this is on the same template type, a diagonal wont be made
+
+        if (left != nullptr
+                && left->tileTemplate() == me->tileTemplate()
+                && (right == nullptr || right->tileTemplate() != me->tileTemplate()))
+            return 1;
+
+        if (right != nullptr
+                && right->tileTemplate() == me->tileTemplate()
+                && (left == nullptr || left->tileTemplate() != me->tileTemplate()))
+            return 2;
+    }
+
+    return 0;
+}
+
+/// The tiles that shouldDiagonal() was given for north, west, south and east.
+const QPoint LegacyCenters[4] = { QPoint(0, -1), QPoint(-1, 0), QPoint(0, 1), QPoint(1, 0) };
+const QPoint LegacyFars[4] = { QPoint(0, -2), QPoint(-2, 0), QPoint(0, 2), QPoint(2, 0) };
+const QPoint LegacyLefts[4] = { QPoint(-1, -1), QPoint(-1, 1), QPoint(1, 1), QPoint(1, -1) };
+const QPoint LegacyRights[4] = { QPoint(1, -1), QPoint(-1, -1), QPoint(-1, 1), QPoint(1, 1) };
+
+int legacyBlockDiagonal(const TileNeighborhoodInfo &mTileNeighborhood, int direction, bool topWallDrops)
+{
+    const TileInfo *me = mTileNeighborhood.centerTile();
+
+    const TileInfo *far = mTileNeighborhood(LegacyFars[direction]);
+    const TileInfo *cent = mTileNeighborhood(LegacyCenters[direction]);
+    const TileInfo *left = mTileNeighborhood(LegacyLefts[direction]);
+    const TileInfo *right = mTileNeighborhood(LegacyRights[direction]);
+
+    return topWallDrops? shouldDiagonal(me, cent, far, left, right) : 0;
+}
+/* END legacy blocky mesher decisions */
+
+
+/// Converts the legacy (inner, outer) pairs of one side to BlockyTables::GroundDiagonals.
+quint8 toGroundDiagonals(QPair<bool, bool> top, QPair<bool, bool> bottom)
+{
+    using namespace BlockyTables;
+
+    return (top.first ? TopInner : 0) | (top.second ? TopOuter : 0)
+            | (bottom.first ? BottomInner : 0) | (bottom.second ? BottomOuter : 0);
+}
+
+/// A triangle with its corners given in grid units.
+PolygonClipper::Polygon gridTriangle(int ax, int ay, int bx, int by, int cx, int cy)
+{
+    qreal s = PolygonClipper::Scale;
+    return PolygonClipper::Polygon({QPointF(ax / s, ay / s), QPointF(bx / s, by / s), QPointF(cx / s, cy / s)});
+}
+
+QVector<PolygonClipper::Polygon> scaled(const QVector<PolygonClipper::Polygon> &polygons, qreal factor)
+{
+    QVector<PolygonClipper::Polygon> result;
+    for (const PolygonClipper::Polygon &polygon : polygons) {
+        PolygonClipper::Polygon p;
+        for (const QPointF &q : polygon.outer)
+            p.outer.append(q * factor);
+        for (const QVector<QPointF> &hole : polygon.holes) {
+            p.holes.append(QVector<QPointF>());
+            for (const QPointF &q : hole)
+                p.holes.last().append(q * factor);
+        }
+        result.append(p);
+    }
+
+    return result;
+}
+
+qreal ringArea(const QVector<QPointF> &ring)
+{
+    qreal area2 = 0;
+    for (int i = 0; i < ring.size(); ++i) {
+        const QPointF &a = ring[i];
+        const QPointF &b = ring[(i + 1) % ring.size()];
+        area2 += a.x() * b.y() - a.y() * b.x();
+    }
+
+    return qAbs(area2) / 2;
+}
+
+qreal totalArea(const QVector<PolygonClipper::Polygon> &polygons)
+{
+    qreal area = 0;
+    for (const PolygonClipper::Polygon &polygon : polygons) {
+        area += ringArea(polygon.outer);
+        for (const QVector<QPointF> &hole : polygon.holes)
+            area -= ringArea(hole);
+    }
+
+    return area;
+}
+
+bool sameBoxes(const QVector<BoundingBox> &a, const QVector<BoundingBox> &b)
+{
+    if (a.size() != b.size())
+        return false;
+
+    for (int i = 0; i < a.size(); ++i) {
+        if (a[i].min != b[i].min || a[i].max != b[i].max)
+            return false;
+    }
+
+    return true;
+}
+
+/// Describes every triangle of a scene by its vertices' attributes, rounded so that
+/// meshes made in different places compare equal, in sorted order. Objects may be
+/// split or ordered differently between scenes, so they are not told apart.
+QStringList sceneTriangles(const SimpleTexturedScene &scene)
+{
+    auto round = [] (float value) { return QString::number(qRound(value * 1024)); };
+
+    QStringList triangles;
+
+    for (const QSharedPointer<SimpleTexturedObject> &object : scene.objects()) {
+        const QVector<QVector3D> &vertices = object->getVertices();
+        const QVector<QVector3D> &normals = object->getVertexNormals();
+        const QVector<QVector2D> &texCoords = object->getVertexTexCoords();
+        const QVector<quint16> &materials = object->getVertexMaterials();
+
+        auto vertex = [&] (unsigned int v) {
+            return QStringList({round(vertices[v].x()), round(vertices[v].y()), round(vertices[v].z()),
+                                round(normals[v].x()), round(normals[v].y()), round(normals[v].z()),
+                                round(texCoords[v].x()), round(texCoords[v].y()),
+                                QString::number(materials[v])}).join(' ');
+        };
+
+        for (const SimpleTexturedObject::Triangle &tri : object->getTriangles())
+            triangles.append(vertex(tri.getFirst()) + " | " + vertex(tri.getSecond()) + " | " + vertex(tri.getThird()));
+    }
+
+    triangles.sort();
+    return triangles;
+}
+
+/// The tiles of a map that the checks fill in. Map coordinates are relative to center.
+class CheckMap
+{
+public:
+    explicit CheckMap(QPoint center)
+        : mMap(QSize(2 * center.x() + 1, 2 * center.y() + 1), false, false)
+        , mCenter(center) {}
+
+    void setTile(QPoint offset, TileTemplate *tileTemplate)
+    {
+        mMap.setTile(mCenter.x() + offset.x(), mCenter.y() + offset.y(), tileTemplate);
+    }
+
+    void clear()
+    {
+        for (int x = 0; x < mMap.mapSize().width(); ++x)
+            for (int y = 0; y < mMap.mapSize().height(); ++y)
+                mMap.clearTile(x, y);
+    }
+
+    /// Takes a snapshot of the map, which the neighborhood refers to.
+    TileNeighborhoodInfo neighborhood()
+    {
+        mSnapshot = MapSnapshot(&mMap);
+        return TileNeighborhoodInfo(&mSnapshot, mCenter);
+    }
+
+private:
+    TileMap mMap;
+    QPoint mCenter;
+    MapSnapshot mSnapshot;
+};
+
+}
+
+
+Checks::Checks()
+    : mErr(stderr) {}
+
+int Checks::run()
+{
+    int failures = 0;
+
+    mErr << "scene transactions" << endl;
+    failures += checkSceneTransactions();
+
+    mErr << "ground diagonal table" << endl;
+    failures += checkGroundDiagonalTable();
+
+    mErr << "block diagonal table" << endl;
+    failures += checkBlockDiagonalTable();
+
+    mErr << "polygon clipper rounding" << endl;
+    failures += checkPolygonClipperRounding();
+
+    mErr << "indoor occluders" << endl;
+    failures += checkIndoorOccluders();
+
+    mErr << "incremental remeshing" << endl;
+    failures += checkIncrementalRemeshing();
+
+    mErr << "remesh estimate" << endl;
+    failures += checkRemeshEstimate();
+
+    return failures;
+}
+
+int Checks::checkSceneTransactions()
+{
+    const QString check = "scene transactions";
+    int failures = 0;
+
+    SharedSimpleTexturedScene scene = SimpleTexturedScene::makeScene();
+
+    SimpleTexturedScene::Delta delta;
+    QObject::connect(scene.get(), &SimpleTexturedScene::deltaCommitted,
+                     [&delta] (const SimpleTexturedScene::Delta &committed) { delta = committed; });
+
+    auto makeObject = [] () { return QSharedPointer<SimpleTexturedObject>::create(); };
+
+    SlotHandle kept = scene->addObject(makeObject());
+    SlotHandle replaced = scene->addObject(makeObject());
+    SlotHandle removed = scene->addObject(makeObject());
+
+    // The scene hands the freed slot straight to the next added object. The other
+    // object gets a new slot.
+    scene->beginTransaction();
+    scene->removeObject(replaced);
+    SlotHandle added = scene->addObject(makeObject());
+    SlotHandle appended = scene->addObject(makeObject());
+    scene->removeObject(removed);
+    scene->commitTransaction();
+
+    if (added.index != replaced.index || added.generation == replaced.generation)
+        failures += fail(check, "the added object does not reuse the removed object's slot");
+
+    if (delta.added != QVector<SlotHandle>({added, appended}) || delta.removed != QVector<SlotHandle>({replaced, removed}))
+        failures += fail(check, "the delta does not hold exactly the changed objects");
+
+    if (!scene->objects().contains(kept) || scene->objects().contains(replaced) || scene->objects().size() != 3)
+        failures += fail(check, "the scene does not hold the expected objects");
+
+    QVector<SimpleTexturedRenderer::PendingChange> changes = SimpleTexturedRenderer::orderDelta(delta);
+
+    auto position = [&changes] (SlotHandle handle, bool removal) {
+        for (int i = 0; i < changes.size(); ++i) {
+            if (changes[i].handle == handle && changes[i].removal == removal)
+                return i;
+        }
+        return -1;
+    };
+
+    int replacedAt = position(replaced, true);
+    int addedAt = position(added, false);
+    int removedAt = position(removed, true);
+    int appendedAt = position(appended, false);
+
+    if (changes.size() != 4 || replacedAt < 0 || addedAt < 0 || removedAt < 0 || appendedAt < 0)
+        failures += fail(check, "the renderer does not queue every change exactly once");
+    else if (replacedAt > addedAt)
+        failures += fail(check, "the renderer queues an addition before the removal from the same slot");
+    else if (removedAt < appendedAt)
+        failures += fail(check, "the renderer queues a removal before an addition into another slot");
+
+    return failures;
+}
+
+int Checks::checkGroundDiagonalTable()
+{
+    using namespace BlockyTables;
+
+    const QString check = "ground diagonal table";
+    int failures = 0;
+
+    TileTemplateSet templates("Check Templates");
+
+    // The side's template, another template that connects diagonals, and one that does not.
+    TileTemplate *wall = new TileTemplate(Qt::darkGray, "Wall", 1.5, 0.3);
+    wall->setConnectDiagonals(true);
+    TileTemplate *otherWall = new TileTemplate(Qt::gray, "Other Wall", 1.5, 0.3);
+    otherWall->setConnectDiagonals(true);
+    TileTemplate *block = new TileTemplate(Qt::lightGray, "Block", 2, 1);
+
+    templates.addTileTemplate(wall, true);
+    templates.addTileTemplate(otherWall, true);
+    templates.addTileTemplate(block, true);
+
+    CheckMap map(QPoint(2, 2));
+
+    // Offsets for the left side, like in GroundSideFact, and the fact of each.
+    const QPair<QPoint, int> sameFacts[] = {
+        {QPoint(0, -1), TopSame},
+        {QPoint(0, 1), BottomSame},
+        {QPoint(1, 0), OppositeSame},
+        {QPoint(-1, -2), FarTopSame},
+        {QPoint(-2, -1), FarTopOutsideSame},
+        {QPoint(-1, 2), FarBottomSame},
+        {QPoint(-2, 1), FarBottomOutsideSame}
+    };
+    const QPair<QPoint, int> clearFacts[] = {
+        {QPoint(-1, -1), TopCornerClear},
+        {QPoint(-1, 1), BottomCornerClear}
+    };
+
+    // Tiles that differ from the side are ground in the first pass and of another
+    // template in the second.
+    for (int pass = 0; pass < 2; ++pass) {
+        TileTemplate *different = pass == 0 ? nullptr : otherWall;
+        TileTemplate *filled = pass == 0 ? otherWall : wall;
+        TileTemplate *notConnecting = pass == 0 ? nullptr : block;
+
+        for (int side = 0; side < 2; ++side) {
+            int mirror = side == 0 ? 1 : -1;
+            auto mirrored = [mirror] (QPoint p) { return QPoint(mirror * p.x(), p.y()); };
+
+            // Only the right side has the facts about the left side's diagonals.
+            int numFacts = side == 0 ? TopTaken : 1 << NumGroundSideFacts;
+
+            for (int facts = 0; facts < numFacts; ++facts) {
+                map.clear();
+
+                map.setTile(mirrored(QPoint(-1, 0)), facts & SideConnects ? wall : notConnecting);
+
+                for (const QPair<QPoint, int> &fact : sameFacts)
+                    map.setTile(mirrored(fact.first), facts & fact.second ? wall : different);
+
+                for (const QPair<QPoint, int> &fact : clearFacts)
+                    map.setTile(mirrored(fact.first), facts & fact.second ? nullptr : filled);
+
+                TileNeighborhoodInfo nbhd = map.neighborhood();
+
+                QPair<bool, bool> top(false, false);
+                QPair<bool, bool> bottom(false, false);
+                quint8 leftDiagonals = 0;
+
+                if (side == 0) {
+                    legacyLeftDiagonals(nbhd, top, bottom);
+                } else {
+                    // The left side's diagonals are only told apart by top and bottom.
+                    QPair<bool, bool> topLeft(bool(facts & TopTaken), false);
+                    QPair<bool, bool> bottomLeft(bool(facts & BottomTaken), false);
+                    leftDiagonals = toGroundDiagonals(topLeft, bottomLeft);
+
+                    legacyRightDiagonals(nbhd, topLeft, bottomLeft, top, bottom);
+                }
+
+                quint8 expected = toGroundDiagonals(top, bottom);
+                quint8 actual = GroundBlockyPolygonTileMesher::sideDiagonals(nbhd, side, leftDiagonals);
+                quint8 tabulated = facts & SideConnects ? GroundSideTable[facts] : 0;
+
+                if (actual != expected || tabulated != expected) {
+                    failures += fail(check, QString("side %1, facts %2, pass %3: expected %4, got %5 (table %6)")
+                                     .arg(side).arg(facts).arg(pass).arg(int(expected)).arg(int(actual)).arg(int(tabulated)));
+                }
+
+                // Both sides together, as GroundBlockyPolygonTileMesher::topPolygons() asks them.
+                QPair<bool, bool> topLeft(false, false);
+                QPair<bool, bool> bottomLeft(false, false);
+                QPair<bool, bool> topRight(false, false);
+                QPair<bool, bool> bottomRight(false, false);
+                legacyLeftDiagonals(nbhd, topLeft, bottomLeft);
+                legacyRightDiagonals(nbhd, topLeft, bottomLeft, topRight, bottomRight);
+
+                quint8 left = GroundBlockyPolygonTileMesher::sideDiagonals(nbhd, 0, 0);
+                quint8 right = GroundBlockyPolygonTileMesher::sideDiagonals(nbhd, 1, left);
+
+                if (left != toGroundDiagonals(topLeft, bottomLeft) || right != toGroundDiagonals(topRight, bottomRight)) {
+                    failures += fail(check, QString("both sides, side %1, facts %2, pass %3: the sides disagree")
+                                     .arg(side).arg(facts).arg(pass));
+                }
+            }
+        }
+    }
+
+    return failures;
+}
+
+int Checks::checkBlockDiagonalTable()
+{
+    using namespace BlockyTables;
+
+    const QString check = "block diagonal table";
+    int failures = 0;
+
+    TileTemplateSet templates("Check Templates");
+
+    TileTemplate *wall = new TileTemplate(Qt::darkGray, "Wall", 1.5, 0.3);
+    wall->setConnectDiagonals(true);
+    TileTemplate *otherWall = new TileTemplate(Qt::gray, "Other Wall", 1.5, 0.3);
+    otherWall->setConnectDiagonals(true);
+
+    templates.addTileTemplate(wall, true);
+    templates.addTileTemplate(otherWall, true);
+
+    CheckMap map(QPoint(2, 2));
+
+    for (int pass = 0; pass < 2; ++pass) {
+        TileTemplate *different = pass == 0 ? nullptr : otherWall;
+        TileTemplate *filled = pass == 0 ? otherWall : wall;
+
+        for (int direction = 0; direction < 4; ++direction) {
+            for (int facts = 0; facts < 1 << NumBlockDirectionFacts; ++facts) {
+                map.clear();
+
+                map.setTile(QPoint(0, 0), wall);
+                map.setTile(LegacyCenters[direction], facts & FrontFilled ? filled : nullptr);
+                map.setTile(LegacyFars[direction], facts & FarSame ? wall : different);
+                map.setTile(LegacyLefts[direction], facts & LeftSame ? wall : different);
+                map.setTile(LegacyRights[direction], facts & RightSame ? wall : different);
+
+                TileNeighborhoodInfo nbhd = map.neighborhood();
+                bool bridged = facts & Bridged;
+
+                int expected = legacyBlockDiagonal(nbhd, direction, !bridged);
+                int actual = BlockyPolygonTileMesher::directionDiagonal(nbhd, direction, bridged);
+                int tabulated = BlockDirectionTable[facts];
+
+                if (actual != expected || tabulated != expected) {
+                    failures += fail(check, QString("direction %1, facts %2, pass %3: expected %4, got %5 (table %6)")
+                                     .arg(direction).arg(facts).arg(pass).arg(expected).arg(actual).arg(tabulated));
+                }
+            }
+        }
+    }
+
+    return failures;
+}
+
+int Checks::checkPolygonClipperRounding()
+{
+    using namespace PolygonClipper;
+
+    const QString check = "polygon clipper rounding";
+    int failures = 0;
+
+    struct Case {
+        const char *name;
+        QVector<Polygon> subject;
+        QVector<Polygon> clipPolygons;
+    };
+
+    const QVector<Case> cases = {
+        // A boundary ended at a point where no edge of the result started, which
+        // indexed past the vertices.
+        {"dangling end",
+         {gridTriangle(1, 1, 1, 0, 3, 2)},
+         {gridTriangle(2, 1, 0, 0, 2, 1), gridTriangle(0, 0, 2, 2, 1, 0)}},
+
+        // The only boundary of the result did not close, and was dropped.
+        {"open boundary",
+         {gridTriangle(6, 1, 3, 1, 7, 3), gridTriangle(7, 5, 0, 1, 1, 5)},
+         {gridTriangle(3, 8, 2, 8, 9, 0), gridTriangle(0, 0, 1, 8, 9, 6)}}
+    };
+
+    // Scaled up this much, the inputs are far from the grid's resolution.
+    const qreal factor = 4096;
+
+    // Each rounded crossing may move the boundary by about one grid unit.
+    const qreal tolerance = 16.0 / (Scale * Scale);
+
+    for (const Case &c : cases) {
+        bool repaired;
+        QVector<Polygon> result = clip(Operation::Union, c.subject, c.clipPolygons, &repaired);
+        QVector<Polygon> reference = clip(Operation::Union, scaled(c.subject, factor), scaled(c.clipPolygons, factor));
+
+        qreal area = totalArea(result);
+        qreal expected = totalArea(reference) / (factor * factor);
+
+        if (qAbs(area - expected) > tolerance) {
+            failures += fail(check, QString("%1: area %2 grid units squared, expected %3%4")
+                             .arg(c.name).arg(area * Scale * Scale).arg(expected * Scale * Scale)
+                             .arg(repaired ? " (repaired)" : ""));
+        }
+    }
+
+    return failures;
+}
+
+int Checks::checkIndoorOccluders()
+{
+    const QString check = "indoor occluders";
+    int failures = 0;
+
+    TileTemplateSet templates("Check Templates");
+
+    TileTemplate *wall = new TileTemplate(Qt::darkGray, "Wall", 1.5, 0.3);
+    wall->setBridgeTiles(true);
+    templates.addTileTemplate(wall, true);
+
+    // Several chunks, with walls that cross chunk borders.
+    TileMap map(QSize(40, 40), false, false);
+    for (int i = 0; i < 40; ++i) {
+        map.setTile(i, 20, wall);
+        map.setTile(20, i, wall);
+        map.setTile(i, i, wall);
+    }
+
+    Map2Mesh map2Mesh(&map);
+    map2Mesh.finishSceneUpdate();
+
+    SharedSimpleTexturedScene scene = map2Mesh.getScene();
+
+    if (!scene->occluders().isEmpty())
+        failures += fail(check, "an outdoor map has occluders");
+
+    // The occluders of the scene should always be those of a scene made from the current map.
+    auto expectFresh = [&] (const QString &step) {
+        Map2Mesh fresh(&map);
+        fresh.finishSceneUpdate();
+
+        if (!sameBoxes(scene->occluders(), fresh.getScene()->occluders()))
+            failures += fail(check, QString("the occluders differ from a fresh scene's after %1").arg(step));
+    };
+
+    map.setIndoor(true);
+    map2Mesh.finishSceneUpdate();
+
+    if (scene->occluders().isEmpty())
+        failures += fail(check, "an indoor map has no occluders");
+    expectFresh("making the map indoor");
+
+    map.clearTile(20, 20);
+    map.setTile(5, 30, wall);
+    map2Mesh.finishSceneUpdate();
+    expectFresh("editing the map");
+
+    map.setIndoor(false);
+
+    if (!scene->occluders().isEmpty())
+        failures += fail(check, "the occluders are kept after the map became outdoor");
+
+    return failures;
+}
+
+int Checks::checkIncrementalRemeshing()
+{
+    const QString check = "incremental remeshing";
+    int failures = 0;
+
+    TileTemplateSet templates("Check Templates");
+
+    TileTemplate *wall = new TileTemplate(Qt::darkGray, "Wall", 1.5, 0.3);
+    wall->setBridgeTiles(true);
+    TileTemplate *block = new TileTemplate(Qt::lightGray, "Block", 2, 1);
+
+    templates.addTileTemplate(wall, true);
+    templates.addTileTemplate(block, true);
+
+    // Repeated neighborhoods in several chunks, so that most tiles are cache hits.
+    TileMap map(QSize(40, 40), false, false);
+    for (int i = 0; i < 40; ++i) {
+        map.setTile(i, 20, wall);
+        map.setTile(20, i, wall);
+        map.setTile(i, i, wall);
+    }
+    for (int i = 4; i < 40; i += 8) {
+        for (int j = 4; j < 40; j += 8)
+            map.setTile(i, j, block);
+    }
+
+    Map2Mesh map2Mesh(&map);
+    map2Mesh.finishSceneUpdate();
+
+    // The scene should always match one made from the current map without the cache.
+    auto expectFresh = [&] (const QString &step) {
+        Map2Mesh fresh(&map);
+        fresh.setMeshCacheEnabled(false);
+        fresh.finishSceneUpdate();
+
+        if (sceneTriangles(*map2Mesh.getScene()) != sceneTriangles(*fresh.getScene()))
+            failures += fail(check, QString("the scene differs from an uncached fresh scene after %1").arg(step));
+    };
+
+    expectFresh("making the scene");
+
+    if (map2Mesh.meshCacheStats().hits == 0)
+        failures += fail(check, "no tile mesh came from the cache");
+
+    // Edits on and across chunk borders.
+    map.clearTile(20, 20);
+    map.setTile(15, 16, wall);
+    map.setTile(16, 15, block);
+    map.setTile(12, 12, block);
+    map.clearTile(36, 36);
+    map2Mesh.finishSceneUpdate();
+    expectFresh("editing the map");
+
+    map.setTile(20, 20, block);
+    map.clearTile(15, 16);
+    map2Mesh.finishSceneUpdate();
+    expectFresh("editing the same chunks again");
+
+    return failures;
+}
+
+int Checks::checkRemeshEstimate()
+{
+    const QString check = "remesh estimate";
+    int failures = 0;
+
+    TileTemplateSet templates("Check Templates");
+
+    TileTemplate *wall = new TileTemplate(Qt::darkGray, "Wall", 1.5);
+    templates.addTileTemplate(wall, true);
+
+    TileMap map(QSize(64, 64), false, false);
+
+    Map2Mesh map2Mesh(&map);
+    map2Mesh.finishSceneUpdate();
+
+    // The edit is near a chunk corner, so it queues four chunks.
+    int chunk = Map2Mesh::DefaultChunkSize;
+    map.setTile(chunk, chunk, wall);
+
+    const int side = 2 * M2M::AbstractTileMesher::NeighborhoodRadius + 1;
+    const M2M::RemeshScheduler::Decision &decision = map2Mesh.remeshScheduler().lastDecision();
+
+    if (map2Mesh.queuedChunkCount() != 4)
+        failures += fail(check, QString("the edit queued %1 chunks, expected 4").arg(map2Mesh.queuedChunkCount()));
+
+    if (decision.queuedTiles != side * side)
+        failures += fail(check, QString("the edit was estimated as %1 tiles, expected %2")
+                         .arg(decision.queuedTiles).arg(side * side));
+
+    map2Mesh.finishSceneUpdate();
+
+    return failures;
+}
+
+int Checks::fail(const QString &check, const QString &message)
+{
+    mErr << "FAILED " << check << ": " << message << endl;
+    return 1;
+}
@@ -0,0 +1,74 @@
+#ifndef CHECKS_H
+#define CHECKS_H
+
+#include <QString>
+#include <QTextStream>
+
+/**
+ * @brief Exhaustive and regression checks of code that the benchmarks rely on.
+ *
+ * Each check prints its failures to stderr and returns how many there were.
+ */
+class Checks
+{
+public:
+    Checks();
+
+    /**
+     * @brief Runs all checks. Returns the total number of failures.
+     */
+    int run();
+
+    /**
+     * @brief Removes an object and adds another into its slot in one transaction, and
+     * checks that the renderer queues the removal before the addition.
+     */
+    int checkSceneTransactions();
+
+    /**
+     * @brief Compares GroundBlockyPolygonTileMesher::sideDiagonals() with the decisions
+     * that the mesher made before BlockyTables, for every GroundSideFact mask of both
+     * sides, with other tiles either ground or of another template.
+     */
+    int checkGroundDiagonalTable();
+
+    /**
+     * @brief Compares BlockyPolygonTileMesher::directionDiagonal() with the decisions
+     * that the mesher made before BlockyTables, for every BlockDirectionFact mask in
+     * every direction.
+     */
+    int checkBlockDiagonalTable();
+
+    /**
+     * @brief Clips inputs whose crossings, rounded to the grid, used to break the boundary
+     * of the result, and compares the areas with those of the same inputs scaled up, where
+     * rounding hardly matters.
+     */
+    int checkPolygonClipperRounding();
+
+    /**
+     * @brief Toggles whether a map is indoor and edits it, and compares the scene's
+     * occluders with those of a scene made from scratch.
+     */
+    int checkIndoorOccluders();
+
+    /**
+     * @brief Edits a map whose tiles are mostly meshed from the cache, and compares the
+     * incrementally updated scene with one made from scratch without the cache.
+     */
+    int checkIncrementalRemeshing();
+
+    /**
+     * @brief Checks that the cost of a pass after a single edit is estimated from the
+     * tiles around the edit rather than from its chunks.
+     */
+    int checkRemeshEstimate();
+
+private:
+    /// Prints a failure of the named check and returns 1.
+    int fail(const QString &check, const QString &message);
+
+    QTextStream mErr;
+};
+
+#endif // CHECKS_H
@@ -0,0 +1,126 @@
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QJsonDocument>
+#include <QFile>
+#include <QThread>
+#include <QTextStream>
+
+#include "benchmarks.h"
+#include "checks.h"
+#include "map2mesh.h"
+
+int main(int argc, char *argv[])
+{
+    // Benchmarks never open a window.
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QGuiApplication app(argc, argv);
+    QGuiApplication::setApplicationName("wahbenchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times map-to-mesh conversion on synthetic maps and prints the results as JSON.");
+    parser.addHelpOption();
+
+    QCommandLineOption sizesOption("sizes",
+                                   "Comma-separated map side lengths.",
+                                   "list",
+                                   "64,128,256,512,1024");
+    QCommandLineOption densitiesOption("densities",
+                                       QString("Comma-separated map densities out of: %1.")
+                                            .arg(SyntheticMaps::densityNames().join(", ")),
+                                       "list",
+                                       SyntheticMaps::densityNames().join(','));
+    QCommandLineOption repeatOption("repeat",
+                                    "Repeat each full remesh <n> more times with a warm cache.",
+                                    "n",
+                                    "3");
+    QCommandLineOption editsOption("edits",
+                                   "Time <n> single-tile edits per map.",
+                                   "n",
+                                   "20");
+    QCommandLineOption polygonIterationsOption("polygon-iterations",
+                                               "Repeat each polygon operation <n> times.",
+                                               "n",
+                                               "10000");
+    QCommandLineOption meshThreadsOption({"t", "mesh-threads"},
+                                         "Mesh with <n> threads.",
+                                         "n",
+                                         QString::number(QThread::idealThreadCount()));
+    QCommandLineOption chunkSizeOption("chunk-size",
+                                       "Use <n> by <n> chunks.",
+                                       "n",
+                                       QString::number(Map2Mesh::DefaultChunkSize));
+    QCommandLineOption noMergeOption("no-merge", "Do not merge flat tile tops.");
+    QCommandLineOption keepHiddenWallsOption("keep-hidden-walls", "Do not remove walls hidden by neighboring tiles.");
+    QCommandLineOption noSaveOption("no-save", "Do not time OBJ export.");
+    QCommandLineOption checkOption("check", "Run the consistency checks instead of the benchmarks.");
+    QCommandLineOption outputOption({"o", "output"},
+                                    "Write the JSON results to <file> instead of standard output.",
+                                    "file");
+
+    parser.addOptions({sizesOption, densitiesOption, repeatOption, editsOption,
+                       polygonIterationsOption, meshThreadsOption, chunkSizeOption,
+                       noMergeOption, keepHiddenWallsOption, noSaveOption, checkOption, outputOption});
+
+    parser.process(app);
+
+    QTextStream err(stderr);
+
+    if (parser.isSet(checkOption)) {
+        int failures = Checks().run();
+        if (failures > 0) {
+            err << failures << " checks failed" << endl;
+            return 1;
+        }
+
+        err << "All checks passed" << endl;
+        return 0;
+    }
+
+    Benchmarks::Options options;
+
+    for (const QString &size : parser.value(sizesOption).split(',', QString::SkipEmptyParts)) {
+        bool ok;
+        int s = size.toInt(&ok);
+        if (!ok || s <= 0) {
+            err << "Invalid size: " << size << endl;
+            return 2;
+        }
+        options.sizes.append(s);
+    }
+
+    for (const QString &name : parser.value(densitiesOption).split(',', QString::SkipEmptyParts)) {
+        SyntheticMaps::Density density;
+        if (!SyntheticMaps::parseDensity(name.trimmed(), &density)) {
+            err << "Invalid density: " << name << endl;
+            return 2;
+        }
+        options.densities.append(density);
+    }
+
+    options.repeats = qMax(0, parser.value(repeatOption).toInt());
+    options.singleTileEdits = qMax(0, parser.value(editsOption).toInt());
+    options.polygonIterations = qMax(1, parser.value(polygonIterationsOption).toInt());
+    options.meshThreads = qMax(1, parser.value(meshThreadsOption).toInt());
+    options.chunkSize = qMax(1, parser.value(chunkSizeOption).toInt());
+    options.mergeTopFaces = !parser.isSet(noMergeOption);
+    options.removeHiddenWalls = !parser.isSet(keepHiddenWallsOption);
+    options.timeSave = !parser.isSet(noSaveOption);
+
+    Benchmarks benchmarks(options);
+    QByteArray json = QJsonDocument(benchmarks.run()).toJson();
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly)) {
+            err << "Could not write " << file.fileName() << endl;
+            return 1;
+        }
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+
+    return 0;
+}
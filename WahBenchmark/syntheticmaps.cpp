@@ -0,0 +1,115 @@
+#include "syntheticmaps.h"
+
+#include <random>
+
+namespace {
+
+/// The seed for all random maps.
+const unsigned RandomSeed = 20180415;
+
+}
+
+
+SyntheticMaps::SyntheticMaps()
+    : mTemplates("Benchmark Templates")
+{
+    mBlock = new TileTemplate(Qt::gray, "Block", 2, 1);
+
+    mThinWall = new TileTemplate(Qt::darkGray, "Thin Wall", 1.5, 0.3);
+    mThinWall->setBridgeTiles(true);
+    mThinWall->setConnectDiagonals(true);
+
+    mTemplates.addTileTemplate(mBlock, true);
+    mTemplates.addTileTemplate(mThinWall, true);
+}
+
+TileMap *SyntheticMaps::makeMap(int size, Density density) const
+{
+    TileMap *map = new TileMap(QSize(size, size), false, false);
+
+    // std::mt19937's output is specified exactly, unlike the standard distributions.
+    std::mt19937 random(RandomSeed);
+
+    switch (density) {
+    case Empty:
+        break;
+
+    case Sparse: {
+        // About 5% of the tiles are blocks.
+        for (int x = 0; x < size; ++x)
+            for (int y = 0; y < size; ++y)
+                if (random() % 20 == 0)
+                    map->setTile(x, y, mBlock);
+
+        // Short diagonal walls, which get connected with diagonals.
+        int numDiagonals = size * size / 256;
+        for (int i = 0; i < numDiagonals; ++i) {
+            int x = random() % size;
+            int y = random() % size;
+            int dy = random() % 2 == 0 ? 1 : -1;
+
+            for (int j = 0; j < 6 && x + j < size && y + j * dy >= 0 && y + j * dy < size; ++j)
+                map->setTile(x + j, y + j * dy, mThinWall);
+        }
+    } break;
+
+    case Maze: {
+        // Walls along every fourth row and column, with a doorway in most wall segments.
+        for (int x = 0; x < size; ++x) {
+            for (int y = 0; y < size; ++y) {
+                bool onRow = y % 4 == 0;
+                bool onColumn = x % 4 == 0;
+
+                if (onRow || onColumn)
+                    map->setTile(x, y, mThinWall);
+            }
+        }
+
+        for (int x = 0; x + 4 <= size; x += 4) {
+            for (int y = 0; y + 4 <= size; y += 4) {
+                if (random() % 4 != 0)
+                    map->clearTile(x + 1 + random() % 3, y);
+                if (random() % 4 != 0)
+                    map->clearTile(x, y + 1 + random() % 3);
+            }
+        }
+    } break;
+
+    case Filled:
+        for (int x = 0; x < size; ++x)
+            for (int y = 0; y < size; ++y)
+                map->setTile(x, y, mBlock);
+        break;
+    }
+
+    return map;
+}
+
+QString SyntheticMaps::densityName(Density density)
+{
+    switch (density) {
+    case Empty: return "empty";
+    case Sparse: return "sparse";
+    case Maze: return "maze";
+    case Filled: return "filled";
+    }
+
+    return QString();
+}
+
+bool SyntheticMaps::parseDensity(const QString &name, Density *density)
+{
+    for (Density d : {Empty, Sparse, Maze, Filled}) {
+        if (densityName(d) == name) {
+            *density = d;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+QStringList SyntheticMaps::densityNames()
+{
+    return {densityName(Empty), densityName(Sparse), densityName(Maze), densityName(Filled)};
+}
@@ -0,0 +1,66 @@
+#ifndef SYNTHETICMAPS_H
+#define SYNTHETICMAPS_H
+
+#include <QString>
+#include <QStringList>
+
+#include "tilemap.h"
+#include "tiletemplateset.h"
+
+/**
+ * @brief Builds reproducible maps for benchmarking.
+ *
+ * The same size and density always produce the same map, on every platform.
+ */
+class SyntheticMaps
+{
+public:
+    enum Density {
+        /// Only ground.
+        Empty,
+
+        /// Scattered thick blocks and thin diagonal walls.
+        Sparse,
+
+        /// A grid of thin, bridged walls with doorways, i.e. mostly straight wall runs.
+        Maze,
+
+        /// Every tile is a thick block.
+        Filled
+    };
+
+    SyntheticMaps();
+
+    /**
+     * @brief Creates a size x size map with the given density. The caller owns the map.
+     * The map refers to templates owned by this object, so it must not outlive it.
+     */
+    TileMap *makeMap(int size, Density density) const;
+
+    /**
+     * @brief Returns a template that tiles can be set to, e.g. for single-tile edits.
+     */
+    TileTemplate *blockTemplate() const { return mBlock; }
+
+    static QString densityName(Density density);
+
+    /**
+     * @brief Parses a density name as returned by densityName().
+     * @return True if the name was valid.
+     */
+    static bool parseDensity(const QString &name, Density *density);
+
+    static QStringList densityNames();
+
+private:
+    /// Owns the templates.
+    TileTemplateSet mTemplates;
+
+    /// A full-size block.
+    TileTemplate *mBlock;
+
+    /// A thin wall that bridges to its neighbors and connects diagonally.
+    TileTemplate *mThinWall;
+};
+
+#endif // SYNTHETICMAPS_H
@@ -0,0 +1,26 @@
+#-------------------------------------------------
+#
+# Command-line converter from .wah maps to OBJ meshes.
+# Built from the editor's core sources, without QtWidgets; never opens a window.
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+TARGET = wahconvert
+TEMPLATE = app
+
+CONFIG += c++14 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../WallsAndHoles/wahcore.pri)
+
+
+SOURCES += \
+    main.cpp \
+    batchconverter.cpp
+
+HEADERS += \
+    batchconverter.h
@@ -0,0 +1,231 @@
+#include "batchconverter.h"
+
+#include <QAtomicInt>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QScopedPointer>
+#include <QThreadPool>
+
+#include "map2mesh.h"
+#include "objtools.h"
+#include "tilematerial.h"
+#include "xmltool.h"
+
+
+namespace {
+
+/// Pulls file indices from a shared counter until there are none left.
+class ConversionTask : public QRunnable
+{
+public:
+    ConversionTask(BatchConverter &converter,
+                   const QStringList &inputs,
+                   BatchConverter::Result *results,
+                   QAtomicInt &nextIndex)
+        : mConverter(converter)
+        , mInputs(inputs)
+        , mResults(results)
+        , mNextIndex(nextIndex) {}
+
+    void run() override
+    {
+        int idx;
+        while ((idx = mNextIndex.fetchAndAddRelaxed(1)) < mInputs.size())
+            mResults[idx] = mConverter.convertFile(mInputs[idx]);
+    }
+
+private:
+    BatchConverter &mConverter;
+    const QStringList &mInputs;
+    BatchConverter::Result *mResults;
+    QAtomicInt &mNextIndex;
+};
+
+
+double toMs(qint64 ns)
+{
+    return ns / 1e6;
+}
+
+}
+
+
+BatchConverter::BatchConverter(const Options &options)
+    : mOptions(options)
+{
+    mOptions.jobs = qMax(1, mOptions.jobs);
+    mOptions.meshThreads = qMax(1, mOptions.meshThreads);
+    mOptions.chunkSize = qMax(1, mOptions.chunkSize);
+}
+
+QVector<BatchConverter::Result> BatchConverter::convert(const QStringList &inputs)
+{
+    // The default materials are created lazily; make sure no two maps race to create them.
+    TileMaterial::getDefaultMaterial();
+    TileMaterial::getDefaultGroundMaterial();
+
+    // Workers only write to distinct elements of the results array.
+    QVector<Result> results(inputs.size());
+    Result *resultData = results.data();
+
+    QAtomicInt nextIndex(0);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(mOptions.jobs);
+
+    int numWorkers = qMin(mOptions.jobs, inputs.size());
+    for (int i = 0; i < numWorkers; ++i)
+        pool.start(new ConversionTask(*this, inputs, resultData, nextIndex));
+
+    pool.waitForDone();
+
+    return results;
+}
+
+BatchConverter::Result BatchConverter::convertFile(const QString &input)
+{
+    Result result;
+    result.input = input;
+    result.output = outputPath(input);
+    result.ok = false;
+    result.objects = 0;
+    result.triangles = 0;
+    result.loadNs = 0;
+    result.meshNs = 0;
+    result.saveNs = 0;
+
+    QElapsedTimer timer;
+
+    /* BEGIN load */
+    timer.start();
+
+    // Declared before the map so that it outlives it: it owns the map's template sets.
+    QObject templateSets;
+
+    auto loadTileTemplateSet = [&templateSets] (const QString &path) {
+        SavableTileTemplateSet *templateSet = XMLTool::openTileTemplateSet(path);
+        if (templateSet != nullptr)
+            templateSet->setParent(&templateSets);
+        return templateSet;
+    };
+
+    QScopedPointer<TileMap> tileMap(XMLTool::openTileMap(input, loadTileTemplateSet));
+
+    result.loadNs = timer.nsecsElapsed();
+
+    if (tileMap.isNull()) {
+        result.error = QString("Could not load %1").arg(input);
+        return result;
+    }
+
+    result.mapSize = tileMap->mapSize();
+    /* END load */
+
+
+    /* BEGIN mesh */
+    timer.start();
+
+    Map2Mesh map2Mesh(tileMap.data());
+    map2Mesh.setMeshingThreadCount(mOptions.meshThreads);
+    map2Mesh.setChunkSize(mOptions.chunkSize);
+    map2Mesh.finishSceneUpdate();
+
+    SharedSimpleTexturedScene scene = map2Mesh.getScene();
+
+    result.meshNs = timer.nsecsElapsed();
+    /* END mesh */
+
+
+    /* BEGIN save */
+    timer.start();
+
+    SharedOBJModel objModel = scene->exportOBJ();
+
+    for (const SimpleTexturedObject &obj : *scene) {
+        result.objects += 1;
+        result.triangles += obj.getTriangles().size();
+    }
+
+    QFileInfo outputInfo(result.output);
+    QDir outputDir = outputInfo.absoluteDir();
+
+    if (!outputDir.exists() && !outputDir.mkpath(".")) {
+        result.error = QString("Could not create %1").arg(outputDir.path());
+        return result;
+    }
+
+    // Same as OBJModel::save(), except that images are written under a lock.
+    objModel->name = outputInfo.completeBaseName();
+    objModel->saveOBJ(outputInfo.absoluteFilePath());
+    objModel->saveMTL(outputDir.filePath(objModel->name + ".mtl"));
+    {
+        QMutexLocker locker(&mImageSaveMutex);
+        objModel->saveImages(outputDir.path() + "/");
+    }
+
+    result.saveNs = timer.nsecsElapsed();
+    /* END save */
+
+    if (!QFileInfo::exists(result.output)) {
+        result.error = QString("Could not write %1").arg(result.output);
+        return result;
+    }
+
+    result.ok = true;
+    return result;
+}
+
+QJsonObject BatchConverter::toJson(const QVector<Result> &results, qint64 wallNs) const
+{
+    QJsonArray files;
+    int failed = 0;
+
+    for (const Result &r : results) {
+        QJsonObject file;
+        file["input"] = r.input;
+        file["output"] = r.output;
+        file["ok"] = r.ok;
+
+        if (!r.ok) {
+            file["error"] = r.error;
+            ++failed;
+        }
+
+        file["width"] = r.mapSize.width();
+        file["height"] = r.mapSize.height();
+        file["objects"] = r.objects;
+        file["triangles"] = r.triangles;
+        file["loadMs"] = toMs(r.loadNs);
+        file["meshMs"] = toMs(r.meshNs);
+        file["saveMs"] = toMs(r.saveNs);
+        file["totalMs"] = toMs(r.loadNs + r.meshNs + r.saveNs);
+
+        files.append(file);
+    }
+
+    QJsonObject summary;
+    summary["files"] = results.size();
+    summary["failed"] = failed;
+    summary["jobs"] = mOptions.jobs;
+    summary["meshThreads"] = mOptions.meshThreads;
+    summary["chunkSize"] = mOptions.chunkSize;
+    summary["wallMs"] = toMs(wallNs);
+    summary["results"] = files;
+
+    return summary;
+}
+
+QString BatchConverter::outputPath(const QString &input) const
+{
+    QFileInfo inputInfo(input);
+    QString fileName = inputInfo.completeBaseName() + ".obj";
+
+    if (mOptions.outputDir.isEmpty())
+        return QDir::cleanPath(inputInfo.absoluteDir().filePath(fileName));
+    else
+        return QDir::cleanPath(QDir(mOptions.outputDir).absoluteFilePath(fileName));
+}
@@ -0,0 +1,86 @@
+#ifndef BATCHCONVERTER_H
+#define BATCHCONVERTER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QSize>
+#include <QMutex>
+#include <QJsonObject>
+
+/**
+ * @brief Converts .wah maps to OBJ meshes without any user interface.
+ *
+ * Several files are converted at once, each on its own thread. Each conversion
+ * loads the map with XMLTool::openTileMap(), meshes it with Map2Mesh (no renderer
+ * is ever created for the scene) and saves the scene with OBJModel.
+ */
+class BatchConverter
+{
+public:
+    struct Options {
+        /// The directory for the output files. If empty, each file is written next to its input.
+        QString outputDir;
+
+        /// The number of files that are converted at the same time.
+        int jobs;
+
+        /// The number of threads used to mesh each map.
+        int meshThreads;
+
+        /// The chunk size passed to Map2Mesh::setChunkSize().
+        int chunkSize;
+    };
+
+    /**
+     * @brief The outcome of converting one file. Times are in nanoseconds.
+     */
+    struct Result {
+        QString input;
+        QString output;
+
+        bool ok;
+        QString error;
+
+        QSize mapSize;
+        int objects;
+        int triangles;
+
+        qint64 loadNs;
+        qint64 meshNs;
+        qint64 saveNs;
+    };
+
+
+    explicit BatchConverter(const Options &options);
+
+    /**
+     * @brief convert   Converts all given files. Blocks until all are done.
+     * @param inputs    Paths to .wah files.
+     * @return          One result per input, in the same order.
+     */
+    QVector<Result> convert(const QStringList &inputs);
+
+    /**
+     * @brief Converts a single file on the calling thread.
+     */
+    Result convertFile(const QString &input);
+
+    /**
+     * @brief toJson    Summarizes a batch as a JSON object with one entry per file.
+     * @param results   The results of convert().
+     * @param wallNs    The time the whole batch took.
+     */
+    QJsonObject toJson(const QVector<Result> &results, qint64 wallNs) const;
+
+private:
+    /// Returns the path of the OBJ file for the given input.
+    QString outputPath(const QString &input) const;
+
+    Options mOptions;
+
+    /// Maps that share textures write the same image files, so images are saved one map at a time.
+    QMutex mImageSaveMutex;
+};
+
+#endif // BATCHCONVERTER_H
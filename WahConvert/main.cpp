@@ -0,0 +1,110 @@
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QFile>
+#include <QThread>
+#include <QTextStream>
+
+#include "batchconverter.h"
+#include "map2mesh.h"
+
+int main(int argc, char *argv[])
+{
+    // Never try to connect to a display. The converter only needs QtGui for images,
+    // so the offscreen platform is enough even on machines with no X server.
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QGuiApplication app(argc, argv);
+    QGuiApplication::setApplicationName("wahconvert");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Converts Walls and Holes maps (.wah) to OBJ meshes.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("inputs", "The .wah files to convert.", "<input.wah>...");
+
+    QCommandLineOption outputDirOption({"o", "output-dir"},
+                                       "Write the meshes to <dir> instead of next to each input.",
+                                       "dir");
+    QCommandLineOption jobsOption({"j", "jobs"},
+                                  "Convert <n> files at the same time (default: one per core).",
+                                  "n");
+    QCommandLineOption meshThreadsOption({"t", "mesh-threads"},
+                                         "Use <n> threads to mesh each map (default: all cores "
+                                         "divided by the number of jobs).",
+                                         "n");
+    QCommandLineOption chunkSizeOption("chunk-size",
+                                       "Group tiles into <n> by <n> chunks, each exported as one object per texture.",
+                                       "n",
+                                       QString::number(Map2Mesh::DefaultChunkSize));
+    QCommandLineOption timingOption("timing",
+                                    "Write a JSON timing summary to <file>, or to standard output if <file> is -.",
+                                    "file");
+
+    parser.addOption(outputDirOption);
+    parser.addOption(jobsOption);
+    parser.addOption(meshThreadsOption);
+    parser.addOption(chunkSizeOption);
+    parser.addOption(timingOption);
+
+    parser.process(app);
+
+    QTextStream err(stderr);
+
+    QStringList inputs = parser.positionalArguments();
+    if (inputs.isEmpty()) {
+        err << "No input files." << endl << endl << parser.helpText();
+        return 2;
+    }
+
+    int cores = QThread::idealThreadCount();
+
+    BatchConverter::Options options;
+    options.outputDir = parser.value(outputDirOption);
+    options.jobs = parser.isSet(jobsOption)
+            ? parser.value(jobsOption).toInt()
+            : qMin(cores, inputs.size());
+    options.jobs = qMax(1, options.jobs);
+    options.meshThreads = parser.isSet(meshThreadsOption)
+            ? parser.value(meshThreadsOption).toInt()
+            : cores / options.jobs;
+    options.chunkSize = parser.value(chunkSizeOption).toInt();
+
+    BatchConverter converter(options);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<BatchConverter::Result> results = converter.convert(inputs);
+
+    qint64 wallNs = timer.nsecsElapsed();
+
+    bool allOk = true;
+    for (const BatchConverter::Result &r : results) {
+        if (r.ok) {
+            err << r.input << " -> " << r.output << endl;
+        } else {
+            err << r.input << ": " << r.error << endl;
+            allOk = false;
+        }
+    }
+
+    if (parser.isSet(timingOption)) {
+        QByteArray json = QJsonDocument(converter.toJson(results, wallNs)).toJson();
+        QString timingPath = parser.value(timingOption);
+
+        if (timingPath == "-") {
+            QTextStream(stdout) << json;
+        } else {
+            QFile timingFile(timingPath);
+            if (!timingFile.open(QIODevice::WriteOnly)) {
+                err << "Could not write " << timingPath << endl;
+                return 1;
+            }
+            timingFile.write(json);
+        }
+    }
+
+    return allOk ? 0 : 1;
+}
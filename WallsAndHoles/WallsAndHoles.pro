@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui xml
+QT       += core gui xml concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -27,161 +27,10 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 
 SOURCES += \
-    main.cpp \
-    meshview.cpp \
-    meshviewcameralikeblender.cpp \
-    tile.cpp \
-    tilemap.cpp \
-    tiletemplate.cpp \
-    tiletemplateset.cpp \
-    drawableaxes.cpp \
-    toolmanager.cpp \
-    meshviewcontainer.cpp \
-    mapview.cpp \
-    editor.cpp \
-    shaderprogramonelight.cpp \
-    xmltool.cpp \
-    map2mesh.cpp \
-    mapcell.cpp \
-    tilemapbrushtool.cpp \
-    tilemaptoolmanager.cpp \
-    m2mtilemesher.cpp \
-    m2mpropertyclass.cpp \
-    m2mpropertyinstance.cpp \
-    m2mpropertyset.cpp \
-    map2meshproperties.cpp \
-    tiletemplatesetsview.cpp \
-    newtiletemplatesetdialog.cpp \
-    mapcellgraphicsitem.cpp \
-    abstractshapebrushtool.cpp \
-    linebrushtool.cpp \
-    rectbrushtool.cpp \
-    ellipsebrushtool.cpp \
-    tilemapselectiontool.cpp \
-    filltool.cpp \
-    simpletexturedrenderer.cpp \
-    simpletexturedscene.cpp \
-    simpletexturedobject.cpp \
-    simpletexturedshader.cpp \
-    tiletemplatesetsmanager.cpp \
-    savabletiletemplateset.cpp \
-    newmapdialog.cpp \
-    tilemappreviewgraphicsitem.cpp \
-    objtools.cpp \
-    propertybrowser.cpp \
-    tilepropertymanager.cpp \
-    mappropertymanager.cpp \
-    colorpickerbutton.cpp \
-    tiletemplatepropertymanager.cpp \
-    tilematerial.cpp \
-    tilematerialview.cpp \
-    tilematerialset.cpp \
-    tilematerialselectionbar.cpp \
-    materialpropertymanager.cpp \
-    imagefinderbar.cpp \
-    tilematerialselectiondialog.cpp \
-    templatematerialselector.cpp \
-    abstracttileselectiontool.cpp \
-    tilemaphelpers.cpp \
-    shaperegion.cpp \
-    mapviewcontainer.cpp\
-    m2mpartialmesh.cpp \
-    m2mtilemesher_private.cpp \
-    polygon.cpp \
-    abstractpolygontilemesher.cpp \
-    blockypolygontilemesher.cpp \
-    groundblockypolygontilemesher.cpp \
-    imageandsource.cpp \
-    mapviewmatchercamera.cpp \
-    tiletemplatechangecommand.cpp \
-    dependentundocommand.cpp \
-    emptyparentcommand.cpp
+    main.cpp
+
+include(wahui.pri)
 
-HEADERS += \
-    meshview.h \
-    meshviewcameralikeblender.h \
-    objtools.h \
-    drawableaxes.h \
-    toolmanager.h \
-    tile.h \
-    tilemap.h \
-    tiletemplate.h \
-    abstracttool.h \
-    abstractmeshviewcamera.h \
-    abstractdrawableglobject.h \
-    meshviewcontainer.h \
-    mapview.h \
-    editor.h \
-    array2d.h \
-    shaderprogramonelight.h \
-    xmltool.h \
-    map2mesh.h \
-    m2mtilemesher.h \
-    shaderprogramonelight.h \
-    mapcell.h \
-    tilemaptoolmanager.h \
-    abstracttilemaptool.h \
-    tilemapbrushtool.h \
-    m2mpropertyclass.h \
-    m2mpropertyinstance.h \
-    m2mpropertyset.h \
-    tiletemplateset.h \
-    tiletemplatesetsview.h \
-    newtiletemplatesetdialog.h \
-    mapcellgraphicsitem.h \
-    abstractshapebrushtool.h \
-    linebrushtool.h \
-    rectbrushtool.h \
-    ellipsebrushtool.h \
-    filltool.h \
-    abstractrenderer.h \
-    simpletexturedrenderer.h \
-    abstractscene.h \
-    simpletexturedscene.h \
-    dereferencingiterator.h \
-    dereferencingconstiterator.h \
-    simpletexturedobject.h \
-    triplet.h \
-    simpletexturedshader.h \
-    tilemapselectiontool.h \
-    tilemappreviewgraphicsitem.h \
-    tiletemplatesetsmanager.h \
-    savabletiletemplateset.h \
-    newmapdialog.h \
-    propertybrowser.h \
-    tilepropertymanager.h \
-    mappropertymanager.h \
-    colorpickerbutton.h \
-    tiletemplatepropertymanager.h \
-    abstractpropertymanager.h \
-    tilematerial.h \
-    tilematerialview.h \
-    tilematerialset.h \
-    tilematerialselectionbar.h \
-    materialpropertymanager.h \
-    imagefinderbar.h \
-    imageandsource.h \
-    tilematerialselectiondialog.h \
-    templatematerialselector.h \
-    abstracttileselectiontool.h \
-    tilemaphelpers.h \
-    shaperegion.h \
-    mapviewcontainer.h \
-    m2mpartialmesh.h \
-    array2dtools.h \
-    array2d_private.h \
-    m2mtilemesher_private.h \
-    polygon.h \
-    geometry.h \
-    abstractpolygontilemesher.h \
-    blockypolygontilemesher.h \
-    groundblockypolygontilemesher.h \
-    mapviewmatchercamera.h \
-    tiletemplatechangecommand.h \
-    changevaluecommand.h \
-    undocommandfromfunctions.h \
-    dependentundocommand.h \
-    emptyparentcommand.h
 
 FORMS +=
 
@@ -191,10 +40,5 @@ DISTFILES += \
     onelight.vsh \
     onelight.fsh
 
-RESOURCES += \
-    shaders.qrc \
-    textures.qrc \
-    icons.qrc
-
 RC_FILE = wah.rc
 ICON = images/wahicon.icns
@@ -1,11 +1,39 @@
 #include "abstractpolygontilemesher.h"
+#include "m2mhiddenwallremover.h"
+#include "triangulator.h"
 
 using namespace M2M;
 
 AbstractPolygonTileMesher::AbstractPolygonTileMesher(TileNeighborhoodInfo nbhd)
     : AbstractTileMesher(nbhd) {}
 
-QVector<QSharedPointer<SimpleTexturedObject>> AbstractPolygonTileMesher::makeMesh(QVector2D offset)
+namespace {
+
+/// Returns true if the polygon is exactly the unit square with its corner at offset.
+bool isTileSquare(const BetterPolygon &polygon, QVector2D offset)
+{
+    const QVector<QPointF> &points = polygon.points();
+    if (points.size() != 4)
+        return false;
+
+    for (int i = 0; i < 4; ++i) {
+        QPointF p = points[i] - offset.toPointF();
+
+        if ((p.x() != 0 && p.x() != 1) || (p.y() != 0 && p.y() != 1))
+            return false;
+
+        // Four distinct corners make up the whole square.
+        for (int j = 0; j < i; ++j)
+            if (points[j] == points[i])
+                return false;
+    }
+
+    return true;
+}
+
+}
+
+TileMesh AbstractPolygonTileMesher::makeTileMesh(QVector2D offset)
 {
     QVector<QPointF> tp = {
         QPointF(offset.x()    , offset.y()),
@@ -14,52 +42,71 @@ QVector<QSharedPointer<SimpleTexturedObject>> AbstractPolygonTileMesher::makeMes
         QPointF(offset.x() + 1, offset.y())
     };
 
-    QVector<const Tile *> heightAndMaterialInfo;
+    QVector<const TileInfo *> heightAndMaterialInfo;
 
     QVector<Triplet<BetterPolygon, QVector<float>, QVector<bool>>> topPolys = topPolygons(&heightAndMaterialInfo);
     for (Triplet<BetterPolygon, QVector<float>, QVector<bool>> &p : topPolys)
         p.getFirst().translate(offset.toPointF());
 
-    BetterPolygon groundBase(tp);
-    QVector<BetterPolygon> ground;
+    const TileInfo *tile = mTileNeighborhood.centerTile();
+
+    TileMesh tileMesh;
+
+    // A top that covers the whole tile is left to the TopFaceMerger.
     if (topPolys.isEmpty()) {
-        ground.append(groundBase);
-    } else {
-        ground = groundBase.subtract(topPolys.first().getFirst());
-        for (auto i = topPolys.cbegin() + 1; i != topPolys.cend(); ++i) {
-            QVector<BetterPolygon> tmp;
-            for (const BetterPolygon &p : ground)
-                tmp.append(p.subtract(i->getFirst()));
-
-            ground.swap(tmp);
-        }
+        tileMesh.hasFlatTop = true;
+        tileMesh.topHeight = 0;
+        tileMesh.topMaterial = mTileNeighborhood.groundMaterial();
+        return tileMesh;
+    }
+
+    if (topPolys.size() == 1 && isTileSquare(topPolys.first().getFirst(), offset)) {
+        const Triplet<BetterPolygon, QVector<float>, QVector<bool>> &p = topPolys.first();
+        if (!heightAndMaterialInfo.isEmpty())
+            tile = heightAndMaterialInfo.first();
+
+        tileMesh.hasFlatTop = true;
+        tileMesh.topHeight = tile->height();
+        tileMesh.topMaterial = tile->topMaterial();
+        addSide(tileMesh, p.getFirst(), tile->height(), p.getSecond(), p.getThird(), tile->sideMaterial());
+        return tileMesh;
     }
 
-    const Tile *tile = mTileNeighborhood.centerTile();
+    // The ground keeps its holes, since the triangulator handles them directly.
+    QVector<PolygonClipper::Polygon> tops;
+    tops.reserve(topPolys.size());
+    for (const Triplet<BetterPolygon, QVector<float>, QVector<bool>> &p : topPolys)
+        tops.append(PolygonClipper::Polygon(p.getFirst().points()));
 
-    PartialMeshData mesh;
-    for (const BetterPolygon &p : ground)
-        mesh += makeTop(p, 0, TileMaterial::getDefaultGroundMaterial());
+    QVector<PolygonClipper::Polygon> ground = PolygonClipper::clip(PolygonClipper::Operation::Difference,
+                                                                   {PolygonClipper::Polygon(tp)}, tops);
+
+    PartialMeshData &mesh = tileMesh.mesh;
+    for (const PolygonClipper::Polygon &p : ground)
+        addTop(mesh, p, 0, mTileNeighborhood.groundMaterial());
     for (int i = 0; i < topPolys.size(); ++i) {
         const Triplet<BetterPolygon, QVector<float>, QVector<bool>> &p = topPolys[i];
         if (!heightAndMaterialInfo.isEmpty())
             tile = heightAndMaterialInfo[i];
 
-        mesh += makeTop(p.getFirst(), tile->height(), tile->topMaterial());
-        mesh += makeSide(p.getFirst(), tile->height(), p.getSecond(), p.getThird(), tile->sideMaterial());
+        addTop(mesh, PolygonClipper::Polygon(p.getFirst().points()), tile->height(), tile->topMaterial());
+        addSide(tileMesh, p.getFirst(), tile->height(), p.getSecond(), p.getThird(), tile->sideMaterial());
     }
 
-    return mesh.constructObjects();
+    return tileMesh;
 }
 
-PartialMeshData AbstractPolygonTileMesher::makeTop(const BetterPolygon &polygon,
-                                                   float height,
-                                                   const TileMaterial *material) const
+void AbstractPolygonTileMesher::addTop(PartialMeshData &mesh,
+                                       const PolygonClipper::Polygon &polygon,
+                                       float height,
+                                       const MaterialInfo &material) const
 {
-    QList<Triplet<QPointF, QPointF, QPointF>> triangles = polygon.triangulate();
+    QList<Triangulator::Triangle> triangles = Triangulator::triangulate(polygon.outer, polygon.holes);
+
+    PreObject &object = mesh.object(material.imageInfo());
+    object.reserve(3 * triangles.size(), triangles.size());
 
-    PartialMeshData mesh;
-    for (const Triplet<QPointF, QPointF, QPointF> &t : triangles) {
+    for (const Triangulator::Triangle &t : triangles) {
         QVector3D v1(t.getFirst().x(), height, t.getFirst().y());
         QVector3D v2(t.getSecond().x(), height, t.getSecond().y());
         QVector3D v3(t.getThird().x(), height, t.getThird().y());
@@ -68,24 +115,20 @@ PartialMeshData AbstractPolygonTileMesher::makeTop(const BetterPolygon &polygon,
         QVector2D t2(t.getSecond());
         QVector2D t3(t.getThird());
 
-        mesh.addTrig(M2M::Trig(material,
-                               material,
-                               v1, t1,
-                               v2, t2,
-                               v3, t3));
+        object.addTriangle(material.phongInfo(),
+                           v1, t1,
+                           v2, t2,
+                           v3, t3);
     }
-
-    return mesh;
 }
 
-PartialMeshData AbstractPolygonTileMesher::makeSide(const BetterPolygon &polygon,
-                                                    float startHegiht,
-                                                    const QVector<float> endHeight,
-                                                    const QVector<bool> dropWall,
-                                                    const TileMaterial *material) const
+void AbstractPolygonTileMesher::addSide(TileMesh &tileMesh,
+                                        const BetterPolygon &polygon,
+                                        float startHegiht,
+                                        const QVector<float> endHeight,
+                                        const QVector<bool> dropWall,
+                                        const MaterialInfo &material) const
 {
-    PartialMeshData mesh;
-
     for (int i = 0; i < polygon.points().size(); ++i) {
         if (!dropWall[i]) continue;
         int j = (i + 1) % polygon.points().size();
@@ -93,6 +136,9 @@ PartialMeshData AbstractPolygonTileMesher::makeSide(const BetterPolygon &polygon
         QPointF a = polygon.points()[i];
         QPointF b = polygon.points()[j];
 
+        // Repeated points give walls without width.
+        if (a == b) continue;
+
         float otherHeight = endHeight[i];
 
         QPointF xzCenter = (a + b) / 2;
@@ -110,14 +156,18 @@ PartialMeshData AbstractPolygonTileMesher::makeSide(const BetterPolygon &polygon
             upsideDown = true;
         }
 
-        mesh.addQuad(M2M::Quad::makeVerticalQuad(center,
-                                                 normal,
-                                                 dir.length(),
-                                                 h,
-                                                 material,
-                                                 material,
-                                                 upsideDown));
+        Quad quad = M2M::Quad::makeVerticalQuad(center,
+                                                normal,
+                                                dir.length(),
+                                                h,
+                                                material.imageInfo(),
+                                                material.phongInfo(),
+                                                upsideDown);
+
+        // Axis-aligned walls are kept separate for the HiddenWallRemover.
+        if (HiddenWallRemover::isAxisAligned(quad))
+            tileMesh.walls.append(quad);
+        else
+            tileMesh.mesh.addQuad(quad);
     }
-
-    return mesh;
 }
@@ -3,6 +3,7 @@
 
 #include "m2mtilemesher.h"
 #include "polygon.h"
+#include "polygonclipper.h"
 #include "m2mpartialmesh.h"
 
 namespace M2M {
@@ -12,23 +13,29 @@ class AbstractPolygonTileMesher : public AbstractTileMesher
 public:
     AbstractPolygonTileMesher(TileNeighborhoodInfo nbhd);
 
-    QVector<QSharedPointer<SimpleTexturedObject>> makeMesh(QVector2D offset);
+    TileMesh makeTileMesh(QVector2D offset) override;
 
 protected:
     //Justification of heightAndMAterial:
     //Some meshers may want to not use this tiles height and material, so the mesher can handle an optional vector of tiles
     //The vector must either be left empty, or filled to equal the size of the main return vector
-    virtual QVector<Triplet<BetterPolygon, QVector<float>, QVector<bool>>> topPolygons(QVector<const Tile *> *heightAndMaterial) = 0;
+    virtual QVector<Triplet<BetterPolygon, QVector<float>, QVector<bool>>> topPolygons(QVector<const TileInfo *> *heightAndMaterial) = 0;
 
 private:
-    PartialMeshData makeTop(const BetterPolygon &polygon,
-                            float height,
-                            const TileMaterial *material) const;
-    PartialMeshData makeSide(const BetterPolygon &polygon,
-                             float startHegiht,
-                             const QVector<float> endHeight,
-                             const QVector<bool> dropWall,
-                             const TileMaterial *material) const;
+    /// Triangulates the polygon and adds it to mesh as a horizontal face.
+    void addTop(PartialMeshData &mesh,
+                const PolygonClipper::Polygon &polygon,
+                float height,
+                const MaterialInfo &material) const;
+
+    /// Adds the walls below the polygon's edges: axis-aligned walls to tileMesh.walls
+    /// and all others to tileMesh.mesh.
+    void addSide(TileMesh &tileMesh,
+                 const BetterPolygon &polygon,
+                 float startHegiht,
+                 const QVector<float> endHeight,
+                 const QVector<bool> dropWall,
+                 const MaterialInfo &material) const;
 };
 
 }
@@ -45,6 +45,12 @@ public:
      */
     virtual void create() {}
 
+    /**
+     * @brief Returns text to show over the rendered image, such as statistics about
+     * the last frame, or an empty string. Called on the OpenGL thread after paint().
+     */
+    virtual QString overlayText() const { return QString(); }
+
     /**
      * @brief Initializes OpenGL-related details.
      */
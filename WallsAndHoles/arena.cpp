@@ -0,0 +1,44 @@
+#include "arena.h"
+
+const size_t Arena::InlineSize;
+const size_t Arena::MinBlockSize;
+
+Arena::Arena()
+    : mBlock(mInlineBlock)
+    , mBlockSize(InlineSize)
+    , mBlockUsed(0)
+    , mBytesUsed(0)
+{
+
+}
+
+Arena::~Arena()
+{
+    for (char *block : mHeapBlocks)
+        delete[] block;
+}
+
+void *Arena::allocateBytes(size_t size, size_t alignment)
+{
+    // Pad the start of the allocation to the requested alignment.
+    size_t address = reinterpret_cast<size_t>(mBlock) + mBlockUsed;
+    size_t padding = (alignment - address % alignment) % alignment;
+
+    if (mBlockUsed + padding + size > mBlockSize) {
+        // Start a new block that is large enough. New blocks are aligned for any type.
+        mBlockSize = qMax(MinBlockSize, size + alignof(std::max_align_t));
+        mBlock = new char[mBlockSize];
+        mBlockUsed = 0;
+        mHeapBlocks.push_back(mBlock);
+
+        address = reinterpret_cast<size_t>(mBlock);
+        padding = (alignment - address % alignment) % alignment;
+    }
+
+    void *result = mBlock + mBlockUsed + padding;
+
+    mBlockUsed += padding + size;
+    mBytesUsed += padding + size;
+
+    return result;
+}
@@ -0,0 +1,155 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <QtGlobal>
+
+/**
+ * @brief A bump allocator for the temporary data of one computation.
+ *
+ * Memory is handed out from blocks that are only freed all at once, when the
+ * arena is destroyed. The first block lives inside the arena itself, so a
+ * computation that stays below InlineSize bytes never touches the heap.
+ *
+ * Destructors are never run, so only trivial types may be allocated.
+ */
+class Arena
+{
+public:
+    Arena();
+    ~Arena();
+
+    Arena(const Arena &) = delete;
+    Arena &operator =(const Arena &) = delete;
+
+    /**
+     * @brief Returns uninitialized memory for count objects of type T.
+     */
+    template< typename T >
+    T *allocate(int count)
+    {
+        static_assert(std::is_trivially_copyable<T>::value && std::is_trivially_destructible<T>::value,
+                      "Arena only holds trivial types.");
+
+        return static_cast<T *>(allocateBytes(count * sizeof(T), alignof(T)));
+    }
+
+    void *allocateBytes(size_t size, size_t alignment);
+
+    /**
+     * @brief Returns the number of bytes handed out so far, including padding.
+     */
+    size_t bytesUsed() const { return mBytesUsed; }
+
+    /**
+     * @brief Returns the number of blocks that had to be allocated on the heap.
+     */
+    int heapBlockCount() const { return int(mHeapBlocks.size()); }
+
+    static const size_t InlineSize = 8192;
+    static const size_t MinBlockSize = 65536;
+
+private:
+    alignas(std::max_align_t) char mInlineBlock[InlineSize];
+
+    /// The block that is currently being filled.
+    char *mBlock;
+    size_t mBlockSize;
+    size_t mBlockUsed;
+
+    size_t mBytesUsed;
+
+    std::vector<char *> mHeapBlocks;
+};
+
+
+/**
+ * @brief A growable array that allocates from an Arena.
+ *
+ * Growing leaves the old storage in the arena, which is fine for the short-lived
+ * arrays this is meant for. T must be trivially copyable.
+ */
+template< typename T >
+class ArenaVector
+{
+public:
+    explicit ArenaVector(Arena &arena, int capacity = 0)
+        : mArena(&arena)
+        , mData(nullptr)
+        , mSize(0)
+        , mCapacity(0)
+    {
+        reserve(capacity);
+    }
+
+    void reserve(int capacity)
+    {
+        if (capacity <= mCapacity)
+            return;
+
+        T *data = mArena->allocate<T>(capacity);
+        if (mSize > 0)
+            std::memcpy(data, mData, mSize * sizeof(T));
+
+        mData = data;
+        mCapacity = capacity;
+    }
+
+    void append(const T &value)
+    {
+        if (mSize == mCapacity)
+            reserve(qMax(8, 2 * mCapacity));
+
+        mData[mSize++] = value;
+    }
+
+    /**
+     * @brief Changes the size. New elements are uninitialized.
+     */
+    void resize(int size)
+    {
+        reserve(size);
+        mSize = size;
+    }
+
+    void removeLast() { --mSize; }
+    void clear() { mSize = 0; }
+
+    void swap(ArenaVector &other)
+    {
+        std::swap(mArena, other.mArena);
+        std::swap(mData, other.mData);
+        std::swap(mSize, other.mSize);
+        std::swap(mCapacity, other.mCapacity);
+    }
+
+    int size() const { return mSize; }
+    bool isEmpty() const { return mSize == 0; }
+
+    T &operator [](int i) { Q_ASSERT(i >= 0 && i < mSize); return mData[i]; }
+    const T &operator [](int i) const { Q_ASSERT(i >= 0 && i < mSize); return mData[i]; }
+
+    T &first() { return (*this)[0]; }
+    const T &first() const { return (*this)[0]; }
+    T &last() { return (*this)[mSize - 1]; }
+    const T &last() const { return (*this)[mSize - 1]; }
+
+    T *begin() { return mData; }
+    T *end() { return mData + mSize; }
+    const T *begin() const { return mData; }
+    const T *end() const { return mData + mSize; }
+
+private:
+    Arena *mArena;
+
+    T *mData;
+    int mSize;
+    int mCapacity;
+};
+
+#endif // ARENA_H
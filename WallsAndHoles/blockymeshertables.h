@@ -0,0 +1,232 @@
+#ifndef BLOCKYMESHERTABLES_H
+#define BLOCKYMESHERTABLES_H
+
+#include <QtGlobal>
+
+/**
+ * @brief Lookup tables for the decisions that the blocky meshers make.
+ *
+ * Whether a tile gets a diagonal or a bridge only depends on a few yes/no facts
+ * about its neighborhood, such as whether two tiles have the same template. The
+ * meshers pack those facts into a bitmask and look the decision up in a table that
+ * is generated at compile time. The shapes of the resulting polygons are tabulated
+ * too, relative to the neighboring tiles; only their final size and position depend
+ * on the tiles' thicknesses and positions.
+ */
+namespace M2M {
+namespace BlockyTables {
+
+template< int Size >
+struct Table {
+    quint8 entries[Size];
+
+    constexpr quint8 operator [](int i) const { return entries[i]; }
+};
+
+template< int Size >
+constexpr Table<Size> makeTable(quint8 (*decide)(int facts))
+{
+    Table<Size> table{};
+    for (int facts = 0; facts < Size; ++facts)
+        table.entries[facts] = decide(facts);
+
+    return table;
+}
+
+/// A corner of a neighbor's top square: the neighbor's offset and the corner's direction from its center.
+struct NeighborCorner {
+    int dx;
+    int dy;
+    int sx;
+    int sy;
+};
+
+
+/* BEGIN ground diagonals */
+/**
+ * @brief Facts about one side (left or right) of a ground tile. Positions are relative
+ * to the ground tile, with the x offsets mirrored for the right side, and "same" means
+ * having the same template as the tile on that side.
+ */
+enum GroundSideFact {
+    SideConnects = 1 << 0,          ///< The tile on this side has a template and connects diagonals.
+    TopSame = 1 << 1,               ///< (0, -1)
+    BottomSame = 1 << 2,            ///< (0, 1)
+    OppositeSame = 1 << 3,          ///< The tile on the other side.
+    FarTopSame = 1 << 4,            ///< (-1, -2)
+    FarTopOutsideSame = 1 << 5,     ///< (-2, -1)
+    FarBottomSame = 1 << 6,         ///< (-1, 2)
+    FarBottomOutsideSame = 1 << 7,  ///< (-2, 1)
+    TopCornerClear = 1 << 8,        ///< (-1, -1) has no template.
+    BottomCornerClear = 1 << 9,     ///< (-1, 1) has no template.
+    TopTaken = 1 << 10,             ///< The other side already made a diagonal at the top.
+    BottomTaken = 1 << 11           ///< The other side already made a diagonal at the bottom.
+};
+
+constexpr int NumGroundSideFacts = 12;
+
+enum GroundDiagonal {
+    TopInner = 1 << 0,
+    TopOuter = 1 << 1,
+    BottomInner = 1 << 2,
+    BottomOuter = 1 << 3
+};
+
+/// Returns the GroundDiagonals that one side of a ground tile makes.
+constexpr quint8 groundSideDiagonals(int facts)
+{
+    if (!(facts & SideConnects))
+        return 0;
+
+    quint8 diagonals = 0;
+
+    if ((facts & TopSame) && !(facts & TopTaken)) {
+        if (!(facts & BottomSame) && !(facts & OppositeSame))
+            diagonals |= TopInner;
+
+        if (!(facts & FarTopSame) && !(facts & FarTopOutsideSame) && (facts & TopCornerClear))
+            diagonals |= TopOuter;
+    }
+
+    // A side never makes diagonals at both the top and the bottom.
+    if (diagonals == 0 && (facts & BottomSame) && !(facts & BottomTaken)) {
+        if (!(facts & TopSame) && !(facts & OppositeSame))
+            diagonals |= BottomInner;
+
+        if (!(facts & FarBottomSame) && !(facts & FarBottomOutsideSame) && (facts & BottomCornerClear))
+            diagonals |= BottomOuter;
+    }
+
+    return diagonals;
+}
+
+constexpr Table<1 << NumGroundSideFacts> GroundSideTable = makeTable<1 << NumGroundSideFacts>(groundSideDiagonals);
+
+static_assert(GroundSideTable[SideConnects | TopSame | TopCornerClear] == (TopInner | TopOuter), "");
+static_assert(GroundSideTable[SideConnects | TopSame | BottomSame] == 0, "");
+static_assert(GroundSideTable[SideConnects | BottomSame | OppositeSame | BottomCornerClear] == BottomOuter, "");
+static_assert(GroundSideTable[SideConnects | TopSame | TopTaken | BottomSame | BottomCornerClear] == BottomOuter, "");
+static_assert(GroundSideTable[TopSame | TopCornerClear] == 0, "");
+
+/// The polygon of a ground diagonal, which is later clipped to the ground tile.
+struct GroundDiagonalShape {
+    /// 0 for the left side, 1 for the right side.
+    int side;
+
+    GroundDiagonal diagonal;
+
+    NeighborCorner points[4];
+};
+
+/// All ground diagonals, in the order in which they are made.
+constexpr GroundDiagonalShape GroundDiagonalShapes[8] = {
+    {0, TopInner,    {{-1, 0,  1, -1}, {-1, 0,  1,  1}, {0, -1,  1,  1}, {0, -1, -1,  1}}},
+    {0, TopOuter,    {{-1, 0, -1, -1}, {-1, 0,  1, -1}, {0, -1, -1,  1}, {0, -1, -1, -1}}},
+    {1, TopInner,    {{ 1, 0, -1,  1}, { 1, 0, -1, -1}, {0, -1,  1,  1}, {0, -1, -1,  1}}},
+    {1, TopOuter,    {{ 1, 0, -1, -1}, { 1, 0,  1, -1}, {0, -1,  1, -1}, {0, -1,  1,  1}}},
+    {0, BottomInner, {{-1, 0,  1, -1}, {-1, 0,  1,  1}, {0,  1, -1, -1}, {0,  1,  1, -1}}},
+    {0, BottomOuter, {{-1, 0,  1,  1}, {-1, 0, -1,  1}, {0,  1, -1,  1}, {0,  1, -1, -1}}},
+    {1, BottomInner, {{ 1, 0, -1,  1}, { 1, 0, -1, -1}, {0,  1, -1, -1}, {0,  1,  1, -1}}},
+    {1, BottomOuter, {{ 1, 0,  1,  1}, { 1, 0, -1,  1}, {0,  1,  1, -1}, {0,  1,  1,  1}}}
+};
+/* END ground diagonals */
+
+
+/* BEGIN block diagonals */
+/**
+ * @brief Facts about one direction (north, west, south or east) of a block tile.
+ * "Same" means having the same template as the block.
+ */
+enum BlockDirectionFact {
+    FrontFilled = 1 << 0,   ///< The tile in front has a template.
+    FarSame = 1 << 1,       ///< The tile two steps ahead.
+    LeftSame = 1 << 2,      ///< The tile diagonally ahead on the left.
+    RightSame = 1 << 3,     ///< The tile diagonally ahead on the right.
+    Bridged = 1 << 4        ///< A bridge was made in this direction.
+};
+
+constexpr int NumBlockDirectionFacts = 5;
+
+enum BlockDiagonal {
+    NoDiagonal = 0,
+    LeftDiagonal = 1,
+    RightDiagonal = 2
+};
+
+/// Returns the BlockDiagonal that a block makes in one direction.
+constexpr quint8 blockDirectionDiagonal(int facts)
+{
+    if ((facts & Bridged) || (facts & FrontFilled) || (facts & FarSame))
+        return NoDiagonal;
+
+    bool left = facts & LeftSame;
+    bool right = facts & RightSame;
+
+    if (left && !right)
+        return LeftDiagonal;
+    if (right && !left)
+        return RightDiagonal;
+
+    return NoDiagonal;
+}
+
+constexpr Table<1 << NumBlockDirectionFacts> BlockDirectionTable = makeTable<1 << NumBlockDirectionFacts>(blockDirectionDiagonal);
+
+static_assert(BlockDirectionTable[LeftSame] == LeftDiagonal, "");
+static_assert(BlockDirectionTable[RightSame] == RightDiagonal, "");
+static_assert(BlockDirectionTable[LeftSame | RightSame] == NoDiagonal, "");
+static_assert(BlockDirectionTable[FrontFilled | LeftSame] == NoDiagonal, "");
+static_assert(BlockDirectionTable[Bridged | RightSame] == NoDiagonal, "");
+
+/// The neighbors that decide a block's diagonals, for north, west, south and east.
+struct BlockDirection {
+    int frontX, frontY;
+    int farX, farY;
+    int leftX, leftY;
+    int rightX, rightY;
+};
+
+constexpr BlockDirection BlockDirections[4] = {
+    { 0, -1,   0, -2,  -1, -1,   1, -1},
+    {-1,  0,  -2,  0,  -1,  1,  -1, -1},
+    { 0,  1,   0,  2,   1,  1,  -1,  1},
+    { 1,  0,   2,  0,   1, -1,   1,  1}
+};
+/* END block diagonals */
+
+
+/* BEGIN block bridges */
+/**
+ * @brief A bridge from a block to the tile edge. Its polygon is made of two corners a
+ * and b of the block's top square and their projections onto the tile edge.
+ */
+struct BridgeShape {
+    /// The neighbor that the bridge connects to.
+    int dx;
+    int dy;
+
+    /// The edge of the block's top (0 north, 1 west, 2 south, 3 east) that the bridge replaces.
+    int wall;
+
+    /// The directions of the corners from the block's center.
+    int ax, ay;
+    int bx, by;
+
+    /// The tile edge is where the axis (0 for x, 1 for y) coordinate equals edge.
+    int axis;
+    int edge;
+};
+
+/// All bridges, in the order in which they are made.
+constexpr BridgeShape BridgeShapes[4] = {
+    { 0, -1,  0,  -1, -1,   1, -1,  1, 0},
+    { 1,  0,  3,   1, -1,   1,  1,  0, 1},
+    { 0,  1,  2,   1,  1,  -1,  1,  1, 1},
+    {-1,  0,  1,  -1,  1,  -1, -1,  0, 0}
+};
+/* END block bridges */
+
+}
+}
+
+#endif // BLOCKYMESHERTABLES_H
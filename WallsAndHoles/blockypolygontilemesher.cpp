@@ -1,4 +1,5 @@
 #include "blockypolygontilemesher.h"
+#include "blockymeshertables.h"
 
 using namespace M2M;
 
@@ -36,7 +37,7 @@ void BlockyPolygonTileMesher::determinIfWallShouldDrop(QPointF a, QPointF b, flo
 
     if (edge == -1) return;
 
-    const Tile *other;
+    const TileInfo *other;
     switch (edge) {
     case 0: //NORTH
         other = mTileNeighborhood(0, -1);
@@ -71,30 +72,6 @@ void BlockyPolygonTileMesher::determinIfWallShouldDrop(QPointF a, QPointF b, flo
     }
 }
 
-//0 NO
-//1 Left
-//2 Right
-int shouldDiagonal(const Tile *me, const Tile *center, const Tile *far, const Tile *left, const Tile *right)
-{
-    if (center != nullptr && center->hasTileTemplate()) return false;
-
-    if (far == nullptr || far->tileTemplate() != me->tileTemplate()) {
-        //If the tile two cells in front of this is on the same template type, a diagonal wont be made
-
-        if (left != nullptr
-                && left->tileTemplate() == me->tileTemplate()
-                && (right == nullptr || right->tileTemplate() != me->tileTemplate()))
-            return 1;
-
-        if (right != nullptr
-                && right->tileTemplate() == me->tileTemplate()
-                && (left == nullptr || left->tileTemplate() != me->tileTemplate()))
-            return 2;
-    }
-
-    return 0;
-}
-
 //edge refers to the edge of a unit box.
 QPointF lineHitsEdgeAt(const QLineF &line)
 {
@@ -128,9 +105,30 @@ Triplet<BetterPolygon, QVector<float>, QVector<bool>> makeDiagonal(QPointF meA,
 
 }
 
-QVector<Triplet<BetterPolygon, QVector<float>, QVector<bool>>> BlockyPolygonTileMesher::topPolygons(QVector<const Tile *> *)
+int BlockyPolygonTileMesher::directionDiagonal(const TileNeighborhoodInfo &nbhd, int direction, bool bridged)
 {
-    const Tile *me = mTileNeighborhood.centerTile();
+    const TileInfo *me = nbhd.centerTile();
+    const BlockyTables::BlockDirection &dir = BlockyTables::BlockDirections[direction];
+
+    auto same = [me] (const TileInfo *other) {
+        return other != nullptr && other->tileTemplate() == me->tileTemplate();
+    };
+
+    const TileInfo *front = nbhd(dir.frontX, dir.frontY);
+
+    int facts = 0;
+    if (front != nullptr && front->hasTileTemplate()) facts |= BlockyTables::FrontFilled;
+    if (same(nbhd(dir.farX, dir.farY))) facts |= BlockyTables::FarSame;
+    if (same(nbhd(dir.leftX, dir.leftY))) facts |= BlockyTables::LeftSame;
+    if (same(nbhd(dir.rightX, dir.rightY))) facts |= BlockyTables::RightSame;
+    if (bridged) facts |= BlockyTables::Bridged;
+
+    return BlockyTables::BlockDirectionTable[facts];
+}
+
+QVector<Triplet<BetterPolygon, QVector<float>, QVector<bool>>> BlockyPolygonTileMesher::topPolygons(QVector<const TileInfo *> *)
+{
+    const TileInfo *me = mTileNeighborhood.centerTile();
 
     QPointF center = me->position().toPointF();
     float halfThickness = me->thickness() / 2;
@@ -146,108 +144,53 @@ QVector<Triplet<BetterPolygon, QVector<float>, QVector<bool>>> BlockyPolygonTile
 
     QVector<Triplet<BetterPolygon, QVector<float>, QVector<bool>>> ret;
 
-    if (me->tileTemplate()->bridgeTiles() && halfThickness < 0.5) {
+    if (me->bridgeTiles() && halfThickness < 0.5) {
 
 //BRIDGING======================================================================================================
 
-        //North
-        if (mTileNeighborhood(0, -1) != nullptr
-                && me->tileTemplate() == mTileNeighborhood(0, -1)->tileTemplate()
-                && center.y() - halfThickness > 0) {
-            QVector<QPointF> bridge = {
-                center + QPointF(-halfThickness, -halfThickness),
-                center + QPointF(halfThickness, -halfThickness),
-                QPointF(halfThickness + center.x(), 0),
-                QPointF(-halfThickness + center.x(), 0)
+        for (const BlockyTables::BridgeShape &shape : BlockyTables::BridgeShapes) {
+            const TileInfo *other = mTileNeighborhood(shape.dx, shape.dy);
+            if (other == nullptr || me->tileTemplate() != other->tileTemplate())
+                continue;
+
+            //Only bridge if the block does not already reach the tile edge.
+            qreal blockEdge = (shape.axis == 0 ? center.x() : center.y())
+                    + (shape.edge == 0 ? -halfThickness : halfThickness);
+            if (shape.edge == 0 ? blockEdge <= 0 : blockEdge >= 1)
+                continue;
+
+            QPointF a = center + QPointF(shape.ax * halfThickness, shape.ay * halfThickness);
+            QPointF b = center + QPointF(shape.bx * halfThickness, shape.by * halfThickness);
+
+            auto project = [&shape] (QPointF p) {
+                if (shape.axis == 0)
+                    p.setX(shape.edge);
+                else
+                    p.setY(shape.edge);
+                return p;
             };
 
-            ret.append({bridge, QVector<float>(4, 0), {false, true, false, true}});
-            topWallDrops[0] = false;
-        }
-
-        //East
-        if (mTileNeighborhood(1, 0) != nullptr
-                && me->tileTemplate() == mTileNeighborhood(1, 0)->tileTemplate()
-                && center.x() + halfThickness < 1) {
-            QVector<QPointF> bridge = {
-                center + QPointF(halfThickness, -halfThickness),
-                center + QPointF(halfThickness, halfThickness),
-                QPointF(1, halfThickness + center.y()),
-                QPointF(1, -halfThickness + center.y())
-            };
-
-            ret.append({bridge, QVector<float>(4, 0), {false, true, false, true}});
-            topWallDrops[3] = false;
-        }
-
-        //South
-        if (mTileNeighborhood(0, 1) != nullptr
-                && me->tileTemplate() == mTileNeighborhood(0, 1)->tileTemplate()
-                && center.y() + halfThickness < 1) {
-            QVector<QPointF> bridge = {
-                center + QPointF(halfThickness, halfThickness),
-                center + QPointF(-halfThickness, halfThickness),
-                QPointF(-halfThickness + center.x(), 1),
-                QPointF(halfThickness + center.x(), 1)
-            };
+            QVector<QPointF> bridge = { a, b, project(b), project(a) };
 
             ret.append({bridge, QVector<float>(4, 0), {false, true, false, true}});
-            topWallDrops[2] = false;
-        }
-
-        //West
-        if (mTileNeighborhood(-1, 0) != nullptr
-                && me->tileTemplate() == mTileNeighborhood(-1, 0)->tileTemplate()
-                && center.x() - halfThickness > 0) {
-            QVector<QPointF> bridge = {
-                center + QPointF(-halfThickness, halfThickness),
-                center + QPointF(-halfThickness, -halfThickness),
-                QPointF(0, -halfThickness + center.y()),
-                QPointF(0, halfThickness + center.y())
-            };
-
-            ret.append({bridge, QVector<float>(4, 0), {false, true, false, true}});
-            topWallDrops[1] = false;
+            topWallDrops[shape.wall] = false;
         }
     }
 
-    if (me->tileTemplate()->connectDiagonals()) {
+    if (me->connectDiagonals()) {
 //DIAGONALS======================================================================================================
-        //Start by gathering how each side should "diagonal" (left right, or not at all)
-        const Tile *left[4];
-        const Tile *right[4];
+        //Start by looking up how each side should "diagonal" (left right, or not at all)
+        const TileInfo *left[4];
+        const TileInfo *right[4];
         int shouldDia[4];
 
-        const Tile *far;
-        const Tile *cent;
-
-        //NORTH
-        far = mTileNeighborhood(0, -2);
-        cent = mTileNeighborhood(0, -1);
-        left[0] = mTileNeighborhood(-1, -1);
-        right[0] = mTileNeighborhood(1, -1);
-        shouldDia[0] = topWallDrops[0]? shouldDiagonal(me, cent, far, left[0], right[0]) : 0;
-
-        //WEST
-        far = mTileNeighborhood(-2, 0);
-        cent = mTileNeighborhood(-1, 0);
-        left[1] = mTileNeighborhood(-1, 1);
-        right[1] = mTileNeighborhood(-1, -1);
-        shouldDia[1] = topWallDrops[1]? shouldDiagonal(me, cent, far, left[1], right[1]) : 0;
-
-        //SOUTH
-        far = mTileNeighborhood(0, 2);
-        cent = mTileNeighborhood(0, 1);
-        left[2] = mTileNeighborhood(1, 1);
-        right[2] = mTileNeighborhood(-1, 1);
-        shouldDia[2] = topWallDrops[2]? shouldDiagonal(me, cent, far, left[2], right[2]) : 0;
-
-        //EAST
-        far = mTileNeighborhood(2, 0);
-        cent = mTileNeighborhood(1, 0);
-        left[3] = mTileNeighborhood(1, -1);
-        right[3] = mTileNeighborhood(1, 1);
-        shouldDia[3] = topWallDrops[3]? shouldDiagonal(me, cent, far, left[3], right[3]) : 0;
+        for (int i = 0; i < 4; ++i) {
+            const BlockyTables::BlockDirection &dir = BlockyTables::BlockDirections[i];
+
+            left[i] = mTileNeighborhood(dir.leftX, dir.leftY);
+            right[i] = mTileNeighborhood(dir.rightX, dir.rightY);
+            shouldDia[i] = directionDiagonal(mTileNeighborhood, i, !topWallDrops[i]);
+        }
 
         QPoint corners[4] = {
             QPoint(-1, -1),
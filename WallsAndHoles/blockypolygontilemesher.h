@@ -10,8 +10,15 @@ class BlockyPolygonTileMesher : public AbstractPolygonTileMesher
 public:
     BlockyPolygonTileMesher(TileNeighborhoodInfo nbhd);
 
+    /**
+     * @brief Returns the BlockyTables::BlockDiagonal that the center block makes in a
+     * direction (0 north, 1 west, 2 south, 3 east).
+     * @param bridged   Whether the block made a bridge in that direction.
+     */
+    static int directionDiagonal(const TileNeighborhoodInfo &nbhd, int direction, bool bridged);
+
 protected:
-    QVector<Triplet<BetterPolygon, QVector<float>, QVector<bool>>> topPolygons(QVector<const Tile *> *);
+    QVector<Triplet<BetterPolygon, QVector<float>, QVector<bool>>> topPolygons(QVector<const TileInfo *> *);
 
 private:
     void determinIfWallShouldDrop(QPointF a, QPointF b, float &height, bool &shouldDrop);
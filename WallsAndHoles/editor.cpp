@@ -216,7 +216,7 @@ void Editor::loadMap()
                                                     mSavePath,
                                                     tr("Open Files (*.wah)"));
 
-    TileMap *tileMap = XMLTool::openTileMap(fileName, mTileTemplateSetManager);
+    TileMap *tileMap = mTileTemplateSetManager->openTileMap(fileName);
 
     if (tileMap == nullptr) {
         QMessageBox messageBox;
@@ -255,6 +255,9 @@ void Editor::exportMapMesh()
                                                     tr("Export Files (*.obj)"));
 
     if(!fileName.isEmpty()){
+        // Make sure the exported mesh includes the latest edits.
+        mMap2Mesh->finishSceneUpdate();
+
         SharedOBJModel obj = scene->exportOBJ();
         obj->save(fileName);
     }
@@ -372,7 +375,7 @@ void Editor::loadSettings()
     }
 
     if(!settings.value("tileMap").toString().isNull())
-        setTileMap(XMLTool::openTileMap(settings.value("tileMap").toString(), mTileTemplateSetManager));
+        setTileMap(mTileTemplateSetManager->openTileMap(settings.value("tileMap").toString()));
     else
         setTileMap(nullptr);
 
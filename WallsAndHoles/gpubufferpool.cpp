@@ -0,0 +1,406 @@
+#include "gpubufferpool.h"
+
+#include <cstddef>
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_3_2_Core>
+
+#include "packedmesh.h"
+#include "simpletexturedshader.h"
+
+namespace {
+
+int indexBytesToWords(int bytes)
+{
+    return (bytes + 3) / 4;
+}
+
+int indexSize(GLenum indexType)
+{
+    return indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+}
+
+}
+
+
+GpuBufferPool::GpuBufferPool(SimpleTexturedShader &shader)
+    : mShader(shader)
+    , mGL(nullptr)
+    , mNextPage(0)
+    , mNextId(0)
+    , mBoundPage(-1)
+    , mCompactionBlocked(false)
+    , mAllocationsThisFrame(0)
+    , mFreesThisFrame(0)
+    , mMovesThisFrame(0)
+    , mAllocationsLastFrame(0)
+    , mFreesLastFrame(0)
+    , mMovesLastFrame(0)
+{
+}
+
+void GpuBufferPool::create()
+{
+    destroy();
+
+    mGL = QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_3_2_Core>();
+    Q_ASSERT(mGL);
+    mGL->initializeOpenGLFunctions();
+}
+
+void GpuBufferPool::destroy()
+{
+    for (int page : mPages.keys())
+        destroyPage(page);
+
+    mRanges.clear();
+    mBoundPage = -1;
+    mCompactionBlocked = false;
+}
+
+
+int GpuBufferPool::allocate(const PackedMesh &mesh)
+{
+    Range range = allocateRange(mesh.vertices.size(), mesh.indices.size(), -1);
+    range.numIndices = mesh.numIndices;
+    range.indexType = mesh.indexType;
+
+    const Page &page = *mPages[range.page];
+    write(page.vertices, range.firstVertex * sizeof(PackedVertex),
+          mesh.vertices.constData(), mesh.vertices.size() * sizeof(PackedVertex));
+    write(page.indices, range.indexOffset, mesh.indices.constData(), mesh.indices.size());
+
+    int id = mNextId++;
+    mRanges.insert(id, range);
+    mPages[range.page]->allocations.insert(id);
+
+    mAllocationsThisFrame += 1;
+
+    return id;
+}
+
+void GpuBufferPool::free(int id)
+{
+    Q_ASSERT(mRanges.contains(id));
+
+    Range range = mRanges.take(id);
+    freeRange(range);
+
+    Page &page = *mPages[range.page];
+    page.allocations.remove(id);
+
+    // An empty shared page is kept if it is the only one, since it is likely to be
+    // needed again soon.
+    if (page.allocations.isEmpty()) {
+        bool otherShared = false;
+        for (auto it = mPages.cbegin(); it != mPages.cend(); ++it)
+            otherShared |= it.key() != range.page && !it.value()->dedicated;
+
+        if (page.dedicated || otherShared)
+            destroyPage(range.page);
+    }
+
+    mFreesThisFrame += 1;
+    mCompactionBlocked = false;
+}
+
+const GpuBufferPool::Range &GpuBufferPool::range(int id) const
+{
+    Q_ASSERT(mRanges.contains(id));
+    return *mRanges.find(id);
+}
+
+
+GpuBufferPool::DrawList GpuBufferPool::makeDrawList(int id) const
+{
+    const Range &r = range(id);
+
+    DrawList list;
+    list.page = r.page;
+    list.indexType = r.indexType;
+
+    return list;
+}
+
+void GpuBufferPool::appendToDrawList(DrawList &list, int id) const
+{
+    const Range &r = range(id);
+    Q_ASSERT(r.page == list.page && r.indexType == list.indexType);
+
+    list.counts.append(r.numIndices);
+    list.indexOffsets.append(reinterpret_cast<const GLvoid *>(std::ptrdiff_t(r.indexOffset)));
+    list.baseVertices.append(r.firstVertex);
+}
+
+void GpuBufferPool::draw(const DrawList &list)
+{
+    bindPage(list.page);
+
+    mGL->glMultiDrawElementsBaseVertex(GL_TRIANGLES, list.counts.constData(), list.indexType,
+                                       list.indexOffsets.constData(), list.counts.size(),
+                                       list.baseVertices.constData());
+}
+
+void GpuBufferPool::drawInstanced(int id, QOpenGLBuffer &offsets, int firstInstance, int numInstances)
+{
+    const Range &r = range(id);
+
+    bindPage(r.page);
+
+    // The offset array is only enabled for this draw, so the page's vertex array
+    // object is left as it was.
+    offsets.bind();
+    mShader.setAttrOffsetBuffer(firstInstance * 3 * sizeof(GLfloat), 3 * sizeof(GLfloat));
+    mShader.enableOffsetArray();
+    offsets.release();
+
+    mGL->glDrawElementsInstancedBaseVertex(GL_TRIANGLES, r.numIndices, r.indexType,
+                                           reinterpret_cast<const GLvoid *>(std::ptrdiff_t(r.indexOffset)),
+                                           numInstances, r.firstVertex);
+
+    mShader.disableOffsetArray();
+}
+
+void GpuBufferPool::releaseVertexArrays()
+{
+    if (mBoundPage >= 0)
+        mPages[mBoundPage]->vao.release();
+
+    mBoundPage = -1;
+}
+
+
+bool GpuBufferPool::compact(qint64 maxBytes)
+{
+    if (mCompactionBlocked || stats().fragmentation <= MaxFragmentation)
+        return false;
+
+    // Empty the shared page that has the fewest vertices.
+    int source = -1;
+    int sourceVertices = 0;
+    int numShared = 0;
+    for (auto it = mPages.cbegin(); it != mPages.cend(); ++it) {
+        if (it.value()->dedicated)
+            continue;
+
+        numShared += 1;
+
+        int used = it.value()->vertexRanges.used();
+        if (source < 0 || used < sourceVertices) {
+            source = it.key();
+            sourceVertices = used;
+        }
+    }
+
+    if (numShared < 2)
+        return false;
+
+    qint64 movedBytes = 0;
+    const QSharedPointer<Page> sourcePage = mPages[source];
+
+    for (int id : sourcePage->allocations.values()) {
+        if (movedBytes >= maxBytes)
+            return true;
+
+        Range &from = mRanges[id];
+
+        // Moving into a new page would not reduce the number of pages.
+        int numPages = mPages.size();
+        Range to = allocateRange(from.numVertices, from.indexBytes, source);
+        if (mPages.size() > numPages) {
+            destroyPage(to.page);
+            mCompactionBlocked = true;
+            return false;
+        }
+
+        to.numIndices = from.numIndices;
+        to.indexType = from.indexType;
+
+        const Page &toPage = *mPages[to.page];
+        copy(sourcePage->vertices, from.firstVertex * sizeof(PackedVertex),
+             toPage.vertices, to.firstVertex * sizeof(PackedVertex),
+             from.numVertices * sizeof(PackedVertex));
+        copy(sourcePage->indices, from.indexOffset,
+             toPage.indices, to.indexOffset,
+             from.indexBytes);
+
+        freeRange(from);
+        sourcePage->allocations.remove(id);
+        mPages[to.page]->allocations.insert(id);
+        from = to;
+
+        movedBytes += from.numVertices * sizeof(PackedVertex) + from.indexBytes;
+        mMovesThisFrame += 1;
+    }
+
+    destroyPage(source);
+
+    return stats().fragmentation > MaxFragmentation;
+}
+
+
+GpuBufferPool::Stats GpuBufferPool::stats() const
+{
+    Stats stats;
+    stats.bytesInUse = 0;
+    stats.bytesReserved = 0;
+    stats.pages = mPages.size();
+    stats.allocations = mRanges.size();
+    stats.allocationsLastFrame = mAllocationsLastFrame;
+    stats.freesLastFrame = mFreesLastFrame;
+    stats.movesLastFrame = mMovesLastFrame;
+
+    qint64 sharedInUse = 0;
+    qint64 sharedReserved = 0;
+
+    for (const QSharedPointer<Page> &page : mPages) {
+        qint64 inUse = qint64(page->vertexRanges.used()) * sizeof(PackedVertex)
+                + qint64(page->indexRanges.used()) * 4;
+        qint64 reserved = qint64(page->vertexRanges.capacity()) * sizeof(PackedVertex)
+                + qint64(page->indexRanges.capacity()) * 4;
+
+        stats.bytesInUse += inUse;
+        stats.bytesReserved += reserved;
+
+        if (!page->dedicated) {
+            sharedInUse += inUse;
+            sharedReserved += reserved;
+        }
+    }
+
+    stats.fragmentation = sharedReserved == 0 ? 0 : 1 - double(sharedInUse) / sharedReserved;
+
+    return stats;
+}
+
+void GpuBufferPool::endFrame()
+{
+    mAllocationsLastFrame = mAllocationsThisFrame;
+    mFreesLastFrame = mFreesThisFrame;
+    mMovesLastFrame = mMovesThisFrame;
+
+    mAllocationsThisFrame = 0;
+    mFreesThisFrame = 0;
+    mMovesThisFrame = 0;
+}
+
+
+int GpuBufferPool::createPage(int numVertices, int indexWords)
+{
+    auto page = QSharedPointer<Page>::create();
+
+    page->dedicated = numVertices > PageVertices || indexWords > indexBytesToWords(PageIndexBytes);
+    if (!page->dedicated) {
+        numVertices = PageVertices;
+        indexWords = indexBytesToWords(PageIndexBytes);
+    }
+
+    page->vertexRanges = RangeAllocator(numVertices);
+    page->indexRanges = RangeAllocator(indexWords);
+
+    // Parts of the buffers are rewritten as meshes come and go.
+    page->vertices.create();
+    page->vertices.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    page->vertices.bind();
+    page->vertices.allocate(numVertices * sizeof(PackedVertex));
+
+    page->vao.create();
+    page->vao.bind();
+
+    mShader.setAttrPositionBuffer(offsetof(PackedVertex, position), sizeof(PackedVertex));
+    mShader.setAttrNormalBuffer(offsetof(PackedVertex, normal), sizeof(PackedVertex));
+    mShader.setAttrTexCoordsBuffer(offsetof(PackedVertex, texCoord), sizeof(PackedVertex));
+    mShader.setAttrMaterialBuffer(offsetof(PackedVertex, material), sizeof(PackedVertex));
+    mShader.enableArrays();
+
+    // The index buffer binding is part of the vertex array object's state.
+    page->indices.create();
+    page->indices.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    page->indices.bind();
+    page->indices.allocate(indexWords * 4);
+
+    page->vao.release();
+    page->vertices.release();
+
+    // The page's vertex array object replaced any bound one.
+    mBoundPage = -1;
+
+    int id = mNextPage++;
+    mPages.insert(id, page);
+    return id;
+}
+
+void GpuBufferPool::destroyPage(int page)
+{
+    Q_ASSERT(mPages.contains(page));
+
+    QSharedPointer<Page> p = mPages.take(page);
+    p->vao.destroy();
+    p->vertices.destroy();
+    p->indices.destroy();
+
+    if (mBoundPage == page)
+        mBoundPage = -1;
+}
+
+GpuBufferPool::Range GpuBufferPool::allocateRange(int numVertices, int indexBytes, int excludedPage)
+{
+    int indexWords = indexBytesToWords(indexBytes);
+
+    Range range;
+    range.numVertices = numVertices;
+    range.indexBytes = indexBytes;
+
+    // Vertices and indices must be in the same page.
+    for (auto it = mPages.begin(); it != mPages.end(); ++it) {
+        Page &page = *it.value();
+        if (it.key() == excludedPage || page.dedicated)
+            continue;
+
+        if (page.vertexRanges.largestFree() < numVertices || page.indexRanges.largestFree() < indexWords)
+            continue;
+
+        range.page = it.key();
+        range.firstVertex = page.vertexRanges.allocate(numVertices);
+        range.indexOffset = 4 * page.indexRanges.allocate(indexWords);
+        return range;
+    }
+
+    range.page = createPage(numVertices, indexWords);
+
+    Page &page = *mPages[range.page];
+    range.firstVertex = page.vertexRanges.allocate(numVertices);
+    range.indexOffset = 4 * page.indexRanges.allocate(indexWords);
+    return range;
+}
+
+void GpuBufferPool::bindPage(int page)
+{
+    if (mBoundPage != page) {
+        mPages[page]->vao.bind();
+        mBoundPage = page;
+    }
+}
+
+void GpuBufferPool::freeRange(const Range &range)
+{
+    Page &page = *mPages[range.page];
+    page.vertexRanges.free(range.firstVertex, range.numVertices);
+    page.indexRanges.free(range.indexOffset / 4, indexBytesToWords(range.indexBytes));
+}
+
+void GpuBufferPool::write(const QOpenGLBuffer &buffer, int offset, const void *data, int bytes)
+{
+    mGL->glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.bufferId());
+    mGL->glBufferSubData(GL_COPY_WRITE_BUFFER, offset, bytes, data);
+    mGL->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GpuBufferPool::copy(const QOpenGLBuffer &from, int fromOffset, const QOpenGLBuffer &to, int toOffset, int bytes)
+{
+    mGL->glBindBuffer(GL_COPY_READ_BUFFER, from.bufferId());
+    mGL->glBindBuffer(GL_COPY_WRITE_BUFFER, to.bufferId());
+    mGL->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, fromOffset, toOffset, bytes);
+    mGL->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    mGL->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
@@ -0,0 +1,230 @@
+#ifndef GPUBUFFERPOOL_H
+#define GPUBUFFERPOOL_H
+
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QSharedPointer>
+#include <QVector>
+
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+
+#include "rangeallocator.h"
+
+class QOpenGLFunctions_3_2_Core;
+
+struct PackedMesh;
+class SimpleTexturedShader;
+
+/**
+ * @brief Stores the vertices and indices of many meshes in a few large OpenGL buffers.
+ *
+ * The buffers are split into pages. Each page has one vertex buffer, one index buffer
+ * and one vertex array object, and a RangeAllocator for each buffer. A mesh is
+ * uploaded into free ranges of one page and drawn with a base vertex, so adding or
+ * removing a mesh does not create or destroy any OpenGL objects unless a page fills
+ * up or empties. Meshes that are too large for a page get a page of their own.
+ *
+ * Removing meshes leaves holes in the pages. compact() moves meshes out of the
+ * emptiest page into the holes of the others, a few at a time, until the page is
+ * empty and can be destroyed.
+ *
+ * All methods except stats() assume that the correct OpenGL context is current.
+ */
+class GpuBufferPool
+{
+public:
+    /// The vertex capacity of a page; 16-bit indices can address all of its vertices.
+    static const int PageVertices = 65536;
+
+    /// The index capacity of a page, in bytes.
+    static const int PageIndexBytes = 6 * PageVertices;
+
+
+    /// Where an allocation is stored.
+    struct Range {
+        int page;
+
+        /// The position of the first vertex in the page's vertex buffer, in vertices.
+        int firstVertex;
+        int numVertices;
+
+        /// The position of the indices in the page's index buffer, in bytes.
+        int indexOffset;
+        int indexBytes;
+
+        int numIndices;
+        GLenum indexType;
+    };
+
+    struct Stats {
+        /// The bytes taken by allocations.
+        qint64 bytesInUse;
+
+        /// The size of all pages, in bytes.
+        qint64 bytesReserved;
+
+        /// The fraction of the shared pages that is free. Meshes that have a page of
+        /// their own are not counted.
+        double fragmentation;
+
+        int pages;
+        int allocations;
+
+        /// The number of allocate(), free() and compaction moves in the last frame.
+        int allocationsLastFrame;
+        int freesLastFrame;
+        int movesLastFrame;
+    };
+
+
+    explicit GpuBufferPool(SimpleTexturedShader &shader);
+
+    /**
+     * @brief Prepares the pool for use with the current context. Destroys any
+     * previous contents.
+     */
+    void create();
+
+    /// Destroys all pages. Previously returned ids become invalid.
+    void destroy();
+
+
+    /// Uploads the mesh and returns the id of its allocation.
+    int allocate(const PackedMesh &mesh);
+
+    /// Frees an allocation. The page is destroyed if it becomes empty.
+    void free(int id);
+
+    const Range &range(int id) const;
+
+
+    /// Allocations in one page that are drawn with a single glMultiDrawElementsBaseVertex().
+    struct DrawList {
+        int page;
+        GLenum indexType;
+
+        QVector<GLsizei> counts;
+        QVector<const GLvoid *> indexOffsets;
+        QVector<GLint> baseVertices;
+
+        int size() const { return counts.size(); }
+
+        /// Appends entry i of another list with the same page and index type.
+        void appendFrom(const DrawList &other, int i)
+        {
+            counts.append(other.counts[i]);
+            indexOffsets.append(other.indexOffsets[i]);
+            baseVertices.append(other.baseVertices[i]);
+        }
+    };
+
+    /// Starts a draw list for allocations that have the same page and index type as id.
+    DrawList makeDrawList(int id) const;
+
+    /// Appends an allocation to a draw list. The allocation must belong in the list.
+    void appendToDrawList(DrawList &list, int id) const;
+
+    /**
+     * @brief Draws the triangles of the allocations in the list. The shader program
+     * should be bound, and releaseVertexArrays() should be called after the last draw.
+     */
+    void draw(const DrawList &list);
+
+    /**
+     * @brief Draws an allocation's triangles numInstances times, moved by the offsets
+     * in the given buffer, starting at firstInstance.
+     */
+    void drawInstanced(int id, QOpenGLBuffer &offsets, int firstInstance, int numInstances);
+
+    void releaseVertexArrays();
+
+
+    /**
+     * @brief Moves allocations out of the emptiest shared page if the fragmentation
+     * is above MaxFragmentation.
+     *
+     * @param maxBytes  Stops after moving this many bytes.
+     * @return Whether there is more to compact.
+     */
+    bool compact(qint64 maxBytes);
+
+    /// The fragmentation above which compact() moves allocations.
+    static constexpr double MaxFragmentation = 0.5;
+
+
+    Stats stats() const;
+
+    /// Starts counting the allocations, frees and moves of a new frame.
+    void endFrame();
+
+private:
+    struct Page {
+        QOpenGLBuffer vertices;
+        QOpenGLBuffer indices;
+        QOpenGLVertexArrayObject vao;
+
+        /// In vertices.
+        RangeAllocator vertexRanges;
+
+        /// In 4-byte words, which keeps index offsets aligned.
+        RangeAllocator indexRanges;
+
+        /// Whether the page was made for a single large mesh.
+        bool dedicated;
+
+        QSet<int> allocations;
+
+        Page() : vertices(QOpenGLBuffer::VertexBuffer), indices(QOpenGLBuffer::IndexBuffer) {}
+    };
+
+    /// Creates a page with room for at least the given number of vertices and index words.
+    int createPage(int numVertices, int indexWords);
+
+    void destroyPage(int page);
+
+    /// Allocates ranges in a page other than excludedPage, making a new page if needed.
+    Range allocateRange(int numVertices, int indexBytes, int excludedPage);
+
+    /// Binds the page's vertex array object if it is not bound yet.
+    void bindPage(int page);
+
+    /// Frees the range without destroying its page.
+    void freeRange(const Range &range);
+
+    /// Uploads data into a buffer through GL_COPY_WRITE_BUFFER, which keeps the
+    /// element array binding of the current vertex array object untouched.
+    void write(const QOpenGLBuffer &buffer, int offset, const void *data, int bytes);
+
+    /// Copies data between two buffers.
+    void copy(const QOpenGLBuffer &from, int fromOffset, const QOpenGLBuffer &to, int toOffset, int bytes);
+
+
+    SimpleTexturedShader &mShader;
+
+    QOpenGLFunctions_3_2_Core *mGL;
+
+
+    QMap<int, QSharedPointer<Page>> mPages;
+    int mNextPage;
+
+    QHash<int, Range> mRanges;
+    int mNextId;
+
+    /// The page whose vertex array object is bound, or -1.
+    int mBoundPage;
+
+    /// Set when an allocation could not be moved, and reset by free().
+    bool mCompactionBlocked;
+
+    int mAllocationsThisFrame;
+    int mFreesThisFrame;
+    int mMovesThisFrame;
+
+    int mAllocationsLastFrame;
+    int mFreesLastFrame;
+    int mMovesLastFrame;
+};
+
+#endif // GPUBUFFERPOOL_H
@@ -1,4 +1,5 @@
 #include "groundblockypolygontilemesher.h"
+#include "blockymeshertables.h"
 
 using namespace M2M;
 
@@ -60,269 +61,78 @@ QVector<Triplet<BetterPolygon, QVector<float>, QVector<bool>>> makeDiagonal(QPoi
     return {{ poly, QVector<float>(poly.points().size(), 0), drops }};
 }
 
-QVector<Triplet<BetterPolygon, QVector<float>, QVector<bool>>> GroundBlockyPolygonTileMesher::topPolygons(QVector<const Tile *> *heightAndMaterial)
+quint8 GroundBlockyPolygonTileMesher::sideDiagonals(const TileNeighborhoodInfo &nbhd, int side, quint8 leftDiagonals)
 {
-    //first is the inner diagonal, second is the outer diagonal
-    QPair<bool, bool> topLeft(false, false);
-    QPair<bool, bool> topRight(false, false);
-    QPair<bool, bool> bottomLeft(false, false);
-    QPair<bool, bool> bottomRight(false, false);
-
-    //LEFT ::::::::::::::::::::::::::::::::::::::::::::::
-
-    if (mTileNeighborhood(-1, 0) != nullptr
-            && mTileNeighborhood(-1, 0)->hasTileTemplate()
-            && mTileNeighborhood(-1, 0)->tileTemplate()->connectDiagonals()) {
-        if (mTileNeighborhood(0, -1) != nullptr
-                && mTileNeighborhood(0, -1)->tileTemplate() == mTileNeighborhood(-1, 0)->tileTemplate()) {
-            //Left and Top have the same tile template
-            //Now check if the inner diagonal should be made;
-
-            bool botDiff = mTileNeighborhood(0, 1) == nullptr
-                    || mTileNeighborhood(0, 1)->tileTemplate() != mTileNeighborhood(-1, 0)->tileTemplate();
-            bool rightDiff = mTileNeighborhood(1, 0) == nullptr
-                    || mTileNeighborhood(1, 0)->tileTemplate() != mTileNeighborhood(-1, 0)->tileTemplate();
-
-            if (botDiff && rightDiff)
-                topLeft.first = true;
-
-            //Now see if the outer diagonal should be made;
-
-            bool farTopDiff = mTileNeighborhood(-1, -2) == nullptr
-                    || mTileNeighborhood(-1, -2)->tileTemplate() != mTileNeighborhood(-1, 0)->tileTemplate();
-            bool farLeftDiff = mTileNeighborhood(-2, -1) == nullptr
-                    || mTileNeighborhood(-2, -1)->tileTemplate() != mTileNeighborhood(-1, 0)->tileTemplate();
-            bool centerClear = mTileNeighborhood(-1, -1) == nullptr
-                    || !mTileNeighborhood(-1, -1)->hasTileTemplate();
-
-            if (farTopDiff && farLeftDiff && centerClear)
-                topLeft.second = true;
-        }
-
-        if (!topLeft.first && !topLeft.second
-                && mTileNeighborhood(0, 1) != nullptr
-                && mTileNeighborhood(0, 1)->tileTemplate() == mTileNeighborhood(-1, 0)->tileTemplate()) {
-            //Left and top did not connect a diagonal
-            //Try between Left and Bottom
-
-            bool topDiff = mTileNeighborhood(0, -1) == nullptr
-                    || mTileNeighborhood(0, -1)->tileTemplate() != mTileNeighborhood(-1, 0)->tileTemplate();
-            bool rightDiff = mTileNeighborhood(1, 0) == nullptr
-                    || mTileNeighborhood(1, 0)->tileTemplate() != mTileNeighborhood(-1, 0)->tileTemplate();
-
-            if (topDiff && rightDiff)
-                bottomLeft.first = true;
-
-            //Now see if outer diagonal should be made
-
-            bool farBottomDiff = mTileNeighborhood(-1, 2) == nullptr
-                    || mTileNeighborhood(-1, 2)->tileTemplate() != mTileNeighborhood(-1, 0)->tileTemplate();
-            bool farLeftDiff = mTileNeighborhood(-2, 1) == nullptr
-                    || mTileNeighborhood(-2, 1)->tileTemplate() != mTileNeighborhood(-1, 0)->tileTemplate();
-            bool centerClear = mTileNeighborhood(-1, 1) == nullptr
-                    || !mTileNeighborhood(-1, 1)->hasTileTemplate();
-
-            if (farBottomDiff && farLeftDiff && centerClear)
-                bottomLeft.second = true;
-        }
+    using namespace BlockyTables;
+
+    const TileInfo *sideTile = nbhd(side == 0 ? -1 : 1, 0);
+    if (sideTile == nullptr || !sideTile->hasTileTemplate() || !sideTile->connectDiagonals())
+        return 0;
+
+    //Offsets are given for the left side, so mirror them for the right.
+    int mirror = side == 0 ? 1 : -1;
+
+    auto same = [&nbhd, sideTile, mirror] (int x, int y) {
+        const TileInfo *other = nbhd(mirror * x, y);
+        return other != nullptr && other->tileTemplate() == sideTile->tileTemplate();
+    };
+    auto clear = [&nbhd, mirror] (int x, int y) {
+        const TileInfo *other = nbhd(mirror * x, y);
+        return other == nullptr || !other->hasTileTemplate();
+    };
+
+    int facts = SideConnects;
+    if (same(0, -1)) facts |= TopSame;
+    if (same(0, 1)) facts |= BottomSame;
+    if (same(1, 0)) facts |= OppositeSame;
+    if (same(-1, -2)) facts |= FarTopSame;
+    if (same(-2, -1)) facts |= FarTopOutsideSame;
+    if (same(-1, 2)) facts |= FarBottomSame;
+    if (same(-2, 1)) facts |= FarBottomOutsideSame;
+    if (clear(-1, -1)) facts |= TopCornerClear;
+    if (clear(-1, 1)) facts |= BottomCornerClear;
+
+    if (side == 1) {
+        if (leftDiagonals & (TopInner | TopOuter)) facts |= TopTaken;
+        if (leftDiagonals & (BottomInner | BottomOuter)) facts |= BottomTaken;
     }
 
-    //RIGHT :::::::::::::::::::::::::::::::::::::::::::::
-
-    if (mTileNeighborhood(1, 0) != nullptr
-            && mTileNeighborhood(1, 0)->hasTileTemplate()
-            && mTileNeighborhood(1, 0)->tileTemplate()->connectDiagonals()) {
-        if (!topLeft.first && !topLeft.second
-                && mTileNeighborhood(0, -1) != nullptr
-                && mTileNeighborhood(0, -1)->tileTemplate() == mTileNeighborhood(1, 0)->tileTemplate()) {
-            //Right and top have the same template
-            //Now check if the inner diagonal should be made
-
-            bool botDiff = mTileNeighborhood(0, 1) == nullptr
-                    || mTileNeighborhood(0, 1)->tileTemplate() != mTileNeighborhood(1, 0)->tileTemplate();
-            bool leftDiff = mTileNeighborhood(-1, 0) == nullptr
-                    || mTileNeighborhood(-1, 0)->tileTemplate() != mTileNeighborhood(1, 0)->tileTemplate();
-
-            if (botDiff && leftDiff)
-                topRight.first = true;
-
-            //Now see if outer diagonal should be made
-
-            bool farTopDiff = mTileNeighborhood(1, -2) == nullptr
-                    || mTileNeighborhood(1, -2)->tileTemplate() != mTileNeighborhood(1, 0)->tileTemplate();
-            bool farRightDiff = mTileNeighborhood(2, -1) == nullptr
-                    || mTileNeighborhood(2, -1)->tileTemplate() != mTileNeighborhood(1, 0)->tileTemplate();
-            bool centerClear = mTileNeighborhood(1, -1) == nullptr
-                    || !mTileNeighborhood(1, -1)->hasTileTemplate();
-
-            if (farTopDiff && farRightDiff && centerClear)
-                topRight.second = true;
-        }
-
-        if (!bottomLeft.first && !bottomLeft.second && !topRight.first && !topRight.second
-                && mTileNeighborhood(0, 1) != nullptr
-                && mTileNeighborhood(0, 1)->tileTemplate() == mTileNeighborhood(1, 0)->tileTemplate()) {
-            //Right and bottom have same template, and no other diagonal conflicts
-            //Now check if the inner diagonal should be made
-
-            bool topDiff = mTileNeighborhood(0, -1) == nullptr
-                    || mTileNeighborhood(0, -1)->tileTemplate() != mTileNeighborhood(1, 0)->tileTemplate();
-            bool leftDiff = mTileNeighborhood(-1, 0) == nullptr
-                    || mTileNeighborhood(-1, 0)->tileTemplate() != mTileNeighborhood(1, 0)->tileTemplate();
-
-            if (topDiff && leftDiff)
-                bottomRight.first = true;
-
-            //Now see if the outer diagonal should be made
+    return GroundSideTable[facts];
+}
 
-            bool farBottomDiff = mTileNeighborhood(1, 2) == nullptr
-                    || mTileNeighborhood(1, 2)->tileTemplate() != mTileNeighborhood(1, 0)->tileTemplate();
-            bool farLeftDiff = mTileNeighborhood(2, 1) == nullptr
-                    || mTileNeighborhood(2, 1)->tileTemplate() != mTileNeighborhood(1, 0)->tileTemplate();
-            bool centerClear = mTileNeighborhood(1, 1) == nullptr
-                    || !mTileNeighborhood(1, 1)->hasTileTemplate();
+QVector<Triplet<BetterPolygon, QVector<float>, QVector<bool>>> GroundBlockyPolygonTileMesher::topPolygons(QVector<const TileInfo *> *heightAndMaterial)
+{
+    using namespace BlockyTables;
 
-            if (farBottomDiff && farLeftDiff && centerClear)
-                bottomRight.second = true;
-        }
-    }
+    //Look up which diagonals the left (0) and right (1) neighbors make.
+    const TileInfo *sideTiles[2] = { mTileNeighborhood(-1, 0), mTileNeighborhood(1, 0) };
 
-    //We now have all the info on which diagonals exist, and need to be constructed
-    //TODO This just manually runs through all 8 possible diagonals, could probably be made to run on a loop
+    quint8 diagonals[2];
+    diagonals[0] = sideDiagonals(mTileNeighborhood, 0, 0);
+    diagonals[1] = sideDiagonals(mTileNeighborhood, 1, diagonals[0]);
 
     QVector<Triplet<BetterPolygon, QVector<float>, QVector<bool>>> ret;
 
-    const Tile *left = mTileNeighborhood(-1, 0);
-    const Tile *right = mTileNeighborhood(1, 0);
-    const Tile *top = mTileNeighborhood(0, -1);
-    const Tile *bottom = mTileNeighborhood(0, 1);
-
-    if (topLeft.first) {
-        QPointF topCenter = top->position().toPointF() + QPointF(0, -1);
-        QPointF leftCenter = left->position().toPointF() + QPointF(-1, 0);
-        float topHalfThickness = top->thickness() / 2;
-        float leftHalfThickness = left->thickness() / 2;
-
-        auto dia = makeDiagonal(
-                    leftCenter + QPointF(leftHalfThickness, -leftHalfThickness),
-                    leftCenter + QPointF(leftHalfThickness, leftHalfThickness),
-                    topCenter + QPointF(topHalfThickness, topHalfThickness),
-                    topCenter + QPointF(-topHalfThickness, topHalfThickness));
-
-        ret.append(dia);
-        heightAndMaterial->append(QVector<const Tile *>(dia.size(), left));
-    }
-
-    if (topLeft.second) {
-        QPointF topCenter = top->position().toPointF() + QPointF(0, -1);
-        QPointF leftCenter = left->position().toPointF() + QPointF(-1, 0);
-        float topHalfThickness = top->thickness() / 2;
-        float leftHalfThickness = left->thickness() / 2;
-
-        auto dia = makeDiagonal(
-                    leftCenter + QPointF(-leftHalfThickness, -leftHalfThickness),
-                    leftCenter + QPointF(leftHalfThickness, -leftHalfThickness),
-                    topCenter + QPointF(-topHalfThickness, topHalfThickness),
-                    topCenter + QPointF(-topHalfThickness, -topHalfThickness));
-
-        ret.append(dia);
-        heightAndMaterial->append(QVector<const Tile *>(dia.size(), left));
-    }
-
-    if (topRight.first) {
-        QPointF topCenter = top->position().toPointF() + QPointF(0, -1);
-        QPointF rightCenter = right->position().toPointF() + QPointF(1, 0);
-        float topHalfThickness = top->thickness() / 2;
-        float rightHalfThickness = right->thickness() / 2;
-
-        auto dia = makeDiagonal(
-                    rightCenter + QPointF(-rightHalfThickness, rightHalfThickness),
-                    rightCenter + QPointF(-rightHalfThickness, -rightHalfThickness),
-                    topCenter + QPointF(topHalfThickness, topHalfThickness),
-                    topCenter + QPointF(-topHalfThickness, topHalfThickness));
-
-        ret.append(dia);
-        heightAndMaterial->append(QVector<const Tile *>(dia.size(), right));
-    }
-
-    if (topRight.second) {
-        QPointF topCenter = top->position().toPointF() + QPointF(0, -1);
-        QPointF rightCenter = right->position().toPointF() + QPointF(1, 0);
-        float topHalfThickness = top->thickness() / 2;
-        float rightHalfThickness = right->thickness() / 2;
-
-        auto dia = makeDiagonal(
-                    rightCenter + QPointF(-rightHalfThickness, -rightHalfThickness),
-                    rightCenter + QPointF(rightHalfThickness, -rightHalfThickness),
-                    topCenter + QPointF(topHalfThickness, -topHalfThickness),
-                    topCenter + QPointF(topHalfThickness, topHalfThickness));
-
-        ret.append(dia);
-        heightAndMaterial->append(QVector<const Tile *>(dia.size(), right));
-    }
-
-    if (bottomLeft.first) {
-        QPointF bottomCenter = bottom->position().toPointF() + QPointF(0, 1);
-        QPointF leftCenter = left->position().toPointF() + QPointF(-1, 0);
-        float bottomHalfThickness = bottom->thickness() / 2;
-        float leftHalfThickness = left->thickness() / 2;
-
-        auto dia = makeDiagonal(
-                    leftCenter + QPointF(leftHalfThickness, -leftHalfThickness),
-                    leftCenter + QPointF(leftHalfThickness, leftHalfThickness),
-                    bottomCenter + QPointF(-bottomHalfThickness, -bottomHalfThickness),
-                    bottomCenter + QPointF(bottomHalfThickness, -bottomHalfThickness));
-
-        ret.append(dia);
-        heightAndMaterial->append(QVector<const Tile *>(dia.size(), left));
-    }
-
-    if (bottomLeft.second) {
-        QPointF bottomCenter = bottom->position().toPointF() + QPointF(0, 1);
-        QPointF leftCenter = left->position().toPointF() + QPointF(-1, 0);
-        float bottomHalfThickness = bottom->thickness() / 2;
-        float leftHalfThickness = left->thickness() / 2;
-
-        auto dia = makeDiagonal(
-                    leftCenter + QPointF(leftHalfThickness, leftHalfThickness),
-                    leftCenter + QPointF(-leftHalfThickness, leftHalfThickness),
-                    bottomCenter + QPointF(-bottomHalfThickness, bottomHalfThickness),
-                    bottomCenter + QPointF(-bottomHalfThickness, -bottomHalfThickness));
+    for (const GroundDiagonalShape &shape : GroundDiagonalShapes) {
+        if (!(diagonals[shape.side] & shape.diagonal))
+            continue;
 
-        ret.append(dia);
-        heightAndMaterial->append(QVector<const Tile *>(dia.size(), left));
-    }
+        QPointF points[4];
+        for (int i = 0; i < 4; ++i) {
+            const NeighborCorner &corner = shape.points[i];
+            const TileInfo *neighbor = mTileNeighborhood(corner.dx, corner.dy);
+            float halfThickness = neighbor->thickness() / 2;
 
-    if (bottomRight.first) {
-        QPointF bottomCenter = bottom->position().toPointF() + QPointF(0, 1);
-        QPointF rightCenter = right->position().toPointF() + QPointF(1, 0);
-        float bottomHalfThickness = bottom->thickness() / 2;
-        float rightHalfThickness = right->thickness() / 2;
+            points[i] = neighbor->position().toPointF()
+                    + QPointF(corner.dx, corner.dy)
+                    + QPointF(corner.sx * halfThickness, corner.sy * halfThickness);
+        }
 
-        auto dia = makeDiagonal(
-                    rightCenter + QPointF(-rightHalfThickness, rightHalfThickness),
-                    rightCenter + QPointF(-rightHalfThickness, -rightHalfThickness),
-                    bottomCenter + QPointF(-bottomHalfThickness, -bottomHalfThickness),
-                    bottomCenter + QPointF(bottomHalfThickness, -bottomHalfThickness));
+        auto dia = makeDiagonal(points[0], points[1], points[2], points[3]);
 
         ret.append(dia);
-        heightAndMaterial->append(QVector<const Tile *>(dia.size(), right));
+        heightAndMaterial->append(QVector<const TileInfo *>(dia.size(), sideTiles[shape.side]));
     }
 
-    if (bottomRight.second) {
-        QPointF bottomCenter = bottom->position().toPointF() + QPointF(0, 1);
-        QPointF rightCenter = right->position().toPointF() + QPointF(1, 0);
-        float bottomHalfThickness = bottom->thickness() / 2;
-        float rightHalfThickness = right->thickness() / 2;
-
-        auto dia = makeDiagonal(
-                    rightCenter + QPointF(rightHalfThickness, rightHalfThickness),
-                    rightCenter + QPointF(-rightHalfThickness, rightHalfThickness),
-                    bottomCenter + QPointF(bottomHalfThickness, -bottomHalfThickness),
-                    bottomCenter + QPointF(bottomHalfThickness, bottomHalfThickness));
-
-        ret.append(dia);
-        heightAndMaterial->append(QVector<const Tile *>(dia.size(), right));
-    }
     return ret;
 }
@@ -10,8 +10,16 @@ class GroundBlockyPolygonTileMesher : public AbstractPolygonTileMesher
 public:
     GroundBlockyPolygonTileMesher(TileNeighborhoodInfo nbhd);
 
+    /**
+     * @brief Returns the BlockyTables::GroundDiagonals that the left (0) or right (1)
+     * neighbor of a ground tile makes.
+     * @param leftDiagonals     The diagonals of the left side, which gets the first pick.
+     *                          Ignored for the left side.
+     */
+    static quint8 sideDiagonals(const TileNeighborhoodInfo &nbhd, int side, quint8 leftDiagonals);
+
 protected:
-    QVector<Triplet<BetterPolygon, QVector<float>, QVector<bool>>> topPolygons(QVector<const Tile *> *heightAndMaterial);
+    QVector<Triplet<BetterPolygon, QVector<float>, QVector<bool>>> topPolygons(QVector<const TileInfo *> *heightAndMaterial);
 };
 
 }
@@ -0,0 +1,332 @@
+#include "m2mhiddenwallremover.h"
+
+#include <QMap>
+#include <QPair>
+
+#include <algorithm>
+
+#include "array2d.h"
+
+using namespace M2M;
+
+
+namespace {
+
+/// Returns the sorted, distinct values that lie in [min, max].
+QVector<float> gridLines(QVector<float> values, float min, float max)
+{
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+
+    QVector<float> lines;
+    for (float v : values)
+        if (v >= min && v <= max)
+            lines.append(v);
+
+    return lines;
+}
+
+/// Whether the point lies on the axis-aligned segment from a to b, excluding the end points.
+bool isStrictlyBetween(QPointF point, QPointF a, QPointF b)
+{
+    if (a.x() == b.x())
+        return point.x() == a.x() && point.y() > qMin(a.y(), b.y()) && point.y() < qMax(a.y(), b.y());
+    else
+        return point.y() == a.y() && point.x() > qMin(a.x(), b.x()) && point.x() < qMax(a.x(), b.x());
+}
+
+}
+
+
+/* BEGIN HiddenWallRemover */
+HiddenWallRemover::HiddenWallRemover(bool removeHidden)
+    : mRemoveHidden(removeHidden) {}
+
+void HiddenWallRemover::addTile(QPoint position, const QVector<Quad> &walls)
+{
+    addWalls(position, walls, true);
+}
+
+void HiddenWallRemover::addNeighbor(QPoint position, const QVector<Quad> &walls)
+{
+    addWalls(position, walls, false);
+}
+
+void HiddenWallRemover::addWalls(QPoint position, const QVector<Quad> &walls, bool output)
+{
+    for (int i = 0; i < walls.size(); ++i) {
+        const Quad &quad = walls[i];
+
+        if (!mRemoveHidden || !isAxisAligned(quad)) {
+            if (output)
+                mMesh.addQuad(quad);
+            continue;
+        }
+
+        Wall wall{quad, 0, 0, false, 0, 0, 0, 0, position, i, output};
+
+        QVector3D normal = quad.normal();
+        wall.axis = normal.x() != 0 ? 0 : 1;
+        wall.facesPositive = (wall.axis == 0 ? normal.x() : normal.z()) > 0;
+        wall.plane = wall.axis == 0 ? quad.vertex(0).x() : quad.vertex(0).z();
+
+        wall.s0 = wall.s1 = wall.along(quad.vertex(0));
+        wall.y0 = wall.y1 = quad.vertex(0).y();
+        for (int v = 1; v < 4; ++v) {
+            wall.s0 = qMin(wall.s0, wall.along(quad.vertex(v)));
+            wall.s1 = qMax(wall.s1, wall.along(quad.vertex(v)));
+            wall.y0 = qMin(wall.y0, quad.vertex(v).y());
+            wall.y1 = qMax(wall.y1, quad.vertex(v).y());
+        }
+
+        // Walls without area can never be seen.
+        if (wall.s0 == wall.s1 || wall.y0 == wall.y1)
+            continue;
+
+        mWalls.append(wall);
+    }
+}
+
+PartialMeshData HiddenWallRemover::finish()
+{
+    // Group the walls by the plane they lie on.
+    QMap<QPair<int, float>, QVector<int>> planes;
+    for (int i = 0; i < mWalls.size(); ++i)
+        planes[qMakePair(mWalls[i].axis, mWalls[i].plane)].append(i);
+
+    for (const QVector<int> &planeWalls : planes) {
+        QVector<Piece> pieces = visiblePieces(planeWalls);
+
+        for (const Piece &piece : pieces) {
+            const Wall &wall = mWalls[piece.wall];
+            if (!wall.output)
+                continue;
+
+            // Corners of neighboring pieces facing the same way that would form T-junctions.
+            QVector<QPointF> weldPoints;
+            for (const Piece &other : pieces) {
+                if (&other == &piece || mWalls[other.wall].facesPositive != wall.facesPositive)
+                    continue;
+
+                for (const QPointF &corner : other.corners())
+                    if (piece.hasOnEdge(corner))
+                        weldPoints.append(corner);
+            }
+
+            addPiece(piece, weldPoints);
+        }
+    }
+
+    return std::move(mMesh);
+}
+
+bool HiddenWallRemover::isAxisAligned(const Quad &quad)
+{
+    QVector3D normal = quad.normal();
+    return normal.y() == 0 && (normal.x() == 0) != (normal.z() == 0);
+}
+
+QVector<HiddenWallRemover::Piece> HiddenWallRemover::visiblePieces(const QVector<int> &planeWalls) const
+{
+    QVector<Piece> pieces;
+
+    for (int w : planeWalls) {
+        const Wall &wall = mWalls[w];
+
+        QVector<const Wall *> occluders;
+        for (int o : planeWalls) {
+            const Wall &other = mWalls[o];
+            if (o == w || !wall.overlaps(other))
+                continue;
+
+            if (other.facesPositive != wall.facesPositive || other.precedes(wall))
+                occluders.append(&other);
+        }
+
+        if (occluders.isEmpty()) {
+            pieces.append({w, wall.s0, wall.s1, wall.y0, wall.y1});
+            continue;
+        }
+
+        // Split the wall into cells along the edges of the walls that hide parts of it.
+        QVector<float> s = {wall.s0, wall.s1};
+        QVector<float> y = {wall.y0, wall.y1};
+        for (const Wall *o : occluders) {
+            s << o->s0 << o->s1;
+            y << o->y0 << o->y1;
+        }
+
+        s = gridLines(s, wall.s0, wall.s1);
+        y = gridLines(y, wall.y0, wall.y1);
+
+        Array2D<bool> visible(s.size() - 1, y.size() - 1, true);
+        for (const Wall *o : occluders) {
+            for (int i = 0; i < visible.width(); ++i) {
+                if (s[i] < o->s0 || s[i + 1] > o->s1)
+                    continue;
+
+                for (int j = 0; j < visible.height(); ++j)
+                    if (y[j] >= o->y0 && y[j + 1] <= o->y1)
+                        visible(i, j) = false;
+            }
+        }
+
+        // Greedily merge the visible cells into rectangles: first along s, then along y.
+        for (int j = 0; j < visible.height(); ++j) {
+            for (int i = 0; i < visible.width(); ++i) {
+                if (!visible(i, j))
+                    continue;
+
+                int width = 1;
+                while (i + width < visible.width() && visible(i + width, j))
+                    ++width;
+
+                int height = 1;
+                for (bool rowVisible = true; rowVisible && j + height < visible.height(); ) {
+                    for (int di = 0; di < width && rowVisible; ++di)
+                        rowVisible = visible(i + di, j + height);
+
+                    if (rowVisible)
+                        ++height;
+                }
+
+                for (int di = 0; di < width; ++di)
+                    for (int dj = 0; dj < height; ++dj)
+                        visible(i + di, j + dj) = false;
+
+                pieces.append({w, s[i], s[i + width], y[j], y[j + height]});
+            }
+        }
+    }
+
+    return pieces;
+}
+
+void HiddenWallRemover::addPiece(const Piece &piece, const QVector<QPointF> &weldPoints)
+{
+    const Wall &wall = mWalls[piece.wall];
+    const Quad &quad = wall.quad;
+
+    // Order the corners like the wall's quad, so that the piece faces the same way.
+    bool lowSFirst = wall.along(quad.vertex(0)) < wall.along(quad.vertex(1));
+    bool lowYFirst = quad.vertex(0).y() < quad.vertex(3).y();
+
+    float sA = lowSFirst ? piece.s0 : piece.s1;
+    float sB = lowSFirst ? piece.s1 : piece.s0;
+    float yA = lowYFirst ? piece.y0 : piece.y1;
+    float yB = lowYFirst ? piece.y1 : piece.y0;
+
+    QPointF corners[4] = {
+        QPointF(sA, yA),
+        QPointF(sB, yA),
+        QPointF(sB, yB),
+        QPointF(sA, yB)
+    };
+
+    PreObject &object = mMesh.object(quad.imageInfo());
+
+    if (weldPoints.isEmpty()) {
+        object.addQuad(quad.normal(), quad.phongInfo(),
+                       wall.position(corners[0]), wall.texCoord(corners[0]),
+                       wall.position(corners[1]), wall.texCoord(corners[1]),
+                       wall.position(corners[2]), wall.texCoord(corners[2]),
+                       wall.position(corners[3]), wall.texCoord(corners[3]));
+        return;
+    }
+
+    // Walk around the piece, visiting the weld points on each edge in order.
+    QVector<QPointF> boundary;
+    for (int i = 0; i < 4; ++i) {
+        QPointF from = corners[i];
+        QPointF to = corners[(i + 1) % 4];
+
+        QVector<QPointF> onEdge;
+        for (const QPointF &p : weldPoints)
+            if (isStrictlyBetween(p, from, to))
+                onEdge.append(p);
+
+        auto closerToFrom = [from] (const QPointF &a, const QPointF &b) {
+            return (a - from).manhattanLength() < (b - from).manhattanLength();
+        };
+
+        std::sort(onEdge.begin(), onEdge.end(), closerToFrom);
+        onEdge.erase(std::unique(onEdge.begin(), onEdge.end()), onEdge.end());
+
+        boundary.append(from);
+        boundary += onEdge;
+    }
+
+    // A fan around the center splits every edge at the weld points.
+    QPointF center = (corners[0] + corners[2]) / 2;
+    for (int i = 0; i < boundary.size(); ++i) {
+        const QPointF &a = boundary[i];
+        const QPointF &b = boundary[(i + 1) % boundary.size()];
+
+        object.addTriangle(quad.phongInfo(),
+                           wall.position(center), wall.texCoord(center),
+                           wall.position(a), wall.texCoord(a),
+                           wall.position(b), wall.texCoord(b));
+    }
+}
+/* END HiddenWallRemover */
+
+
+/* BEGIN HiddenWallRemover::Wall */
+bool HiddenWallRemover::Wall::precedes(const Wall &other) const
+{
+    if (tile.y() != other.tile.y())
+        return tile.y() < other.tile.y();
+    if (tile.x() != other.tile.x())
+        return tile.x() < other.tile.x();
+
+    return index < other.index;
+}
+
+bool HiddenWallRemover::Wall::overlaps(const Wall &other) const
+{
+    return qMin(s1, other.s1) > qMax(s0, other.s0)
+            && qMin(y1, other.y1) > qMax(y0, other.y0);
+}
+
+float HiddenWallRemover::Wall::along(QVector3D point) const
+{
+    return axis == 0 ? point.z() : point.x();
+}
+
+QVector3D HiddenWallRemover::Wall::position(QPointF sy) const
+{
+    if (axis == 0)
+        return QVector3D(plane, sy.y(), sy.x());
+    else
+        return QVector3D(sy.x(), sy.y(), plane);
+}
+
+QVector2D HiddenWallRemover::Wall::texCoord(QPointF sy) const
+{
+    // Texture coordinates are linear along the quad's edges (vertex 0 to 1 is
+    // horizontal and vertex 0 to 3 is vertical), so pieces line up with the original.
+    QVector3D v0 = quad.vertex(0);
+
+    float u = (sy.x() - along(v0)) / (along(quad.vertex(1)) - along(v0));
+    float v = (sy.y() - v0.y()) / (quad.vertex(3).y() - v0.y());
+
+    QVector2D t0 = quad.texCoord(0);
+    return t0 + u * (quad.texCoord(1) - t0) + v * (quad.texCoord(3) - t0);
+}
+/* END HiddenWallRemover::Wall */
+
+
+/* BEGIN HiddenWallRemover::Piece */
+QVector<QPointF> HiddenWallRemover::Piece::corners() const
+{
+    return {QPointF(s0, y0), QPointF(s1, y0), QPointF(s1, y1), QPointF(s0, y1)};
+}
+
+bool HiddenWallRemover::Piece::hasOnEdge(QPointF sy) const
+{
+    bool onVerticalEdge = (sy.x() == s0 || sy.x() == s1) && sy.y() > y0 && sy.y() < y1;
+    bool onHorizontalEdge = (sy.y() == y0 || sy.y() == y1) && sy.x() > s0 && sy.x() < s1;
+
+    return onVerticalEdge || onHorizontalEdge;
+}
+/* END HiddenWallRemover::Piece */
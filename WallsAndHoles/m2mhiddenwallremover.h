@@ -0,0 +1,120 @@
+#ifndef M2MHIDDENWALLREMOVER_H
+#define M2MHIDDENWALLREMOVER_H
+
+#include <QPoint>
+#include <QPointF>
+#include <QVector>
+
+#include "m2mpartialmesh.h"
+
+namespace M2M {
+
+/**
+ * @brief Combines the walls of a group of tiles (e.g. a chunk), leaving out the
+ * parts that can never be seen.
+ *
+ * Only vertical walls whose normal points along the x or z axis are handled (see
+ * isAxisAligned()). Walls on the same plane are compared with each other:
+ *  - Where two walls facing opposite ways overlap, the solids behind them touch,
+ *    so both are removed there.
+ *  - Where two walls facing the same way overlap, only the wall of the tile that
+ *    comes first in (y, x) order is kept, so that the faces do not z-fight.
+ *
+ * Removing parts of walls leaves corners of one wall in the middle of an edge of
+ * the next wall on the same plane. These T-junctions are welded by splitting
+ * the edge at the corner, so that no cracks show between the walls.
+ *
+ * The result for a wall only depends on the walls of its own tile and of the
+ * tiles around it, so tiles next to the group have to be added with addNeighbor().
+ */
+class HiddenWallRemover
+{
+public:
+    /**
+     * @param removeHidden  If false, all walls are output unchanged.
+     */
+    explicit HiddenWallRemover(bool removeHidden = true);
+
+    /**
+     * @brief addTile   Adds the walls of the tile at the given position.
+     */
+    void addTile(QPoint position, const QVector<Quad> &walls);
+
+    /**
+     * @brief addNeighbor   Adds the walls of a tile next to the group. They can hide
+     *                      walls of the group, but are not output.
+     */
+    void addNeighbor(QPoint position, const QVector<Quad> &walls);
+
+    /**
+     * @brief Returns the visible parts of the walls of all added tiles. The mesh is
+     * moved out, so this should only be called once.
+     */
+    PartialMeshData finish();
+
+    /**
+     * @brief Returns true if the quad is vertical and its normal points along the x or z axis.
+     */
+    static bool isAxisAligned(const Quad &quad);
+
+private:
+    struct Wall {
+        Quad quad;
+
+        /// 0 if the wall lies on a plane of constant x, 1 for constant z.
+        int axis;
+        float plane;
+        bool facesPositive;
+
+        /// The extent of the wall along the other horizontal axis ("s") and along y.
+        float s0, s1;
+        float y0, y1;
+
+        QPoint tile;
+        int index;
+        bool output;
+
+        /// Whether this wall is kept over the other one where they overlap and face the same way.
+        bool precedes(const Wall &other) const;
+
+        /// Whether the walls overlap in an area larger than zero.
+        bool overlaps(const Wall &other) const;
+
+        /// Returns the coordinate of the point along the wall's horizontal axis.
+        float along(QVector3D point) const;
+
+        QVector3D position(QPointF sy) const;
+        QVector2D texCoord(QPointF sy) const;
+    };
+
+    /// A visible, rectangular part of a wall.
+    struct Piece {
+        int wall;
+        float s0, s1;
+        float y0, y1;
+
+        /// The corners as (s, y) points.
+        QVector<QPointF> corners() const;
+
+        /// Whether the (s, y) point lies on an edge of the piece, but is not a corner.
+        bool hasOnEdge(QPointF sy) const;
+    };
+
+    void addWalls(QPoint position, const QVector<Quad> &walls, bool output);
+
+    /// Finds the visible parts of the given walls, which all lie on one plane.
+    QVector<Piece> visiblePieces(const QVector<int> &planeWalls) const;
+
+    /// Adds the piece to mMesh, splitting its edges at the given points.
+    void addPiece(const Piece &piece, const QVector<QPointF> &weldPoints);
+
+    bool mRemoveHidden;
+
+    QVector<Wall> mWalls;
+
+    PartialMeshData mMesh;
+};
+
+}
+
+#endif // M2MHIDDENWALLREMOVER_H
@@ -0,0 +1,137 @@
+#include "m2mmapsnapshot.h"
+
+using namespace M2M;
+
+
+/* BEGIN TileInfo */
+TileInfo::TileInfo()
+    : mTileTemplate(nullptr)
+    , mBridgeTiles(false)
+    , mConnectDiagonals(false)
+    , mThickness(1)
+    , mHeight(0)
+    , mPosition(0.5, 0.5)
+    , mTopMaterial(TileMaterial::getDefaultGroundMaterial())
+    , mSideMaterial(TileMaterial::getDefaultGroundMaterial()) {}
+
+TileInfo::TileInfo(const Tile &tile)
+    : mTileTemplate(tile.tileTemplate())
+    , mBridgeTiles(tile.hasTileTemplate() && tile.tileTemplate()->bridgeTiles())
+    , mConnectDiagonals(tile.hasTileTemplate() && tile.tileTemplate()->connectDiagonals())
+    , mThickness(tile.thickness())
+    , mHeight(tile.height())
+    , mPosition(tile.position())
+    , mTopMaterial(tile.topMaterial())
+    , mSideMaterial(tile.sideMaterial()) {}
+/* END TileInfo */
+
+
+/* BEGIN MapSnapshot */
+MapSnapshot::MapSnapshot(const TileMap *tileMap)
+    : mTiles(tileMap->mapSize())
+    , mGroundMaterial(TileMaterial::getDefaultGroundMaterial())
+{
+    for (int x = 0; x < tileMap->width(); ++x)
+        for (int y = 0; y < tileMap->height(); ++y)
+            mTiles(x, y) = TileInfo(tileMap->cTileAt(x, y));
+}
+
+void MapSnapshot::updateTile(const TileMap *tileMap, int x, int y)
+{
+    Q_ASSERT(mTiles.size() == tileMap->mapSize());
+
+    mTiles(x, y) = TileInfo(tileMap->cTileAt(x, y));
+}
+
+namespace {
+
+/**
+ * @brief Returns the box of a tile, extended along x (axis 0) or y (axis 1) where
+ * it bridges to its neighbors. Along y, the box is only returned if it is extended,
+ * since the x box already covers the tile's top square.
+ */
+BoundingBox tileOccluder(const MapSnapshot &map, int x, int y, int axis)
+{
+    const TileInfo &tile = map.tileAt(x, y);
+    if (!tile.hasTileTemplate() || tile.height() <= 0)
+        return BoundingBox::empty();
+
+    float half = qMin(tile.thickness(), 1.0f) / 2;
+    QVector2D center = tile.position() + QVector2D(x, y);
+
+    QVector2D min = center - QVector2D(half, half);
+    QVector2D max = center + QVector2D(half, half);
+
+    // The same test that BlockyPolygonTileMesher uses for bridges.
+    auto bridges = [&] (int dx, int dy) {
+        return tile.bridgeTiles() && half < 0.5
+                && map.contains(x + dx, y + dy)
+                && map.tileAt(x + dx, y + dy).tileTemplate() == tile.tileTemplate();
+    };
+
+    int dx = axis == 0 ? 1 : 0;
+    int dy = axis == 0 ? 0 : 1;
+
+    bool extended = false;
+    if (bridges(-dx, -dy)) {
+        min[axis] = axis == 0 ? x : y;
+        extended = true;
+    }
+    if (bridges(dx, dy)) {
+        max[axis] = (axis == 0 ? x : y) + 1;
+        extended = true;
+    }
+
+    if (axis == 1 && !extended)
+        return BoundingBox::empty();
+
+    return {QVector3D(min.x(), 0, min.y()), QVector3D(max.x(), tile.height(), max.y())};
+}
+
+/// Appends the box, or merges it into the last box if that one ends where it starts along axis.
+void appendOccluder(QVector<BoundingBox> &boxes, int runStart, const BoundingBox &box, int axis)
+{
+    if (box.isEmpty())
+        return;
+
+    // The x and y of the map are x and z in the mesh.
+    int axis3D = axis == 0 ? 0 : 2;
+    int other3D = axis == 0 ? 2 : 0;
+
+    if (boxes.size() > runStart) {
+        BoundingBox &last = boxes.last();
+
+        if (last.max[axis3D] == box.min[axis3D]
+                && last.min[other3D] == box.min[other3D] && last.max[other3D] == box.max[other3D]
+                && last.max.y() == box.max.y()) {
+            last.max[axis3D] = box.max[axis3D];
+            return;
+        }
+    }
+
+    boxes.append(box);
+}
+
+}
+
+QVector<BoundingBox> MapSnapshot::occluders(const QRect &tiles) const
+{
+    Q_ASSERT(QRect(QPoint(0, 0), mapSize()).contains(tiles));
+
+    QVector<BoundingBox> boxes;
+
+    for (int y = tiles.top(); y <= tiles.bottom(); ++y) {
+        int runStart = boxes.size();
+        for (int x = tiles.left(); x <= tiles.right(); ++x)
+            appendOccluder(boxes, runStart, tileOccluder(*this, x, y, 0), 0);
+    }
+
+    for (int x = tiles.left(); x <= tiles.right(); ++x) {
+        int runStart = boxes.size();
+        for (int y = tiles.top(); y <= tiles.bottom(); ++y)
+            appendOccluder(boxes, runStart, tileOccluder(*this, x, y, 1), 1);
+    }
+
+    return boxes;
+}
+/* END MapSnapshot */
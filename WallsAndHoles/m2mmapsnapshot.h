@@ -0,0 +1,132 @@
+#ifndef M2MMAPSNAPSHOT_H
+#define M2MMAPSNAPSHOT_H
+
+#include <QRect>
+#include <QSize>
+#include <QVector2D>
+
+#include "array2d.h"
+#include "tilemap.h"
+#include "m2mpartialmesh.h"
+#include "viewfrustum.h"
+
+namespace M2M {
+
+/**
+ * @brief A copy of the parts of a TileMaterial that are needed for meshing.
+ */
+class MaterialInfo
+{
+public:
+    MaterialInfo() {}
+    MaterialInfo(const TileMaterial *material)
+        : mImage(material)
+        , mPhong(material) {}
+
+    const ImageInfo &imageInfo() const { return mImage; }
+    const PhongInfo &phongInfo() const { return mPhong; }
+
+private:
+    ImageInfo mImage;
+    PhongInfo mPhong;
+};
+
+
+/**
+ * @brief A copy of the parts of a Tile that are needed for meshing.
+ *
+ * Meshers read TileInfos instead of Tiles so that meshing can run on other threads
+ * while the user keeps editing the map.
+ */
+class TileInfo
+{
+public:
+    /// Creates the info for a ground tile with the default ground material.
+    TileInfo();
+    explicit TileInfo(const Tile &tile);
+
+    bool hasTileTemplate() const { return mTileTemplate != nullptr; }
+
+    /**
+     * @brief The template the tile used when the snapshot was made. This should only be
+     * used to compare tiles against each other, never dereferenced, since the template
+     * may be changed or deleted on the GUI thread at any time.
+     */
+    const TileTemplate *tileTemplate() const { return mTileTemplate; }
+
+    bool bridgeTiles() const { return mBridgeTiles; }
+    bool connectDiagonals() const { return mConnectDiagonals; }
+
+    float thickness() const { return mThickness; }
+    float height() const { return mHeight; }
+    QVector2D position() const { return mPosition; }
+
+    const MaterialInfo &topMaterial() const { return mTopMaterial; }
+    const MaterialInfo &sideMaterial() const { return mSideMaterial; }
+
+private:
+    const TileTemplate *mTileTemplate;
+
+    bool mBridgeTiles;
+    bool mConnectDiagonals;
+
+    float mThickness;
+    float mHeight;
+    QVector2D mPosition;
+
+    MaterialInfo mTopMaterial;
+    MaterialInfo mSideMaterial;
+};
+
+
+/**
+ * @brief A copy of all the information in a TileMap that is needed for meshing.
+ *
+ * Copying a MapSnapshot is cheap: the tile data is implicitly shared and only
+ * the columns that are modified afterwards get copied.
+ */
+class MapSnapshot
+{
+public:
+    MapSnapshot() {}
+
+    /// Copies all tiles in the map. Must be called on the TileMap's thread.
+    explicit MapSnapshot(const TileMap *tileMap);
+
+    /// Copies the tile at (x, y) again. Must be called on the TileMap's thread.
+    void updateTile(const TileMap *tileMap, int x, int y);
+
+    bool contains(int x, int y) const { return mTiles.isInBounds(QPoint(x, y)); }
+
+    const TileInfo &tileAt(int x, int y) const { return mTiles(x, y); }
+
+    QSize mapSize() const { return mTiles.size(); }
+
+    /// The material used for the ground around tiles.
+    const MaterialInfo &groundMaterial() const { return mGroundMaterial; }
+
+    /**
+     * @brief Returns boxes that are inside the meshes of the tiles, for occlusion culling.
+     *
+     * Each tile with a template gives the box under its top square, extended to the
+     * tile edges where it bridges to its neighbors. Diagonals are left out. Boxes of
+     * neighboring tiles in a row or column are merged where they line up exactly.
+     */
+    QVector<BoundingBox> occluders() const { return occluders(QRect(QPoint(0, 0), mapSize())); }
+
+    /**
+     * @brief Returns the occluders of the tiles in the rectangle, which must be inside
+     * the map. Boxes are only merged within the rectangle, so the occluders of a set of
+     * rectangles can be updated one rectangle at a time.
+     */
+    QVector<BoundingBox> occluders(const QRect &tiles) const;
+
+private:
+    Array2D<TileInfo> mTiles;
+
+    MaterialInfo mGroundMaterial;
+};
+
+}
+
+#endif // M2MMAPSNAPSHOT_H
@@ -0,0 +1,130 @@
+#include "m2mmeshcache.h"
+
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <QPair>
+#include <QVector>
+
+#include <algorithm>
+
+using namespace M2M;
+
+
+MeshCache::MeshCache()
+    : mBytes(0)
+    , mMaxBytes(64 * 1024 * 1024)
+    , mHits(0)
+    , mMisses(0)
+    , mClock(0)
+    , mEvictionRounds(0)
+    , mEvictedEntries(0) {}
+
+bool MeshCache::find(const QByteArray &key, TileMesh &mesh) const
+{
+    QReadLocker locker(&mLock);
+
+    auto itr = mEntries.constFind(key);
+    if (itr == mEntries.constEnd()) {
+        mMisses.fetchAndAddRelaxed(1);
+        return false;
+    }
+
+    mesh = itr->mesh;
+    itr->lastUse.store(mClock.fetchAndAddRelaxed(1));
+    mHits.fetchAndAddRelaxed(1);
+    return true;
+}
+
+void MeshCache::insert(const QByteArray &key, const TileMesh &mesh)
+{
+    qint64 bytes = mesh.memoryUsage() + key.size();
+
+    QWriteLocker locker(&mLock);
+
+    // Another thread may have meshed the same neighborhood in the meantime.
+    if (mEntries.contains(key))
+        return;
+
+    // Evicting more than needed means that a map with more distinct neighborhoods
+    // than fit does not evict on every insertion.
+    if (mBytes + bytes > mMaxBytes)
+        evict(mMaxBytes * 3 / 4 - bytes);
+
+    Entry &entry = mEntries[key];
+    entry.mesh = mesh;
+    entry.bytes = bytes;
+    entry.lastUse.store(mClock.fetchAndAddRelaxed(1));
+
+    mBytes += bytes;
+}
+
+void MeshCache::clear()
+{
+    QWriteLocker locker(&mLock);
+
+    mEntries.clear();
+    mBytes = 0;
+}
+
+void MeshCache::setMaxBytes(qint64 maxBytes)
+{
+    QWriteLocker locker(&mLock);
+
+    mMaxBytes = maxBytes;
+
+    if (mBytes > mMaxBytes)
+        evict(mMaxBytes);
+}
+
+qint64 MeshCache::maxBytes() const
+{
+    QReadLocker locker(&mLock);
+    return mMaxBytes;
+}
+
+MeshCache::Stats MeshCache::stats() const
+{
+    QReadLocker locker(&mLock);
+
+    Stats stats;
+    stats.hits = mHits.load();
+    stats.misses = mMisses.load();
+    stats.entries = mEntries.size();
+    stats.bytes = mBytes;
+    stats.evictionRounds = mEvictionRounds;
+    stats.evictedEntries = mEvictedEntries;
+
+    return stats;
+}
+
+void MeshCache::resetCounters()
+{
+    mHits.store(0);
+    mMisses.store(0);
+
+    QWriteLocker locker(&mLock);
+    mEvictionRounds = 0;
+    mEvictedEntries = 0;
+}
+
+void MeshCache::evict(qint64 targetBytes)
+{
+    QVector<QPair<qint64, QByteArray>> byLastUse;
+    byLastUse.reserve(mEntries.size());
+
+    for (auto itr = mEntries.constBegin(); itr != mEntries.constEnd(); ++itr)
+        byLastUse.append(qMakePair(itr->lastUse.load(), itr.key()));
+
+    std::sort(byLastUse.begin(), byLastUse.end(),
+              [] (const QPair<qint64, QByteArray> &a, const QPair<qint64, QByteArray> &b) { return a.first < b.first; });
+
+    ++mEvictionRounds;
+
+    for (const auto &use : byLastUse) {
+        if (mBytes <= targetBytes)
+            break;
+
+        mBytes -= mEntries.take(use.second).bytes;
+        ++mEvictedEntries;
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef M2MMESHCACHE_H
+#define M2MMESHCACHE_H
+
+#include <QHash>
+#include <QByteArray>
+#include <QReadWriteLock>
+#include <QAtomicInteger>
+
+#include "m2mtilemesher.h"
+
+namespace M2M {
+
+/**
+ * @brief Remembers the meshes of tile neighborhoods so that tiles in identical
+ * configurations (open ground, straight wall runs, ...) are only meshed once.
+ *
+ * Meshes are stored for a tile at the origin and keyed by
+ * TileNeighborhoodInfo::signature(). When the cache would grow over its memory
+ * limit, the least recently used meshes are evicted until it is down to
+ * three quarters of the limit. All methods are thread-safe.
+ */
+class MeshCache
+{
+public:
+    struct Stats {
+        qint64 hits;
+        qint64 misses;
+
+        /// The number of cached meshes.
+        int entries;
+
+        /// The approximate memory used by the cached meshes, in bytes.
+        qint64 bytes;
+
+        /// The number of times that meshes were evicted, and the number of meshes evicted.
+        qint64 evictionRounds;
+        qint64 evictedEntries;
+
+        /// Returns the fraction of lookups that were hits, or 0 if there were none.
+        double hitRate() const
+        {
+            qint64 lookups = hits + misses;
+            return lookups == 0 ? 0 : double(hits) / lookups;
+        }
+    };
+
+
+    MeshCache();
+
+    /**
+     * @brief find  Looks up the mesh for a neighborhood.
+     * @param key   The neighborhood's signature.
+     * @param mesh  Set to the cached mesh if one exists.
+     * @return      True if the mesh was in the cache.
+     */
+    bool find(const QByteArray &key, TileMesh &mesh) const;
+
+    /**
+     * @brief insert    Caches the mesh for a neighborhood. If the cache would be over
+     *                  its memory limit, the least recently used meshes are evicted first.
+     * @param key       The neighborhood's signature.
+     * @param mesh      The mesh of a tile at the origin.
+     */
+    void insert(const QByteArray &key, const TileMesh &mesh);
+
+    /**
+     * @brief Removes all cached meshes. Does not reset the hit and miss counts.
+     */
+    void clear();
+
+    /**
+     * @brief Sets the approximate number of bytes the cache may use. Defaults to 64 MiB.
+     */
+    void setMaxBytes(qint64 maxBytes);
+
+    qint64 maxBytes() const;
+
+    Stats stats() const;
+
+    /**
+     * @brief Resets the hit, miss and eviction counts to zero.
+     */
+    void resetCounters();
+
+private:
+    struct Entry {
+        TileMesh mesh;
+        qint64 bytes;
+
+        /// The value of mClock when the mesh was last inserted or found.
+        mutable QAtomicInteger<qint64> lastUse;
+    };
+
+    /**
+     * @brief Evicts the least recently used meshes until the cache uses at most
+     * targetBytes. Assumes mLock is locked for writing.
+     */
+    void evict(qint64 targetBytes);
+
+    QHash<QByteArray, Entry> mEntries;
+
+    /// The sum of the sizes of all entries, including their keys.
+    qint64 mBytes;
+
+    qint64 mMaxBytes;
+
+    /// Protects mEntries, mBytes and mMaxBytes.
+    mutable QReadWriteLock mLock;
+
+    mutable QAtomicInteger<qint64> mHits;
+    mutable QAtomicInteger<qint64> mMisses;
+
+    /// Counts lookups and insertions, to order the entries by their last use.
+    mutable QAtomicInteger<qint64> mClock;
+
+    /// Protected by mLock.
+    qint64 mEvictionRounds;
+    qint64 mEvictedEntries;
+};
+
+}
+
+#endif // M2MMESHCACHE_H
@@ -0,0 +1,136 @@
+#include "m2mparallelmesher.h"
+
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QThread>
+
+#include "m2mtilemesher.h"
+
+using namespace M2M;
+
+
+namespace {
+
+/// Pulls tile indices from a shared counter until there are none left.
+class MeshingTask : public QRunnable
+{
+public:
+    MeshingTask(const MapSnapshot &map,
+                const QVector<QPoint> &tiles,
+                TileMesh *results,
+                QAtomicInt &nextIndex,
+                const QAtomicInt *cancel,
+                MeshCache *cache)
+        : mMap(map)
+        , mTiles(tiles)
+        , mResults(results)
+        , mNextIndex(nextIndex)
+        , mCancel(cancel)
+        , mCache(cache) {}
+
+    void run() override
+    {
+        int idx;
+        while ((idx = mNextIndex.fetchAndAddRelaxed(1)) < mTiles.size()) {
+            if (mCancel != nullptr && mCancel->loadAcquire() != 0)
+                return;
+
+            QPoint pt = mTiles[idx];
+            TileNeighborhoodInfo nbhd(&mMap, pt);
+
+            if (mCache == nullptr) {
+                mResults[idx] = nbhd.makeMesher()->makeTileMesh(QVector2D(pt));
+                continue;
+            }
+
+            // Meshes are cached for a tile at the origin.
+            QByteArray key = nbhd.signature();
+            TileMesh mesh;
+
+            if (!mCache->find(key, mesh)) {
+                mesh = nbhd.makeMesher()->makeTileMesh(QVector2D(0, 0));
+                mCache->insert(key, mesh);
+            }
+
+            mesh.translate(QVector2D(pt));
+            mResults[idx] = mesh;
+        }
+    }
+
+private:
+    const MapSnapshot &mMap;
+    const QVector<QPoint> &mTiles;
+    TileMesh *mResults;
+    QAtomicInt &mNextIndex;
+    const QAtomicInt *mCancel;
+    MeshCache *mCache;
+};
+
+}
+
+
+ParallelMesher::ParallelMesher()
+    : mCacheEnabled(true)
+{
+    setThreadCount(QThread::idealThreadCount());
+}
+
+void ParallelMesher::setThreadCount(int threadCount)
+{
+    mThreadCount = qMax(1, threadCount);
+
+    // The calling thread also does work.
+    mPool.setMaxThreadCount(qMax(1, mThreadCount - 1));
+}
+
+int ParallelMesher::threadCount() const
+{
+    return mThreadCount;
+}
+
+void ParallelMesher::setCacheEnabled(bool enabled)
+{
+    mCacheEnabled = enabled;
+}
+
+bool ParallelMesher::isCacheEnabled() const
+{
+    return mCacheEnabled;
+}
+
+MeshCache &ParallelMesher::meshCache()
+{
+    return mMeshCache;
+}
+
+const MeshCache &ParallelMesher::meshCache() const
+{
+    return mMeshCache;
+}
+
+QVector<TileMesh> ParallelMesher::makeMeshes(const MapSnapshot &map,
+                                             const QVector<QPoint> &tiles,
+                                             const QAtomicInt *cancel)
+{
+    MeshCache *cache = mCacheEnabled ? &mMeshCache : nullptr;
+
+    // Workers only write to distinct elements of the results array.
+    QVector<TileMesh> results(tiles.size());
+    TileMesh *resultData = results.data();
+
+    QAtomicInt nextIndex(0);
+
+    int numWorkers = 0;
+    if (tiles.size() >= MinTilesForThreading)
+        numWorkers = qMin(mThreadCount - 1, tiles.size() / MinTilesForThreading);
+
+    for (int i = 0; i < numWorkers; ++i)
+        mPool.start(new MeshingTask(map, tiles, resultData, nextIndex, cancel, cache));
+
+    // The calling thread participates as well.
+    MeshingTask(map, tiles, resultData, nextIndex, cancel, cache).run();
+
+    mPool.waitForDone();
+
+    return results;
+}
@@ -0,0 +1,91 @@
+#ifndef M2MPARALLELMESHER_H
+#define M2MPARALLELMESHER_H
+
+#include <QVector>
+#include <QPoint>
+#include <QThreadPool>
+
+#include <QAtomicInt>
+
+#include "m2mmapsnapshot.h"
+#include "m2mtilemesher.h"
+#include "m2mmeshcache.h"
+
+namespace M2M {
+
+/**
+ * @brief Meshes many tiles at once by fanning the work out over a thread pool.
+ *
+ * Each tile's mesher only reads the tile's neighborhood and writes its own
+ * TileMesh, so tiles can be meshed independently. The results are returned
+ * in the same order as the requested tiles, so merging them is deterministic
+ * regardless of the number of threads.
+ *
+ * Thread safety of the inputs: meshers only read the MapSnapshot, which holds copies
+ * of all tile and material data, so makeMeshes() may run on any thread while the map
+ * is being edited. BetterPolygon operations are reentrant (they only use local data
+ * and QPainterPath), and shared images are only copied through atomically
+ * reference-counted pointers.
+ *
+ * Tiles whose neighborhoods have been meshed before are taken from a MeshCache
+ * and only translated into place.
+ */
+class ParallelMesher
+{
+public:
+    /**
+     * @brief Creates a mesher that uses QThread::idealThreadCount() threads.
+     */
+    ParallelMesher();
+
+    /**
+     * @brief Sets the number of threads used for meshing, including the calling thread.
+     * Values less than 1 are treated as 1.
+     */
+    void setThreadCount(int threadCount);
+
+    int threadCount() const;
+
+    /**
+     * @brief Enables or disables the mesh cache. It is enabled by default.
+     * Disabling it does not clear it.
+     */
+    void setCacheEnabled(bool enabled);
+
+    bool isCacheEnabled() const;
+
+    /**
+     * @brief Returns the cache of neighborhood meshes, e.g. to read its stats.
+     */
+    MeshCache &meshCache();
+    const MeshCache &meshCache() const;
+
+    /**
+     * @brief makeMeshes    Meshes the given tiles. Blocks until all tiles are meshed.
+     *                      Only one call may be running at a time.
+     * @param map           The map containing the tiles.
+     * @param tiles         The positions of the tiles to mesh.
+     * @param cancel        If not null, meshing stops as soon as possible once this is nonzero.
+     *                      In that case, some of the returned meshes are empty.
+     * @return              The mesh of each tile, parallel to the tiles array.
+     */
+    QVector<TileMesh> makeMeshes(const MapSnapshot &map,
+                                 const QVector<QPoint> &tiles,
+                                 const QAtomicInt *cancel = nullptr);
+
+private:
+    /// Below this many tiles, meshing happens entirely on the calling thread.
+    static const int MinTilesForThreading = 64;
+
+    int mThreadCount;
+
+    bool mCacheEnabled;
+
+    MeshCache mMeshCache;
+
+    QThreadPool mPool;
+};
+
+}
+
+#endif // M2MPARALLELMESHER_H
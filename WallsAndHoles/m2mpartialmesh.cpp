@@ -1,12 +1,53 @@
 #include "m2mpartialmesh.h"
 
+#include <QAtomicInt>
+#include <QHash>
+
+#include <algorithm>
+
 
 using namespace M2M;
 
 
+namespace {
+
+/// All attributes of a vertex. Vertices with equal keys are welded.
+struct VertexKey {
+    float values[9];
+
+    bool operator ==(const VertexKey &other) const
+    {
+        return std::equal(values, values + 9, other.values);
+    }
+};
+
+uint qHash(const VertexKey &key, uint seed = 0)
+{
+    return qHashBits(key.values, sizeof(key.values), seed);
+}
+
+QAtomicInt bufferAllocationCount;
+
+/// Makes room for extra more elements, growing geometrically like QVector::append().
+template< typename T >
+void reserveExtra(QVector<T> &vector, int extra)
+{
+    int size = vector.size() + extra;
+
+    // A shared vector is copied on write, which allocates as well.
+    if (size <= vector.capacity() && vector.isDetached())
+        return;
+
+    bufferAllocationCount.ref();
+    vector.reserve(qMax(size, 2 * vector.capacity()));
+}
+
+}
+
+
 /* BEGIN Quad */
-Quad::Quad(QVector3D normal, ImageInfo texture,
-            PhongInfo material,
+Quad::Quad(QVector3D normal, const ImageInfo &texture,
+            const PhongInfo &material,
             QVector3D v1, QVector2D t1,
             QVector3D v2, QVector2D t2,
             QVector3D v3, QVector2D t3,
@@ -37,14 +78,12 @@ QVector3D Quad::normal() const
     return mNormal;
 }
 
-ImageInfo Quad::imageInfo() const
-{
-    return mTexture;
-}
-
-PhongInfo Quad::phongInfo() const
+void Quad::translate(QVector3D offset)
 {
-    return mMaterial;
+    mV1 += offset;
+    mV2 += offset;
+    mV3 += offset;
+    mV4 += offset;
 }
 
 
@@ -52,8 +91,8 @@ Quad Quad::makeVerticalQuad(QVector3D center,
                             QVector2D xzDirection,
                             float width,
                             float height,
-                            ImageInfo texture,
-                            PhongInfo material,
+                            const ImageInfo &texture,
+                            const PhongInfo &material,
                             bool upsideDown)
 {
     QVector2D t1(0, 0);
@@ -91,62 +130,141 @@ Quad Quad::makeVerticalQuad(QVector3D center,
 
 
 
+/* BEGIN Trig */
+Trig::Trig(const ImageInfo &texture, const PhongInfo &material, QVector3D v1, QVector2D t1, QVector3D v2, QVector2D t2, QVector3D v3, QVector2D t3)
+    : mV1(v1), mV2(v2), mV3(v3)
+    , mT1(t1), mT2(t2), mT3(t3)
+    , mTexture(texture)
+    , mMaterial(material)
+    , mNormal(faceNormal(v1, v2, v3)) {}
+
+QVector3D Trig::vertex(int idx) const
+{
+    QVector3D verts[3] = {mV1, mV2, mV3};
+    return verts[idx];
+}
+
+QVector2D Trig::texCoord(int idx) const
+{
+    QVector2D texCoords[3] = {mT1, mT2, mT3};
+    return texCoords[idx];
+}
+
+QVector3D Trig::faceNormal(QVector3D v1, QVector3D v2, QVector3D v3)
+{
+    return QVector3D::crossProduct(v3 - v2, v1 - v2).normalized();
+}
+/* END Trig */
+
+
+
 /* BEGIN PartialMeshData */
-void PartialMeshData::addQuad(const Quad &q)
+PreObject &PartialMeshData::object(const ImageInfo &image)
 {
-    const QImage *quadImage = q.imageInfo().image()->image().data();
+    const QImage *imageKey = image.image()->image().data();
 
-    auto itr = mTexturesToObjects.find(quadImage);
+    PreObject *existing = findObject(imageKey);
+    if (existing)
+        return *existing;
 
-    // If the map contains the key...
-    if (itr != mTexturesToObjects.end()) {
-        itr->addQuad(q);
+    reserveExtra(mObjects, 1);
+    mObjects.append(PreObject(image));
 
-    // If the map doesn't contain the key...
-    } else {
-        PreObject newObject(q.imageInfo());
-        newObject.addQuad(q);
+    return mObjects.last();
+}
 
-        mTexturesToObjects.insert(quadImage, newObject);
-    }
+PreObject *PartialMeshData::findObject(const QImage *imageKey)
+{
+    for (PreObject &object : mObjects)
+        if (object.imageKey() == imageKey)
+            return &object;
+
+    return nullptr;
+}
+
+void PartialMeshData::addQuad(const Quad &q)
+{
+    object(q.imageInfo()).addQuad(q);
 }
 
 void PartialMeshData::addTrig(const Trig &t)
 {
-    const QImage *image = t.imageInfo().image()->image().data();
+    object(t.imageInfo()).addTrig(t);
+}
+
+void PartialMeshData::addTriangle(const ImageInfo &image, const PhongInfo &material,
+                                  QVector3D v1, QVector2D t1,
+                                  QVector3D v2, QVector2D t2,
+                                  QVector3D v3, QVector2D t3)
+{
+    object(image).addTriangle(material, v1, t1, v2, t2, v3, t3);
+}
 
-    auto itr = mTexturesToObjects.find(image);
+void PartialMeshData::addPartialMesh(const PartialMeshData &p)
+{
+    for (const PreObject &other : p.mObjects) {
+        PreObject *existing = findObject(other.imageKey());
+
+        if (existing) {
+            existing->addPreObject(other);
+        } else {
+            // Shares the other object's buffers until either one changes.
+            reserveExtra(mObjects, 1);
+            mObjects.append(other);
+        }
+    }
+}
 
-    // If the map contains the key...
-    if (itr != mTexturesToObjects.end()) {
-        itr->addTrig(t);
+void PartialMeshData::addPartialMesh(PartialMeshData &&p)
+{
+    if (mObjects.isEmpty()) {
+        mObjects = std::move(p.mObjects);
+        return;
+    }
 
-    // If the map doesn't contain the key...
-    } else {
-        PreObject newObject(t.imageInfo());
-        newObject.addTrig(t);
+    for (PreObject &other : p.mObjects) {
+        PreObject *existing = findObject(other.imageKey());
 
-        mTexturesToObjects.insert(image, newObject);
+        if (existing) {
+            existing->addPreObject(other);
+        } else {
+            reserveExtra(mObjects, 1);
+            mObjects.append(std::move(other));
+        }
     }
+
+    p.mObjects.clear();
 }
 
-void PartialMeshData::addPartialMesh(const PartialMeshData &p)
+
+void PartialMeshData::translate(QVector2D offset)
 {
-    for (auto i = p.mTexturesToObjects.cbegin(); i != p.mTexturesToObjects.cend(); ++i) {
-        auto itr = mTexturesToObjects.find(i.key());
-        if (itr != mTexturesToObjects.end())
-            itr->addPreObject(*i);
-        else
-            mTexturesToObjects.insert(i.key(), *i);
-    }
+    for (PreObject &preObject : mObjects)
+        preObject.translate(offset);
 }
 
+int PartialMeshData::memoryUsage() const
+{
+    int bytes = sizeof(PartialMeshData);
+
+    for (const PreObject &preObject : mObjects)
+        bytes += preObject.memoryUsage();
 
-QVector<QSharedPointer<SimpleTexturedObject>> PartialMeshData::constructObjects()
+    return bytes;
+}
+
+int PartialMeshData::bufferAllocations()
+{
+    return bufferAllocationCount.load();
+}
+
+
+QVector<QSharedPointer<SimpleTexturedObject>> PartialMeshData::constructObjects() const
 {
     QVector<QSharedPointer<SimpleTexturedObject>> objects;
+    objects.reserve(mObjects.size());
 
-    for (const auto &preObject : mTexturesToObjects)
+    for (const PreObject &preObject : mObjects)
         objects.append(preObject.toObject());
 
     return objects;
@@ -155,58 +273,75 @@ QVector<QSharedPointer<SimpleTexturedObject>> PartialMeshData::constructObjects(
 
 
 /* BEGIN PartialMeshData::PreObject */
-PreObject::PreObject(ImageInfo img)
-    : mImage(img.image()) {}
+PreObject::PreObject(const ImageInfo &img)
+    : mImage(img.image())
+    , mImageKey(img.image()->image().data()) {}
 
 
 void PreObject::addQuad(const Quad &q)
 {
-    // index of first vertex of quad in mVertexPositions
-    unsigned int firstIdx = mVertexPositions.size();
+    addQuad(q.normal(), q.phongInfo(),
+            q.vertex(0), q.texCoord(0),
+            q.vertex(1), q.texCoord(1),
+            q.vertex(2), q.texCoord(2),
+            q.vertex(3), q.texCoord(3));
+}
 
+void PreObject::addTrig(const Trig &t)
+{
+    unsigned int firstIdx = mVertices.size();
 
-    // One entry per vertex.
-    mVertexPositions.append({ q.vertex(0), q.vertex(1), q.vertex(2), q.vertex(3) });
+    reserve(3, 1);
 
-    auto phongInfo = q.phongInfo();
-    mReflAmbient.append(QVector<float>(4, phongInfo.ambient));
-    mReflDiffuse.append(QVector<float>(4, phongInfo.diffuse));
-    mReflSpecular.append(QVector<float>(4, phongInfo.specular));
-    mShininess.append(QVector<float>(4, phongInfo.shininess));
+    mVertices.append({t.vertex(0), t.normal(), t.texCoord(0), t.phongInfo()});
+    mVertices.append({t.vertex(1), t.normal(), t.texCoord(1), t.phongInfo()});
+    mVertices.append({t.vertex(2), t.normal(), t.texCoord(2), t.phongInfo()});
 
-    // One entry per triangle.
-    mTriangleNormals.append({ q.normal(), q.normal() });
-    mTriangles.append({
-                          {firstIdx, firstIdx+1, firstIdx+2},
-                          {firstIdx, firstIdx+2, firstIdx+3}
-                      });
-    mTriangleTextureCoordinates.append({
-                                           { q.texCoord(0), q.texCoord(1), q.texCoord(2) },
-                                           { q.texCoord(0), q.texCoord(2), q.texCoord(3) }
-                                       });
+    mTriangles.append({firstIdx, firstIdx + 1, firstIdx + 2});
 }
 
-void PreObject::addTrig(const Trig &t)
+void PreObject::addQuad(QVector3D normal, const PhongInfo &material,
+                        QVector3D v1, QVector2D t1,
+                        QVector3D v2, QVector2D t2,
+                        QVector3D v3, QVector2D t3,
+                        QVector3D v4, QVector2D t4)
+{
+    // index of first vertex of quad in mVertices
+    unsigned int firstIdx = mVertices.size();
+
+    reserve(4, 2);
+
+    mVertices.append({v1, normal, t1, material});
+    mVertices.append({v2, normal, t2, material});
+    mVertices.append({v3, normal, t3, material});
+    mVertices.append({v4, normal, t4, material});
+
+    mTriangles.append({firstIdx, firstIdx + 1, firstIdx + 2});
+    mTriangles.append({firstIdx, firstIdx + 2, firstIdx + 3});
+}
+
+void PreObject::addTriangle(const PhongInfo &material,
+                            QVector3D v1, QVector2D t1,
+                            QVector3D v2, QVector2D t2,
+                            QVector3D v3, QVector2D t3)
 {
-    unsigned int firstIdx = mVertexPositions.size();
+    unsigned int firstIdx = mVertices.size();
+    QVector3D normal = Trig::faceNormal(v1, v2, v3);
+
+    reserve(3, 1);
 
-    mVertexPositions.append(t.verts());
-    PhongInfo phongInfo = t.phongInfo();
-    mReflAmbient.append(QVector<float>(3, phongInfo.ambient));
-    mReflDiffuse.append(QVector<float>(3, phongInfo.diffuse));
-    mReflSpecular.append(QVector<float>(3, phongInfo.specular));
-    mShininess.append(QVector<float>(3, phongInfo.shininess));
+    mVertices.append({v1, normal, t1, material});
+    mVertices.append({v2, normal, t2, material});
+    mVertices.append({v3, normal, t3, material});
 
-    mTriangleNormals.append(t.normal());
     mTriangles.append({firstIdx, firstIdx + 1, firstIdx + 2});
-    mTriangleTextureCoordinates.append({t.textureCoords()[0],
-                                        t.textureCoords()[1],
-                                        t.textureCoords()[2]});
 }
 
 void PreObject::addPreObject(const PreObject &o)
 {
-    unsigned firstIdx = mVertexPositions.size();
+    unsigned firstIdx = mVertices.size();
+
+    reserve(o.mVertices.size(), o.mTriangles.size());
 
     for (const SimpleTexturedObject::Triangle &t : o.mTriangles) {
         mTriangles.append({
@@ -216,35 +351,96 @@ void PreObject::addPreObject(const PreObject &o)
                           });
     }
 
-    mVertexPositions.append(o.mVertexPositions);
-    mTriangleNormals.append(o.mTriangleNormals);
-    mReflAmbient.append(o.mReflAmbient);
-    mReflDiffuse.append(o.mReflDiffuse);
-    mReflSpecular.append(o.mReflSpecular);
-    mShininess.append(o.mShininess);
-    mTriangleTextureCoordinates.append(o.mTriangleTextureCoordinates);
+    mVertices.append(o.mVertices);
+}
+
+void PreObject::reserve(int numVertices, int numTriangles)
+{
+    reserveExtra(mVertices, numVertices);
+    reserveExtra(mTriangles, numTriangles);
+}
+
+
+void PreObject::translate(QVector2D offset)
+{
+    QVector3D offset3D(offset.x(), 0, offset.y());
+
+    for (MeshVertex &v : mVertices) {
+        v.position += offset3D;
+
+        // Only horizontal faces use world coordinates for texturing.
+        if (v.normal.y() != 0)
+            v.texCoord += offset;
+    }
+}
+
+int PreObject::memoryUsage() const
+{
+    return sizeof(PreObject)
+            + mVertices.size() * sizeof(MeshVertex)
+            + mTriangles.size() * sizeof(SimpleTexturedObject::Triangle);
 }
 
 
 QSharedPointer<SimpleTexturedObject> PreObject::toObject() const
 {
+    QVector<QVector3D> positions;
+    QVector<QVector3D> normals;
+    QVector<QVector2D> texCoords;
+    QVector<quint16> materials;
+
+    // Maps each vertex to the index of its welded copy.
+    QVector<unsigned int> weldedIndex(mVertices.size());
+
+    QHash<VertexKey, unsigned int> indices;
+    indices.reserve(mVertices.size());
+
+    for (int i = 0; i < mVertices.size(); ++i) {
+        const QVector3D &p = mVertices[i].position;
+        const QVector3D &n = mVertices[i].normal;
+        const QVector2D &t = mVertices[i].texCoord;
+        quint16 m = mVertices[i].material.material;
+
+        // Adding 0 turns -0 into 0, so that equal values also have equal bits. Material
+        // indices are exactly representable as floats.
+        VertexKey key = {{
+            p.x() + 0.0f, p.y() + 0.0f, p.z() + 0.0f,
+            n.x() + 0.0f, n.y() + 0.0f, n.z() + 0.0f,
+            t.x() + 0.0f, t.y() + 0.0f,
+            float(m)
+        }};
+
+        auto itr = indices.find(key);
+        if (itr == indices.end()) {
+            itr = indices.insert(key, positions.size());
+
+            positions.append(p);
+            normals.append(n);
+            texCoords.append(t);
+            materials.append(m);
+        }
+
+        weldedIndex[i] = *itr;
+    }
+
+    QVector<SimpleTexturedObject::Triangle> triangles;
+    triangles.reserve(mTriangles.size());
+    for (const SimpleTexturedObject::Triangle &t : mTriangles) {
+        triangles.append({
+                             weldedIndex[t.getFirst()],
+                             weldedIndex[t.getSecond()],
+                             weldedIndex[t.getThird()]
+                         });
+    }
+
     QSharedPointer<SimpleTexturedObject> obj = QSharedPointer<SimpleTexturedObject>::create();
 
-    obj->setTriangleInfo(mVertexPositions, mTriangleNormals, mTriangles);
-    obj->setMaterialInfo(mReflAmbient, mReflDiffuse, mReflSpecular, mShininess);
-    obj->setTextureInfo(mTriangleTextureCoordinates, mImage);
+    obj->setTriangleInfo(positions, normals, triangles);
+    obj->setMaterialInfo(materials);
+    obj->setTextureInfo(texCoords, mImage);
 
     obj->commit();
 
     return obj;
 }
 /* END PartialMeshData::PreObject */
-
-Trig::Trig(ImageInfo texture, PhongInfo material, QVector3D v1, QVector2D t1, QVector3D v2, QVector2D t2, QVector3D v3, QVector2D t3)
-    : mV1(v1), mV2(v2), mV3(v3)
-    , mT1(t1), mT2(t2), mT3(t3)
-    , mTexture(texture)
-    , mMaterial(material)
-{
-    mNormal = QVector3D::crossProduct(mV3 - mV2, mV1 - mV2).normalized();
-}
@@ -4,9 +4,9 @@
 #include <QVector>
 #include <QVector3D>
 #include <QSharedPointer>
-#include <QMap>
 
 #include "imageandsource.h"
+#include "materialtable.h"
 #include "simpletexturedobject.h"
 #include "tilematerial.h"
 
@@ -22,7 +22,7 @@ public:
     ImageInfo(const TileMaterial *material)
         : mImage(material->texture()) {}
 
-    SharedImageAndSource image() const { return mImage; }
+    const SharedImageAndSource &image() const { return mImage; }
 
     bool operator ==(const ImageInfo &other) const
     {
@@ -38,25 +38,21 @@ private:
     SharedImageAndSource mImage;
 };
 
-/// Class to wrap Phong reflection info.
+/// Class to wrap Phong reflection info. The parameters themselves live in the
+/// MaterialTable; this only refers to the material's entry.
 struct PhongInfo {
+    PhongInfo()
+        : material(0) {}
+
     PhongInfo(const TileMaterial *material)
-        : ambient(material->ambient())
-        , diffuse(material->diffuse())
-        , specular(material->specular())
-        , shininess(material->shininess()) {}
+        : material(MaterialTable::global().indexOf(material)) {}
 
-    float ambient;
-    float diffuse;
-    float specular;
-    float shininess;
+    /// The index of the material's entry in the MaterialTable.
+    quint16 material;
 
     bool operator ==(const PhongInfo &other) const
     {
-        return ambient == other.ambient
-                && diffuse == other.diffuse
-                && specular == other.specular
-                && shininess == other.shininess;
+        return material == other.material;
     }
 
     bool operator !=(const PhongInfo &other) const
@@ -77,8 +73,8 @@ public:
      * in counterclockwise order.
      */
     Quad(QVector3D normal,
-         ImageInfo texture,
-         PhongInfo material,
+         const ImageInfo &texture,
+         const PhongInfo &material,
          QVector3D v1, QVector2D t1,
          QVector3D v2, QVector2D t2,
          QVector3D v3, QVector2D t3,
@@ -89,8 +85,11 @@ public:
 
     QVector3D normal() const;
 
-    ImageInfo imageInfo() const;
-    PhongInfo phongInfo() const;
+    const ImageInfo &imageInfo() const { return mTexture; }
+    const PhongInfo &phongInfo() const { return mMaterial; }
+
+    /// Moves the quad by the given amount. Texture coordinates do not change.
+    void translate(QVector3D offset);
 
 
     /**
@@ -114,8 +113,8 @@ public:
                                  QVector2D xzDirection,
                                  float width,
                                  float height,
-                                 ImageInfo texture,
-                                 PhongInfo material,
+                                 const ImageInfo &texture,
+                                 const PhongInfo &material,
                                  bool upsideDown = false);
 
 
@@ -133,19 +132,22 @@ private:
 class Trig
 {
 public:
-    Trig(ImageInfo texture,
-         PhongInfo material,
+    Trig(const ImageInfo &texture,
+         const PhongInfo &material,
          QVector3D v1, QVector2D t1,
          QVector3D v2, QVector2D t2,
          QVector3D v3, QVector2D t3);
 
-    QVector<QVector3D> verts() const { return {mV1, mV2, mV3}; }
-    QVector<QVector2D> textureCoords() const { return {mT1, mT2, mT3}; }
+    QVector3D vertex(int idx) const;
+    QVector2D texCoord(int idx) const;
 
     QVector3D normal() const { return mNormal; }
 
-    ImageInfo imageInfo() const { return mTexture; }
-    PhongInfo phongInfo() const { return mMaterial; }
+    const ImageInfo &imageInfo() const { return mTexture; }
+    const PhongInfo &phongInfo() const { return mMaterial; }
+
+    /// Returns the normal of a triangle whose vertices are given in counterclockwise order.
+    static QVector3D faceNormal(QVector3D v1, QVector3D v2, QVector3D v3);
 
 private:
     QVector3D mV1, mV2, mV3;
@@ -158,45 +160,82 @@ private:
 };
 
 
+/// All attributes of one vertex of a PreObject.
+struct MeshVertex {
+    QVector3D position;
+    QVector3D normal;
+    QVector2D texCoord;
+    PhongInfo material;
+};
+
+
 /// Struct that holds SimpleTexturedObject information.
 /// This exists because SimpleTexturedObject is not made for partial construction.
+///
+/// Vertices are stored in a single array of MeshVertex, so adding a face grows at
+/// most two buffers (vertices and triangles), and only when they are out of room.
 class PreObject
 {
 public:
+    PreObject() : mImageKey(nullptr) {}
+
     /// Creates the PreObject with the given texture image.
-    PreObject(ImageInfo img);
+    PreObject(const ImageInfo &img);
 
     /// Adds the quad to this object, but does not change this object's texture image.
     void addQuad(const Quad &q);
 
     void addTrig(const Trig &t);
 
+    /// Adds a quad without constructing a Quad. Vertices must be in counterclockwise order.
+    void addQuad(QVector3D normal, const PhongInfo &material,
+                 QVector3D v1, QVector2D t1,
+                 QVector3D v2, QVector2D t2,
+                 QVector3D v3, QVector2D t3,
+                 QVector3D v4, QVector2D t4);
+
+    /// Adds a triangle without constructing a Trig. The normal is computed like Trig's.
+    void addTriangle(const PhongInfo &material,
+                     QVector3D v1, QVector2D t1,
+                     QVector3D v2, QVector2D t2,
+                     QVector3D v3, QVector2D t3);
+
     void addPreObject(const PreObject &o);
 
-    /// Compiles this PreObject into a SimpleTexturedObject.
+    /// Makes room for the given number of additional vertices and triangles.
+    void reserve(int numVertices, int numTriangles);
+
+    /// Moves this object by the given amount in the xz plane. See PartialMeshData::translate().
+    void translate(QVector2D offset);
+
+    /// Returns the approximate number of bytes used by this object's arrays.
+    int memoryUsage() const;
+
+    /// Compiles this PreObject into a SimpleTexturedObject. Vertices that are equal in
+    /// every attribute (position, normal, texture coordinates and material) are welded
+    /// into one, so the object is an indexed mesh with shared vertices.
     QSharedPointer<SimpleTexturedObject> toObject() const;
 
-    ImageInfo imageInfo() const { return mImage; }
+    ImageInfo imageInfo() const { return ImageInfo(mImage); }
+
+    /// The texture image that PartialMeshData groups objects by.
+    const QImage *imageKey() const { return mImageKey; }
 
 private:
-    // Face information.
-    QVector<QVector3D> mVertexPositions;
-    QVector<QVector3D> mTriangleNormals;
+    QVector<MeshVertex> mVertices;
     QVector<SimpleTexturedObject::Triangle> mTriangles;
 
-    // Material information.
-    QVector<float> mReflAmbient;
-    QVector<float> mReflDiffuse;
-    QVector<float> mReflSpecular;
-    QVector<float> mShininess;
-
-    // Texture information.
-    QVector<SimpleTexturedObject::TriangleTexCoords> mTriangleTextureCoordinates;
     SharedImageAndSource mImage;
+    const QImage *mImageKey;
 };
 
 /**
  * @brief Class to allow piece-by-piece mesh construction.
+ *
+ * Faces are appended straight into the buffers of the PreObject for their texture
+ * (see object()), so building a mesh does not create intermediate meshes. Meshes
+ * are combined with addPartialMesh(); an rvalue is spliced in by moving its
+ * PreObjects, which only copies data for textures that both meshes use.
  */
 class PartialMeshData
 {
@@ -206,7 +245,13 @@ public:
      * @brief   Constructs a list of meshes out of the data stored in this class.
      * @return  A list of meshes.
      */
-    QVector<QSharedPointer<SimpleTexturedObject>> constructObjects();
+    QVector<QSharedPointer<SimpleTexturedObject>> constructObjects() const;
+
+    /**
+     * @brief Returns the PreObject that collects the faces with the given texture,
+     * creating it if there is none yet.
+     */
+    PreObject &object(const ImageInfo &image);
 
     /**
      * @brief addQuad   Adds a quad to the mesh.
@@ -216,26 +261,64 @@ public:
 
     void addTrig(const Trig &t);
 
+    /// Adds a triangle without constructing a Trig. See PreObject::addTriangle().
+    void addTriangle(const ImageInfo &image, const PhongInfo &material,
+                     QVector3D v1, QVector2D t1,
+                     QVector3D v2, QVector2D t2,
+                     QVector3D v3, QVector2D t3);
+
     void addPartialMesh(const PartialMeshData &p);
 
+    /// Adds p to this mesh, moving its PreObjects where possible. p is left empty.
+    void addPartialMesh(PartialMeshData &&p);
+
+    /**
+     * @brief translate Moves the mesh by the given amount in the xz plane.
+     *
+     * Horizontal faces are textured using their world xz coordinates, so their
+     * texture coordinates move along with them. Other faces keep theirs.
+     *
+     * @param offset    The amount to move along the x and z axes.
+     */
+    void translate(QVector2D offset);
+
+    /**
+     * @brief memoryUsage   Returns the approximate number of bytes used by the mesh data.
+     */
+    int memoryUsage() const;
+
     PartialMeshData &operator +=(const PartialMeshData &other)
     {
         addPartialMesh(other);
         return *this;
     }
 
-    PartialMeshData &operator +(const PartialMeshData &other)
+    PartialMeshData &operator +=(PartialMeshData &&other)
     {
-        PartialMeshData p = *this;
-        return p += other;
+        addPartialMesh(std::move(other));
+        return *this;
     }
 
+    /**
+     * @brief Returns how many times any PartialMeshData has allocated (or copied on
+     * write) one of its buffers since the program started. Used to measure the
+     * allocations made while meshing.
+     */
+    static int bufferAllocations();
+
 private:
-    /// Keeps track of one PreObject per texture image.
-    QMap<const QImage *, PreObject> mTexturesToObjects;
+    /// Returns the PreObject with the given image key, or nullptr.
+    PreObject *findObject(const QImage *imageKey);
+
+    /// One PreObject per texture image. Tiles use very few textures, so a linear
+    /// search is faster than a map.
+    QVector<PreObject> mObjects;
 };
 
 
 }
 
+Q_DECLARE_TYPEINFO(M2M::MeshVertex, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(M2M::PreObject, Q_MOVABLE_TYPE);
+
 #endif // M2MPARTIALMESH_H
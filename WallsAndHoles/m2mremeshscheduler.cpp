@@ -0,0 +1,84 @@
+#include "m2mremeshscheduler.h"
+
+#include <QtGlobal>
+
+using namespace M2M;
+
+
+namespace {
+
+/// The initial guess for the time per tile, before any pass has been measured.
+const double InitialMsPerTile = 0.1;
+
+/// The weight of the newest pass in the time-per-tile average.
+const double MsPerTileSmoothing = 0.3;
+
+}
+
+
+const int RemeshScheduler::ImmediateCostMs;
+const int RemeshScheduler::StrokeIntervalMs;
+const int RemeshScheduler::MinCoalesceDelayMs;
+const int RemeshScheduler::MaxCoalesceDelayMs;
+
+
+RemeshScheduler::RemeshScheduler()
+    : mMsPerTile(InitialMsPerTile)
+    , mLastDecision({0, 0, 0, false})
+    , mStats({0, 0, 0, 0, 0}) {}
+
+RemeshScheduler::Decision RemeshScheduler::decide(int queuedTiles)
+{
+    bool inStroke = mSinceLastDecision.isValid()
+            && mSinceLastDecision.elapsed() < StrokeIntervalMs;
+
+    mSinceLastDecision.start();
+
+    Decision decision;
+    decision.queuedTiles = queuedTiles;
+    decision.estimatedCostMs = estimatedCostMs(queuedTiles);
+    decision.coalesced = inStroke || decision.estimatedCostMs > ImmediateCostMs;
+
+    if (decision.coalesced) {
+        // Waiting about as long as the pass will take keeps the mesher busy at
+        // most half the time while gathering as many edits as possible.
+        decision.delayMs = qBound(MinCoalesceDelayMs,
+                                  qRound(decision.estimatedCostMs),
+                                  MaxCoalesceDelayMs);
+        ++mStats.coalescedPasses;
+    } else {
+        decision.delayMs = 0;
+        ++mStats.immediatePasses;
+    }
+
+    ++mStats.decisions;
+    mLastDecision = decision;
+
+    return decision;
+}
+
+bool RemeshScheduler::shouldCancel(qint64 elapsedMs, int passTiles)
+{
+    bool cancel = elapsedMs < estimatedCostMs(passTiles) / 2;
+
+    if (cancel)
+        ++mStats.cancelledPasses;
+
+    return cancel;
+}
+
+void RemeshScheduler::passFinished(int numTiles, qint64 elapsedNs)
+{
+    ++mStats.completedPasses;
+
+    if (numTiles <= 0)
+        return;
+
+    double msPerTile = elapsedNs / 1e6 / numTiles;
+    mMsPerTile += MsPerTileSmoothing * (msPerTile - mMsPerTile);
+}
+
+double RemeshScheduler::estimatedCostMs(int numTiles) const
+{
+    return numTiles * mMsPerTile;
+}
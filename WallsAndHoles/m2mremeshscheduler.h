@@ -0,0 +1,119 @@
+#ifndef M2MREMESHSCHEDULER_H
+#define M2MREMESHSCHEDULER_H
+
+#include <QElapsedTimer>
+
+namespace M2M {
+
+/**
+ * @brief Decides when Map2Mesh should start its next meshing pass.
+ *
+ * The cost of a pass is estimated from the number of tiles it has to mesh that
+ * are not in the mesh cache, and a running average of the time per such tile of
+ * recent passes, as measured on the worker thread. The time of the cached tiles
+ * of the same chunks is spread over them. Cheap, isolated edits are meshed right
+ * away. Edits that keep arriving while earlier ones are still being meshed (e.g.
+ * during a brush stroke) are coalesced for about as long as a pass takes, so that
+ * meshing keeps up without starting a pass for every tile.
+ *
+ * This class is only used from the thread that owns the Map2Mesh.
+ */
+class RemeshScheduler
+{
+public:
+    /**
+     * @brief A scheduling decision, kept for profiling.
+     */
+    struct Decision {
+        /// How long to wait before starting the pass, in milliseconds.
+        int delayMs;
+
+        /// The number of tiles waiting to be meshed.
+        int queuedTiles;
+
+        /// The estimated time to mesh the queued tiles, in milliseconds.
+        double estimatedCostMs;
+
+        /// True if edits were being coalesced, false if the pass starts right away.
+        bool coalesced;
+    };
+
+    struct Stats {
+        int decisions;
+        int immediatePasses;
+        int coalescedPasses;
+
+        /// The number of running passes that were cancelled because of an edit.
+        int cancelledPasses;
+
+        int completedPasses;
+    };
+
+
+    RemeshScheduler();
+
+    /**
+     * @brief decide        Chooses the delay before meshing the queued tiles.
+     * @param queuedTiles   The number of tiles waiting to be meshed that are not in the
+     *                      mesh cache, roughly.
+     * @return              The decision, which is also stored as lastDecision().
+     */
+    Decision decide(int queuedTiles);
+
+    /**
+     * @brief shouldCancel  Decides whether an edit that affects the running pass
+     *                      should cancel it. A pass that is mostly done is allowed
+     *                      to finish, so that long strokes still show progress.
+     * @param elapsedMs     How long the pass has been running.
+     * @param passTiles     The number of tiles in the pass.
+     */
+    bool shouldCancel(qint64 elapsedMs, int passTiles);
+
+    /**
+     * @brief passFinished  Updates the time-per-tile estimate.
+     * @param numTiles      The queuedTiles of the pass, as given to decide().
+     * @param elapsedNs     The time the pass took on its worker thread, not counting
+     *                      the wait for the event loop to handle its result.
+     */
+    void passFinished(int numTiles, qint64 elapsedNs);
+
+    /**
+     * @brief Returns the estimated time to mesh the given number of tiles, in milliseconds.
+     */
+    double estimatedCostMs(int numTiles) const;
+
+    /**
+     * @brief The current estimate of the average meshing time per tile, in milliseconds.
+     */
+    double msPerTile() const { return mMsPerTile; }
+
+    const Decision &lastDecision() const { return mLastDecision; }
+
+    const Stats &stats() const { return mStats; }
+
+
+    /// Passes estimated to take at most this long start right away when not coalescing.
+    static const int ImmediateCostMs = 8;
+
+    /// Decisions closer together than this are considered part of one stroke.
+    static const int StrokeIntervalMs = 150;
+
+    /// Bounds for the delay while coalescing.
+    static const int MinCoalesceDelayMs = 16;
+    static const int MaxCoalesceDelayMs = 250;
+
+private:
+    /// Exponential moving average of the time per tile.
+    double mMsPerTile;
+
+    /// Measures the time since the last decision.
+    QElapsedTimer mSinceLastDecision;
+
+    Decision mLastDecision;
+
+    Stats mStats;
+};
+
+}
+
+#endif // M2MREMESHSCHEDULER_H
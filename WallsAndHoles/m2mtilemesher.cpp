@@ -4,44 +4,50 @@
 #include "polygon.h"
 
 #include "m2mtilemesher_private.h"
+#include "m2mtopfacemerger.h"
 #include "blockypolygontilemesher.h"
 #include "groundblockypolygontilemesher.h"
 
-M2M::TileNeighborhoodInfo::TileNeighborhoodInfo(const TileMap *tileMap, QPoint centerTilePos)
-    : mTileMap(tileMap)
+M2M::TileNeighborhoodInfo::TileNeighborhoodInfo(const MapSnapshot *map, QPoint centerTilePos)
+    : mMap(map)
     , mCenterTilePos(centerTilePos)
 {
-    Q_ASSERT(tileMap != nullptr);
+    Q_ASSERT(map != nullptr);
 }
 
-const Tile *M2M::TileNeighborhoodInfo::operator ()(int x, int y) const
+const M2M::TileInfo *M2M::TileNeighborhoodInfo::operator ()(int x, int y) const
 {
     QPoint pt = QPoint(x, y) + mCenterTilePos;
 
-    if (mTileMap->contains(pt.x(), pt.y()))
-        return &mTileMap->cTileAt(pt.x(), pt.y());
+    if (mMap->contains(pt.x(), pt.y()))
+        return &mMap->tileAt(pt.x(), pt.y());
     else
         return nullptr;
 }
 
-const Tile *M2M::TileNeighborhoodInfo::operator ()(QPoint pt) const
+const M2M::TileInfo *M2M::TileNeighborhoodInfo::operator ()(QPoint pt) const
 {
     pt += mCenterTilePos;
 
-    if (mTileMap->contains(pt.x(), pt.y()))
-        return &mTileMap->cTileAt(pt.x(), pt.y());
+    if (mMap->contains(pt.x(), pt.y()))
+        return &mMap->tileAt(pt.x(), pt.y());
     else
         return nullptr;
 }
 
-const Tile *M2M::TileNeighborhoodInfo::centerTile() const
+const M2M::TileInfo *M2M::TileNeighborhoodInfo::centerTile() const
 {
-    if (mTileMap->contains(mCenterTilePos.x(), mCenterTilePos.y()))
-        return &mTileMap->cTileAt(mCenterTilePos.x(), mCenterTilePos.y());
+    if (mMap->contains(mCenterTilePos.x(), mCenterTilePos.y()))
+        return &mMap->tileAt(mCenterTilePos.x(), mCenterTilePos.y());
     else
         return nullptr;
 }
 
+const M2M::MaterialInfo &M2M::TileNeighborhoodInfo::groundMaterial() const
+{
+    return mMap->groundMaterial();
+}
+
 QSharedPointer<M2M::AbstractTileMesher> M2M::TileNeighborhoodInfo::makeMesher() const
 {
     if (centerTile()->hasTileTemplate())
@@ -50,9 +56,103 @@ QSharedPointer<M2M::AbstractTileMesher> M2M::TileNeighborhoodInfo::makeMesher()
         return QSharedPointer<M2M::AbstractTileMesher>(new GroundBlockyPolygonTileMesher(*this));
 }
 
-QSharedPointer<M2M::AbstractTileMesher> M2M::AbstractTileMesher::getMesherForTile(const TileMap *tileMap, QPoint tilePoint)
+namespace {
+
+template< typename T >
+void appendBytes(QByteArray &key, const T &value)
+{
+    key.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+void appendMaterial(QByteArray &key, const M2M::MaterialInfo &material)
+{
+    // The image pointer cannot be reused by a different image while a cached
+    // mesh that uses it is alive, because the mesh holds a reference to it.
+    appendBytes(key, material.imageInfo().image().data());
+
+    // Meshes only refer to the material's Phong parameters by index, so editing them
+    // does not change the mesh.
+    appendBytes(key, material.phongInfo().material);
+}
+
+}
+
+QByteArray M2M::TileNeighborhoodInfo::signature() const
+{
+    const int radius = AbstractTileMesher::NeighborhoodRadius;
+    const int numCells = (2 * radius + 1) * (2 * radius + 1);
+
+    // Templates in the order in which they first appear. Label 0 means "no template".
+    const TileTemplate *templates[numCells];
+    int numTemplates = 0;
+
+    QByteArray key;
+    key.reserve(numCells * 64);
+
+    appendMaterial(key, groundMaterial());
+
+    for (int dx = -radius; dx <= radius; ++dx) {
+        for (int dy = -radius; dy <= radius; ++dy) {
+            const TileInfo *tile = (*this)(dx, dy);
+
+            if (tile == nullptr) {
+                key.append('\0');
+                continue;
+            }
+
+            quint8 label = 0;
+            if (tile->hasTileTemplate()) {
+                int idx = 0;
+                while (idx < numTemplates && templates[idx] != tile->tileTemplate())
+                    ++idx;
+
+                if (idx == numTemplates)
+                    templates[numTemplates++] = tile->tileTemplate();
+
+                label = idx + 1;
+            }
+
+            quint8 flags = 1
+                    | (tile->bridgeTiles() ? 2 : 0)
+                    | (tile->connectDiagonals() ? 4 : 0);
+
+            appendBytes(key, flags);
+            appendBytes(key, label);
+            appendBytes(key, tile->height());
+            appendBytes(key, tile->thickness());
+            appendBytes(key, tile->position().x());
+            appendBytes(key, tile->position().y());
+            appendMaterial(key, tile->topMaterial());
+            appendMaterial(key, tile->sideMaterial());
+        }
+    }
+
+    return key;
+}
+
+QSharedPointer<M2M::AbstractTileMesher> M2M::AbstractTileMesher::getMesherForTile(const MapSnapshot *map, QPoint tilePoint)
 {
-    return TileNeighborhoodInfo(tileMap, tilePoint).makeMesher();
+    return TileNeighborhoodInfo(map, tilePoint).makeMesher();
+}
+
+QVector<QSharedPointer<SimpleTexturedObject>> M2M::AbstractTileMesher::makeMesh(QVector2D offset)
+{
+    return makeMeshData(offset).constructObjects();
+}
+
+M2M::PartialMeshData M2M::AbstractTileMesher::makeMeshData(QVector2D offset)
+{
+    TileMesh tileMesh = makeTileMesh(offset);
+
+    if (tileMesh.hasFlatTop) {
+        QRectF top(offset.x(), offset.y(), 1, 1);
+        addHorizontalRectangle(tileMesh.mesh, top, tileMesh.topHeight, tileMesh.topMaterial);
+    }
+
+    for (const Quad &wall : tileMesh.walls)
+        tileMesh.mesh.addQuad(wall);
+
+    return std::move(tileMesh.mesh);
 }
 
 M2M::AbstractTileMesher::AbstractTileMesher(M2M::TileNeighborhoodInfo nbhd)
@@ -3,9 +3,11 @@
 
 #include <QVector2D>
 #include <QSharedPointer>
+#include <QByteArray>
 
-#include "tilemap.h"
 #include "simpletexturedobject.h"
+#include "m2mpartialmesh.h"
+#include "m2mmapsnapshot.h"
 
 namespace M2M {
 
@@ -14,22 +16,79 @@ class AbstractTileMesher;
 class TileNeighborhoodInfo
 {
 public:
-    TileNeighborhoodInfo(const TileMap *tileMap, QPoint centerTilePos);
+    TileNeighborhoodInfo(const MapSnapshot *map, QPoint centerTilePos);
 
-    const Tile *operator ()(int x, int y) const;
-    const Tile *operator ()(QPoint pt) const;
+    const TileInfo *operator ()(int x, int y) const;
+    const TileInfo *operator ()(QPoint pt) const;
 
-    const Tile *centerTile() const;
+    const TileInfo *centerTile() const;
+
+    /// The material for ground that is not covered by any tile.
+    const MaterialInfo &groundMaterial() const;
 
     QSharedPointer<AbstractTileMesher> makeMesher() const;
 
+    /**
+     * @brief Returns a key that is equal for two neighborhoods exactly when their
+     * meshes are equal up to a translation.
+     *
+     * The key contains everything meshers can read about each tile in the 5x5
+     * window. Tile templates are only compared against each other, so they are
+     * numbered in order of first appearance rather than stored as pointers.
+     */
+    QByteArray signature() const;
+
 private:
-    const TileMap *mTileMap;
+    const MapSnapshot *mMap;
 
     QPoint mCenterTilePos;
 };
 
 
+/**
+ * @brief The mesh of a single tile.
+ *
+ * If the tile's whole top surface is one flat unit square (e.g. open ground or a
+ * full-size block), the top is left out of the mesh and only described by topHeight
+ * and topMaterial, so that neighboring tops can be merged (see TopFaceMerger).
+ * Likewise, vertical walls that face along the x or z axis are kept separate so
+ * that walls hidden by neighboring tiles can be removed (see HiddenWallRemover).
+ */
+struct TileMesh
+{
+    TileMesh()
+        : hasFlatTop(false)
+        , topHeight(0) {}
+
+    /// Everything except the flat top and the walls.
+    PartialMeshData mesh;
+
+    /// Vertical walls whose normal points along the x or z axis.
+    QVector<Quad> walls;
+
+    bool hasFlatTop;
+    float topHeight;
+    MaterialInfo topMaterial;
+
+    /// Moves the mesh by the given amount in the xz plane. The flat top is described
+    /// relative to the tile, so it does not change.
+    void translate(QVector2D offset)
+    {
+        mesh.translate(offset);
+
+        for (Quad &wall : walls)
+            wall.translate(QVector3D(offset.x(), 0, offset.y()));
+    }
+
+    /// Returns the approximate number of bytes used by this mesh.
+    int memoryUsage() const
+    {
+        return sizeof(TileMesh) - sizeof(PartialMeshData) + mesh.memoryUsage()
+                + walls.size() * sizeof(Quad);
+    }
+};
+
+
 /**
  * @brief A collection of methods for generating tile mesh data.
  */
@@ -39,25 +98,48 @@ public:
 
     virtual ~AbstractTileMesher() {}
 
+    /**
+     * @brief The largest offset (in either coordinate) of a tile that a mesher may read
+     * through its TileNeighborhoodInfo. A tile's mesh therefore depends on the
+     * (2 * NeighborhoodRadius + 1)^2 tiles around it.
+     */
+    static const int NeighborhoodRadius = 2;
+
     /**
      * @brief Returns a TileMesher instance that will create the mesh for the given tile,
      * or, if the tile has not changed (determined by oldMesher), returns nullptr.
      */
-    static QSharedPointer<AbstractTileMesher> getMesherForTile(const TileMap *tileMap, QPoint tilePoint);
+    static QSharedPointer<AbstractTileMesher> getMesherForTile(const MapSnapshot *map, QPoint tilePoint);
 
 
     /**
      * @brief makeMesh  Creates the mesh for this tile.
      * @return          A list of objects that contain the mesh info for the tile.
      */
-    virtual QVector<QSharedPointer<SimpleTexturedObject>> makeMesh(QVector2D offset) = 0;
+    QVector<QSharedPointer<SimpleTexturedObject>> makeMesh(QVector2D offset);
+
+    /**
+     * @brief makeMeshData  Creates the mesh data for this tile without creating any objects.
+     * @return              The complete mesh data for the tile, offset by the given amount.
+     */
+    PartialMeshData makeMeshData(QVector2D offset);
+
+    /**
+     * @brief makeTileMesh  Creates the mesh for this tile, with a flat top split out.
+     *
+     * This only reads the tile's neighborhood in the MapSnapshot and does not touch any
+     * shared state, so meshers for different tiles may run this concurrently on any thread.
+     *
+     * @return              The mesh for the tile, offset by the given amount.
+     */
+    virtual TileMesh makeTileMesh(QVector2D offset) = 0;
 
 
 protected:
     AbstractTileMesher(TileNeighborhoodInfo nbhd);
 
     /**
-     * @brief Information for each tile in the 3x3 neighborhood of the tile to which this mesher is associated.
+     * @brief Information for each tile in the 5x5 neighborhood of the tile to which this mesher is associated.
      */
     TileNeighborhoodInfo mTileNeighborhood;
 };
@@ -41,8 +41,8 @@ M2M::Quad SideTools::makeTopQuadFragment(SideDirection side,
                                          QVector2D quadCenter,
                                          QVector2D minusQuadCenter,
                                          float minusQuadSize,
-                                         M2M::ImageInfo quadImage,
-                                         M2M::PhongInfo quadMaterial)
+                                         const M2M::ImageInfo &quadImage,
+                                         const M2M::PhongInfo &quadMaterial)
 {
     // The normal direction is just the away direction.
     QVector3D awayDirection = SideTools::normalDirection(side);
@@ -69,8 +69,8 @@ M2M::Quad makeTopQuadFragment(SideDirection side,
                               QVector2D quadCenter,
                               QVector2D minusQuadCenter,
                               float minusQuadSize,
-                              M2M::ImageInfo quadImage,
-                              M2M::PhongInfo quadMaterial);
+                              const M2M::ImageInfo &quadImage,
+                              const M2M::PhongInfo &quadMaterial);
 
 }
 }
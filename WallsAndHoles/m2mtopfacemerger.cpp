@@ -0,0 +1,119 @@
+#include "m2mtopfacemerger.h"
+
+#include "array2d.h"
+
+using namespace M2M;
+
+
+void M2M::addHorizontalRectangle(PartialMeshData &mesh, QRectF xzRect, float height, const MaterialInfo &material)
+{
+    float x0 = xzRect.left();
+    float x1 = xzRect.right();
+    float z0 = xzRect.top();
+    float z1 = xzRect.bottom();
+
+    QVector3D v00(x0, height, z0);
+    QVector3D v01(x0, height, z1);
+    QVector3D v11(x1, height, z1);
+    QVector3D v10(x1, height, z0);
+
+    // Both triangles face up (see Trig::faceNormal()).
+    PreObject &object = mesh.object(material.imageInfo());
+    object.addTriangle(material.phongInfo(),
+                       v00, QVector2D(x0, z0),
+                       v01, QVector2D(x0, z1),
+                       v11, QVector2D(x1, z1));
+    object.addTriangle(material.phongInfo(),
+                       v00, QVector2D(x0, z0),
+                       v11, QVector2D(x1, z1),
+                       v10, QVector2D(x1, z0));
+}
+
+
+/* BEGIN TopFaceMerger */
+TopFaceMerger::TopFaceMerger(bool mergeTops)
+    : mMergeTops(mergeTops) {}
+
+void TopFaceMerger::addTile(QPoint position, const TileMesh &tileMesh)
+{
+    mMesh += tileMesh.mesh;
+
+    if (tileMesh.hasFlatTop)
+        mFlatTops.append({position, tileMesh.topHeight, tileMesh.topMaterial});
+}
+
+PartialMeshData TopFaceMerger::finish()
+{
+    if (mFlatTops.isEmpty())
+        return std::move(mMesh);
+
+    if (!mMergeTops) {
+        for (const FlatTop &top : mFlatTops)
+            addHorizontalRectangle(mMesh, QRectF(top.position, QSizeF(1, 1)), top.height, top.material);
+
+        return std::move(mMesh);
+    }
+
+    // Put the tops into a grid that covers all of them.
+    int minX = mFlatTops.first().position.x();
+    int minY = mFlatTops.first().position.y();
+    int maxX = minX;
+    int maxY = minY;
+
+    for (const FlatTop &top : mFlatTops) {
+        minX = qMin(minX, top.position.x());
+        minY = qMin(minY, top.position.y());
+        maxX = qMax(maxX, top.position.x());
+        maxY = qMax(maxY, top.position.y());
+    }
+
+    // Indices into mFlatTops, or -1 for tiles that have no flat top (or were merged already).
+    Array2D<int> grid(maxX - minX + 1, maxY - minY + 1, -1);
+    for (int i = 0; i < mFlatTops.size(); ++i)
+        grid(mFlatTops[i].position - QPoint(minX, minY)) = i;
+
+    auto matches = [this, &grid] (int x, int y, const FlatTop &top) {
+        int idx = grid(x, y);
+        return idx != -1 && mFlatTops[idx].canMergeWith(top);
+    };
+
+    // Greedily grow a rectangle from each remaining top: first along x, then along y.
+    for (int y = 0; y < grid.height(); ++y) {
+        for (int x = 0; x < grid.width(); ++x) {
+            if (grid(x, y) == -1)
+                continue;
+
+            const FlatTop top = mFlatTops[grid(x, y)];
+
+            int width = 1;
+            while (x + width < grid.width() && matches(x + width, y, top))
+                ++width;
+
+            int height = 1;
+            for (bool rowMatches = true; rowMatches && y + height < grid.height(); ) {
+                for (int dx = 0; dx < width && rowMatches; ++dx)
+                    rowMatches = matches(x + dx, y + height, top);
+
+                if (rowMatches)
+                    ++height;
+            }
+
+            for (int dx = 0; dx < width; ++dx)
+                for (int dy = 0; dy < height; ++dy)
+                    grid(x + dx, y + dy) = -1;
+
+            QRectF rect(minX + x, minY + y, width, height);
+            addHorizontalRectangle(mMesh, rect, top.height, top.material);
+        }
+    }
+
+    return std::move(mMesh);
+}
+
+bool TopFaceMerger::FlatTop::canMergeWith(const FlatTop &other) const
+{
+    return height == other.height
+            && material.imageInfo() == other.material.imageInfo()
+            && material.phongInfo() == other.material.phongInfo();
+}
+/* END TopFaceMerger */
@@ -0,0 +1,68 @@
+#ifndef M2MTOPFACEMERGER_H
+#define M2MTOPFACEMERGER_H
+
+#include <QPoint>
+#include <QRectF>
+#include <QVector>
+
+#include "m2mtilemesher.h"
+
+namespace M2M {
+
+/**
+ * @brief Adds an upward-facing, axis-aligned rectangle at the given height to mesh.
+ *
+ * Like other horizontal faces, it is textured using world xz coordinates.
+ *
+ * @param xzRect    The rectangle in the xz plane (x is QRectF's x, z is QRectF's y).
+ */
+void addHorizontalRectangle(PartialMeshData &mesh, QRectF xzRect, float height, const MaterialInfo &material);
+
+
+/**
+ * @brief Combines the meshes of a group of tiles (e.g. a chunk) and merges
+ * their flat tops.
+ *
+ * Adjacent flat tops with the same height and material are greedily merged into
+ * maximal rectangles, each of which is only two triangles. The tops are textured
+ * with world coordinates, so textures continue seamlessly across the merged tiles.
+ */
+class TopFaceMerger
+{
+public:
+    /**
+     * @param mergeTops If false, each flat top is output on its own.
+     */
+    explicit TopFaceMerger(bool mergeTops = true);
+
+    /**
+     * @brief addTile   Adds the mesh of the tile at the given position. The tile's
+     *                  walls are not included, see HiddenWallRemover.
+     */
+    void addTile(QPoint position, const TileMesh &tileMesh);
+
+    /**
+     * @brief Returns the combined mesh of all added tiles. The mesh is moved out,
+     * so this should only be called once.
+     */
+    PartialMeshData finish();
+
+private:
+    struct FlatTop {
+        QPoint position;
+        float height;
+        MaterialInfo material;
+
+        bool canMergeWith(const FlatTop &other) const;
+    };
+
+    bool mMergeTops;
+
+    PartialMeshData mMesh;
+
+    QVector<FlatTop> mFlatTops;
+};
+
+}
+
+#endif // M2MTOPFACEMERGER_H
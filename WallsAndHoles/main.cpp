@@ -10,7 +10,7 @@ int main(int argc, char *argv[])
 
     QSurfaceFormat format;
     format.setDepthBufferSize(24);
-    format.setVersion(3, 2);
+    format.setVersion(3, 3); // for instanced vertex attributes
     format.setProfile(QSurfaceFormat::CoreProfile);
     QSurfaceFormat::setDefaultFormat(format);
 
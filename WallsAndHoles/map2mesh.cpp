@@ -1,16 +1,47 @@
-#include <QMutexLocker>
-#include <QTimer>
+#include <QtConcurrent>
+
+#include <algorithm>
 
 #include "map2mesh.h"
 #include "array2dtools.h"
+#include "m2mtopfacemerger.h"
+#include "m2mhiddenwallremover.h"
+
+
+namespace {
+
+/// Orders points by (y, x).
+bool rowMajorLess(const QPoint &a, const QPoint &b)
+{
+    return a.y() < b.y() || (a.y() == b.y() && a.x() < b.x());
+}
+
+}
 
 
 Map2Mesh::Map2Mesh(TileMap *tileMap, QObject *parent)
     : QObject(parent)
     , mTileMap(tileMap)
     , mScene(SimpleTexturedScene::makeScene())
-    , mSceneUpdateScheduled(false)
+    , mChunkSize(DefaultChunkSize)
+    , mMergeTopFaces(true)
+    , mRemoveHiddenWalls(true)
+    , mRemakeAllPending(false)
+    , mAllOccludersPending(false)
+    , mPassCancelled(0)
+    , mPassActive(false)
+    , mPassWorkerNs(0)
+    , mPassQueuedTiles(0)
+    , mPassNumTiles(0)
+    , mPassReplacesAll(false)
+    , mPassFindsOccluders(false)
+    , mPassFindsAllOccluders(false)
 {
+    mSceneUpdateTimer.setSingleShot(true);
+    connect(&mSceneUpdateTimer, &QTimer::timeout, this, &Map2Mesh::startSceneUpdate);
+
+    connect(&mPassWatcher, &QFutureWatcherBase::finished, this, &Map2Mesh::sceneUpdateFinished);
+
     if (mTileMap) {
         // This will set up and initialize all output-related variables.
         remakeAll();
@@ -19,78 +50,464 @@ Map2Mesh::Map2Mesh(TileMap *tileMap, QObject *parent)
         // Connect the tile changed & map resized signals.
         connect(mTileMap, &TileMap::tileChanged, this, &Map2Mesh::tileChanged);
         connect(mTileMap, &TileMap::resized, this, &Map2Mesh::remakeAll);
+        connect(mTileMap, &TileMap::indoorChanged, this, &Map2Mesh::indoorChanged);
     }
 }
 
 
+Map2Mesh::~Map2Mesh()
+{
+    mPassCancelled.storeRelease(1);
+    mPassWatcher.waitForFinished();
+}
+
+
 SharedSimpleTexturedScene Map2Mesh::getScene() const
 {
     return mScene;
 }
 
+void Map2Mesh::setMeshingThreadCount(int threadCount)
+{
+    mParallelMesher.setThreadCount(threadCount);
+}
+
+int Map2Mesh::meshingThreadCount() const
+{
+    return mParallelMesher.threadCount();
+}
+
+M2M::MeshCache::Stats Map2Mesh::meshCacheStats() const
+{
+    return mParallelMesher.meshCache().stats();
+}
+
+void Map2Mesh::setMeshCacheEnabled(bool enabled)
+{
+    mParallelMesher.setCacheEnabled(enabled);
+}
+
+bool Map2Mesh::isMeshCacheEnabled() const
+{
+    return mParallelMesher.isCacheEnabled();
+}
+
+void Map2Mesh::setChunkSize(int chunkSize)
+{
+    chunkSize = qMax(1, chunkSize);
+
+    if (chunkSize == mChunkSize)
+        return;
+
+    mChunkSize = chunkSize;
+
+    if (mTileMap)
+        remakeAll();
+}
+
+int Map2Mesh::chunkSize() const
+{
+    return mChunkSize;
+}
+
+void Map2Mesh::setMergeTopFaces(bool merge)
+{
+    if (merge == mMergeTopFaces)
+        return;
+
+    mMergeTopFaces = merge;
+
+    if (mTileMap)
+        remakeAll();
+}
+
+bool Map2Mesh::mergeTopFaces() const
+{
+    return mMergeTopFaces;
+}
+
+void Map2Mesh::setRemoveHiddenWalls(bool remove)
+{
+    if (remove == mRemoveHiddenWalls)
+        return;
+
+    mRemoveHiddenWalls = remove;
+
+    if (mTileMap)
+        remakeAll();
+}
+
+bool Map2Mesh::removeHiddenWalls() const
+{
+    return mRemoveHiddenWalls;
+}
+
+QSize Map2Mesh::chunkGridSize(QSize mapSize) const
+{
+    return QSize((mapSize.width() + mChunkSize - 1) / mChunkSize,
+                 (mapSize.height() + mChunkSize - 1) / mChunkSize);
+}
+
+QRect Map2Mesh::chunkTiles(QPoint chunk, QSize mapSize) const
+{
+    QPoint start = chunk * mChunkSize;
+    QPoint end(qMin(start.x() + mChunkSize, mapSize.width()), qMin(start.y() + mChunkSize, mapSize.height()));
+
+    return QRect(start, end - QPoint(1, 1));
+}
+
+void Map2Mesh::updateSceneOccluders()
+{
+    QVector<BoundingBox> occluders;
+    for (const QVector<BoundingBox> &chunkOccluders : mChunkOccluders)
+        occluders += chunkOccluders;
+
+    mScene->setOccluders(occluders);
+}
+
+int Map2Mesh::estimateQueuedTiles() const
+{
+    QSize mapSize = mMapSnapshot.mapSize();
+    if (mRemakeAllPending)
+        return mapSize.width() * mapSize.height();
+
+    // Each edit changes the neighborhoods of the tiles around it, but never more
+    // tiles than the queued chunks hold. The other tiles come from the mesh cache.
+    int side = 2 * M2M::AbstractTileMesher::NeighborhoodRadius + 1;
+
+    return qMin(mEditedTiles.size() * side * side, mChunksToUpdate.size() * mChunkSize * mChunkSize);
+}
+
+const M2M::RemeshScheduler &Map2Mesh::remeshScheduler() const
+{
+    return mRemeshScheduler;
+}
+
+int Map2Mesh::queuedChunkCount() const
+{
+    return mChunksToUpdate.size();
+}
+
+void Map2Mesh::finishSceneUpdate()
+{
+    for (;;) {
+        if (mPassActive) {
+            mPassWatcher.waitForFinished();
+            sceneUpdateFinished();
+        } else if (!mChunksToUpdate.isEmpty() || mRemakeAllPending || mAllOccludersPending) {
+            mSceneUpdateTimer.stop();
+            startSceneUpdate();
+        } else {
+            break;
+        }
+    }
+}
+
 void Map2Mesh::tileChanged(int x, int y)
 {
-    // Update this tile and its neighboring tiles.
-    QMutexLocker sceneLocker(&mSceneUpdateMutex);
+    QSize mapSize = mTileMap->mapSize();
+
+    // The snapshot is replaced anyway if the map is being resized.
+    if (mMapSnapshot.mapSize() == mapSize)
+        mMapSnapshot.updateTile(mTileMap, x, y);
 
-    mTilesToUpdate += {x, y};
-    mTilesToUpdate += getValidNeighbors(x, y, mTileMap->mapSize());
-    sceneLocker.unlock();
+    mEditedTiles += QPoint(x, y);
 
+    // Update every chunk with a tile whose mesher can see this tile, or, when
+    // removing hidden walls, with a tile next to such a tile.
+    const int radius = M2M::AbstractTileMesher::NeighborhoodRadius + (mRemoveHiddenWalls ? 1 : 0);
 
-    if (!mSceneUpdateScheduled) {
-        mSceneUpdateScheduled = true;
+    bool affectsPass = false;
 
-        QTimer::singleShot(500, this, [this] () {
-            mSceneUpdateScheduled = false;
-            updateScene();
-        });
+    for (int dx = -radius; dx <= radius; ++dx) {
+        for (int dy = -radius; dy <= radius; ++dy) {
+            if (!isPointInBounds(x + dx, y + dy, mapSize))
+                continue;
+
+            QPoint chunk((x + dx) / mChunkSize, (y + dy) / mChunkSize);
+            mChunksToUpdate += chunk;
+
+            if (mPassActive && !affectsPass)
+                affectsPass = std::binary_search(mPassChunks.begin(), mPassChunks.end(), chunk, rowMajorLess);
+        }
     }
+
+    // Part of the running pass is now out of date. Either way, its chunks are
+    // meshed again by the next pass, so cancelling only saves work.
+    if (affectsPass
+            && mPassCancelled.loadAcquire() == 0
+            && mRemeshScheduler.shouldCancel(mPassTimer.elapsed(), mPassQueuedTiles))
+        cancelSceneUpdate();
+
+    scheduleSceneUpdate();
 }
 
 
 void Map2Mesh::remakeAll()
 {
-    mTileObjects = TileObjectGrid(mTileMap->mapSize());
-    mScene->clear();
+    cancelSceneUpdate();
+
+    mMapSnapshot = M2M::MapSnapshot(mTileMap);
+
+    // Update all chunks. The old objects stay in the scene until the new ones are ready.
+    QSize gridSize = chunkGridSize(mTileMap->mapSize());
+
+    mRemakeAllPending = true;
+    mChunksToUpdate.clear();
+    mEditedTiles.clear();
+    for (int x = 0; x < gridSize.width(); ++x)
+        for (int y = 0; y < gridSize.height(); ++y)
+            mChunksToUpdate.insert(QPoint(x, y));
+
+    // Start from the event loop (or finishSceneUpdate()), so that settings changed
+    // right after construction apply to the first pass.
+    mSceneUpdateTimer.start(0);
+}
+
+
+void Map2Mesh::indoorChanged(bool indoor)
+{
+    if (indoor) {
+        mAllOccludersPending = true;
+        scheduleSceneUpdate();
+    } else {
+        // The running pass sees that the map is outdoor now and drops its occluders.
+        mAllOccludersPending = false;
+        mChunkOccluders = Array2D<QVector<BoundingBox>>(mChunkOccluders.size());
+        updateSceneOccluders();
+    }
+}
 
-    // Update all points.
-    QMutexLocker locker(&mSceneUpdateMutex);
-    for (const QPoint &pt : mTileMap->getArray2D().indices())
-        mTilesToUpdate.insert(pt);
-    locker.unlock();
 
+void Map2Mesh::scheduleSceneUpdate()
+{
+    if (mPassActive || mSceneUpdateTimer.isActive()
+            || (mChunksToUpdate.isEmpty() && !mRemakeAllPending && !mAllOccludersPending))
+        return;
+
+    M2M::RemeshScheduler::Decision decision = mRemeshScheduler.decide(estimateQueuedTiles());
 
-    updateScene();
+    // Even with no delay, the pass starts from the event loop so that all tiles
+    // changed by one operation are meshed together.
+    mSceneUpdateTimer.start(decision.delayMs);
 }
 
 
-void Map2Mesh::updateScene()
+void Map2Mesh::startSceneUpdate()
 {
-    QMutexLocker locker(&mSceneUpdateMutex);
+    if (mPassActive || (mChunksToUpdate.isEmpty() && !mRemakeAllPending && !mAllOccludersPending))
+        return;
+
+    QSize mapSize = mMapSnapshot.mapSize();
+    QSize gridSize = chunkGridSize(mapSize);
+
+    mPassQueuedTiles = estimateQueuedTiles();
+
+    mPassChunks.clear();
+    mPassChunks.reserve(mChunksToUpdate.size());
+
+    for (const QPoint &chunk : mChunksToUpdate) {
+        // The map may have been resized since the chunk was added.
+        if (isPointInBounds(chunk.x(), chunk.y(), gridSize))
+            mPassChunks.append(chunk);
+    }
+
+    mChunksToUpdate.clear();
+
+    mPassEditedTiles = mEditedTiles;
+    mEditedTiles.clear();
+
+    // Sort the chunks so that objects are always added to the scene in the same order.
+    std::sort(mPassChunks.begin(), mPassChunks.end(), rowMajorLess);
 
-    for (int x = 0; x < mTileMap->width(); ++x) {
-        for (int y = 0; y < mTileMap->height(); ++y) {
-            // Get a new mesher for the tile. If this is nullptr,
-            // that means that the tile's mesh does not need an update.
-            auto newMesher = M2M::AbstractTileMesher::getMesherForTile(mTileMap, QPoint(x, y));
+    // List the tiles chunk by chunk. Each chunk's tiles are followed by the tiles
+    // around it, whose walls may hide walls of the chunk. chunkEnds[i] is one past
+    // the last tile of chunk i, and ringEnds[i] one past the last tile around it.
+    QVector<QPoint> tiles;
+    QVector<int> chunkEnds;
+    QVector<int> ringEnds;
+    chunkEnds.reserve(mPassChunks.size());
+    ringEnds.reserve(mPassChunks.size());
 
-            auto oldObjects = mTileObjects(x, y);
+    bool removeHiddenWalls = mRemoveHiddenWalls;
 
-            for (auto obj : oldObjects)
-                mScene->removeObject(obj);
+    mPassNumTiles = 0;
 
-            auto newObjects = newMesher->makeMesh(QVector2D(x, y));
+    for (const QPoint &chunk : mPassChunks) {
+        QRect chunkRect = chunkTiles(chunk, mapSize);
+        int startX = chunkRect.left();
+        int startY = chunkRect.top();
+        int endX = chunkRect.right() + 1;
+        int endY = chunkRect.bottom() + 1;
 
-            for (auto obj : newObjects)
-                mScene->addObject(obj);
+        for (int y = startY; y < endY; ++y)
+            for (int x = startX; x < endX; ++x)
+                tiles.append(QPoint(x, y));
 
-            mTileObjects(x, y) = newObjects;
+        mPassNumTiles += (endX - startX) * (endY - startY);
+        chunkEnds.append(tiles.size());
+
+        if (removeHiddenWalls) {
+            for (int y = startY - 1; y <= endY; ++y) {
+                for (int x = startX - 1; x <= endX; ++x) {
+                    bool inChunk = x >= startX && x < endX && y >= startY && y < endY;
+
+                    if (!inChunk && isPointInBounds(x, y, mapSize))
+                        tiles.append(QPoint(x, y));
+                }
+            }
         }
+
+        ringEnds.append(tiles.size());
+    }
+
+    mPassMapSize = mapSize;
+    mPassReplacesAll = mRemakeAllPending;
+    mRemakeAllPending = false;
+
+    mPassCancelled.storeRelease(0);
+    mPassActive = true;
+    mPassTimer.start();
+
+    // The worker gets its own copy of the snapshot so that edits made while
+    // it runs do not affect it.
+    M2M::MapSnapshot snapshot = mMapSnapshot;
+
+    bool mergeTopFaces = mMergeTopFaces;
+
+    // Outdoor maps are mostly open, so occlusion culling would rarely pay off.
+    // Otherwise, only the chunks that are meshed again get new occluders, unless
+    // every chunk needs them. A chunk's occluders only depend on the tiles that
+    // its meshes depend on, so the other chunks' occluders stay valid.
+    mPassFindsOccluders = mTileMap->isIndoor();
+    mPassFindsAllOccluders = mPassFindsOccluders && (mAllOccludersPending || mPassReplacesAll);
+    mAllOccludersPending = false;
+
+    mPassOccluderChunks.clear();
+    if (mPassFindsAllOccluders) {
+        for (int y = 0; y < gridSize.height(); ++y)
+            for (int x = 0; x < gridSize.width(); ++x)
+                mPassOccluderChunks.append(QPoint(x, y));
+    } else if (mPassFindsOccluders) {
+        mPassOccluderChunks = mPassChunks;
     }
 
-    mTilesToUpdate.clear();
+    QVector<QRect> occluderRects;
+    occluderRects.reserve(mPassOccluderChunks.size());
+    for (const QPoint &chunk : mPassOccluderChunks)
+        occluderRects.append(chunkTiles(chunk, mapSize));
 
-    mScene->commitChanges();
+    mPassWatcher.setFuture(QtConcurrent::run([this, snapshot, tiles, chunkEnds, ringEnds, mergeTopFaces, removeHiddenWalls, occluderRects] () {
+        QElapsedTimer workerTimer;
+        workerTimer.start();
+
+        QVector<M2M::TileMesh> tileMeshes = mParallelMesher.makeMeshes(snapshot, tiles, &mPassCancelled);
+
+        // Taken from the same snapshot as the meshes, so that the occluders never
+        // hide objects behind walls that are not in the scene yet.
+        mPassOccluders.clear();
+        for (const QRect &rect : occluderRects)
+            mPassOccluders.append(snapshot.occluders(rect));
+
+        QVector<M2M::PartialMeshData> chunkMeshes(chunkEnds.size());
+        if (mPassCancelled.loadAcquire() != 0)
+            return chunkMeshes;
+
+        int tileIdx = 0;
+        for (int i = 0; i < chunkEnds.size(); ++i) {
+            M2M::TopFaceMerger merger(mergeTopFaces);
+            M2M::HiddenWallRemover walls(removeHiddenWalls);
+
+            for (; tileIdx < chunkEnds[i]; ++tileIdx) {
+                merger.addTile(tiles[tileIdx], tileMeshes[tileIdx]);
+                walls.addTile(tiles[tileIdx], tileMeshes[tileIdx].walls);
+            }
+
+            for (; tileIdx < ringEnds[i]; ++tileIdx)
+                walls.addNeighbor(tiles[tileIdx], tileMeshes[tileIdx].walls);
+
+            chunkMeshes[i] = merger.finish();
+            chunkMeshes[i] += walls.finish();
+        }
+
+        mPassWorkerNs = workerTimer.nsecsElapsed();
+
+        return chunkMeshes;
+    }));
 }
 
+
+void Map2Mesh::cancelSceneUpdate()
+{
+    if (mPassActive)
+        mPassCancelled.storeRelease(1);
+}
+
+
+void Map2Mesh::sceneUpdateFinished()
+{
+    // The result may have already been handled by finishSceneUpdate().
+    if (!mPassActive || !mPassWatcher.isFinished())
+        return;
+
+    mPassActive = false;
+
+    if (mPassCancelled.loadAcquire() != 0) {
+        // Redo the pass's work in the next pass.
+        for (const QPoint &chunk : mPassChunks)
+            mChunksToUpdate.insert(chunk);
+
+        mEditedTiles += mPassEditedTiles;
+        mRemakeAllPending = mRemakeAllPending || mPassReplacesAll;
+        mAllOccludersPending = mAllOccludersPending || (mPassFindsAllOccluders && mTileMap->isIndoor());
+    } else {
+        QVector<M2M::PartialMeshData> meshes = mPassWatcher.result();
+
+        QVector<SimpleTexturedScene::ObjectHandle> oldObjects;
+        QVector<QSharedPointer<SimpleTexturedObject>> newObjects;
+
+        // Where each chunk's objects start in newObjects.
+        QVector<int> chunkStarts;
+
+        if (mPassReplacesAll) {
+            for (const auto &chunkObjects : mChunkObjects)
+                oldObjects += chunkObjects;
+
+            mChunkObjects = ChunkObjectGrid(chunkGridSize(mPassMapSize));
+            mChunkOccluders = Array2D<QVector<BoundingBox>>(chunkGridSize(mPassMapSize));
+        }
+
+        for (int i = 0; i < mPassChunks.size(); ++i) {
+            QPoint chunk = mPassChunks[i];
+
+            if (!mPassReplacesAll)
+                oldObjects += mChunkObjects(chunk);
+
+            chunkStarts.append(newObjects.size());
+            newObjects += meshes[i].constructObjects();
+        }
+        chunkStarts.append(newObjects.size());
+
+        // The map may have become outdoor while the pass was running.
+        if (mPassFindsOccluders && mTileMap->isIndoor()) {
+            for (int i = 0; i < mPassOccluderChunks.size(); ++i)
+                mChunkOccluders(mPassOccluderChunks[i]) = mPassOccluders[i];
+
+            updateSceneOccluders();
+        }
+
+        QVector<SimpleTexturedScene::ObjectHandle> handles = mScene->replaceObjects(oldObjects, newObjects);
+
+        for (int i = 0; i < mPassChunks.size(); ++i)
+            mChunkObjects(mPassChunks[i]) = handles.mid(chunkStarts[i], chunkStarts[i + 1] - chunkStarts[i]);
+
+        mRemeshScheduler.passFinished(mPassQueuedTiles, mPassWorkerNs);
+
+        emit sceneMeshUpdated(mPassNumTiles);
+    }
+
+    mPassChunks.clear();
+
+    // Schedule the changes made while the pass was running.
+    scheduleSceneUpdate();
+}
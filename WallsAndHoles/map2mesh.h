@@ -4,7 +4,10 @@
 
 #include <QObject>
 #include <QSet>
-#include <QMutex>
+#include <QTimer>
+#include <QAtomicInt>
+#include <QFutureWatcher>
+#include <QElapsedTimer>
 
 #include "simpletexturedscene.h"
 #include "simpletexturedobject.h"
@@ -13,11 +16,20 @@
 
 #include "m2mpropertyclass.h"
 #include "m2mtilemesher.h"
+#include "m2mparallelmesher.h"
+#include "m2mmapsnapshot.h"
+#include "m2mremeshscheduler.h"
 
 #include "array2d.h"
 
 /**
  * @brief An object that keeps track of map-to-mesh conversion.
+ *
+ * Meshing happens on a background thread from a snapshot of the map, so edits
+ * never wait for the mesher. The scene keeps showing the previous meshes until
+ * a pass completes, at which point all of the pass's objects are swapped in at
+ * once. A pass that is still running when the map changes again is cancelled
+ * and its tiles are remeshed by the next pass.
  */
 class Map2Mesh : public QObject {
 
@@ -30,12 +42,94 @@ public:
      */
     Map2Mesh(TileMap *tileMap, QObject *parent = nullptr);
 
+    /**
+     * @brief Cancels any running meshing pass and waits for it to stop.
+     */
+    ~Map2Mesh();
+
 
     /**
      * @brief Returns the Scene that this Map2Mesh instance works with.
      */
     SharedSimpleTexturedScene getScene() const;
 
+
+    /**
+     * @brief Sets the number of threads used to mesh tiles. Defaults to
+     * QThread::idealThreadCount().
+     */
+    void setMeshingThreadCount(int threadCount);
+
+    int meshingThreadCount() const;
+
+    /**
+     * @brief Returns the hit and memory counters of the cache of tile neighborhood
+     * meshes. Safe to call while a pass is running.
+     */
+    M2M::MeshCache::Stats meshCacheStats() const;
+
+    /**
+     * @brief Sets whether tile meshes are looked up in the cache of tile neighborhood
+     * meshes. Enabled by default. Disabling it meshes every tile where it is, which is
+     * slower but gives the same scene.
+     */
+    void setMeshCacheEnabled(bool enabled);
+
+    bool isMeshCacheEnabled() const;
+
+
+    /**
+     * @brief Sets the size of the square chunks of tiles that share scene objects.
+     * Each chunk produces one object per texture, and an edit rebuilds only the
+     * chunks it affects. A size of 1 gives every tile its own objects.
+     * Defaults to DefaultChunkSize. Changing it remakes the whole scene.
+     */
+    void setChunkSize(int chunkSize);
+
+    int chunkSize() const;
+
+    static const int DefaultChunkSize = 16;
+
+
+    /**
+     * @brief Sets whether adjacent flat tile tops with the same height and material are
+     * merged into larger rectangles within each chunk. Enabled by default. Changing it
+     * remakes the whole scene.
+     */
+    void setMergeTopFaces(bool merge);
+
+    bool mergeTopFaces() const;
+
+
+    /**
+     * @brief Sets whether the parts of walls that are hidden by walls of neighboring
+     * tiles are removed, see M2M::HiddenWallRemover. Enabled by default. Changing it
+     * remakes the whole scene.
+     */
+    void setRemoveHiddenWalls(bool remove);
+
+    bool removeHiddenWalls() const;
+
+
+    /**
+     * @brief Returns the scheduler that decides when passes start, e.g. to read
+     * its last decision and statistics.
+     */
+    const M2M::RemeshScheduler &remeshScheduler() const;
+
+    /**
+     * @brief Returns the number of chunks waiting for a pass, not counting the
+     * chunks of the running pass.
+     */
+    int queuedChunkCount() const;
+
+
+    /**
+     * @brief Blocks until every pending change has been meshed and applied to the
+     * scene. Useful when there is no event loop, e.g. when exporting a map.
+     */
+    void finishSceneUpdate();
+
 public slots:
     /**
      * @brief Modifies the mesh near the tile that changed.
@@ -49,12 +143,65 @@ public slots:
      */
     void remakeAll();
 
+    /**
+     * @brief Removes the scene's occluders for an outdoor map, or has the next pass find
+     * the occluders of every chunk for an indoor map.
+     */
+    void indoorChanged(bool indoor);
+
+signals:
+    /**
+     * @brief Emitted after the scene has been updated.
+     * @param numTilesRemeshed  The number of tiles whose meshes were rebuilt.
+     */
+    void sceneMeshUpdated(int numTilesRemeshed);
+
 
 protected:
     /**
-     * @brief Updates the scene for all tiles that need updates.
+     * @brief Asks mRemeshScheduler when to mesh the queued chunks and starts the
+     * timer accordingly. Does nothing while a pass is running or already scheduled.
+     */
+    void scheduleSceneUpdate();
+
+    /**
+     * @brief Starts a background pass that meshes all chunks in mChunksToUpdate.
+     * Does nothing if a pass is already running; the pending tiles are picked
+     * up when it finishes.
+     */
+    void startSceneUpdate();
+
+    /**
+     * @brief Cancels the running pass, if any. Its chunks are queued again.
+     */
+    void cancelSceneUpdate();
+
+    /**
+     * @brief Called when the running pass finishes. Swaps the new meshes into
+     * the scene, or requeues the pass's chunks if it was cancelled.
+     */
+    void sceneUpdateFinished();
+
+    /**
+     * @brief Returns the number of chunks along each axis for a map of the given size.
+     */
+    QSize chunkGridSize(QSize mapSize) const;
+
+    /**
+     * @brief Returns the tiles of the chunk in a map of the given size.
+     */
+    QRect chunkTiles(QPoint chunk, QSize mapSize) const;
+
+    /**
+     * @brief Gives the scene the occluders of all chunks.
+     */
+    void updateSceneOccluders();
+
+    /**
+     * @brief Returns about how many tiles the next pass has to mesh that are not in
+     * the mesh cache: those near mEditedTiles, or all tiles if the whole scene is remade.
      */
-    void updateScene();
+    int estimateQueuedTiles() const;
 
 
     /**
@@ -69,31 +216,173 @@ protected:
     SharedSimpleTexturedScene mScene;
 
 
-    /// A grid containing lists of objects. A tile's "mesh" may consist of several
-    /// objects for texturing purposes.
-    using TileObjectGrid = Array2D<QVector<QSharedPointer<SimpleTexturedObject>>>;
+    /// A grid containing lists of scene objects. A chunk's "mesh" consists of one
+    /// object per texture.
+    using ChunkObjectGrid = Array2D<QVector<SimpleTexturedScene::ObjectHandle>>;
+
+
+    /**
+     * @brief The scene objects of every chunk. Chunk (i, j) holds the tiles with
+     * x / mChunkSize == i and y / mChunkSize == j.
+     */
+    ChunkObjectGrid mChunkObjects;
+
+    /**
+     * @brief The occluders of every chunk, which match the chunk's objects in mChunkObjects.
+     * Empty for outdoor maps.
+     */
+    Array2D<QVector<BoundingBox>> mChunkOccluders;
+
+    /**
+     * @brief The width and height of a chunk, in tiles.
+     */
+    int mChunkSize;
 
+    /**
+     * @brief Whether flat tops are merged, see setMergeTopFaces().
+     */
+    bool mMergeTopFaces;
 
     /**
-     * @brief Mesh data for every tile.
+     * @brief Whether hidden walls are removed, see setRemoveHiddenWalls().
      */
-    TileObjectGrid mTileObjects;
+    bool mRemoveHiddenWalls;
 
 
     /**
-     * @brief Whether an updateScene() call has been scheduled. Used in tileChanged().
+     * @brief A copy of the map's data that is safe to read from the meshing thread.
+     * Kept in sync with mTileMap through tileChanged() and remakeAll().
+     */
+    M2M::MapSnapshot mMapSnapshot;
+
+
+    /**
+     * @brief Meshes the tiles of a pass across several threads.
+     */
+    M2M::ParallelMesher mParallelMesher;
+
+
+    /**
+     * @brief Decides how long to wait before each pass.
+     */
+    M2M::RemeshScheduler mRemeshScheduler;
+
+    /**
+     * @brief Delays passes so that a burst of edits is meshed together.
      */
-    bool mSceneUpdateScheduled;
+    QTimer mSceneUpdateTimer;
 
     /**
-     * @brief Coordinates of tiles that need updating.
+     * @brief Coordinates of chunks that need updating. When a tile changes, every chunk
+     * containing a tile whose mesher reads it (see AbstractTileMesher::NeighborhoodRadius)
+     * is added here. When hidden walls are removed, a chunk also depends on the
+     * meshes of the tiles around it, so the radius is one larger.
      */
-    QSet<QPoint> mTilesToUpdate;
+    QSet<QPoint> mChunksToUpdate;
 
     /**
-     * @brief Mutex for scene-update related operations.
+     * @brief The tiles that changed since the last pass started. Only used to
+     * estimate the cost of the next pass, since most tiles of a chunk whose
+     * neighborhoods did not change come from the mesh cache.
      */
-    QMutex mSceneUpdateMutex;
+    QSet<QPoint> mEditedTiles;
+
+    /**
+     * @brief Whether the next pass has to replace every object in the scene,
+     * e.g. after the map was resized.
+     */
+    bool mRemakeAllPending;
+
+    /**
+     * @brief Whether the next pass has to find the occluders of every chunk, not just of
+     * the chunks that it meshes, e.g. after the map became indoor.
+     */
+    bool mAllOccludersPending;
+
+
+    /* BEGIN running pass */
+
+    /**
+     * @brief Watches the running pass. The result is parallel to mPassChunks.
+     */
+    QFutureWatcher<QVector<M2M::PartialMeshData>> mPassWatcher;
+
+    /**
+     * @brief Set to nonzero to ask the running pass to stop early.
+     */
+    QAtomicInt mPassCancelled;
+
+    /**
+     * @brief Whether a pass was started and its result has not been handled yet.
+     */
+    bool mPassActive;
+
+    /**
+     * @brief Measures the running pass, from starting it to applying its result.
+     */
+    QElapsedTimer mPassTimer;
+
+    /**
+     * @brief The time that the running pass's worker took, written by the worker itself.
+     * Unlike mPassTimer, this leaves out the time until the result is handled.
+     */
+    qint64 mPassWorkerNs;
+
+    /**
+     * @brief The tiles edited before the running pass, requeued if it is cancelled.
+     */
+    QSet<QPoint> mPassEditedTiles;
+
+    /**
+     * @brief estimateQueuedTiles() when the running pass started, which is what the
+     * mRemeshScheduler learns its time per tile from.
+     */
+    int mPassQueuedTiles;
+
+    /**
+     * @brief The chunks being meshed by the running pass, sorted by (y, x).
+     */
+    QVector<QPoint> mPassChunks;
+
+    /**
+     * @brief The number of tiles in mPassChunks, not counting the tiles around
+     * the chunks that are only meshed to find hidden walls.
+     */
+    int mPassNumTiles;
+
+    /**
+     * @brief The map size that the running pass was started with.
+     */
+    QSize mPassMapSize;
+
+    /**
+     * @brief Whether the running pass replaces every object in the scene.
+     */
+    bool mPassReplacesAll;
+
+    /**
+     * @brief Whether the running pass finds occluders, which it does for indoor maps.
+     */
+    bool mPassFindsOccluders;
+
+    /**
+     * @brief Whether the running pass finds the occluders of every chunk.
+     */
+    bool mPassFindsAllOccluders;
+
+    /**
+     * @brief The chunks whose occluders the running pass finds: mPassChunks, or every
+     * chunk if mPassFindsAllOccluders.
+     */
+    QVector<QPoint> mPassOccluderChunks;
+
+    /**
+     * @brief The occluders of mPassOccluderChunks, found by the pass itself from the
+     * same snapshot as its meshes. Only read once the pass has finished.
+     */
+    QVector<QVector<BoundingBox>> mPassOccluders;
+
+    /* END running pass */
 
 
 public:
@@ -14,6 +14,8 @@ void MapPropertyManager::propertyEdited(QString name, QVariant value)
         QSize size = mTileMap->mapSize();
         size.setHeight(value.toInt());
         mTileMap->resizeMap(size);
+    } else if (name == "Is Indoors") {
+        mTileMap->setIndoor(value.toBool());
     }
 }
 
@@ -23,7 +25,7 @@ QVector<QVector<QVariant> > MapPropertyManager::properties()
     return {
         {"Width",       mTileMap->mapSize().width(),  true, 1, 1000},
         {"Height",      mTileMap->mapSize().height(), true, 1, 1000},
-        {"Is Indoors",  mTileMap->isIndoor(),         false},
+        {"Is Indoors",  mTileMap->isIndoor(),         true},
         {"Has Ceiling", mTileMap->hasCeiling(),       false}
     };
 }
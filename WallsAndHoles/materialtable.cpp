@@ -0,0 +1,98 @@
+#include "materialtable.h"
+
+#include <QDebug>
+
+#include "tilematerial.h"
+
+
+MaterialTable::MaterialTable()
+    : mFullWarned(false)
+    , mVersion(0)
+{
+    mEntries.append({1, 1, 1, 1});
+}
+
+MaterialTable &MaterialTable::global()
+{
+    static MaterialTable table;
+    return table;
+}
+
+
+quint16 MaterialTable::indexOf(const TileMaterial *material)
+{
+    QMutexLocker locker(&mMutex);
+
+    auto itr = mIndices.constFind(material);
+    if (itr != mIndices.constEnd())
+        return *itr;
+
+    quint16 index;
+    if (!mFreeIndices.isEmpty()) {
+        index = mFreeIndices.dequeue();
+        mEntries[index] = entryFor(material);
+    } else if (mEntries.size() < MaxEntries) {
+        index = mEntries.size();
+        mEntries.append(entryFor(material));
+    } else {
+        // Indices are stored in 16 bits, so there is no room for another entry.
+        if (!mFullWarned) {
+            qWarning() << "MaterialTable is full:" << MaxEntries
+                       << "materials are alive; further materials use the default parameters.";
+            mFullWarned = true;
+        }
+        return 0;
+    }
+
+    mIndices.insert(material, index);
+    ++mVersion;
+
+    locker.unlock();
+
+    connect(material, &TileMaterial::phongParamsChanged, this, [this, material, index] () {
+        QMutexLocker locker(&mMutex);
+        mEntries[index] = entryFor(material);
+        ++mVersion;
+        locker.unlock();
+
+        emit entryChanged(index);
+    });
+
+    // A new material may later be created at the same address. Materials can be
+    // deleted on threads without an event loop (e.g. by wahconvert's workers), so
+    // this must not be queued; it only touches state behind the mutex.
+    connect(material, &QObject::destroyed, this, [this, material] () {
+        QMutexLocker locker(&mMutex);
+        mFreeIndices.enqueue(mIndices.take(material));
+    }, Qt::DirectConnection);
+
+    return index;
+}
+
+MaterialTable::Entry MaterialTable::entry(int index) const
+{
+    QMutexLocker locker(&mMutex);
+    return mEntries[index];
+}
+
+QVector<MaterialTable::Entry> MaterialTable::entries(int *version) const
+{
+    QMutexLocker locker(&mMutex);
+
+    if (version)
+        *version = mVersion;
+
+    return mEntries;
+}
+
+int MaterialTable::version() const
+{
+    QMutexLocker locker(&mMutex);
+    return mVersion;
+}
+
+
+MaterialTable::Entry MaterialTable::entryFor(const TileMaterial *material)
+{
+    return {material->ambient(), material->diffuse(), material->specular(), material->shininess()};
+}
@@ -0,0 +1,90 @@
+#ifndef MATERIALTABLE_H
+#define MATERIALTABLE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QQueue>
+#include <QVector>
+
+class TileMaterial;
+
+/**
+ * @brief The Phong parameters of all materials that meshes refer to.
+ *
+ * Vertices only store the index of their material's entry, and the renderer reads
+ * the parameters from this table. Editing a TileMaterial's Phong parameters
+ * therefore only changes one entry, and no mesh has to be remade.
+ *
+ * The entry of a deleted material is reused for a later material, the longest
+ * freed one first. Meshes that still refer to it show the new material's
+ * parameters until their tiles are meshed again. Entry 0 is a default material
+ * with all parameters equal to 1.
+ *
+ * The table can be read from any thread.
+ */
+class MaterialTable : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Entry {
+        float ambient;
+        float diffuse;
+        float specular;
+        float shininess;
+    };
+
+    /// The largest number of entries, since indices are stored in 16 bits.
+    static const int MaxEntries = 65536;
+
+    /// The table that all meshes use.
+    static MaterialTable &global();
+
+    /**
+     * @brief Returns the index of the material's entry, adding an entry if there is none
+     * yet. The entry follows the material's phongParamsChanged() signal until the
+     * material is deleted.
+     *
+     * If all MaxEntries entries are in use, a warning is printed and the default
+     * entry 0 is returned.
+     */
+    quint16 indexOf(const TileMaterial *material);
+
+    Entry entry(int index) const;
+
+    /**
+     * @brief Returns a copy of all entries.
+     * @param version   If not null, set to the version of the returned entries.
+     */
+    QVector<Entry> entries(int *version = nullptr) const;
+
+    /// Returns a number that changes whenever an entry is added or changed.
+    int version() const;
+
+signals:
+    /// Emitted when the parameters of an existing entry change.
+    void entryChanged(int index);
+
+private:
+    MaterialTable();
+
+    static Entry entryFor(const TileMaterial *material);
+
+    mutable QMutex mMutex;
+
+    QVector<Entry> mEntries;
+    QHash<const TileMaterial *, quint16> mIndices;
+
+    /// The entries of deleted materials, in the order they were freed.
+    QQueue<quint16> mFreeIndices;
+
+    /// Whether the warning about a full table was printed.
+    bool mFullWarned;
+
+    int mVersion;
+};
+
+Q_DECLARE_TYPEINFO(MaterialTable::Entry, Q_PRIMITIVE_TYPE);
+
+#endif // MATERIALTABLE_H
@@ -1,5 +1,6 @@
 #include <QTimer>
 #include <QMutexLocker>
+#include <QPainter>
 
 
 #include "meshview.h"
@@ -169,6 +170,13 @@ void MeshView::paintGL()
         QMatrix4x4 transform = mCamera->getTransformationMatrix();
         QMatrix4x4 mvp = mProjectionMatrix * transform;
         renderer->paint(mvp, mCamera->getPosition());
+
+        QString overlay = renderer->overlayText();
+        if (!overlay.isEmpty()) {
+            QPainter painter(this);
+            painter.setPen(Qt::white);
+            painter.drawText(rect().adjusted(8, 8, -8, -8), Qt::AlignLeft | Qt::AlignTop, overlay);
+        }
     }
 }
 
@@ -2,7 +2,6 @@
 #include "triplet.h"
 
 using Triangle = Triplet<unsigned int, unsigned int, unsigned int>;
-using TriangleTexCoords = Triplet<QVector2D, QVector2D, QVector2D>;
 
 QString vec3D2Str(QVector3D vec)
 {
@@ -31,14 +30,22 @@ void OBJModel::addSimpleTextured(SharedSimpleTexturedObject obj)
 {
     mObjects.append(obj);
 
-    QString materialName = obj->getMaterialName();
-    if(!mMaterials.contains(materialName)){
+    // An object holds every material that shares its texture, e.g. all tiles of a chunk.
+    QSet<quint16> objectMaterials;
+    for(quint16 material: obj->getVertexMaterials())
+        objectMaterials.insert(material);
+
+    for(quint16 material: objectMaterials){
+        QString materialName = obj->getMaterialName(material);
+        if(mMaterials.contains(materialName))
+            continue;
+
         QString name = materialName;
 
-        QVector3D Ka(obj->getAmbient(),obj->getAmbient(), obj->getAmbient());
-        QVector3D Kd(obj->getDiffuse(),obj->getDiffuse(),obj->getDiffuse());
-        QVector3D Ks(obj->getSpecular(),obj->getSpecular(),obj->getSpecular());
-        int Ns=obj->getShininess();
+        QVector3D Ka(obj->getAmbient(material),obj->getAmbient(material), obj->getAmbient(material));
+        QVector3D Kd(obj->getDiffuse(material),obj->getDiffuse(material),obj->getDiffuse(material));
+        QVector3D Ks(obj->getSpecular(material),obj->getSpecular(material),obj->getSpecular(material));
+        int Ns=obj->getShininess(material);
         int illum=2;
 
         QString imagePath = obj->getImageAndSource()->source();
@@ -64,15 +71,17 @@ void OBJModel::saveOBJ(QString path)
         return;
 
     QVector<QVector3D> vertices;
-    QVector<QVector3D> faceNormals;
+    QVector<QVector3D> vertexNormals;
+    QVector<QVector2D> vertexTexCoords;
     QVector<QVector<Triangle>> meshs;
-    QVector<TriangleTexCoords> faceTexCoords;
 
+    // Every vertex has exactly one position, texture coordinate and normal, so
+    // all three are written with the same (1-based) index.
     int numVertices=1;
-    //int numTriangles=0;
     for(auto object: mObjects){
         vertices += object->getVertices();
-        faceNormals += object->getFaceNormals();
+        vertexNormals += object->getVertexNormals();
+        vertexTexCoords += object->getVertexTexCoords();
         QVector<Triangle> mesh;
         for(auto triangle: object->getTriangles()){
             Triangle newTriangle(
@@ -82,7 +91,6 @@ void OBJModel::saveOBJ(QString path)
             mesh.append(newTriangle);
         }
         meshs.append(mesh);
-        faceTexCoords += object->getFaceTexCoords();
         numVertices += object->getNumVertices();
     }
 
@@ -99,57 +107,55 @@ void OBJModel::saveOBJ(QString path)
     }
 
     // Write the list of texture coordinates.
-    // Note: For vertex j of triangle i, its texture coordinates are at (0-based) index
-    //              3*i + j
-    for (auto const &texCoords : faceTexCoords) {
-
-        // texCoords is a Triplet of QVector2D
-        QVector2D uvs[3] = {texCoords.getFirst(), texCoords.getSecond(), texCoords.getThird()};
-
-        for (int i = 0; i < 3; ++i) {
-            const auto &uv = uvs[i];
-
-            out << "vt";
-            for (int i = 0; i < 2; i++)
-                out << " " << uv[i];
-            out << endl;
-        }
+    for (auto const &uv : vertexTexCoords) {
+        out << "vt";
+        for (int i = 0; i < 2; i++)
+            out << " " << uv[i];
+        out << endl;
     }
 
-    // Write the list of face normals.
-    for (auto const &faceNorm : faceNormals) {
+    // Write the list of vertex normals.
+    for (auto const &normal : vertexNormals) {
         out << "vn";
         for (int i = 0; i < 3; i++)
-            out << " " << faceNorm[i];
+            out << " " << normal[i];
         out << endl;
     }
 
-    // Write the list of faces.
+    // Write the list of faces. The material of a triangle is that of its vertices,
+    // and may change within an object.
     QString oldMaterial = "";
-    int faceIdStart = 1;
     for(int i=0; i<mObjects.length(); i++){
-        QVector<Triangle> triangles = meshs[i];
-        QString newMaterial = mObjects[i]->getMaterialName();
-        if(newMaterial!=oldMaterial){
-            out << "usemtl " << mObjects[i]->getMaterialName() << endl;
-            oldMaterial = newMaterial;
-        }
-        for (int faceIdx = faceIdStart; faceIdx < faceIdStart+triangles.size(); ++faceIdx) {
-            const auto &face = triangles[faceIdx-faceIdStart];
+        const QVector<Triangle> &triangles = meshs[i];
+        const QVector<Triangle> &objectTriangles = mObjects[i]->getTriangles();
+        const QVector<quint16> &vertexMaterials = mObjects[i]->getVertexMaterials();
+
+        QHash<quint16, QString> materialNames;
+
+        for (int t = 0; t < triangles.size(); ++t) {
+            const Triangle &face = triangles[t];
+
+            quint16 material = vertexMaterials[objectTriangles[t].getFirst()];
+            auto itr = materialNames.find(material);
+            if (itr == materialNames.end())
+                itr = materialNames.insert(material, mObjects[i]->getMaterialName(material));
+
+            if(*itr!=oldMaterial){
+                out << "usemtl " << *itr << endl;
+                oldMaterial = *itr;
+            }
 
             out << "f";
 
             unsigned int vertexIndices[3] = {face.getFirst(), face.getSecond(), face.getThird()};
 
             for (int idx = 0; idx < 3; ++idx) {
-                out << " " << vertexIndices[idx];
-                out << "/" << (faceIdx-1)*3 + idx+1;      // texture coordinate; see tex coord output above
-                out << "/" << faceIdx;              // one normal per face
+                unsigned int vIdx = vertexIndices[idx];
+                out << " " << vIdx << "/" << vIdx << "/" << vIdx;
             }
 
             out << endl;
         }
-        faceIdStart+=triangles.size();
     }
     objFile.close();
 }
@@ -4,6 +4,8 @@
 #include <QTextStream>
 #include <cassert>
 #include <QMap>
+#include <QHash>
+#include <QSet>
 #include <QVector3D>
 #include <QDebug>
 
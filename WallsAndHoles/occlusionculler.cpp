@@ -0,0 +1,222 @@
+#include "occlusionculler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <QPair>
+
+OcclusionCuller::OcclusionCuller()
+    : mDepth(Width * Height, std::numeric_limits<float>::max())
+    , mHasOccluders(false)
+{
+}
+
+void OcclusionCuller::setOccluders(const QVector<BoundingBox> &occluders)
+{
+    mOccluders = occluders;
+}
+
+int OcclusionCuller::render(const QMatrix4x4 &mvp, QVector3D camPos)
+{
+    mMvp = mvp;
+    std::fill(mDepth.begin(), mDepth.end(), std::numeric_limits<float>::max());
+    mHasOccluders = false;
+
+    ViewFrustum frustum(mvp);
+
+    // Rank the visible occluders by their approximate size on screen.
+    QVector<QPair<float, int>> ranked;
+    for (int i = 0; i < mOccluders.size(); ++i) {
+        const BoundingBox &box = mOccluders[i];
+        if (!frustum.intersects(box))
+            continue;
+
+        float size = (box.max - box.min).lengthSquared();
+        float distance = box.distanceTo(camPos);
+        ranked.append(qMakePair(-size / (distance * distance + 1e-6f), i));
+    }
+
+    int numDrawn = qMin(ranked.size(), int(MaxOccluders));
+    std::partial_sort(ranked.begin(), ranked.begin() + numDrawn, ranked.end());
+
+    // The faces of a box, as indices into the corners from project().
+    static const int faces[6][4] = {
+        {0, 1, 3, 2}, {4, 6, 7, 5},
+        {0, 4, 5, 1}, {2, 3, 7, 6},
+        {0, 2, 6, 4}, {1, 5, 7, 3}
+    };
+
+    int numRendered = 0;
+    for (int i = 0; i < numDrawn; ++i) {
+        QVector3D corners[8];
+        if (!project(mOccluders[ranked[i].second], corners))
+            continue;
+
+        // The back faces are behind the front faces, so they change nothing, but
+        // telling them apart would cost about as much as drawing them.
+        for (const auto &face : faces)
+            drawQuad(corners[face[0]], corners[face[1]], corners[face[2]], corners[face[3]]);
+
+        numRendered += 1;
+    }
+
+    mHasOccluders = numRendered > 0;
+    return numRendered;
+}
+
+bool OcclusionCuller::isOccluded(const BoundingBox &box) const
+{
+    if (!mHasOccluders || box.isEmpty())
+        return false;
+
+    QVector3D corners[8];
+    if (!project(box, corners))
+        return false;
+
+    float minX = corners[0].x(), maxX = corners[0].x();
+    float minY = corners[0].y(), maxY = corners[0].y();
+    float nearest = corners[0].z();
+    for (const QVector3D &c : corners) {
+        minX = qMin(minX, c.x());
+        maxX = qMax(maxX, c.x());
+        minY = qMin(minY, c.y());
+        maxY = qMax(maxY, c.y());
+        nearest = qMin(nearest, c.z());
+    }
+
+    // Every pixel that the box touches must be covered.
+    int x0 = qMax(0, int(std::floor(minX)));
+    int x1 = qMin(Width - 1, int(std::ceil(maxX)) - 1);
+    int y0 = qMax(0, int(std::floor(minY)));
+    int y1 = qMin(Height - 1, int(std::ceil(maxY)) - 1);
+
+    // Boxes outside the viewport are left to frustum culling.
+    if (x0 > x1 || y0 > y1)
+        return false;
+
+    for (int y = y0; y <= y1; ++y) {
+        const float *row = mDepth.constData() + y * Width;
+
+        // Counting instead of exiting early keeps the loop free of branches, so that
+        // the compiler can vectorize it.
+        int uncovered = 0;
+        for (int x = x0; x <= x1; ++x)
+            uncovered += row[x] >= nearest;
+
+        if (uncovered > 0)
+            return false;
+    }
+
+    return true;
+}
+
+bool OcclusionCuller::project(const BoundingBox &box, QVector3D corners[8]) const
+{
+    for (int i = 0; i < 8; ++i) {
+        QVector4D p = mMvp * QVector4D(i & 1 ? box.max.x() : box.min.x(),
+                                       i & 2 ? box.max.y() : box.min.y(),
+                                       i & 4 ? box.max.z() : box.min.z(),
+                                       1);
+
+        // Points between the camera and the near plane are clipped when rendering,
+        // so nothing can be said about what they hide or whether they are hidden.
+        if (p.w() <= 0 || p.z() < -p.w())
+            return false;
+
+        corners[i] = QVector3D((p.x() / p.w() + 1) / 2 * Width,
+                               (p.y() / p.w() + 1) / 2 * Height,
+                               p.z() / p.w());
+    }
+
+    return true;
+}
+
+void OcclusionCuller::drawQuad(const QVector3D &a, const QVector3D &b, const QVector3D &c, const QVector3D &d)
+{
+    const QVector3D v[4] = {a, b, c, d};
+
+    float area = 0;
+    for (int i = 0; i < 4; ++i) {
+        const QVector3D &p = v[i];
+        const QVector3D &q = v[(i + 1) % 4];
+        area += p.x() * q.y() - q.x() * p.y();
+    }
+
+    // Edge-on faces cover nothing.
+    if (qAbs(area) < 1e-6f)
+        return;
+
+    float orientation = area > 0 ? 1 : -1;
+
+    // Edge i is ex[i] * x + ey[i] * y + e0[i], which is positive inside the quad. A
+    // pixel is covered if the edge is at least threshold[i] at its center, since
+    // then it is positive at all of the pixel's corners.
+    float ex[4], ey[4], e0[4], threshold[4];
+    for (int i = 0; i < 4; ++i) {
+        const QVector3D &p = v[i];
+        const QVector3D &q = v[(i + 1) % 4];
+
+        ex[i] = -(q.y() - p.y()) * orientation;
+        ey[i] = (q.x() - p.x()) * orientation;
+        e0[i] = -(ex[i] * p.x() + ey[i] * p.y());
+        threshold[i] = (qAbs(ex[i]) + qAbs(ey[i])) / 2;
+    }
+
+    // The depth is zx * x + zy * y + z0 across the quad, which is planar. Pick the
+    // triangle of three corners with the largest area to compute the plane from.
+    const QVector3D *p0 = &v[0], *p1 = &v[1], *p2 = &v[2];
+    float det = (v[1].x() - v[0].x()) * (v[2].y() - v[0].y()) - (v[2].x() - v[0].x()) * (v[1].y() - v[0].y());
+    float otherDet = (v[2].x() - v[0].x()) * (v[3].y() - v[0].y()) - (v[3].x() - v[0].x()) * (v[2].y() - v[0].y());
+    if (qAbs(otherDet) > qAbs(det)) {
+        p1 = &v[2];
+        p2 = &v[3];
+        det = otherDet;
+    }
+
+    if (qAbs(det) < 1e-6f)
+        return;
+
+    float zx = ((p1->z() - p0->z()) * (p2->y() - p0->y()) - (p2->z() - p0->z()) * (p1->y() - p0->y())) / det;
+    float zy = ((p1->x() - p0->x()) * (p2->z() - p0->z()) - (p2->x() - p0->x()) * (p1->z() - p0->z())) / det;
+    float z0 = p0->z() - zx * p0->x() - zy * p0->y();
+
+    // The farthest depth within a pixel is this much more than at its center.
+    float zSlack = (qAbs(zx) + qAbs(zy)) / 2;
+
+    float minX = qMin(qMin(a.x(), b.x()), qMin(c.x(), d.x()));
+    float maxX = qMax(qMax(a.x(), b.x()), qMax(c.x(), d.x()));
+    float minY = qMin(qMin(a.y(), b.y()), qMin(c.y(), d.y()));
+    float maxY = qMax(qMax(a.y(), b.y()), qMax(c.y(), d.y()));
+
+    int x0 = qMax(0, int(std::floor(minX)));
+    int x1 = qMin(Width - 1, int(std::ceil(maxX)) - 1);
+    int y0 = qMax(0, int(std::floor(minY)));
+    int y1 = qMin(Height - 1, int(std::ceil(maxY)) - 1);
+
+    for (int y = y0; y <= y1; ++y) {
+        float cy = y + 0.5f;
+
+        float r0 = ey[0] * cy + e0[0];
+        float r1 = ey[1] * cy + e0[1];
+        float r2 = ey[2] * cy + e0[2];
+        float r3 = ey[3] * cy + e0[3];
+        float rz = zy * cy + z0 + zSlack;
+
+        float *row = mDepth.data() + y * Width;
+
+        // Bitwise operators and a select keep the loop free of branches, so that
+        // the compiler can vectorize it.
+        for (int x = x0; x <= x1; ++x) {
+            float cx = x + 0.5f;
+
+            bool covered = (ex[0] * cx + r0 >= threshold[0])
+                    & (ex[1] * cx + r1 >= threshold[1])
+                    & (ex[2] * cx + r2 >= threshold[2])
+                    & (ex[3] * cx + r3 >= threshold[3]);
+
+            float z = zx * cx + rz;
+            row[x] = covered & (z < row[x]) ? z : row[x];
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef OCCLUSIONCULLER_H
+#define OCCLUSIONCULLER_H
+
+#include <QMatrix4x4>
+#include <QVector>
+#include <QVector3D>
+
+#include "viewfrustum.h"
+
+/**
+ * @brief Finds boxes that are hidden behind occluder boxes, on the CPU.
+ *
+ * Each frame, render() draws the faces of the nearest and largest occluders into a
+ * small depth buffer, and isOccluded() compares boxes against it. Both are
+ * conservative: an occluder only covers the pixels that it covers completely,
+ * with the farthest depth it has in them, and a box is only occluded if every
+ * pixel that it touches is covered by something nearer than its nearest point.
+ *
+ * Occluders must be inside opaque geometry; they usually come from
+ * M2M::MapSnapshot::occluders().
+ */
+class OcclusionCuller
+{
+public:
+    /// The size of the depth buffer, which spans the whole viewport.
+    static const int Width = 128;
+    static const int Height = 64;
+
+    /// The most occluders that render() draws.
+    static const int MaxOccluders = 256;
+
+
+    OcclusionCuller();
+
+    void setOccluders(const QVector<BoundingBox> &occluders);
+
+    const QVector<BoundingBox> &occluders() const { return mOccluders; }
+
+    /**
+     * @brief Draws the occluders that are likely to hide the most into the depth buffer.
+     * @return The number of occluders that were drawn.
+     */
+    int render(const QMatrix4x4 &mvp, QVector3D camPos);
+
+    /// Returns true if the box is certainly hidden by the occluders drawn by render().
+    bool isOccluded(const BoundingBox &box) const;
+
+private:
+    /// Projects the corners of a box to the depth buffer's pixels, with NDC depth.
+    /// Returns false if a corner is in front of the near plane.
+    bool project(const BoundingBox &box, QVector3D corners[8]) const;
+
+    /// Draws a convex quad with corners in the depth buffer's pixels.
+    void drawQuad(const QVector3D &a, const QVector3D &b, const QVector3D &c, const QVector3D &d);
+
+
+    QVector<BoundingBox> mOccluders;
+
+    QMatrix4x4 mMvp;
+
+    /// Row-major, the nearest depth of each pixel.
+    QVector<float> mDepth;
+
+    /// Whether render() drew anything.
+    bool mHasOccluders;
+};
+
+#endif // OCCLUSIONCULLER_H
@@ -0,0 +1,128 @@
+#include "packedmesh.h"
+
+#include <QCryptographicHash>
+
+#include "simpletexturedobject.h"
+
+namespace {
+
+float signNotZero(float v)
+{
+    return v < 0 ? -1 : 1;
+}
+
+GLbyte toSignedNormalized(float v)
+{
+    return GLbyte(qRound(qBound(-1.0f, v, 1.0f) * 127));
+}
+
+template< typename Index >
+void packIndices(const QVector<SimpleTexturedObject::Triangle> &triangles, QByteArray &indices)
+{
+    indices.resize(3 * triangles.size() * sizeof(Index));
+
+    Index *out = reinterpret_cast<Index *>(indices.data());
+    for (const SimpleTexturedObject::Triangle &t : triangles) {
+        *out++ = Index(t.getFirst());
+        *out++ = Index(t.getSecond());
+        *out++ = Index(t.getThird());
+    }
+}
+
+/// Returns the vertex with its position relative to origin.
+PackedVertex relativeTo(PackedVertex v, const GLfloat *origin)
+{
+    for (int i = 0; i < 3; ++i)
+        v.position[i] -= origin[i];
+
+    return v;
+}
+
+}
+
+
+void PackedVertex::setNormal(QVector3D n)
+{
+    // Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half
+    // over the upper one. The shader undoes this in decodeNormal().
+    float l1 = qAbs(n.x()) + qAbs(n.y()) + qAbs(n.z());
+    if (l1 == 0) {
+        normal[0] = normal[1] = 0;
+        return;
+    }
+
+    float x = n.x() / l1;
+    float y = n.y() / l1;
+
+    if (n.z() < 0) {
+        float foldedX = (1 - qAbs(y)) * signNotZero(x);
+        float foldedY = (1 - qAbs(x)) * signNotZero(y);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    normal[0] = toSignedNormalized(x);
+    normal[1] = toSignedNormalized(y);
+}
+
+
+PackedMesh PackedMesh::pack(const SimpleTexturedObject &obj)
+{
+    const auto &positions = obj.getVertices();
+    const auto &normals = obj.getVertexNormals();
+    const auto &texCoords = obj.getVertexTexCoords();
+    const auto &materials = obj.getVertexMaterials();
+    const auto &triangles = obj.getTriangles();
+
+    PackedMesh mesh;
+    mesh.bounds = BoundingBox::empty();
+
+    int numVertices = obj.getNumVertices();
+    mesh.vertices.resize(numVertices);
+
+    // The vertex count separates the vertices from the indices, and also fixes the
+    // index type. PackedVertex has no padding, so its bytes can be hashed directly.
+    QCryptographicHash digest(QCryptographicHash::Sha1);
+    digest.addData(reinterpret_cast<const char *>(&numVertices), sizeof(numVertices));
+
+    PackedVertex *first = mesh.vertices.data();
+    PackedVertex *out = first;
+    for (int i = 0; i < numVertices; ++i, ++out) {
+        out->position[0] = positions[i].x();
+        out->position[1] = positions[i].y();
+        out->position[2] = positions[i].z();
+        out->texCoord[0] = texCoords[i].x();
+        out->texCoord[1] = texCoords[i].y();
+        out->setNormal(normals[i]);
+        out->material = materials[i];
+
+        mesh.bounds.addPoint(positions[i]);
+
+        PackedVertex relative = relativeTo(*out, first->position);
+        digest.addData(reinterpret_cast<const char *>(&relative), sizeof(PackedVertex));
+    }
+
+    if (numVertices <= 65536) {
+        mesh.indexType = GL_UNSIGNED_SHORT;
+        packIndices<GLushort>(triangles, mesh.indices);
+    } else {
+        mesh.indexType = GL_UNSIGNED_INT;
+        packIndices<GLuint>(triangles, mesh.indices);
+    }
+
+    mesh.numIndices = 3 * triangles.size();
+
+    digest.addData(mesh.indices);
+    mesh.shapeDigest = digest.result();
+
+    return mesh;
+}
+
+QVector3D PackedMesh::origin() const
+{
+    if (vertices.isEmpty())
+        return QVector3D();
+
+    const GLfloat *p = vertices.first().position;
+    return QVector3D(p[0], p[1], p[2]);
+}
@@ -0,0 +1,74 @@
+#ifndef PACKEDMESH_H
+#define PACKEDMESH_H
+
+#include <QByteArray>
+#include <QVector>
+#include <QVector3D>
+
+#include <qopengl.h>
+
+#include "viewfrustum.h"
+
+class SimpleTexturedObject;
+
+/**
+ * @brief The vertex format that SimpleTexturedRenderer uploads: all attributes of a
+ * vertex, interleaved and packed into 24 bytes.
+ *
+ * Texture coordinates stay 32-bit floats, since horizontal faces are textured with
+ * world coordinates, which quickly become too large for half floats.
+ */
+struct PackedVertex {
+    GLfloat position[3];
+    GLfloat texCoord[2];
+
+    /// The normal in octahedral encoding, as normalized signed bytes.
+    GLbyte normal[2];
+
+    /// The index of the vertex's material in the MaterialTable.
+    GLushort material;
+
+    void setNormal(QVector3D n);
+};
+
+Q_STATIC_ASSERT(sizeof(PackedVertex) == 24);
+Q_DECLARE_TYPEINFO(PackedVertex, Q_PRIMITIVE_TYPE);
+
+
+/**
+ * @brief The vertex and index data of a SimpleTexturedObject, ready to be uploaded
+ * into one vertex buffer and one index buffer.
+ */
+struct PackedMesh {
+    QVector<PackedVertex> vertices;
+
+    /// The triangles' vertex indices, as GLushorts if there are few enough vertices.
+    QByteArray indices;
+    GLenum indexType;
+    int numIndices;
+
+    /// The box around all vertex positions.
+    BoundingBox bounds;
+
+    /**
+     * @brief A SHA-1 digest of the mesh relative to its origin(), so meshes that only
+     * differ by a translation have the same digest. The other attributes, including the
+     * texture coordinates, are part of the digest.
+     */
+    QByteArray shapeDigest;
+
+    /**
+     * @brief Packs the committed object in a single pass over its vertices and
+     * triangles, which also computes the bounds and the shapeDigest.
+     */
+    static PackedMesh pack(const SimpleTexturedObject &obj);
+
+
+    /// The position of the first vertex, or the zero vector if there are no vertices.
+    QVector3D origin() const;
+
+    /// Returns true if the meshes are the same up to a translation.
+    bool hasSameShape(const PackedMesh &other) const { return shapeDigest == other.shapeDigest; }
+};
+
+#endif // PACKEDMESH_H
@@ -1,14 +1,15 @@
 #include "polygon.h"
 
 #include "geometry.h"
+#include "polygonclipper.h"
+#include "segmentintersection.h"
+#include "triangulator.h"
 
-#include <QSet>
 #include <QDebug>
+#include <QVarLengthArray>
 
-uint qHash(const QPointF &key)
-{
-    return qHash(QPair<float, float>(key.x(), key.y()));
-}
+#include <algorithm>
+#include <limits>
 
 BetterPolygon::BetterPolygon(const QVector<QPointF> &points)
 {
@@ -28,34 +29,24 @@ bool BetterPolygon::isValid() const
 {
     if (mPolygon.size() < 3) return false;
 
-    QSet<QPointF> points;
-
     //Check to see if any points are the same
-    for (QPointF p : mPolygon) {
-        if (points.contains(p))
-            return false;
-        points.insert(p);
-    }
-
-    //Check to see if any edges cross
-    for (int i = 0; i < mPolygon.size(); ++i) {
-        int j = (i + 1) % mPolygon.size();
-
-        QLineF lineA(mPolygon[i], mPolygon[j]);
+    QVector<QPointF> sorted = mPolygon;
+    std::sort(sorted.begin(), sorted.end(), [] (const QPointF &a, const QPointF &b) {
+        return a.x() < b.x() || (a.x() == b.x() && a.y() < b.y());
+    });
 
-        for (int a = 0; a < mPolygon.size(); ++a) {
-            int b = (a + 1) % mPolygon.size();
-
-            if (i == a || i == b || j == a || j == b) continue;
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end())
+        return false;
 
-            if (lineA.intersect(QLineF(mPolygon[a], mPolygon[b]), nullptr) == QLineF::BoundedIntersection)
-                return false;
-        }
-    }
+    //Check to see if any edges that are not neighbors cross
+    int n = mPolygon.size();
+    bool crosses = SegmentIntersection::findIntersections(SegmentIntersection::ringEdges(mPolygon), [n] (int i, int j) {
+        return j != i + 1 && !(i == 0 && j == n - 1);
+    });
 
     // TODO need to ensure it's counter clockwise
 
-    return true;
+    return !crosses;
 }
 
 bool BetterPolygon::chordIsClear(int ind1, int ind2) const
@@ -68,12 +59,16 @@ bool BetterPolygon::chordIsClear(int ind1, int ind2) const
 
     if (!mPolygon.containsPoint(line.center(), Qt::OddEvenFill)) return false;
 
+    SegmentIntersection::RingEdges edges(mPolygon);
+    QVarLengthArray<quint8, 32> hits(mPolygon.size());
+    SegmentIntersection::intersectBatch(line, edges.batch(), hits.data());
+
     for (int i = 0; i < mPolygon.size(); ++i) {
         int j = (i + 1) % mPolygon.size();
 
         if (i == ind1 || i == ind2 || j == ind1 || j == ind2) continue;
 
-        if (line.intersect(QLineF(mPolygon[i], mPolygon[j]), nullptr) == QLineF::BoundedIntersection)
+        if (hits[i])
             return false;
     }
 
@@ -84,42 +79,36 @@ bool BetterPolygon::connectionIsClear(const BetterPolygon &other, int pointOnThi
 {
     QLineF line(mPolygon[pointOnThis], other.mPolygon[pointOnOther]);
 
-    for (int i = 0; i < mPolygon.size(); ++i) {
-        int j = (i + 1) % mPolygon.size();
-
-        if (j == pointOnThis || i == pointOnThis) continue;
+    //Edges that end at either end of the connection do not count.
+    auto isClear = [&line] (const QPolygonF &polygon, int point) {
+        SegmentIntersection::RingEdges edges(polygon);
+        QVarLengthArray<quint8, 32> hits(polygon.size());
+        SegmentIntersection::intersectBatch(line, edges.batch(), hits.data());
 
-        if (line.intersect(QLineF(mPolygon[i], mPolygon[j]), nullptr) == QLineF::BoundedIntersection)
-            return false;
-    }
+        for (int i = 0; i < polygon.size(); ++i) {
+            int j = (i + 1) % polygon.size();
 
-    for (int i = 0; i < other.mPolygon.size(); ++i) {
-        int j = (i + 1) % other.mPolygon.size();
+            if (j == point || i == point) continue;
 
-        if (j == pointOnOther || i == pointOnOther) continue;
+            if (hits[i])
+                return false;
+        }
 
-        if (line.intersect(QLineF(other.mPolygon[i], other.mPolygon[j]), nullptr) == QLineF::BoundedIntersection)
-            return false;
-    }
+        return true;
+    };
 
-    return true;
+    return isClear(mPolygon, pointOnThis) && isClear(other.mPolygon, pointOnOther);
 }
 
 bool BetterPolygon::overlaps(const BetterPolygon &other) const
 {
-    for (int i = 0; i < mPolygon.size(); ++i) {
-        int j = (i + 1) % mPolygon.size();
-        QLineF line(mPolygon[i], mPolygon[j]);
-
-        for (int a = 0; a < other.mPolygon.size(); ++a) {
-            int b = (a + 1) % other.mPolygon.size();
-
-            if (line.intersect(QLineF(other.mPolygon[a], other.mPolygon[b]), nullptr) == QLineF::BoundedIntersection)
-                return true;
-        }
-    }
-
-    return false;
+    //Only pairs of one edge from each polygon count.
+    int n = mPolygon.size();
+    return SegmentIntersection::findIntersections(SegmentIntersection::ringEdges(mPolygon)
+                                                  + SegmentIntersection::ringEdges(other.mPolygon),
+                                                  [n] (int i, int j) {
+        return i < n && j >= n;
+    });
 }
 
 QPair<BetterPolygon, BetterPolygon> BetterPolygon::splitPolygon() const
@@ -195,171 +184,90 @@ QList<Triplet<QPointF, QPointF, QPointF>> BetterPolygon::triangulate() const
 {
     Q_ASSERT(mPolygon.size() >= 3);
 
-    if (mPolygon.size() == 3) {
-        if (Geometry::orientation(mPolygon[0], mPolygon[1], mPolygon[2]) == 2)
-            return { {mPolygon[0], mPolygon[1], mPolygon[2]} };
-        else
-            return { {mPolygon[0], mPolygon[2], mPolygon[1]} };
-    }
-
-    QPair<BetterPolygon, BetterPolygon> split = splitPolygon();
-    QList<Triplet<QPointF, QPointF, QPointF>> trigs = split.first.triangulate();
-    trigs.append(split.second.triangulate());
-
-    return trigs;
+    return Triangulator::triangulate(mPolygon);
 }
 
-QVector<BetterPolygon> parseQPolygonF(QPolygonF base)
+namespace {
+
+/**
+ * @brief Converts the output of the clipper to BetterPolygons, which cannot have holes.
+ *
+ * A polygon with holes is cut in two along a vertical line through its first hole,
+ * which opens that hole up into the boundaries of both halves. The halves are
+ * converted recursively until no holes are left.
+ */
+QVector<BetterPolygon> toBetterPolygons(const QVector<PolygonClipper::Polygon> &polygons)
 {
-    if (base.isEmpty()) return {};
+    using namespace PolygonClipper;
 
-    if (base.isClosed()) base.removeLast();
-    if (BetterPolygon(base).isValid()) return { BetterPolygon(base) };
+    QVector<BetterPolygon> result;
 
-    //The following is very specific to how QPolygonF seems to output TODO add details about how this works.
+    for (const Polygon &polygon : polygons) {
+        if (polygon.holes.isEmpty()) {
+            result.append(BetterPolygon(polygon.outer));
+            continue;
+        }
 
-    QVector<BetterPolygon> polygons;
+        // Cut on the grid, strictly inside the hole's horizontal extent.
+        qint64 minU = std::numeric_limits<qint64>::max();
+        qint64 maxU = std::numeric_limits<qint64>::min();
+        for (const QPointF &p : polygon.holes.first()) {
+            qint64 u = qRound64(p.x() * Scale);
+            minU = qMin(minU, u);
+            maxU = qMax(maxU, u);
+        }
 
-    QPointF startPoint = base.first();
-    QPolygonF currentPoly;
-    currentPoly.append(startPoint);
+        // A hole this thin cannot be cut on the grid; fill it in.
+        if (maxU - minU < 2) {
+            Polygon filled = polygon;
+            filled.holes.removeFirst();
+            result += toBetterPolygons({filled});
+            continue;
+        }
 
-    //parse the first polygon
-    auto i = base.begin() + 1;
-    while (*i != startPoint) {
-        currentPoly.append(*i);
-        ++i;
-    }
+        qreal cut = qreal((minU + maxU) / 2) / Scale;
+        QRectF bounds = QPolygonF(polygon.outer).boundingRect().adjusted(-1, -1, 1, 1);
 
-    polygons.append(currentPoly);
-    currentPoly = QPolygonF();
-    if (++i == base.end()) return polygons;
-    currentPoly.append(startPoint = *(i++));
-    while(i != base.end()) {
-        if (*i == startPoint) {
-            polygons.append(currentPoly);
-            currentPoly = QPolygonF();
-            if (++i == base.end()) return polygons;
-            if (++i == base.end()) return polygons;
-            startPoint = *i;
-        }
+        Polygon left({bounds.topLeft(), QPointF(cut, bounds.top()),
+                      QPointF(cut, bounds.bottom()), bounds.bottomLeft()});
+        Polygon right({QPointF(cut, bounds.top()), bounds.topRight(),
+                       bounds.bottomRight(), QPointF(cut, bounds.bottom())});
 
-        currentPoly.append(*(i++));
+        result += toBetterPolygons(clip(Operation::Intersection, {polygon}, {left}));
+        result += toBetterPolygons(clip(Operation::Intersection, {polygon}, {right}));
     }
 
-    return polygons;
+    return result;
+}
+
 }
 
 QVector<BetterPolygon> BetterPolygon::subtract(const BetterPolygon &other) const
 {
-    bool firstPointContained = mPolygon.containsPoint(other.mPolygon.first(), Qt::OddEvenFill);
-
-    if (!overlaps(other)) {
-        if (firstPointContained) {
-            //Special case, polygon to subtract is contained within this
-            auto findConnection = [this, other](int &i, int &j) {
-                while(true) {
-                    bool shouldBreak = false;
-                    while(true) {
-                        if (connectionIsClear(other, i, j)) {
-                            shouldBreak = true;
-                            break;
-                        }
-
-                        j = (j + 1) % other.mPolygon.size();
-                    }
-                    if (shouldBreak) break;
-
-                    i = (i + 1) % mPolygon.size();
-                }
-            };
-
-            QPair<int, int> cA, cB;
-            findConnection(cA.first = 0,
-                           cA.second = 0);
-            findConnection(cB.first = (cA.first + 1) % mPolygon.size(),
-                           cB.second = (cA.second + 1) % other.mPolygon.size());
-
-            //Construct the two new polygons.
-            QPolygonF polyA;
-            polyA.append(mPolygon[cA.first]);
-            polyA.append(other.mPolygon[cA.second]);
-
-            int prog = (cA.second + 1) % other.mPolygon.size();
-            while (prog != cB.second) {
-                polyA.append(other.mPolygon[prog]);
-                prog = (prog + 1) % other.mPolygon.size();
-            }
-
-            polyA.append(other.mPolygon[cB.second]);
-            polyA.append(mPolygon[cB.first]);
-
-            prog = (cB.first - 1 + mPolygon.size()) % mPolygon.size();
-            while (prog != cA.first) {
-                polyA.append(mPolygon[prog]);
-                prog = (prog - 1 + mPolygon.size()) % mPolygon.size();
-            }
-
-            QPolygonF polyB;
-            polyB.append(mPolygon[cA.first]);
-            polyB.append(other.mPolygon[cA.second]);
-
-            prog = (cA.second - 1 + other.mPolygon.size()) % other.mPolygon.size();
-            while (prog != cB.second) {
-                polyB.append(other.mPolygon[prog]);
-                prog = (prog - 1 + other.mPolygon.size()) % other.mPolygon.size();
-            }
-
-            polyB.append(other.mPolygon[cB.second]);
-            polyB.append(mPolygon[cB.first]);
-
-            prog = (cB.first + 1) % mPolygon.size();
-            while (prog != cA.first) {
-                polyB.append(mPolygon[prog]);
-                prog = (prog + 1) % mPolygon.size();
-            }
-
-            return { polyA, polyB };
-
-        } else {
-            if (other.mPolygon.containsPoint(mPolygon.first(), Qt::OddEvenFill))
-                return {};
-            else
-                return { *this };
-        }
-    }
+    return subtract(QVector<BetterPolygon>{other});
+}
 
-    //The base subraction of the two polygons. Output might not be
-    //valid by the rules of BetterPolygon
-    QPolygonF base = mPolygon.subtracted(other.mPolygon);
+QVector<BetterPolygon> BetterPolygon::subtract(const QVector<BetterPolygon> &others) const
+{
+    QVector<PolygonClipper::Polygon> clipPolygons;
+    clipPolygons.reserve(others.size());
+    for (const BetterPolygon &other : others)
+        clipPolygons.append(PolygonClipper::Polygon(other.mPolygon));
 
-    return parseQPolygonF(base);
+    return toBetterPolygons(PolygonClipper::clip(PolygonClipper::Operation::Difference,
+                                                 {PolygonClipper::Polygon(mPolygon)}, clipPolygons));
 }
 
 QVector<BetterPolygon> BetterPolygon::intersect(const BetterPolygon &other) const
 {
-    auto sub = subtract(other);
-
-    if (sub.size() == 0) return { *this };
-    if (sub.size() == 1) return subtract(sub.first());
-
-    QVector<BetterPolygon> ret  = subtract(sub.first());
-
-    for (auto i = sub.cbegin() + 1; i != sub.cend(); ++i) {
-        QVector<BetterPolygon> tmp;
-
-        for (const BetterPolygon &p : ret)
-            tmp.append(p.subtract(*i));
-
-        ret.swap(tmp);
-    }
-
-    return ret;
+    return toBetterPolygons(PolygonClipper::clip(PolygonClipper::Operation::Intersection,
+                                                 {PolygonClipper::Polygon(mPolygon)},
+                                                 {PolygonClipper::Polygon(other.mPolygon)}));
 }
 
 QVector<BetterPolygon> BetterPolygon::united(const BetterPolygon &other) const
 {
-    QPolygonF base = mPolygon.united(other.mPolygon);
-
-    return parseQPolygonF(base);
+    return toBetterPolygons(PolygonClipper::clip(PolygonClipper::Operation::Union,
+                                                 {PolygonClipper::Polygon(mPolygon)},
+                                                 {PolygonClipper::Polygon(other.mPolygon)}));
 }
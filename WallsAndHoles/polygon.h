@@ -68,13 +68,26 @@ public:
     /**
      * @brief triangulate
      *
-     * Returns a list of triangles that represent this polygon
+     * Returns a list of triangles that represent this polygon,
+     * computed by Triangulator.
      *
      * @return
      */
     QList<Triplet<QPointF, QPointF, QPointF>> triangulate() const;
 
+    /**
+     * @brief Boolean operations, computed by PolygonClipper.
+     *
+     * Parts of the result with holes are cut into several polygons without holes.
+     */
     QVector<BetterPolygon> subtract(const BetterPolygon &other) const;
+
+    /**
+     * @brief Subtracts all of others at once, which is much cheaper than subtracting
+     * them one by one and gives the same result.
+     */
+    QVector<BetterPolygon> subtract(const QVector<BetterPolygon> &others) const;
+
     QVector<BetterPolygon> intersect(const BetterPolygon &other) const;
     QVector<BetterPolygon> united(const BetterPolygon &other) const;
 
@@ -0,0 +1,658 @@
+#include "polygonclipper.h"
+
+#include <algorithm>
+
+#include "arena.h"
+#include "segmentintersection.h"
+
+using namespace PolygonClipper;
+
+
+namespace {
+
+using Coord = qint64;
+
+/// A point on the fixed-point grid.
+struct Point {
+    Coord x;
+    Coord y;
+
+    bool operator ==(const Point &other) const { return x == other.x && y == other.y; }
+    bool operator !=(const Point &other) const { return !(*this == other); }
+    bool operator <(const Point &other) const { return x < other.x || (x == other.x && y < other.y); }
+
+    Point operator +(const Point &other) const { return {x + other.x, y + other.y}; }
+    Point operator -(const Point &other) const { return {x - other.x, y - other.y}; }
+};
+
+Coord cross(Point a, Point b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+Coord dot(Point a, Point b)
+{
+    return a.x * b.x + a.y * b.y;
+}
+
+Point toGrid(QPointF p)
+{
+    return {qRound64(p.x() * Scale), qRound64(p.y() * Scale)};
+}
+
+QPointF fromGrid(Point p)
+{
+    return QPointF(qreal(p.x) / Scale, qreal(p.y) / Scale);
+}
+
+
+/// An input edge. The inside of its operand is on its left.
+struct Edge {
+    Point a;
+    Point b;
+    int operand;
+};
+
+/// A point where an edge has to be split.
+struct SplitPoint {
+    int edge;
+
+    /// Orders the split points along the edge.
+    Coord along;
+
+    Point p;
+
+    bool operator <(const SplitPoint &other) const
+    {
+        return edge < other.edge || (edge == other.edge && along < other.along);
+    }
+};
+
+/// A piece of the arrangement of all edges. Pieces never cross each other.
+struct Segment {
+    /// a < b
+    Point a;
+    Point b;
+
+    /// For each operand, the number of its edges along this segment that point from
+    /// a to b, minus the number of those that point from b to a.
+    int winding[2];
+
+    bool operator <(const Segment &other) const
+    {
+        return a < other.a || (a == other.a && b < other.b);
+    }
+};
+
+/// An edge of the result. The inside of the result is on its left.
+struct ResultEdge {
+    Point from;
+    Point to;
+    int fromVertex;
+    int toVertex;
+
+    bool operator <(const ResultEdge &other) const
+    {
+        return fromVertex < other.fromVertex;
+    }
+};
+
+/// A traced ring: points [start, end) of the ring point array.
+struct Ring {
+    int start;
+    int end;
+
+    /// Twice the signed area. Outer rings are positive and holes are negative.
+    Coord area2;
+};
+
+
+/// Twice the signed area of the ring, computed relative to its first point.
+Coord signedArea2(const Point *points, int count)
+{
+    Coord area2 = 0;
+    for (int i = 1; i + 1 < count; ++i)
+        area2 += cross(points[i] - points[0], points[i + 1] - points[0]);
+
+    return area2;
+}
+
+/// Whether p lies on segment ab, excluding the end points. Assumes p is on the line through a and b.
+bool isInsideCollinear(Point p, Point a, Point b)
+{
+    return p != a && p != b && dot(p - a, b - a) > 0 && dot(p - b, a - b) > 0;
+}
+
+void addRing(const QVector<QPointF> &ring, int operand, bool hole, ArenaVector<Edge> &edges, Arena &arena)
+{
+    ArenaVector<Point> points(arena, ring.size());
+    for (const QPointF &p : ring) {
+        Point q = toGrid(p);
+        if (points.isEmpty() || q != points.last())
+            points.append(q);
+    }
+
+    while (points.size() > 1 && points.first() == points.last())
+        points.removeLast();
+
+    if (points.size() < 3)
+        return;
+
+    Coord area2 = signedArea2(points.begin(), points.size());
+    if (area2 == 0)
+        return;
+
+    // Outer boundaries turn left (positive area), holes turn right.
+    bool reverse = (area2 > 0) == hole;
+
+    for (int i = 0; i < points.size(); ++i) {
+        Point a = points[i];
+        Point b = points[(i + 1) % points.size()];
+
+        if (reverse)
+            edges.append({b, a, operand});
+        else
+            edges.append({a, b, operand});
+    }
+}
+
+void addSplit(ArenaVector<SplitPoint> &splits, const Edge &e, int edgeIdx, Point p)
+{
+    if (p != e.a && p != e.b)
+        splits.append({edgeIdx, dot(p - e.a, e.b - e.a), p});
+}
+
+/// Finds the points where edges i and j have to be split so that they only meet at end points.
+void intersectEdges(const ArenaVector<Edge> &edges, int i, int j, ArenaVector<SplitPoint> &splits)
+{
+    const Edge &e = edges[i];
+    const Edge &f = edges[j];
+
+    if (qMax(e.a.x, e.b.x) < qMin(f.a.x, f.b.x) || qMax(f.a.x, f.b.x) < qMin(e.a.x, e.b.x)
+            || qMax(e.a.y, e.b.y) < qMin(f.a.y, f.b.y) || qMax(f.a.y, f.b.y) < qMin(e.a.y, e.b.y))
+        return;
+
+    Point d1 = e.b - e.a;
+    Point d2 = f.b - f.a;
+
+    Coord denom = cross(d1, d2);
+
+    if (denom == 0) {
+        // Parallel edges only matter if they lie on the same line.
+        if (cross(f.a - e.a, d1) != 0)
+            return;
+
+        if (isInsideCollinear(f.a, e.a, e.b)) addSplit(splits, e, i, f.a);
+        if (isInsideCollinear(f.b, e.a, e.b)) addSplit(splits, e, i, f.b);
+        if (isInsideCollinear(e.a, f.a, f.b)) addSplit(splits, f, j, e.a);
+        if (isInsideCollinear(e.b, f.a, f.b)) addSplit(splits, f, j, e.b);
+        return;
+    }
+
+    // The edges meet at e.a + t * d1 = f.a + u * d2, with t = tNum / denom and u = uNum / denom.
+    Coord tNum = cross(f.a - e.a, d2);
+    Coord uNum = cross(f.a - e.a, d1);
+
+    if (denom < 0) {
+        denom = -denom;
+        tNum = -tNum;
+        uNum = -uNum;
+    }
+
+    if (tNum < 0 || tNum > denom || uNum < 0 || uNum > denom)
+        return;
+
+    Point p;
+    if (tNum == 0)
+        p = e.a;
+    else if (tNum == denom)
+        p = e.b;
+    else if (uNum == 0)
+        p = f.a;
+    else if (uNum == denom)
+        p = f.b;
+    else {
+        // A proper crossing, which is rounded to the grid.
+        double t = double(tNum) / double(denom);
+        p = {e.a.x + qRound64(t * d1.x), e.a.y + qRound64(t * d1.y)};
+    }
+
+    addSplit(splits, e, i, p);
+    addSplit(splits, f, j, p);
+}
+
+/**
+ * @brief Returns the winding number of the segments of one operand around the point m
+ * (in doubled coordinates), as if m were moved right by an infinitesimal amount and
+ * then up by an even smaller one.
+ */
+int windingNumber(const ArenaVector<Segment> &segments, int operand, Point m)
+{
+    int winding = 0;
+
+    for (const Segment &s : segments) {
+        if (s.winding[operand] == 0)
+            continue;
+
+        Point p = s.a + s.a;
+        Point q = s.b + s.b;
+
+        // Half-open rule: end points on the ray's line count as slightly below it.
+        if ((p.y <= m.y) == (q.y <= m.y))
+            continue;
+
+        Coord dy = q.y - p.y;
+        Coord num = (p.x - m.x) * dy + (m.y - p.y) * (q.x - p.x);
+
+        // Only count edges that cross strictly to the right of m.
+        if (num == 0 || (num > 0) != (dy > 0))
+            continue;
+
+        // Upward edges have the point on their left, i.e. inside.
+        winding += dy > 0 ? s.winding[operand] : -s.winding[operand];
+    }
+
+    return winding;
+}
+
+bool isInResult(Operation operation, bool inSubject, bool inClip)
+{
+    switch (operation) {
+    case Operation::Union:
+        return inSubject || inClip;
+    case Operation::Intersection:
+        return inSubject && inClip;
+    case Operation::Difference:
+        return inSubject && !inClip;
+    }
+
+    return false;
+}
+
+/// Orders directions by the clockwise angle from r. Used to pick the sharpest left
+/// turn when tracing, so that rings that touch at a vertex are traced separately.
+int clockwiseGroup(Point r, Point u)
+{
+    Coord c = cross(r, u);
+    if (c < 0) return 0;
+    if (c > 0) return 2;
+    return dot(r, u) < 0 ? 1 : 3;
+}
+
+bool isClockwiseBefore(Point r, Point u, Point v)
+{
+    int gu = clockwiseGroup(r, u);
+    int gv = clockwiseGroup(r, v);
+
+    if (gu != gv)
+        return gu < gv;
+
+    return cross(u, v) < 0;
+}
+
+/// Converts a ring to QPointFs in BetterPolygon's orientation, leaving out collinear points.
+QVector<QPointF> toOutput(const Point *points, int count)
+{
+    QVector<QPointF> output;
+    output.reserve(count);
+
+    // Rings are traced with the inside on their left; BetterPolygon uses the opposite.
+    for (int i = count - 1; i >= 0; --i) {
+        Point prev = points[(i + 1) % count];
+        Point cur = points[i];
+        Point next = points[(i - 1 + count) % count];
+
+        if (cross(cur - prev, next - cur) != 0)
+            output.append(fromGrid(cur));
+    }
+
+    return output;
+}
+
+}
+
+
+QVector<Polygon> PolygonClipper::clip(Operation operation, const QVector<Polygon> &subject, const QVector<Polygon> &clipPolygons,
+                                      bool *repaired)
+{
+    Arena arena;
+
+    if (repaired)
+        *repaired = false;
+
+    /* BEGIN input */
+    ArenaVector<Edge> edges(arena);
+
+    const QVector<Polygon> *operands[2] = {&subject, &clipPolygons};
+    for (int operand = 0; operand < 2; ++operand) {
+        for (const Polygon &polygon : *operands[operand]) {
+            addRing(polygon.outer, operand, false, edges, arena);
+
+            for (const QVector<QPointF> &hole : polygon.holes)
+                addRing(hole, operand, true, edges, arena);
+        }
+    }
+    /* END input */
+
+
+    /* BEGIN arrangement */
+    // Split the edges wherever they meet, so that they only touch at end points.
+    // Rounding a crossing to the grid bends both edges slightly, which can make them
+    // cross edges that they only passed before, so the pieces are split again until
+    // no two cross.
+    ArenaVector<qreal> minX(arena, edges.size());
+    ArenaVector<qreal> maxX(arena, edges.size());
+    ArenaVector<SplitPoint> splits(arena);
+
+    for (int round = 0; round < MaxSplitRounds; ++round) {
+        // Only edges whose x ranges overlap can meet.
+        minX.clear();
+        maxX.clear();
+        for (const Edge &e : edges) {
+            minX.append(qMin(e.a.x, e.b.x));
+            maxX.append(qMax(e.a.x, e.b.x));
+        }
+
+        splits.clear();
+        SegmentIntersection::sweepIntervals(minX.begin(), maxX.begin(), edges.size(),
+                                            [&edges, &splits] (int i, const int *active, int numActive) {
+            for (int k = 0; k < numActive; ++k)
+                intersectEdges(edges, qMin(i, active[k]), qMax(i, active[k]), splits);
+            return false;
+        });
+
+        if (splits.isEmpty())
+            break;
+
+        std::sort(splits.begin(), splits.end());
+
+        ArenaVector<Edge> pieces(arena, edges.size() + splits.size());
+
+        int splitIdx = 0;
+        for (int i = 0; i < edges.size(); ++i) {
+            const Edge &e = edges[i];
+            Point prev = e.a;
+
+            for (; splitIdx < splits.size() && splits[splitIdx].edge == i; ++splitIdx) {
+                if (splits[splitIdx].p != prev) {
+                    pieces.append({prev, splits[splitIdx].p, e.operand});
+                    prev = splits[splitIdx].p;
+                }
+            }
+
+            if (e.b != prev)
+                pieces.append({prev, e.b, e.operand});
+        }
+
+        edges.swap(pieces);
+    }
+
+    // Orient the pieces from the smaller to the larger point.
+    ArenaVector<Segment> pieces(arena, edges.size());
+    for (const Edge &e : edges) {
+        Segment s;
+        s.winding[0] = s.winding[1] = 0;
+
+        if (e.a < e.b) {
+            s.a = e.a;
+            s.b = e.b;
+            s.winding[e.operand] = 1;
+        } else {
+            s.a = e.b;
+            s.b = e.a;
+            s.winding[e.operand] = -1;
+        }
+
+        pieces.append(s);
+    }
+
+    // Merge pieces that coincide.
+    std::sort(pieces.begin(), pieces.end());
+
+    ArenaVector<Segment> segments(arena, pieces.size());
+    for (const Segment &piece : pieces) {
+        if (!segments.isEmpty() && segments.last().a == piece.a && segments.last().b == piece.b) {
+            segments.last().winding[0] += piece.winding[0];
+            segments.last().winding[1] += piece.winding[1];
+        } else {
+            segments.append(piece);
+        }
+    }
+    /* END arrangement */
+
+
+    /* BEGIN classification */
+    // A segment is on the boundary of the result if the result is on exactly one side of it.
+    ArenaVector<ResultEdge> resultEdges(arena);
+
+    for (const Segment &s : segments) {
+        if (s.winding[0] == 0 && s.winding[1] == 0)
+            continue;
+
+        // windingNumber() measures just to the right of the midpoint, or, for
+        // horizontal segments, just above it.
+        Point d = s.b - s.a;
+        bool measuresLeft = d.y <= 0;
+
+        bool inLeft[2];
+        bool inRight[2];
+        for (int operand = 0; operand < 2; ++operand) {
+            int w = windingNumber(segments, operand, s.a + s.b);
+
+            // Crossing a segment from right to left adds its winding.
+            int left = measuresLeft ? w : w + s.winding[operand];
+            int right = measuresLeft ? w - s.winding[operand] : w;
+
+            inLeft[operand] = left != 0;
+            inRight[operand] = right != 0;
+        }
+
+        bool left = isInResult(operation, inLeft[0], inLeft[1]);
+        bool right = isInResult(operation, inRight[0], inRight[1]);
+
+        if (left == right)
+            continue;
+
+        if (left)
+            resultEdges.append({s.a, s.b, -1, -1});
+        else
+            resultEdges.append({s.b, s.a, -1, -1});
+    }
+    /* END classification */
+
+
+    /* BEGIN tracing */
+    // A broken boundary can end at a point where no edge starts, so both ends count.
+    ArenaVector<Point> vertices(arena, 2 * resultEdges.size());
+    for (const ResultEdge &e : resultEdges) {
+        vertices.append(e.from);
+        vertices.append(e.to);
+    }
+
+    std::sort(vertices.begin(), vertices.end());
+    int numVertices = std::unique(vertices.begin(), vertices.end()) - vertices.begin();
+
+    auto vertexIndex = [&vertices, numVertices] (Point p) {
+        return int(std::lower_bound(vertices.begin(), vertices.begin() + numVertices, p) - vertices.begin());
+    };
+
+    for (ResultEdge &e : resultEdges) {
+        e.fromVertex = vertexIndex(e.from);
+        e.toVertex = vertexIndex(e.to);
+    }
+
+    // Group the edges by the vertex they start at.
+    std::sort(resultEdges.begin(), resultEdges.end());
+
+    ArenaVector<int> firstOut(arena, numVertices + 1);
+    for (int v = 0, e = 0; v <= numVertices; ++v) {
+        while (e < resultEdges.size() && resultEdges[e].fromVertex < v)
+            ++e;
+        firstOut.append(e);
+    }
+
+    ArenaVector<bool> used(arena, resultEdges.size());
+    for (int e = 0; e < resultEdges.size(); ++e)
+        used.append(false);
+
+    ArenaVector<Point> traced(arena);
+    ArenaVector<Point> loop(arena);
+    ArenaVector<Point> ringPoints(arena, resultEdges.size());
+    ArenaVector<Ring> rings(arena);
+
+    // Adds the given points as a ring, unless they have no area.
+    auto addRing = [&ringPoints, &rings] (const Point *points, int count) {
+        Coord area2 = count >= 3 ? signedArea2(points, count) : 0;
+        if (area2 == 0)
+            return;
+
+        int start = ringPoints.size();
+        for (int i = 0; i < count; ++i)
+            ringPoints.append(points[i]);
+
+        rings.append({start, ringPoints.size(), area2});
+    };
+
+    // Returns the unused edge that starts nearest to p, or start if its start is at
+    // least as near.
+    auto nearestLooseEnd = [&resultEdges, &used] (Point p, int start) {
+        int nearest = start;
+        Coord nearestDist = dot(resultEdges[start].from - p, resultEdges[start].from - p);
+
+        for (int o = 0; o < resultEdges.size(); ++o) {
+            Coord dist = dot(resultEdges[o].from - p, resultEdges[o].from - p);
+            if (!used[o] && dist < nearestDist) {
+                nearest = o;
+                nearestDist = dist;
+            }
+        }
+
+        return nearest;
+    };
+
+    for (int start = 0; start < resultEdges.size(); ++start) {
+        if (used[start])
+            continue;
+
+        traced.clear();
+
+        for (int e = start; ; ) {
+            used[e] = true;
+            traced.append(resultEdges[e].from);
+
+            // Continue with the sharpest left turn.
+            int v = resultEdges[e].toVertex;
+            Point back = resultEdges[e].from - resultEdges[e].to;
+
+            int next = -1;
+            for (int o = firstOut[v]; o < firstOut[v + 1]; ++o) {
+                if (next == -1 || isClockwiseBefore(back,
+                                                    resultEdges[o].to - resultEdges[o].from,
+                                                    resultEdges[next].to - resultEdges[next].from))
+                    next = o;
+            }
+
+            if (next == start)
+                break;
+
+            // Rounding can break the boundary, so that it ends at a vertex or runs into
+            // a part that was already traced. Join it to the nearest loose end instead
+            // of dropping it.
+            if (next == -1 || used[next]) {
+                if (repaired)
+                    *repaired = true;
+
+                next = nearestLooseEnd(resultEdges[e].to, start);
+                if (next == start)
+                    break;
+            }
+
+            e = next;
+        }
+
+        // The sharpest left turn keeps rings that touch from the outside apart, but
+        // a hole that touches the outer boundary at a vertex is traced as part of
+        // it. Split off every loop that returns to an earlier vertex.
+        loop.clear();
+        for (const Point &p : traced) {
+            int repeat = loop.size() - 1;
+            while (repeat >= 0 && loop[repeat] != p)
+                --repeat;
+
+            if (repeat < 0) {
+                loop.append(p);
+                continue;
+            }
+
+            addRing(loop.begin() + repeat, loop.size() - repeat);
+
+            while (loop.size() > repeat + 1)
+                loop.removeLast();
+        }
+
+        addRing(loop.begin(), loop.size());
+    }
+    /* END tracing */
+
+
+    /* BEGIN output */
+    QVector<Polygon> result;
+    ArenaVector<int> resultIndex(arena, rings.size());
+
+    for (const Ring &ring : rings) {
+        if (ring.area2 > 0) {
+            resultIndex.append(result.size());
+            result.append(Polygon(toOutput(ringPoints.begin() + ring.start, ring.end - ring.start)));
+        } else {
+            resultIndex.append(-1);
+        }
+    }
+
+    // Put each hole into the smallest outer ring that contains it.
+    for (const Ring &hole : rings) {
+        if (hole.area2 > 0)
+            continue;
+
+        // The midpoint of an edge of the hole cannot lie on another ring.
+        Point m = ringPoints[hole.start] + ringPoints[hole.start + 1];
+
+        int parent = -1;
+        for (int r = 0; r < rings.size(); ++r) {
+            const Ring &outer = rings[r];
+            if (outer.area2 <= 0 || (parent != -1 && outer.area2 >= rings[parent].area2))
+                continue;
+
+            // Wrap the ring's points in segments to reuse windingNumber().
+            ArenaVector<Segment> outerSegments(arena, outer.end - outer.start);
+            for (int i = outer.start; i < outer.end; ++i) {
+                Point a = ringPoints[i];
+                Point b = ringPoints[i + 1 < outer.end ? i + 1 : outer.start];
+
+                Segment s;
+                s.winding[1] = 0;
+                if (a < b) {
+                    s.a = a;
+                    s.b = b;
+                    s.winding[0] = 1;
+                } else {
+                    s.a = b;
+                    s.b = a;
+                    s.winding[0] = -1;
+                }
+                outerSegments.append(s);
+            }
+
+            if (windingNumber(outerSegments, 0, m) != 0)
+                parent = r;
+        }
+
+        // Every hole should have a parent, but rounding could leave a hole on its own.
+        if (parent != -1)
+            result[resultIndex[parent]].holes.append(toOutput(ringPoints.begin() + hole.start, hole.end - hole.start));
+        else if (repaired)
+            *repaired = true;
+    }
+    /* END output */
+
+    return result;
+}
@@ -0,0 +1,66 @@
+#ifndef POLYGONCLIPPER_H
+#define POLYGONCLIPPER_H
+
+#include <QVector>
+#include <QPointF>
+
+/**
+ * @brief Boolean operations on polygons with holes.
+ *
+ * Coordinates are rounded to a fixed-point grid with Scale units per tile, and all
+ * decisions (which edges cross, which side of an edge is inside) are made with exact
+ * integer arithmetic on that grid. Only the positions of edge crossings are rounded.
+ * This makes the results consistent no matter how the edges of the inputs touch,
+ * overlap or line up, which is the common case for tile geometry.
+ *
+ * Each call does its temporary allocations from its own Arena.
+ */
+namespace PolygonClipper {
+
+enum class Operation {
+    Union,
+    Intersection,
+    Difference
+};
+
+/**
+ * @brief A polygon with holes.
+ *
+ * The outer boundary uses the same orientation as BetterPolygon, and holes use
+ * the opposite one. The orientation of input polygons does not matter.
+ */
+struct Polygon {
+    Polygon() {}
+    Polygon(const QVector<QPointF> &outer) : outer(outer) {}
+
+    QVector<QPointF> outer;
+    QVector<QVector<QPointF>> holes;
+};
+
+/// The number of fixed-point units per unit of length.
+const qint64 Scale = 1 << 16;
+
+/// How often the edges are split again after rounding crossings made them cross new edges.
+const int MaxSplitRounds = 8;
+
+/**
+ * @brief Applies the operation to subject and clipPolygons. Difference computes subject minus clipPolygons.
+ *
+ * The polygons within each of subject and clipPolygons may overlap; each is treated as
+ * the union of its polygons. The result consists of polygons that do not overlap
+ * and have no collinear points. Polygons that only touch at a point are output
+ * separately, as are holes that touch the outer boundary at a point.
+ *
+ * Rounding crossings to the grid can, rarely, leave a boundary that does not close.
+ * Such a boundary is closed by joining it to the nearest loose end, which may move it
+ * by a few grid units, instead of dropping it.
+ *
+ * @param repaired  If not null, set to whether a boundary had to be closed that way,
+ *                  or a hole had no outer boundary around it and was left out.
+ */
+QVector<Polygon> clip(Operation operation, const QVector<Polygon> &subject, const QVector<Polygon> &clipPolygons,
+                      bool *repaired = nullptr);
+
+}
+
+#endif // POLYGONCLIPPER_H
@@ -0,0 +1,75 @@
+#include "rangeallocator.h"
+
+RangeAllocator::RangeAllocator(int capacity)
+    : mCapacity(capacity)
+    , mUsed(0)
+{
+    if (capacity > 0)
+        mFree.insert(0, capacity);
+}
+
+int RangeAllocator::allocate(int size)
+{
+    Q_ASSERT(size >= 0);
+
+    // Empty ranges take no space, so any offset will do.
+    if (size == 0)
+        return 0;
+
+    for (auto it = mFree.begin(); it != mFree.end(); ++it) {
+        if (it.value() < size)
+            continue;
+
+        int offset = it.key();
+        int remaining = it.value() - size;
+
+        mFree.erase(it);
+        if (remaining > 0)
+            mFree.insert(offset + size, remaining);
+
+        mUsed += size;
+        return offset;
+    }
+
+    return -1;
+}
+
+void RangeAllocator::free(int offset, int size)
+{
+    Q_ASSERT(offset >= 0 && offset + size <= mCapacity);
+
+    if (size == 0)
+        return;
+
+    mUsed -= size;
+
+    // The first free range after this one.
+    auto next = mFree.lowerBound(offset);
+    Q_ASSERT(next == mFree.end() || next.key() >= offset + size);
+
+    if (next != mFree.end() && next.key() == offset + size) {
+        size += next.value();
+        next = mFree.erase(next);
+    }
+
+    if (next != mFree.begin()) {
+        auto previous = next - 1;
+        Q_ASSERT(previous.key() + previous.value() <= offset);
+
+        if (previous.key() + previous.value() == offset) {
+            previous.value() += size;
+            return;
+        }
+    }
+
+    mFree.insert(offset, size);
+}
+
+int RangeAllocator::largestFree() const
+{
+    int largest = 0;
+    for (int size : mFree)
+        largest = qMax(largest, size);
+
+    return largest;
+}
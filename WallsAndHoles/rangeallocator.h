@@ -0,0 +1,39 @@
+#ifndef RANGEALLOCATOR_H
+#define RANGEALLOCATOR_H
+
+#include <QMap>
+
+/**
+ * @brief Hands out ranges of the units [0, capacity) with a first-fit free list.
+ *
+ * The free list is ordered by offset, so allocations fill the lowest holes first,
+ * and freed ranges are merged with the free ranges next to them.
+ */
+class RangeAllocator
+{
+public:
+    explicit RangeAllocator(int capacity = 0);
+
+    /// Returns the offset of a range of the given size, or -1 if no free range is large enough.
+    int allocate(int size);
+
+    /// Frees a range that allocate() returned.
+    void free(int offset, int size);
+
+    int capacity() const { return mCapacity; }
+
+    /// The number of allocated units.
+    int used() const { return mUsed; }
+
+    /// The size of the largest free range.
+    int largestFree() const;
+
+private:
+    int mCapacity;
+    int mUsed;
+
+    /// Maps the offsets of free ranges to their sizes.
+    QMap<int, int> mFree;
+};
+
+#endif // RANGEALLOCATOR_H
@@ -0,0 +1,157 @@
+#include "segmentintersection.h"
+
+#include <algorithm>
+
+#include "arena.h"
+
+using namespace SegmentIntersection;
+
+
+void SegmentIntersection::intersectBatch(const QLineF &line, const Batch &batch, quint8 *hits)
+{
+    // The same formulas as QLineF::intersect().
+    const qreal ax = line.dx();
+    const qreal ay = line.dy();
+    const qreal px = line.x1();
+    const qreal py = line.y1();
+
+    const qreal *x1 = batch.x1;
+    const qreal *y1 = batch.y1;
+    const qreal *x2 = batch.x2;
+    const qreal *y2 = batch.y2;
+
+    // Read into a local, since stores to hits could alias batch.count.
+    const int count = batch.count;
+
+    for (int i = 0; i < count; ++i) {
+        qreal bx = x1[i] - x2[i];
+        qreal by = y1[i] - y2[i];
+        qreal cx = px - x1[i];
+        qreal cy = py - y1[i];
+
+        qreal denominator = ay * bx - ax * by;
+        qreal reciprocal = 1 / denominator;
+
+        qreal na = (by * cx - bx * cy) * reciprocal;
+        qreal nb = (ax * cy - ay * cx) * reciprocal;
+
+        // Bitwise operators keep the loop free of branches. The difference is only
+        // zero if the denominator is finite.
+        hits[i] = (denominator != 0) & (denominator - denominator == 0)
+                & (na >= 0) & (na <= 1) & (nb >= 0) & (nb <= 1);
+    }
+}
+
+bool SegmentIntersection::sweepIntervals(const qreal *minX, const qreal *maxX, int count,
+                                         const std::function<bool (int, const int *, int)> &visit)
+{
+    Arena arena;
+
+    ArenaVector<int> order(arena, count);
+    for (int i = 0; i < count; ++i)
+        order.append(i);
+
+    std::sort(order.begin(), order.end(), [minX] (int a, int b) {
+        return minX[a] < minX[b];
+    });
+
+    ArenaVector<int> active(arena, count);
+    for (int i : order) {
+        // Intervals that end before this one starts cannot overlap any later ones either.
+        int kept = 0;
+        for (int a : active)
+            if (maxX[a] >= minX[i])
+                active[kept++] = a;
+        active.resize(kept);
+
+        if (visit(i, active.begin(), active.size()))
+            return true;
+
+        active.append(i);
+    }
+
+    return false;
+}
+
+bool SegmentIntersection::findIntersections(const QVector<QLineF> &segments, const std::function<bool (int, int)> &report)
+{
+    int count = segments.size();
+
+    Arena arena;
+
+    ArenaVector<qreal> minX(arena, count);
+    ArenaVector<qreal> maxX(arena, count);
+    for (const QLineF &s : segments) {
+        minX.append(qMin(s.x1(), s.x2()));
+        maxX.append(qMax(s.x1(), s.x2()));
+    }
+
+    // The active segments are copied into these arrays to test them in one batch.
+    ArenaVector<qreal> x1(arena, count);
+    ArenaVector<qreal> y1(arena, count);
+    ArenaVector<qreal> x2(arena, count);
+    ArenaVector<qreal> y2(arena, count);
+    ArenaVector<quint8> hits(arena, count);
+
+    auto visit = [&] (int i, const int *active, int numActive) {
+        x1.resize(numActive);
+        y1.resize(numActive);
+        x2.resize(numActive);
+        y2.resize(numActive);
+        hits.resize(numActive);
+
+        for (int k = 0; k < numActive; ++k) {
+            const QLineF &s = segments[active[k]];
+            x1[k] = s.x1();
+            y1[k] = s.y1();
+            x2[k] = s.x2();
+            y2[k] = s.y2();
+        }
+
+        intersectBatch(segments[i], {x1.begin(), y1.begin(), x2.begin(), y2.begin(), numActive}, hits.begin());
+
+        for (int k = 0; k < numActive; ++k)
+            if (hits[k] && report(qMin(i, active[k]), qMax(i, active[k])))
+                return true;
+
+        return false;
+    };
+
+    return sweepIntervals(minX.begin(), maxX.begin(), count, visit);
+}
+
+QVector<QLineF> SegmentIntersection::ringEdges(const QVector<QPointF> &ring)
+{
+    QVector<QLineF> edges;
+    edges.reserve(ring.size());
+
+    for (int i = 0; i < ring.size(); ++i)
+        edges.append(QLineF(ring[i], ring[(i + 1) % ring.size()]));
+
+    return edges;
+}
+
+
+/* BEGIN RingEdges */
+RingEdges::RingEdges(const QVector<QPointF> &ring)
+    : mX1(ring.size())
+    , mY1(ring.size())
+    , mX2(ring.size())
+    , mY2(ring.size())
+{
+    for (int i = 0; i < ring.size(); ++i) {
+        const QPointF &a = ring[i];
+        const QPointF &b = ring[(i + 1) % ring.size()];
+
+        mX1[i] = a.x();
+        mY1[i] = a.y();
+        mX2[i] = b.x();
+        mY2[i] = b.y();
+    }
+}
+
+Batch RingEdges::batch() const
+{
+    return {mX1.constData(), mY1.constData(), mX2.constData(), mY2.constData(), mX1.size()};
+}
+/* END RingEdges */
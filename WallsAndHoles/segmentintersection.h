@@ -0,0 +1,80 @@
+#ifndef SEGMENTINTERSECTION_H
+#define SEGMENTINTERSECTION_H
+
+#include <functional>
+
+#include <QLineF>
+#include <QVarLengthArray>
+#include <QVector>
+
+/**
+ * @brief Segment intersection tests for the polygon code.
+ *
+ * Single queries (one segment against many) go through intersectBatch(), which
+ * stores the segments as separate coordinate arrays and has no branches in its
+ * loop, so that the compiler can vectorize it. Queries between all pairs of
+ * segments sweep over x with sweepIntervals(), so that only segments whose x
+ * ranges overlap are tested.
+ */
+namespace SegmentIntersection {
+
+/// Segments stored as separate arrays of coordinates: segment i goes from (x1[i], y1[i]) to (x2[i], y2[i]).
+struct Batch {
+    const qreal *x1;
+    const qreal *y1;
+    const qreal *x2;
+    const qreal *y2;
+    int count;
+};
+
+/**
+ * @brief Sets hits[i] to whether line intersects segment i of the batch.
+ *
+ * This gives the same results as testing line.intersect(segment) for
+ * QLineF::BoundedIntersection; in particular, parallel segments never intersect.
+ */
+void intersectBatch(const QLineF &line, const Batch &batch, quint8 *hits);
+
+/**
+ * @brief Sweeps over the intervals [minX[i], maxX[i]] in order of minX.
+ *
+ * For each interval i, calls visit(i, active, numActive), where active lists the
+ * earlier intervals that overlap it. Stops as soon as visit returns true.
+ *
+ * @return Whether visit returned true.
+ */
+bool sweepIntervals(const qreal *minX, const qreal *maxX, int count,
+                    const std::function<bool(int i, const int *active, int numActive)> &visit);
+
+/**
+ * @brief Calls report(i, j) with i < j for every pair of segments that intersect,
+ * in the sense of intersectBatch(). Stops as soon as report returns true.
+ *
+ * @return Whether report returned true.
+ */
+bool findIntersections(const QVector<QLineF> &segments, const std::function<bool(int i, int j)> &report);
+
+/// Returns the edges of a ring, where edge i goes from point i to point i + 1.
+QVector<QLineF> ringEdges(const QVector<QPointF> &ring);
+
+
+/**
+ * @brief The edges of a ring, stored as a Batch. Small rings do not allocate.
+ */
+class RingEdges
+{
+public:
+    explicit RingEdges(const QVector<QPointF> &ring);
+
+    Batch batch() const;
+
+private:
+    QVarLengthArray<qreal, 32> mX1;
+    QVarLengthArray<qreal, 32> mY1;
+    QVarLengthArray<qreal, 32> mX2;
+    QVarLengthArray<qreal, 32> mY2;
+};
+
+}
+
+#endif // SEGMENTINTERSECTION_H
@@ -1,5 +1,7 @@
 #include "simpletexturedobject.h"
 
+#include "materialtable.h"
+
 SimpleTexturedObject::SimpleTexturedObject()
     : mCommitted(false)
 {
@@ -15,14 +17,9 @@ SimpleTexturedObject::~SimpleTexturedObject()
 void SimpleTexturedObject::commit()
 {
     // All of these arrays must be parallel to the vertex positions array.
-    Q_ASSERT(getNumVertices() == mReflAmbient.size());
-    Q_ASSERT(getNumVertices() == mReflDiffuse.size());
-    Q_ASSERT(getNumVertices() == mReflSpecular.size());
-    Q_ASSERT(getNumVertices() == mShininess.size());
-
-    // All of these arrays must be parallel to the triangles array.
-    Q_ASSERT(getNumTriangles() == mTriangleNormals.size());
-    Q_ASSERT(getNumTriangles() == mTriangleTextureCoordinates.size());
+    Q_ASSERT(getNumVertices() == mVertexMaterials.size());
+    Q_ASSERT(getNumVertices() == mVertexNormals.size());
+    Q_ASSERT(getNumVertices() == mVertexTextureCoordinates.size());
 
 
     mCommitted = true;
@@ -34,52 +31,43 @@ void SimpleTexturedObject::commit()
 
 void SimpleTexturedObject::setTriangleInfo(QVector<QVector3D> positions, QVector<QVector3D> normals, QVector<Triangle> triangles)
 {
-    // The normals should be specified per-face.
-    Q_ASSERT(normals.size() == triangles.size());
+    // The normals should be specified per-vertex.
+    Q_ASSERT(normals.size() == positions.size());
 
     mVertexPositions = positions;
-    mTriangleNormals = normals;
+    mVertexNormals = normals;
     mTriangles = triangles;
 
     mCommitted = false;
 }
 
-void SimpleTexturedObject::setMaterialInfo(float ambient, float diffuse, float specular, float shininess)
+void SimpleTexturedObject::setMaterialInfo(quint16 material)
 {
-    mReflAmbient = QVector<float>(getNumVertices(), ambient);
-    mReflDiffuse = QVector<float>(getNumVertices(), diffuse);
-    mReflSpecular = QVector<float>(getNumVertices(), specular);
-    mShininess = QVector<float>(getNumVertices(), shininess);
+    mVertexMaterials = QVector<quint16>(getNumVertices(), material);
 
     mCommitted = false;
 }
 
 
-void SimpleTexturedObject::setMaterialInfo(QVector<float> ambient, QVector<float> diffuse, QVector<float> specular, QVector<float> shininess)
+void SimpleTexturedObject::setMaterialInfo(QVector<quint16> materials)
 {
     // It is assumed that setTriangleInfo() has been called and that the
-    // arrays are parallel to the vertex position array.
-    Q_ASSERT(ambient.size() == getNumVertices());
-    Q_ASSERT(diffuse.size() == getNumVertices());
-    Q_ASSERT(specular.size() == getNumVertices());
-    Q_ASSERT(shininess.size() == getNumVertices());
+    // array is parallel to the vertex position array.
+    Q_ASSERT(materials.size() == getNumVertices());
 
-    mReflAmbient = ambient;
-    mReflDiffuse = diffuse;
-    mReflSpecular = specular;
-    mShininess = shininess;
+    mVertexMaterials = materials;
 
     mCommitted = false;
 }
 
 
-void SimpleTexturedObject::setTextureInfo(QVector<TriangleTexCoords> texCoords, SharedImageAndSource image)
+void SimpleTexturedObject::setTextureInfo(QVector<QVector2D> texCoords, SharedImageAndSource image)
 {
     // It is assumed that setTriangleInfo() has been called and that the
-    // texCoords array is parallel to the triangles array.
-    Q_ASSERT(texCoords.size() == getNumTriangles());
+    // texCoords array is parallel to the vertex position array.
+    Q_ASSERT(texCoords.size() == getNumVertices());
 
-    mTriangleTextureCoordinates = texCoords;
+    mVertexTextureCoordinates = texCoords;
     mImage = image;
 
     mCommitted = false;
@@ -109,10 +97,10 @@ const QVector<QVector3D> &SimpleTexturedObject::getVertices() const
     return mVertexPositions;
 }
 
-const QVector<QVector3D> &SimpleTexturedObject::getFaceNormals() const
+const QVector<QVector3D> &SimpleTexturedObject::getVertexNormals() const
 {
     Q_ASSERT(isCommitted());
-    return mTriangleNormals;
+    return mVertexNormals;
 }
 
 const QVector<SimpleTexturedObject::Triangle> &SimpleTexturedObject::getTriangles() const
@@ -121,34 +109,16 @@ const QVector<SimpleTexturedObject::Triangle> &SimpleTexturedObject::getTriangle
     return mTriangles;
 }
 
-const QVector<float> &SimpleTexturedObject::getVertexAmbient() const
-{
-    Q_ASSERT(isCommitted());
-    return mReflAmbient;
-}
-
-const QVector<float> &SimpleTexturedObject::getVertexDiffuse() const
-{
-    Q_ASSERT(isCommitted());
-    return mReflDiffuse;
-}
-
-const QVector<float> &SimpleTexturedObject::getVertexSpecular() const
-{
-    Q_ASSERT(isCommitted());
-    return mReflSpecular;
-}
-
-const QVector<float> &SimpleTexturedObject::getVertexShininess() const
+const QVector<quint16> &SimpleTexturedObject::getVertexMaterials() const
 {
     Q_ASSERT(isCommitted());
-    return mShininess;
+    return mVertexMaterials;
 }
 
-const QVector<SimpleTexturedObject::TriangleTexCoords> &SimpleTexturedObject::getFaceTexCoords() const
+const QVector<QVector2D> &SimpleTexturedObject::getVertexTexCoords() const
 {
     Q_ASSERT(isCommitted());
-    return mTriangleTextureCoordinates;
+    return mVertexTextureCoordinates;
 }
 
 const QImage &SimpleTexturedObject::getImage() const
@@ -158,21 +128,21 @@ const QImage &SimpleTexturedObject::getImage() const
     return *mImage->image();
 }
 
-float SimpleTexturedObject::getAmbient() const
+float SimpleTexturedObject::getAmbient(quint16 material) const
 {
-    return getVertexAmbient()[0];
+    return MaterialTable::global().entry(material).ambient;
 }
-float SimpleTexturedObject::getDiffuse() const
+float SimpleTexturedObject::getDiffuse(quint16 material) const
 {
-    return getVertexDiffuse()[0];
+    return MaterialTable::global().entry(material).diffuse;
 }
-float SimpleTexturedObject::getSpecular() const
+float SimpleTexturedObject::getSpecular(quint16 material) const
 {
-    return getVertexSpecular()[0];
+    return MaterialTable::global().entry(material).specular;
 }
-float SimpleTexturedObject::getShininess() const
+float SimpleTexturedObject::getShininess(quint16 material) const
 {
-    return getVertexShininess()[0];
+    return MaterialTable::global().entry(material).shininess;
 }
 
 SharedImageAndSource SimpleTexturedObject::getImageAndSource() const
@@ -180,8 +150,9 @@ SharedImageAndSource SimpleTexturedObject::getImageAndSource() const
     return mImage;
 }
 
-QString SimpleTexturedObject::getMaterialName() const
+QString SimpleTexturedObject::getMaterialName(quint16 material) const
 {
-    QString feature = QString::number(getAmbient()+getDiffuse()+getSpecular()+getShininess())+getImageAndSource()->source();
+    QString feature = QString::number(getAmbient(material)+getDiffuse(material)+getSpecular(material)+getShininess(material))
+            +getImageAndSource()->source();
     return QString(QCryptographicHash::hash(feature.toUtf8(),QCryptographicHash::Md5).toHex());
 }
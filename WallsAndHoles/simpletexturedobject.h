@@ -19,6 +19,10 @@
 /**
  * @brief The SimpleTexturedObject class represents an object with Phong lighting information
  * and a single texture.
+ *
+ * The object is an indexed triangle mesh: every attribute is stored per vertex, and
+ * vertices are shared by the triangles that use them. Instead of the Phong parameters,
+ * each vertex stores the index of its material in the MaterialTable.
  */
 class SimpleTexturedObject : public QObject
 {
@@ -27,7 +31,6 @@ class SimpleTexturedObject : public QObject
 public:
 
     using Triangle = Triplet<unsigned int, unsigned int, unsigned int>;
-    using TriangleTexCoords = Triplet<QVector2D, QVector2D, QVector2D>;
 
 
     /**
@@ -48,7 +51,7 @@ public:
     /**
      * @brief Sets up face information for the object.
      * @param positions     A list of vertex positions.
-     * @param normals       A list of face normals. Should be parallel to triangles array.
+     * @param normals       A list of vertex normals. Should be parallel to positions array.
      * @param triangles     A list of triangles. Each triangle is a triplet of indices
      *                      into the positions array.
      */
@@ -62,40 +65,32 @@ public:
      * each vertex.
      *
      * Assumes setTriangleInfo() has been called.
-     * @param ambient       The ambient parameter.
-     * @param diffuse       The diffuse parameter.
-     * @param specular      The specular parameter.
-     * @param shininess     The shininess parameter.
+     * @param material      The index of the material in the MaterialTable.
      */
-    void setMaterialInfo(float ambient, float diffuse, float specular, float shininess);
+    void setMaterialInfo(quint16 material);
 
     /**
      * @brief Sets up per-vertex materials for the object.
      *
      * Assumes setTriangleInfo() has been called.
-     * @param ambient       The ambient parameter.
-     * @param diffuse       The diffuse parameter.
-     * @param specular      The specular parameter.
-     * @param shininess     The shininess parameter.
+     * @param materials     The index of each vertex's material in the MaterialTable.
      */
-    void setMaterialInfo(QVector<float> ambient, QVector<float> diffuse, QVector<float> specular, QVector<float> shininess);
+    void setMaterialInfo(QVector<quint16> materials);
 
     /**
      * @brief Sets up texture information for the object.
      *
      * Assumes setTriangleInfo() has been called.
-     * @param texCoords     Texture coordinates for each triangle.
+     * @param texCoords     Texture coordinates for each vertex.
      * @param image         The image (texture) for the object.
      */
-    void setTextureInfo(QVector<TriangleTexCoords> texCoords, SharedImageAndSource image);
+    void setTextureInfo(QVector<QVector2D> texCoords, SharedImageAndSource image);
 
 
     bool isCommitted() const;
 
     /**
-     * @brief Returns the number of vertices in the vertex array. This may not be the same
-     * as the number of vertices when the object is rendered (it may be that the triangle
-     * array is unrolled).
+     * @brief Returns the number of vertices in the vertex array.
      * @return Equal to getVertices().size() if isCommitted() is true. In any case, equal
      * to the size of the positions array last passed to setTriangleInfo().
      */
@@ -105,22 +100,26 @@ public:
 
     /* All of the below methods assert that isCommitted() is true. */
     const QVector<QVector3D> &getVertices() const;
-    const QVector<QVector3D> &getFaceNormals() const;
+    const QVector<QVector3D> &getVertexNormals() const;
     const QVector<Triangle> &getTriangles() const;
 
-    const QVector<float> &getVertexAmbient() const;
-    const QVector<float> &getVertexDiffuse() const;
-    const QVector<float> &getVertexSpecular() const;
-    const QVector<float> &getVertexShininess() const;
+    const QVector<quint16> &getVertexMaterials() const;
 
-    const QVector<TriangleTexCoords> &getFaceTexCoords() const;
+    const QVector<QVector2D> &getVertexTexCoords() const;
     const QImage &getImage() const;
 
-    float getAmbient() const;
-    float getDiffuse() const;
-    float getSpecular() const;
-    float getShininess() const;
-    QString getMaterialName() const;
+    /* The Phong parameters of one of the vertex materials, read from the MaterialTable. */
+    float getAmbient(quint16 material) const;
+    float getDiffuse(quint16 material) const;
+    float getSpecular(quint16 material) const;
+    float getShininess(quint16 material) const;
+
+    /**
+     * @brief Returns a name for one of the vertex materials, which is the same for all
+     * objects with the same texture and Phong parameters.
+     */
+    QString getMaterialName(quint16 material) const;
+
     SharedImageAndSource getImageAndSource() const;
 
 
@@ -137,17 +136,14 @@ private:
 
     // Face information.
     QVector<QVector3D> mVertexPositions;
-    QVector<QVector3D> mTriangleNormals;                    /// This array is parallel to mTriangles.
+    QVector<QVector3D> mVertexNormals;                      /// This array is parallel to mVertexPositions.
     QVector<Triangle> mTriangles;
 
-    // Material information.
-    QVector<float> mReflAmbient;
-    QVector<float> mReflDiffuse;
-    QVector<float> mReflSpecular;
-    QVector<float> mShininess;
+    // Material information. The Phong parameters are looked up in the MaterialTable.
+    QVector<quint16> mVertexMaterials;                      /// This array is parallel to mVertexPositions.
 
     // Texture information.
-    QVector<TriangleTexCoords> mTriangleTextureCoordinates; /// This array is parallel to mTriangles.
+    QVector<QVector2D> mVertexTextureCoordinates;           /// This array is parallel to mVertexPositions.
     SharedImageAndSource mImage;
 
 
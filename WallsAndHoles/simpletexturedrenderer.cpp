@@ -6,62 +6,123 @@
 // For std::reference_wrapper
 #include <functional>
 
+#include <algorithm>
+#include <limits>
+
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QtConcurrent>
+
 #include "simpletexturedrenderer.h"
 
+#include "materialtable.h"
+#include "packedmesh.h"
+
 SimpleTexturedRenderer::SimpleTexturedRenderer(SharedSimpleTexturedScene scene)
     : mScene(scene)
+    , mNumPendingAdds(0)
+    , mUploadBudget(DefaultUploadBudget)
+    , mBufferPool(mShaderProgram)
+    , mNextMesh(0)
+    , mRenderListDirty(true)
+    , mInstanceOffsets(QOpenGLBuffer::VertexBuffer)
+    , mObjectsDrawn(0)
+    , mObjectsCulled(0)
+    , mObjectsOccluded(0)
+    , mMaterialTableVersion(-1)
 {
-
+    // Material edits only change the table, which is uploaded again when painting.
+    connect(&MaterialTable::global(), &MaterialTable::entryChanged,
+            this, &SimpleTexturedRenderer::requestUpdate);
 }
 
 SimpleTexturedRenderer::~SimpleTexturedRenderer()
 {
+    // The workers read the objects and write into the batches.
+    QMutexLocker locker(&mGLDataMutex);
+    cancelPendingUploads();
+}
+
 
+void SimpleTexturedRenderer::objectAdded(SlotHandle handle, const SimpleTexturedObject &obj)
+{
+    QMutexLocker locker(&mGLDataMutex);
+    queueObject(handle, obj);
 }
 
 
-void SimpleTexturedRenderer::objectAdded(const SimpleTexturedObject &obj)
+void SimpleTexturedRenderer::objectRemoved(SlotHandle handle, const SimpleTexturedObject &obj)
 {
-    // obj must be wrapped in a reference_wrapper because references are not
-    // otherwise copy-constructible
-    emit makeContextCurrent();
-    createObjectBuffers(obj);
-    emit doneContextCurrent();
+    Q_UNUSED(obj);
+
+    QMutexLocker locker(&mGLDataMutex);
+    queueRemoval(handle);
 }
 
 
-void SimpleTexturedRenderer::objectRemoved(const SimpleTexturedObject &obj)
+void SimpleTexturedRenderer::applyDelta(const SimpleTexturedScene::Delta &delta)
 {
     QMutexLocker locker(&mGLDataMutex);
 
-    // It is safe to use QMap::remove() even if the key might not be in the map.
-    emit makeContextCurrent();
-    mVAOs.remove(&obj);
-    mObjectVertexPositions.remove(&obj);
-    mObjectVertexNormals.remove(&obj);
-    mObjectVertexMaterials.remove(&obj);
-    mObjectVertexTexCoords.remove(&obj);
-    mNumVertices.remove(&obj);
+    const SlotMap<QSharedPointer<SimpleTexturedObject>> &objects = mScene->objects();
 
-    // If the object's image has an associated texture, remove the object
-    // from the texture's set.
-    if (mImagesToTextures.contains(&obj.getImage())) {
-        QSharedPointer<QOpenGLTexture> texturePtr = mImagesToTextures[&obj.getImage()];
+    for (const PendingChange &change : orderDelta(delta)) {
+        if (change.removal)
+            queueRemoval(change.handle);
+        else
+            queueObject(change.handle, *objects[change.handle]);
+    }
+}
+
+QVector<SimpleTexturedRenderer::PendingChange> SimpleTexturedRenderer::orderDelta(const SimpleTexturedScene::Delta &delta)
+{
+    QVector<PendingChange> changes;
+    changes.reserve(delta.added.size() + delta.removed.size());
+
+    // Each slot holds one object at a time, so a slot is in at most one removed handle.
+    QHash<int, SlotHandle> removedBySlot;
+    for (SlotHandle handle : delta.removed)
+        removedBySlot.insert(handle.index, handle);
+
+    // The uploaded object and the queued addition of a slot must be gone before the
+    // slot's next object is queued.
+    for (SlotHandle handle : delta.added) {
+        auto removed = removedBySlot.find(handle.index);
+        if (removed != removedBySlot.end()) {
+            changes.append({removed.value(), true});
+            removedBySlot.erase(removed);
+        }
 
-        auto &textureUsageSet = mTexturesToObjects[texturePtr.data()];
+        changes.append({handle, false});
+    }
 
-        textureUsageSet.remove(&obj);
+    for (SlotHandle handle : delta.removed) {
+        if (removedBySlot.contains(handle.index))
+            changes.append({handle, true});
+    }
 
-        // If the texture has no users, unload it.
-        if (textureUsageSet.size() <= 0) {
-            texturePtr->destroy();
+    return changes;
+}
 
-            mTexturesToObjects.remove(texturePtr.data());
-            mImagesToTextures.remove(&obj.getImage());
-        }
+void SimpleTexturedRenderer::queueRemoval(SlotHandle handle)
+{
+    // An object that was never uploaded only has to be kept from being uploaded.
+    if (handle.index < mPendingAdds.size() && mPendingAdds[handle.index].generation == handle.generation) {
+        PendingAdd &pending = mPendingAdds[handle.index];
+        PackingBatch &batch = *pending.batch;
+
+        // The worker may be reading the object, which is about to be destroyed.
+        if (batch.started)
+            batch.future.waitForFinished();
+
+        batch.objects[pending.index] = nullptr;
+        pending = PendingAdd();
+        mNumPendingAdds -= 1;
+        return;
     }
 
-    emit doneContextCurrent();
+    if (handle.index < mUploadedObjects.size() && mUploadedObjects[handle.index].generation == handle.generation)
+        mPendingChanges.append({handle, true});
 }
 
 
@@ -69,13 +130,14 @@ void SimpleTexturedRenderer::clearAll()
 {
     QMutexLocker locker(&mGLDataMutex);
 
+    // The scene keeps its objects alive until this returns.
+    cancelPendingUploads();
+    mPendingChanges.clear();
+
     emit makeContextCurrent();
-    mVAOs.clear();
-    mObjectVertexPositions.clear();
-    mObjectVertexNormals.clear();
-    mObjectVertexMaterials.clear();
-    mObjectVertexTexCoords.clear();
-    mNumVertices.clear();
+    mBufferPool.destroy();
+    mInstanceOffsets.destroy();
+    clearMeshes();
 
 
     // destroy() the textures on the OpenGL thread.
@@ -83,9 +145,12 @@ void SimpleTexturedRenderer::clearAll()
     for (const auto &texture : allTextures)
         texture->destroy();
 
-    mTexturesToObjects.clear();
     mImagesToTextures.clear();
 
+    if (mMaterialTable)
+        mMaterialTable->destroy();
+    mMaterialTable = nullptr;
+
     emit doneContextCurrent();
 }
 
@@ -93,15 +158,16 @@ void SimpleTexturedRenderer::cleanUp()
 {
     QMutexLocker locker(&mGLDataMutex);
 
-    mVAOs.clear();
-    mObjectVertexPositions.clear();
-    mObjectVertexNormals.clear();
-    mObjectVertexMaterials.clear();
-    mObjectVertexTexCoords.clear();
-    mNumVertices.clear();
+    mBufferPool.destroy();
+    mInstanceOffsets.destroy();
+    clearMeshes();
 
     mShaderProgram.destroy();
 
+    if (mMaterialTable)
+        mMaterialTable->destroy();
+    mMaterialTable = nullptr;
+
     // Unlock the data mutex because the clearAllTextures() function uses it.
     locker.unlock();
 
@@ -109,6 +175,39 @@ void SimpleTexturedRenderer::cleanUp()
 }
 
 
+GpuBufferPool::Stats SimpleTexturedRenderer::bufferPoolStats() const
+{
+    QMutexLocker locker(&mGLDataMutex);
+
+    return mBufferPool.stats();
+}
+
+QString SimpleTexturedRenderer::overlayText() const
+{
+    QMutexLocker locker(&mGLDataMutex);
+
+    QString text = tr("%1 objects drawn, %2 outside the view, %3 occluded")
+            .arg(mObjectsDrawn).arg(mObjectsCulled).arg(mObjectsOccluded);
+
+    if (mNumPendingAdds > 0)
+        text += tr(", %1 waiting to upload").arg(mNumPendingAdds);
+
+    return text;
+}
+
+void SimpleTexturedRenderer::setUploadBudget(qint64 nsecs)
+{
+    mUploadBudget = nsecs;
+}
+
+int SimpleTexturedRenderer::pendingUploads() const
+{
+    QMutexLocker locker(&mGLDataMutex);
+
+    return mNumPendingAdds;
+}
+
+
 void SimpleTexturedRenderer::paint(QMatrix4x4 mvpMatrix, QVector3D camPos)
 {
     QMutexLocker locker(&mGLDataMutex);
@@ -131,37 +230,42 @@ void SimpleTexturedRenderer::paint(QMatrix4x4 mvpMatrix, QVector3D camPos)
     mShaderProgram.setUniformSourceDiffuseColor(QVector3D(0.3, 0.3, 0.2));
     mShaderProgram.setUniformSourceSpecularColor(QVector3D(0.3, 0.3, 0.2));
 
-    // Draw objects by texture group.
-    foreach (const QImage *img, mImagesToTextures.keys()) {
-        QSharedPointer<QOpenGLTexture> texture = mImagesToTextures[img];
+    // Set the material table.
+    updateMaterialTable();
+    mShaderProgram.bindUniformMaterials(*mMaterialTable);
 
-        const auto &objectsUsingTexture = mTexturesToObjects[texture.data()];
+    uploadPendingChanges();
 
-        // Bind texture.
-        mShaderProgram.bindUniformTexture(*texture);
+    if (mRenderListDirty)
+        buildRenderList();
 
+    // Only instanced draws enable the offset array.
+    mShaderProgram.setAttrOffsetValue(QVector3D());
 
-        // Draw all objects that are using this texture.
-        foreach (const SimpleTexturedObject *obj, objectsUsingTexture) {
-            Q_ASSERT(mVAOs.contains(obj));
-            Q_ASSERT(mNumVertices.contains(obj));
+    // The scene's occluders may belong to objects that are not uploaded yet, while
+    // the old occluders belong to objects that are still drawn. Since they are
+    // shared with the scene, setting them is cheap.
+    if (mPendingChanges.isEmpty())
+        mOcclusionCuller.setOccluders(mScene->occluders());
+    mOcclusionCuller.render(mvpMatrix, camPos);
 
-            auto vao = mVAOs[obj];
-            int numVertices = mNumVertices[obj];
+    // Draw the visible objects by texture group.
+    for (const VisibleBatch &visible : cullRenderList(ViewFrustum(mvpMatrix), camPos)) {
+        mShaderProgram.bindUniformTexture(*visible.batch->texture);
 
-            vao->bind();
+        for (const GpuBufferPool::DrawList &list : visible.lists)
+            mBufferPool.draw(list);
 
-            mShaderProgram.enableArrays();
-            glDrawArrays(GL_TRIANGLES, 0, numVertices);
-            mShaderProgram.disableArrays();
+        for (const TextureBatch::Instances &instances : visible.instances)
+            mBufferPool.drawInstanced(instances.allocation, mInstanceOffsets,
+                                      instances.firstInstance, instances.numInstances);
 
-            vao->release();
-        }
+        mShaderProgram.releaseUniformTexture(*visible.batch->texture);
+    }
 
+    mBufferPool.releaseVertexArrays();
 
-        // Release texture.
-        mShaderProgram.releaseUniformTexture(*texture);
-    }
+    mShaderProgram.releaseUniformMaterials(*mMaterialTable);
 
     // Unset program.
     mShaderProgram.release();
@@ -171,6 +275,17 @@ void SimpleTexturedRenderer::paint(QMatrix4x4 mvpMatrix, QVector3D camPos)
     glDisable(GL_DEPTH_TEST);
 
 
+    // Compaction is spread over several frames so that no frame stalls.
+    bool compacting = mBufferPool.compact(CompactionBytesPerFrame);
+    mBufferPool.endFrame();
+
+    if (mBufferPool.stats().movesLastFrame > 0)
+        mRenderListDirty = true;
+
+    if (compacting)
+        requestUpdate();
+
+
     locker.unlock();
 
     // For good measure! This will print errors to qDebug() if there are any.
@@ -187,6 +302,15 @@ void SimpleTexturedRenderer::initializeRenderer()
     // This will create a new shader program and destroy the old one (if any).
     mShaderProgram.create();
 
+    // Any previous buffers belonged to the old context. Queued objects are queued
+    // again by createSceneBuffers().
+    {
+        QMutexLocker locker(&mGLDataMutex);
+        mBufferPool.create();
+        clearMeshes();
+        cancelPendingUploads();
+    }
+
     // TODO: This needs to happen on the original GL context.
 //    clearAllTextures();
 
@@ -198,161 +322,412 @@ void SimpleTexturedRenderer::initializeRenderer()
 
 void SimpleTexturedRenderer::createSceneBuffers()
 {
-    for (const SimpleTexturedObject &obj : *mScene)
-        createObjectBuffers(obj);
+    QMutexLocker locker(&mGLDataMutex);
+
+    const SlotMap<QSharedPointer<SimpleTexturedObject>> &objects = mScene->objects();
+    for (int i = 0; i < objects.size(); ++i)
+        queueObject(objects.handleAt(i), *objects.valueAt(i));
 }
 
-void SimpleTexturedRenderer::createObjectBuffers(const SimpleTexturedObject &obj)
+void SimpleTexturedRenderer::createObjectBuffers(SlotHandle handle, const SimpleTexturedObject &obj, const PackedMesh &mesh)
 {
+    if (mUploadedObjects.size() <= handle.index)
+        mUploadedObjects.resize(handle.index + 1);
 
-    QVector<GLfloat> vertices;
-    QVector<GLfloat> normals;
-    QVector<GLfloat> materials;
-    QVector<GLfloat> texCoords;
+    // Changes are applied in order, so the slot's previous object is already removed.
+    UploadedObject &uploaded = mUploadedObjects[handle.index];
+    Q_ASSERT(uploaded.generation == 0);
 
-    // Aggregate information into arrays that will be uploaded to OpenGL buffers.
-    // Triangles will be unpacked.
+    uploaded.generation = handle.generation;
+    uploaded.image = &obj.getImage();
 
-    const auto &objVertices = obj.getVertices();
-    const auto &objFaceNormals = obj.getFaceNormals();
-    const auto &objTriangles = obj.getTriangles();
-    const auto &objAmbient = obj.getVertexAmbient();
-    const auto &objDiffuse = obj.getVertexDiffuse();
-    const auto &objSpecular = obj.getVertexSpecular();
-    const auto &objShininess = obj.getVertexShininess();
-    const auto &objFaceTexCoords = obj.getFaceTexCoords();
+    // The buffer pool stores all objects' vertices and indices, so adding an object
+    // usually only writes into existing buffers, if anything.
+    addObjectMesh(uploaded, handle.index, mesh);
 
-    for (int triangleIdx = 0; triangleIdx < obj.getNumTriangles(); ++triangleIdx) {
 
-        auto triangle = objTriangles[triangleIdx];
+    // If the image associated to the object has not yet been created, create it.
+    if (!mImagesToTextures.contains(uploaded.image)) {
+        QSharedPointer<QOpenGLTexture> newTexture = QSharedPointer<QOpenGLTexture>::create(obj.getImage().mirrored());
+        newTexture->setWrapMode(QOpenGLTexture::Repeat);
 
-        int vIdx1 = triangle.getFirst();
-        int vIdx2 = triangle.getSecond();
-        int vIdx3 = triangle.getThird();
+        mImagesToTextures.insert(uploaded.image, newTexture);
+    }
 
-        QVector3D v1 = objVertices[vIdx1];
-        QVector3D v2 = objVertices[vIdx2];
-        QVector3D v3 = objVertices[vIdx3];
+    // Record that the object uses the texture.
+    mImageUsers[uploaded.image] += 1;
+}
 
-        auto triangleTexCoords = objFaceTexCoords[triangleIdx];
-        QVector2D t1 = triangleTexCoords.getFirst();
-        QVector2D t2 = triangleTexCoords.getSecond();
-        QVector2D t3 = triangleTexCoords.getThird();
+void SimpleTexturedRenderer::removeObjectBuffers(SlotHandle handle)
+{
+    if (handle.index >= mUploadedObjects.size() || mUploadedObjects[handle.index].generation != handle.generation)
+        return;
 
-        QVector3D normal = objFaceNormals[triangleIdx];
+    UploadedObject &uploaded = mUploadedObjects[handle.index];
+    removeObjectMesh(uploaded, handle.index);
+
+    // If the texture has no users, unload it.
+    auto users = mImageUsers.find(uploaded.image);
+    if (users != mImageUsers.end() && --*users <= 0) {
+        mImageUsers.erase(users);
+
+        QSharedPointer<QOpenGLTexture> texture = mImagesToTextures.take(uploaded.image);
+        if (texture)
+            texture->destroy();
+    }
+
+    uploaded = UploadedObject();
+}
+
+
+/* BEGIN upload queue */
+void SimpleTexturedRenderer::queueObject(SlotHandle handle, const SimpleTexturedObject &obj)
+{
+    if (!mOpenBatch) {
+        mOpenBatch = QSharedPointer<PackingBatch>::create();
+        mOpenBatch->started = false;
+
+        // Objects added in the same event, such as a whole remesh, share batches.
+        QTimer::singleShot(0, this, [this] () {
+            QMutexLocker locker(&mGLDataMutex);
+            startPacking();
+        });
+    }
 
-        for (QVector3D v : {v1, v2, v3}) {
-            vertices.append(v[0]);
-            vertices.append(v[1]);
-            vertices.append(v[2]);
+    int index = mOpenBatch->objects.size();
+    mOpenBatch->objects.append(&obj);
+
+    if (mPendingAdds.size() <= handle.index)
+        mPendingAdds.resize(handle.index + 1);
+
+    Q_ASSERT(mPendingAdds[handle.index].generation == 0);
+
+    mPendingAdds[handle.index] = {handle.generation, mOpenBatch, index};
+    mNumPendingAdds += 1;
+
+    mPendingChanges.append({handle, false});
+
+    if (mOpenBatch->objects.size() >= PackingBatchSize)
+        startPacking();
+}
+
+void SimpleTexturedRenderer::startPacking()
+{
+    if (!mOpenBatch)
+        return;
+
+    QSharedPointer<PackingBatch> batch = mOpenBatch;
+    mOpenBatch.reset();
+
+    batch->meshes.resize(batch->objects.size());
+    batch->started = true;
+
+    // Only the worker touches the meshes until it finishes, and removing one of the
+    // objects waits for it, so the batch needs no lock.
+    PackingBatch *data = batch.data();
+    batch->future = QtConcurrent::run([data] () {
+        for (int i = 0; i < data->objects.size(); ++i) {
+            if (data->objects[i])
+                data->meshes[i] = PackedMesh::pack(*data->objects[i]);
         }
+    });
+
+    connect(&batch->watcher, &QFutureWatcherBase::finished, this, &SimpleTexturedRenderer::requestUpdate);
+    batch->watcher.setFuture(batch->future);
+}
 
-        for (QVector2D t : {t1, t2, t3}) {
-            texCoords.append(t[0]);
-            texCoords.append(t[1]);
+void SimpleTexturedRenderer::uploadPendingChanges()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    bool first = true;
+    while (!mPendingChanges.isEmpty() && (first || timer.nsecsElapsed() < mUploadBudget)) {
+        SlotHandle handle = mPendingChanges.first().handle;
+
+        if (mPendingChanges.first().removal) {
+            removeObjectBuffers(handle);
+        } else if (mPendingAdds.value(handle.index).generation == handle.generation) {
+            PendingAdd &pending = mPendingAdds[handle.index];
+            PackingBatch &batch = *pending.batch;
+
+            // Changes are applied in order, so that an edit never shows half done.
+            // The batch's watcher requests another frame when the worker finishes.
+            if (!batch.started || !batch.future.isFinished())
+                return;
+
+            createObjectBuffers(handle, *batch.objects[pending.index], batch.meshes[pending.index]);
+
+            // The staged copy is no longer needed.
+            batch.meshes[pending.index] = PackedMesh();
+
+            pending = PendingAdd();
+            mNumPendingAdds -= 1;
         }
 
-        // Same normal for each vertex in one face.
-        for (int i = 0; i < 3; ++i)
-            normals.append({normal[0], normal[1], normal[2]});
+        mPendingChanges.removeFirst();
+        first = false;
+    }
+
+    // Continue in the next frame.
+    if (!mPendingChanges.isEmpty())
+        requestUpdate();
+}
+
+void SimpleTexturedRenderer::cancelPendingUploads()
+{
+    mOpenBatch.reset();
+
+    for (const PendingAdd &pending : mPendingAdds) {
+        if (pending.batch && pending.batch->started)
+            pending.batch->future.waitForFinished();
+    }
 
+    QList<PendingChange> removals;
+    for (const PendingChange &change : mPendingChanges) {
+        if (change.removal)
+            removals.append(change);
+    }
+
+    mPendingChanges = removals;
+    mPendingAdds.clear();
+    mNumPendingAdds = 0;
+}
+/* END upload queue */
 
 
+void SimpleTexturedRenderer::addObjectMesh(UploadedObject &uploaded, int slot, const PackedMesh &mesh)
+{
+    // The digests were computed by the workers, so no vertices are compared here.
+    for (int id : mMeshesByShape.values(mesh.shapeDigest)) {
+        PooledMesh &pooled = mMeshes[id];
+
+        if (pooled.image != uploaded.image)
+            continue;
+
+        pooled.users.insert(slot);
+        uploaded.mesh = id;
+        uploaded.offset = mesh.origin() - pooled.origin;
+        mRenderListDirty = true;
+        return;
+    }
+
+    PooledMesh pooled;
+    pooled.allocation = mBufferPool.allocate(mesh);
+    pooled.origin = mesh.origin();
+    pooled.bounds = mesh.bounds;
+    pooled.shapeDigest = mesh.shapeDigest;
+    pooled.image = uploaded.image;
+    pooled.users.insert(slot);
+
+    int id = mNextMesh++;
+    mMeshes.insert(id, pooled);
+    mMeshesByShape.insert(mesh.shapeDigest, id);
+    uploaded.mesh = id;
+    uploaded.offset = QVector3D();
+    mRenderListDirty = true;
+}
+
+void SimpleTexturedRenderer::removeObjectMesh(UploadedObject &uploaded, int slot)
+{
+    int id = uploaded.mesh;
+
+    PooledMesh &pooled = mMeshes[id];
+    pooled.users.remove(slot);
+
+    if (pooled.users.isEmpty()) {
+        mBufferPool.free(pooled.allocation);
+        mMeshesByShape.remove(pooled.shapeDigest, id);
+        mMeshes.remove(id);
+    }
+
+    mRenderListDirty = true;
+}
 
-        for (int vIdx : {vIdx1, vIdx2, vIdx3}) {
-            materials.append(objAmbient[vIdx]);
-            materials.append(objDiffuse[vIdx]);
-            materials.append(objSpecular[vIdx]);
-            materials.append(objShininess[vIdx]);
+void SimpleTexturedRenderer::clearMeshes()
+{
+    mMeshes.clear();
+    mMeshesByShape.clear();
+    mUploadedObjects.clear();
+    mImageUsers.clear();
+
+    mRenderList.clear();
+    mRenderListDirty = true;
+}
+
+void SimpleTexturedRenderer::buildRenderList()
+{
+    mRenderList.clear();
+    mInstanceOffsetData.clear();
+
+    // The batch of each texture, and the offsets of the users of shared meshes in each batch.
+    QHash<const QImage *, int> batchIndices;
+    QVector<QHash<int, QVector<QVector3D>>> instances;
+
+    for (int slot = 0; slot < mUploadedObjects.size(); ++slot) {
+        const UploadedObject &uploaded = mUploadedObjects[slot];
+        if (uploaded.generation == 0)
+            continue;
+
+        int batchIndex = batchIndices.value(uploaded.image, -1);
+        if (batchIndex < 0) {
+            batchIndex = mRenderList.size();
+            batchIndices.insert(uploaded.image, batchIndex);
+
+            TextureBatch batch;
+            batch.texture = mImagesToTextures.value(uploaded.image);
+            mRenderList.append(batch);
+            instances.append(QHash<int, QVector<QVector3D>>());
         }
+
+        TextureBatch &batch = mRenderList[batchIndex];
+        const PooledMesh &pooled = mMeshes[uploaded.mesh];
+
+        if (pooled.users.size() > 1) {
+            instances[batchIndex][uploaded.mesh].append(uploaded.offset);
+            continue;
+        }
+
+        // There are only a few pages, so a linear search is fine.
+        const GpuBufferPool::Range &range = mBufferPool.range(pooled.allocation);
+
+        int page = 0;
+        while (page < batch.pages.size()
+               && (batch.pages[page].list.page != range.page || batch.pages[page].list.indexType != range.indexType))
+            ++page;
+
+        if (page == batch.pages.size())
+            batch.pages.append({mBufferPool.makeDrawList(pooled.allocation), {}});
+
+        mBufferPool.appendToDrawList(batch.pages[page].list, pooled.allocation);
+        batch.pages[page].bounds.append(pooled.bounds);
     }
 
+    for (int batchIndex = 0; batchIndex < mRenderList.size(); ++batchIndex) {
+        TextureBatch &batch = mRenderList[batchIndex];
+        const QHash<int, QVector<QVector3D>> &batchInstances = instances[batchIndex];
 
+        for (auto instance = batchInstances.cbegin(); instance != batchInstances.cend(); ++instance) {
+            const PooledMesh &pooled = mMeshes[instance.key()];
 
-    auto vertexPositions = QSharedPointer<QOpenGLBuffer>::create(QOpenGLBuffer::VertexBuffer);
-    vertexPositions->create();
-    vertexPositions->bind();
-    vertexPositions->setUsagePattern(QOpenGLBuffer::DynamicDraw); // may be updated in real-time in the future
-    vertexPositions->allocate(vertices.data(), vertices.size() * sizeof(GLfloat));
-    vertexPositions->release();
+            TextureBatch::Instances draw;
+            draw.allocation = pooled.allocation;
+            draw.bounds = pooled.bounds;
+            draw.firstInstance = mInstanceOffsetData.size();
+            draw.numInstances = instance.value().size();
 
-    auto vertexNormals = QSharedPointer<QOpenGLBuffer>::create(QOpenGLBuffer::VertexBuffer);
-    vertexNormals->create();
-    vertexNormals->bind();
-    vertexNormals->setUsagePattern(QOpenGLBuffer::DynamicDraw);
-    vertexNormals->allocate(normals.data(), normals.size() * sizeof(GLfloat));
-    vertexNormals->release();
+            mInstanceOffsetData += instance.value();
 
-    auto vertexMaterials = QSharedPointer<QOpenGLBuffer>::create(QOpenGLBuffer::VertexBuffer);
-    vertexMaterials->create();
-    vertexMaterials->bind();
-    vertexMaterials->setUsagePattern(QOpenGLBuffer::DynamicDraw);
-    vertexMaterials->allocate(materials.data(), materials.size() * sizeof(GLfloat));
-    vertexMaterials->release();
+            batch.instances.append(draw);
+        }
+    }
 
-    auto vertexTexCoords = QSharedPointer<QOpenGLBuffer>::create(QOpenGLBuffer::VertexBuffer);
-    vertexTexCoords->create();
-    vertexTexCoords->bind();
-    vertexTexCoords->setUsagePattern(QOpenGLBuffer::DynamicDraw);
-    vertexTexCoords->allocate(texCoords.data(), texCoords.size() * sizeof(GLfloat));
-    vertexTexCoords->release();
+    Q_STATIC_ASSERT(sizeof(QVector3D) == 3 * sizeof(GLfloat));
 
+    if (!mInstanceOffsets.isCreated())
+        mInstanceOffsets.create();
 
-    auto vao = QSharedPointer<QOpenGLVertexArrayObject>::create(nullptr);
-    vao->create();
-    vao->bind();
+    mInstanceOffsets.bind();
+    mInstanceOffsets.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    mInstanceOffsets.allocate(mInstanceOffsetData.constData(), mInstanceOffsetData.size() * sizeof(QVector3D));
+    mInstanceOffsets.release();
 
-    vertexPositions->bind();
-    mShaderProgram.setAttrPositionBuffer();
-    vertexPositions->release();
+    mRenderListDirty = false;
+}
 
-    vertexNormals->bind();
-    mShaderProgram.setAttrNormalBuffer();
-    vertexNormals->release();
+QVector<SimpleTexturedRenderer::VisibleBatch> SimpleTexturedRenderer::cullRenderList(const ViewFrustum &frustum,
+                                                                                     QVector3D camPos)
+{
+    QVector<VisibleBatch> visibleBatches;
 
-    vertexTexCoords->bind();
-    mShaderProgram.setAttrTexCoordsBuffer();
-    vertexTexCoords->release();
+    mObjectsDrawn = 0;
+    mObjectsCulled = 0;
+    mObjectsOccluded = 0;
 
-    vertexMaterials->bind();
-    mShaderProgram.setAttrReflAmbientBuffer(0 * sizeof(GLfloat), 4 * sizeof(GLfloat));
-    mShaderProgram.setAttrReflDiffuseBuffer(1 * sizeof(GLfloat), 4 * sizeof(GLfloat));
-    mShaderProgram.setAttrReflSpecularBuffer(2 * sizeof(GLfloat), 4 * sizeof(GLfloat));
-    mShaderProgram.setAttrShininessBuffer(3 * sizeof(GLfloat), 4 * sizeof(GLfloat));
-    vertexMaterials->release();
+    // The visible entries of a page and their distances.
+    QVector<QPair<float, int>> order;
 
+    for (const TextureBatch &batch : mRenderList) {
+        VisibleBatch visible;
+        visible.batch = &batch;
+        visible.distance = std::numeric_limits<float>::infinity();
 
-    vao->release();
+        for (const TextureBatch::Page &page : batch.pages) {
+            order.resize(0);
 
+            for (int i = 0; i < page.bounds.size(); ++i) {
+                if (!frustum.intersects(page.bounds[i]))
+                    mObjectsCulled += 1;
+                else if (mOcclusionCuller.isOccluded(page.bounds[i]))
+                    mObjectsOccluded += 1;
+                else
+                    order.append(qMakePair(page.bounds[i].distanceTo(camPos), i));
+            }
 
-    QMutexLocker locker(&mGLDataMutex);
+            mObjectsDrawn += order.size();
 
-    mVAOs[&obj] = vao;
-    mObjectVertexPositions[&obj] = vertexPositions;
-    mObjectVertexNormals[&obj] = vertexNormals;
-    mObjectVertexTexCoords[&obj] = vertexTexCoords;
-    mObjectVertexMaterials[&obj] = vertexMaterials;
-    mNumVertices[&obj] = vertices.size() / 3;
+            if (order.isEmpty())
+                continue;
 
+            // Nearer objects hide farther ones, which then fail the depth test early.
+            std::sort(order.begin(), order.end());
+            visible.distance = qMin(visible.distance, order.first().first);
 
-    // This will point to the OpenGL texture object that contains the object's texture.
-    const QOpenGLTexture *associatedTexture;
+            GpuBufferPool::DrawList list = page.list;
+            list.counts.resize(0);
+            list.indexOffsets.resize(0);
+            list.baseVertices.resize(0);
 
-    // If the image associated to the object has not yet been created, create it.
-    if (!mImagesToTextures.contains(&obj.getImage())) {
-        QSharedPointer<QOpenGLTexture> newTexture = QSharedPointer<QOpenGLTexture>::create(obj.getImage().mirrored());
-        newTexture->setWrapMode(QOpenGLTexture::Repeat);
+            for (const QPair<float, int> &entry : order)
+                list.appendFrom(page.list, entry.second);
 
-        mImagesToTextures.insert(&obj.getImage(), newTexture);
-        mTexturesToObjects.insert(newTexture.data(), QSet<const SimpleTexturedObject *>());
+            visible.lists.append(list);
+        }
 
-        associatedTexture = newTexture.data();
-    } else {
-        associatedTexture = mImagesToTextures[&obj.getImage()].data();
+        // Consecutive visible instances are drawn together.
+        for (const TextureBatch::Instances &instances : batch.instances) {
+            TextureBatch::Instances run = instances;
+            run.numInstances = 0;
+
+            for (int i = instances.firstInstance; i < instances.firstInstance + instances.numInstances; ++i) {
+                BoundingBox bounds = instances.bounds.translated(mInstanceOffsetData[i]);
+
+                bool inside = frustum.intersects(bounds);
+
+                if (inside && !mOcclusionCuller.isOccluded(bounds)) {
+                    if (run.numInstances == 0)
+                        run.firstInstance = i;
+                    run.numInstances += 1;
+
+                    visible.distance = qMin(visible.distance, bounds.distanceTo(camPos));
+                    mObjectsDrawn += 1;
+                } else {
+                    if (run.numInstances > 0)
+                        visible.instances.append(run);
+                    run.numInstances = 0;
+
+                    if (inside)
+                        mObjectsOccluded += 1;
+                    else
+                        mObjectsCulled += 1;
+                }
+            }
+
+            if (run.numInstances > 0)
+                visible.instances.append(run);
+        }
+
+        if (!visible.lists.isEmpty() || !visible.instances.isEmpty())
+            visibleBatches.append(visible);
     }
 
-    // Record that the object uses the texture.
-    mTexturesToObjects[associatedTexture].insert(&obj);
+    // Texture changes are more expensive than overdraw, so objects are only sorted
+    // within their batch and the batches by their nearest object.
+    std::sort(visibleBatches.begin(), visibleBatches.end(), [] (const VisibleBatch &a, const VisibleBatch &b) {
+        return a.distance < b.distance;
+    });
+
+    return visibleBatches;
 }
 
 
@@ -360,10 +735,45 @@ void SimpleTexturedRenderer::clearAllTextures()
 {
     QMutexLocker locker(&mGLDataMutex);
 
-    mTexturesToObjects.clear();
+    mImageUsers.clear();
+    mRenderListDirty = true;
 
     foreach (QSharedPointer<QOpenGLTexture> texture, mImagesToTextures.values())
         texture->destroy();
 
     mImagesToTextures.clear();
 }
+
+
+void SimpleTexturedRenderer::updateMaterialTable()
+{
+    MaterialTable &table = MaterialTable::global();
+
+    if (mMaterialTable && table.version() == mMaterialTableVersion)
+        return;
+
+    Q_STATIC_ASSERT(sizeof(MaterialTable::Entry) == 4 * sizeof(GLfloat));
+
+    QVector<MaterialTable::Entry> entries = table.entries(&mMaterialTableVersion);
+
+    // The texture is only remade when the table outgrows it.
+    if (!mMaterialTable || mMaterialTable->width() < entries.size()) {
+        int width = mMaterialTable ? 2 * mMaterialTable->width() : 64;
+        while (width < entries.size())
+            width *= 2;
+
+        if (mMaterialTable)
+            mMaterialTable->destroy();
+
+        mMaterialTable = QSharedPointer<QOpenGLTexture>::create(QOpenGLTexture::Target1D);
+        mMaterialTable->setFormat(QOpenGLTexture::RGBA32F);
+        mMaterialTable->setSize(width);
+        mMaterialTable->setMipLevels(1);
+        mMaterialTable->setMinMagFilters(QOpenGLTexture::Nearest, QOpenGLTexture::Nearest);
+        mMaterialTable->allocateStorage(QOpenGLTexture::RGBA, QOpenGLTexture::Float32);
+    }
+
+    // Unused texels are uploaded too, since setData() fills the whole texture.
+    entries.resize(mMaterialTable->width());
+    mMaterialTable->setData(QOpenGLTexture::RGBA, QOpenGLTexture::Float32, entries.constData());
+}
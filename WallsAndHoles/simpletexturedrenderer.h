@@ -3,12 +3,18 @@
 
 #include <QSharedPointer>
 #include <QMatrix4x4>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QList>
 #include <QMap>
-
-#include <QOpenGLBuffer>
-#include <QOpenGLVertexArrayObject>
+#include <QSet>
 
 #include "abstractrenderer.h"
+#include "gpubufferpool.h"
+#include "occlusionculler.h"
+#include "packedmesh.h"
+#include "viewfrustum.h"
 
 #include "simpletexturedshader.h"
 #include "simpletexturedscene.h"
@@ -34,18 +40,33 @@ public:
 public slots:
     /**
      * @brief This slot should be called whenever the underlying scene has a new object.
-     * @param obj   The new object.
+     * The object is packed on a worker thread and uploaded by a later paint().
+     * Locks the mGLDataMutex.
+     *
+     * @param handle    The object's handle in the scene.
+     * @param obj       The new object.
      */
-    void objectAdded(const SimpleTexturedObject &obj);
+    void objectAdded(SlotHandle handle, const SimpleTexturedObject &obj);
 
 
     /**
      * @brief This slot should be called whenever an object is removed from the underlying scene.
-     * Locks the mGLDataMutex.
+     * The object is drawn until the changes queued before it are uploaded. Locks the mGLDataMutex.
+     *
+     * @param handle    The object's handle in the scene.
+     * @param obj       The object that is already removed or will be removed. It must
+     *                  stay alive until this returns.
+     */
+    void objectRemoved(SlotHandle handle, const SimpleTexturedObject &obj);
+
+
+    /**
+     * @brief This slot should be called when the underlying scene commits a transaction.
+     * Queues all of its changes at once. Locks the mGLDataMutex.
      *
-     * @param obj   The object that is already removed or will be removed.
+     * @param delta     The changes, whose removed objects must stay alive until this returns.
      */
-    void objectRemoved(const SimpleTexturedObject &obj);
+    void applyDelta(const SimpleTexturedScene::Delta &delta);
 
 
     /**
@@ -62,6 +83,46 @@ public slots:
     void cleanUp() override;
 
 
+    /**
+     * @brief Returns the memory use of the object buffers, and the number of buffer
+     * allocations in the last frame. Locks the mGLDataMutex.
+     */
+    GpuBufferPool::Stats bufferPoolStats() const;
+
+
+    /// Shows how many objects were drawn and culled in the last frame.
+    QString overlayText() const override;
+
+
+    /**
+     * @brief Sets roughly how long each paint() may spend uploading new objects.
+     * At least one queued change is applied per frame.
+     */
+    void setUploadBudget(qint64 nsecs);
+
+    qint64 uploadBudget() const { return mUploadBudget; }
+
+    /// The number of added objects that are not uploaded yet. Locks the mGLDataMutex.
+    int pendingUploads() const;
+
+    static const qint64 DefaultUploadBudget = 4000000;
+
+
+    /// A change to the uploaded objects. Changes are applied in the order of the scene's signals.
+    struct PendingChange {
+        SlotHandle handle;
+        bool removal;
+    };
+
+    /**
+     * @brief Returns the order in which applyDelta() queues the changes of a delta.
+     * Additions come before removals, so that the removed objects are drawn until the
+     * new ones are uploaded. The exception is an added object that reuses the slot of
+     * a removed one, which is only added after that removal.
+     */
+    static QVector<PendingChange> orderDelta(const SimpleTexturedScene::Delta &delta);
+
+
 protected:
 
     void initializeRenderer() override;
@@ -69,25 +130,75 @@ protected:
 
 private:
 
+    /// An object whose mesh and texture are uploaded.
+    struct UploadedObject {
+        /// The generation of the object's handle, or 0 if the slot has no uploaded object.
+        quint32 generation;
+
+        /// The object's image, which is only used as a key, since the object may be gone.
+        const QImage *image;
+
+        /// The id of the object's mesh in mMeshes.
+        int mesh;
+
+        /// The translation from the pooled mesh to the object.
+        QVector3D offset;
+    };
+
+
     /**
-     * @brief Creates vertex arrays and buffers for each object in current scene.
-     * It is assumed that an OpenGL context is bound. Calls createObjectBuffers(), which
-     * locks the mGLDataMutex.
+     * @brief Queues every object in the current scene to be uploaded. Locks the mGLDataMutex.
      */
     void createSceneBuffers();
 
 
     /**
-     * @brief Creates vertex arrays and buffers for the given object (assumed to be in the scene).
-     * It is assumed that an OpenGL context is bound. Locks the mGLDataMutex.
+     * @brief Uploads a packed object (assumed to be in the scene) and its texture.
+     * Assumes the correct OpenGL context is bound and the mGLDataMutex is locked.
      */
-    void createObjectBuffers(const SimpleTexturedObject &obj);
+    void createObjectBuffers(SlotHandle handle, const SimpleTexturedObject &obj, const PackedMesh &mesh);
+
+    /**
+     * @brief Frees the mesh of the uploaded object with the handle, and its use of its
+     * texture. Does nothing if the handle is stale. Assumes the correct OpenGL context
+     * is bound and the mGLDataMutex is locked.
+     */
+    void removeObjectBuffers(SlotHandle handle);
 
     /**
      * @brief Unloads all textures. Assumes the correct OpenGL context is bound. Locks the mGLDataMutex.
      */
     void clearAllTextures();
 
+    /**
+     * @brief Uploads the MaterialTable if it changed since the last upload. Assumes the
+     * correct OpenGL context is bound and the mGLDataMutex is locked.
+     */
+    void updateMaterialTable();
+
+    /**
+     * @brief Adds the object's mesh to the mBufferPool, or to the users of an existing
+     * mesh with the same shape. Assumes the mGLDataMutex is locked.
+     */
+    void addObjectMesh(UploadedObject &uploaded, int slot, const PackedMesh &mesh);
+
+    /// Removes the object from the users of its mesh. Assumes the mGLDataMutex is locked.
+    void removeObjectMesh(UploadedObject &uploaded, int slot);
+
+    /// Frees all meshes, forgets all uploaded objects and clears the render list.
+    /// Assumes the mGLDataMutex is locked.
+    void clearMeshes();
+
+    /**
+     * @brief Groups the objects by texture and by page, and uploads the instance offsets.
+     * Assumes the correct OpenGL context is bound and the mGLDataMutex is locked.
+     */
+    void buildRenderList();
+
+
+
+    /// The most bytes that compaction moves per frame.
+    static const int CompactionBytesPerFrame = 1 << 20;
 
 
     SharedSimpleTexturedScene mScene;
@@ -96,18 +207,185 @@ private:
 
 
     /// QMutex that should be used when modifying or using any of the below variables.
-    QMutex mGLDataMutex;
+    mutable QMutex mGLDataMutex;
+
+
+    /* BEGIN upload queue */
+
+    /// Objects that are packed together by one worker thread.
+    struct PackingBatch {
+        /// Null where the object was removed before it was uploaded.
+        QVector<const SimpleTexturedObject *> objects;
+
+        /// Written by the worker, parallel to objects.
+        QVector<PackedMesh> meshes;
+
+        /// Whether the worker was started. Before that, objects may still change.
+        bool started;
+
+        QFuture<void> future;
+
+        /// Requests a frame once the future is finished. Lives on the renderer's thread,
+        /// so the frame never runs before isFinished() is true.
+        QFutureWatcher<void> watcher;
+    };
+
+    /// An added object that is not uploaded yet.
+    struct PendingAdd {
+        /// The generation of the object's handle, or 0 if the slot has no queued addition.
+        quint32 generation;
+
+        QSharedPointer<PackingBatch> batch;
+        int index;
+    };
+
+    /**
+     * @brief Queues the object to be packed and uploaded. Assumes the mGLDataMutex is locked.
+     */
+    void queueObject(SlotHandle handle, const SimpleTexturedObject &obj);
+
+    /**
+     * @brief Queues the removal of an uploaded object, or keeps a queued object from being
+     * uploaded. The object must still be alive. Assumes the mGLDataMutex is locked.
+     */
+    void queueRemoval(SlotHandle handle);
+
+    /// Starts packing the mOpenBatch, if any. Assumes the mGLDataMutex is locked.
+    void startPacking();
+
+    /**
+     * @brief Applies pending changes in order until the mUploadBudget is spent or the next
+     * added object is not packed yet. Assumes the correct OpenGL context is bound and the
+     * mGLDataMutex is locked.
+     */
+    void uploadPendingChanges();
+
+    /**
+     * @brief Drops all queued additions, waiting for running workers. Queued removals stay.
+     * Assumes the mGLDataMutex is locked.
+     */
+    void cancelPendingUploads();
+
+
+    /// The changes that paint() has not applied yet, oldest first.
+    QList<PendingChange> mPendingChanges;
+
+    /// The queued addition in each slot of the scene, indexed by SlotHandle::index.
+    QVector<PendingAdd> mPendingAdds;
+    int mNumPendingAdds;
+
+    /// The batch that new objects are added to until it is started.
+    QSharedPointer<PackingBatch> mOpenBatch;
+
+    qint64 mUploadBudget;
+
+    /// A batch is started once it has this many objects, or when control returns to the event loop.
+    static const int PackingBatchSize = 64;
+
+    /* END upload queue */
+
+
+    /// Holds the vertices and indices of all objects.
+    GpuBufferPool mBufferPool;
+
+    /// A mesh in the mBufferPool. Objects whose meshes only differ by a translation share one.
+    struct PooledMesh {
+        int allocation;
+
+        /// PackedMesh::origin() of the uploaded mesh.
+        QVector3D origin;
+
+        /// PackedMesh::bounds of the uploaded mesh.
+        BoundingBox bounds;
+
+        QByteArray shapeDigest;
+
+        /// The image of the users, which must be the same for all of them.
+        const QImage *image;
+
+        /// The slots of the objects that are drawn with this mesh.
+        QSet<int> users;
+    };
+
+    QHash<int, PooledMesh> mMeshes;
+    int mNextMesh;
+
+    /// Maps PooledMesh::shapeDigest to the meshes with that digest.
+    QMultiHash<QByteArray, int> mMeshesByShape;
+
+    /// The uploaded object in each slot of the scene, indexed by SlotHandle::index.
+    QVector<UploadedObject> mUploadedObjects;
+
+
+    /// The draws for one texture.
+    struct TextureBatch {
+        QSharedPointer<QOpenGLTexture> texture;
+
+        /// Objects with meshes of their own in one page of the mBufferPool.
+        struct Page {
+            GpuBufferPool::DrawList list;
+
+            /// The bounds of the objects in the list, in the same order.
+            QVector<BoundingBox> bounds;
+        };
+        QVector<Page> pages;
+
+        /// Meshes that several objects share, which are drawn instanced.
+        struct Instances {
+            int allocation;
+
+            /// The bounds of the mesh without an offset.
+            BoundingBox bounds;
+
+            int firstInstance;
+            int numInstances;
+        };
+        QVector<Instances> instances;
+    };
+
+    /// The visible part of a TextureBatch in one frame.
+    struct VisibleBatch {
+        const TextureBatch *batch;
+
+        /// The distance from the camera to the nearest visible object.
+        float distance;
+
+        /// The visible objects of each page, ordered front to back.
+        QVector<GpuBufferPool::DrawList> lists;
+
+        /// Runs of visible instances.
+        QVector<TextureBatch::Instances> instances;
+    };
+
+    /**
+     * @brief Returns the batches that have visible objects, ordered front to back,
+     * and counts the drawn and culled objects. Objects are culled if they are outside
+     * the frustum or hidden by the mOcclusionCuller. Assumes the mGLDataMutex is locked.
+     */
+    QVector<VisibleBatch> cullRenderList(const ViewFrustum &frustum, QVector3D camPos);
+
+    /// What paint() draws. Rebuilt by buildRenderList() when mRenderListDirty is set.
+    QVector<TextureBatch> mRenderList;
+    bool mRenderListDirty;
+
+    /// The offsets of all instances in the mRenderList, as uploaded to mInstanceOffsets.
+    QVector<QVector3D> mInstanceOffsetData;
+    QOpenGLBuffer mInstanceOffsets;
+
+    /// Draws the scene's occluders each frame, for cullRenderList().
+    OcclusionCuller mOcclusionCuller;
+
+    /// The number of objects that were drawn, outside the frustum and occluded in the last frame.
+    int mObjectsDrawn;
+    int mObjectsCulled;
+    int mObjectsOccluded;
 
 
-    // VAO and buffers for each object.
-    // TODO These should be adapted to a textured shader.
-    QMap<const SimpleTexturedObject *, QSharedPointer<QOpenGLVertexArrayObject>> mVAOs;
-    QMap<const SimpleTexturedObject *, int> mNumVertices;
+    /// The MaterialTable as a 1D texture with one RGBA texel per material.
+    QSharedPointer<QOpenGLTexture> mMaterialTable;
 
-    QMap<const SimpleTexturedObject *, QSharedPointer<QOpenGLBuffer>> mObjectVertexPositions;
-    QMap<const SimpleTexturedObject *, QSharedPointer<QOpenGLBuffer>> mObjectVertexNormals;
-    QMap<const SimpleTexturedObject *, QSharedPointer<QOpenGLBuffer>> mObjectVertexMaterials;
-    QMap<const SimpleTexturedObject *, QSharedPointer<QOpenGLBuffer>> mObjectVertexTexCoords;
+    /// The MaterialTable::version() of the uploaded table.
+    int mMaterialTableVersion;
 
 
 
@@ -118,8 +396,8 @@ private:
     QMap<const QImage *, QSharedPointer<QOpenGLTexture>> mImagesToTextures;
 
 
-    /// A map from textures to the objects that use them.
-    QMap<const QOpenGLTexture *, QSet<const SimpleTexturedObject *>> mTexturesToObjects;
+    /// The number of uploaded objects that use each image's texture.
+    QHash<const QImage *, int> mImageUsers;
 
 };
 
@@ -3,9 +3,11 @@
 #include "simpletexturedrenderer.h"
 
 SimpleTexturedScene::SimpleTexturedScene()
+    : mTransactionDepth(0)
 {
     connect(this, &SimpleTexturedScene::objectAdded, this, [this] () { emit sceneUpdated(); });
     connect(this, &SimpleTexturedScene::objectRemoved, this, [this] () { emit sceneUpdated(); });
+    connect(this, &SimpleTexturedScene::deltaCommitted, this, [this] () { emit sceneUpdated(); });
     connect(this, &SimpleTexturedScene::sceneCleared, this, [this] () { emit sceneUpdated(); });
 }
 
@@ -23,20 +25,102 @@ SimpleTexturedScene::~SimpleTexturedScene()
 
 void SimpleTexturedScene::clear()
 {
+    // The renderer may still be reading the objects, so they are only released
+    // once it has handled the signal.
+    SlotMap<QSharedPointer<SimpleTexturedObject>> objects = mObjects;
     mObjects.clear();
+
+    mDelta = Delta();
+    mDeltaAdded.clear();
+
     emit sceneCleared();
 }
 
-void SimpleTexturedScene::addObject(QSharedPointer<SimpleTexturedObject> object)
+void SimpleTexturedScene::beginTransaction()
+{
+    mTransactionDepth += 1;
+}
+
+void SimpleTexturedScene::commitTransaction()
+{
+    Q_ASSERT(mTransactionDepth > 0);
+
+    if (--mTransactionDepth > 0)
+        return;
+
+    // Objects that were added and removed again are in neither list.
+    Delta delta;
+    delta.removed = mDelta.removed;
+    delta.removedObjects = mDelta.removedObjects;
+    for (ObjectHandle handle : mDelta.added) {
+        if (mObjects.contains(handle))
+            delta.added.append(handle);
+    }
+
+    mDelta = Delta();
+    mDeltaAdded.clear();
+
+    if (!delta.isEmpty())
+        emit deltaCommitted(delta);
+
+    commitChanges();
+}
+
+SimpleTexturedScene::ObjectHandle SimpleTexturedScene::addObject(QSharedPointer<SimpleTexturedObject> object)
 {
-    mObjects.push_back(object);
-    emit objectAdded(*object);
+    ObjectHandle handle = mObjects.insert(object);
+
+    if (inTransaction()) {
+        mDelta.added.append(handle);
+        mDeltaAdded.insert(handle);
+    } else {
+        emit objectAdded(handle, *object);
+    }
+
+    return handle;
+}
+
+void SimpleTexturedScene::removeObject(ObjectHandle handle)
+{
+    if (!mObjects.contains(handle))
+        return;
+
+    // Keep the object alive for the signal.
+    QSharedPointer<SimpleTexturedObject> object = mObjects[handle];
+    mObjects.remove(handle);
+
+    if (!inTransaction()) {
+        emit objectRemoved(handle, *object);
+    } else if (!mDeltaAdded.remove(handle)) {
+        mDelta.removed.append(handle);
+        mDelta.removedObjects.append(object);
+    }
+}
+
+QVector<SimpleTexturedScene::ObjectHandle> SimpleTexturedScene::replaceObjects(const QVector<ObjectHandle> &oldObjects,
+                                                                               const QVector<QSharedPointer<SimpleTexturedObject>> &newObjects)
+{
+    QVector<ObjectHandle> handles;
+    handles.reserve(newObjects.size());
+
+    beginTransaction();
+
+    // The renderer applies changes in order, over several frames, so the new
+    // objects are added first.
+    for (auto object : newObjects)
+        handles.append(addObject(object));
+
+    for (ObjectHandle handle : oldObjects)
+        removeObject(handle);
+
+    commitTransaction();
+
+    return handles;
 }
 
-void SimpleTexturedScene::removeObject(QSharedPointer<SimpleTexturedObject> object)
+void SimpleTexturedScene::setOccluders(const QVector<BoundingBox> &occluders)
 {
-    mObjects.removeAll(object);
-    emit objectRemoved(*object);
+    mOccluders = occluders;
 }
 
 void SimpleTexturedScene::commitChanges()
@@ -51,6 +135,7 @@ QSharedPointer<AbstractRenderer> SimpleTexturedScene::makeRenderer()
 
     connect(this, &SimpleTexturedScene::objectAdded, renderer.data(), &SimpleTexturedRenderer::objectAdded);
     connect(this, &SimpleTexturedScene::objectRemoved, renderer.data(), &SimpleTexturedRenderer::objectRemoved);
+    connect(this, &SimpleTexturedScene::deltaCommitted, renderer.data(), &SimpleTexturedRenderer::applyDelta);
     connect(this, &SimpleTexturedScene::sceneCleared, renderer.data(), &SimpleTexturedRenderer::clearAll);
     connect(this, &SimpleTexturedScene::changesCommitted, renderer.data(), &SimpleTexturedRenderer::requestUpdate);
 
@@ -60,7 +145,7 @@ QSharedPointer<AbstractRenderer> SimpleTexturedScene::makeRenderer()
 SharedOBJModel SimpleTexturedScene::exportOBJ()
 {
     SharedOBJModel objModel = SharedOBJModel::create();
-    foreach(QSharedPointer<SimpleTexturedObject> obj, mObjects){
+    for (const QSharedPointer<SimpleTexturedObject> &obj : mObjects) {
         objModel->addSimpleTextured(obj);
     }
     return objModel;
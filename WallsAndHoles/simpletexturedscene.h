@@ -5,18 +5,33 @@
 #include <memory>
 
 #include <QVector>
+#include <QSet>
 #include <QSharedPointer>
 
 #include "dereferencingiterator.h"
 #include "dereferencingconstiterator.h"
 
 #include "abstractscene.h"
+#include "slotmap.h"
 
 #include "simpletexturedobject.h"
 
 #include "objtools.h"
 
+#include "viewfrustum.h"
 
+
+/**
+ * @brief A scene of SimpleTexturedObjects.
+ *
+ * Objects are stored under ObjectHandles, which make adding, removing and finding an
+ * object take constant time. Renderers can keep data about objects in arrays indexed
+ * by ObjectHandle::index.
+ *
+ * Each added or removed object emits a signal, unless the change is made inside a
+ * transaction. Then the changes are collected into one Delta that is emitted when
+ * the transaction is committed, which is much cheaper for large changes.
+ */
 class SimpleTexturedScene : public AbstractScene, public std::enable_shared_from_this<SimpleTexturedScene>
 {
     Q_OBJECT
@@ -25,6 +40,24 @@ public:
 
     using SharedSimpleTexturedScene = std::shared_ptr<SimpleTexturedScene>;
 
+    using ObjectHandle = SlotHandle;
+
+    /// The changes made by a transaction.
+    struct Delta {
+        /// The objects that were added and are still in the scene, in the order they were added.
+        QVector<ObjectHandle> added;
+
+        /// The objects that were in the scene before the transaction and were removed,
+        /// in the order they were removed. The handles are stale.
+        QVector<ObjectHandle> removed;
+
+        /// The removed objects, parallel to removed. They are kept alive until the
+        /// Delta is destroyed.
+        QVector<QSharedPointer<SimpleTexturedObject>> removedObjects;
+
+        bool isEmpty() const { return added.isEmpty() && removed.isEmpty(); }
+    };
+
 
     /**
      * @brief Creates an empty scene.
@@ -40,17 +73,50 @@ public:
      */
     void clear();
 
+    /**
+     * @brief Starts collecting changes into a Delta instead of emitting a signal per
+     * object. Transactions may be nested; only the outermost one is committed.
+     */
+    void beginTransaction();
+
+    /**
+     * @brief Ends a transaction. For the outermost transaction, emits deltaCommitted()
+     * if anything changed, and then changesCommitted().
+     */
+    void commitTransaction();
+
+    bool inTransaction() const { return mTransactionDepth > 0; }
+
     /**
      * @brief Adds an object to the scene.
      * @param object    The object to be added.
+     * @return The handle of the object, until it is removed.
+     */
+    ObjectHandle addObject(QSharedPointer<SimpleTexturedObject> object);
+
+    /**
+     * @brief Removes an object from the scene. Does nothing if the handle is stale.
+     * @param handle    The handle of the object to be removed.
      */
-    void addObject(QSharedPointer<SimpleTexturedObject> object);
+    void removeObject(ObjectHandle handle);
 
     /**
-     * @brief Removes an object from the scene.
-     * @param object    The object to be removed.
+     * @brief Returns the object of the handle, or null if the handle is stale.
      */
-    void removeObject(QSharedPointer<SimpleTexturedObject> object);
+    QSharedPointer<SimpleTexturedObject> object(ObjectHandle handle) const { return mObjects.value(handle); }
+
+    /**
+     * @brief Removes some objects and adds others in one transaction, then commits
+     * the changes. The renderer sees the old objects until all new objects are in place.
+     * @param oldObjects    The handles of the objects to be removed.
+     * @param newObjects    The objects to be added.
+     * @return The handles of the new objects, in the same order.
+     */
+    QVector<ObjectHandle> replaceObjects(const QVector<ObjectHandle> &oldObjects,
+                                         const QVector<QSharedPointer<SimpleTexturedObject>> &newObjects);
+
+    /// The objects with their handles. Iterating over the scene gives the same order.
+    const SlotMap<QSharedPointer<SimpleTexturedObject>> &objects() const { return mObjects; }
 
 
     /**
@@ -59,6 +125,16 @@ public:
      */
     void commitChanges();
 
+
+    /**
+     * @brief Sets boxes that are inside opaque objects, which the renderer uses to
+     * skip objects hidden behind them. The new boxes take effect with the next
+     * commitChanges().
+     */
+    void setOccluders(const QVector<BoundingBox> &occluders);
+
+    const QVector<BoundingBox> &occluders() const { return mOccluders; }
+
     /* Iterators for accessing objects in the scene */
     auto begin()
     {
@@ -93,20 +169,30 @@ public:
 signals:
     /**
      * @brief Emitted when an object is added.
-     * @param obj   The newly added object (already in the scene).
+     * @param handle    The object's handle.
+     * @param obj       The newly added object (already in the scene).
      */
-    void objectAdded(const SimpleTexturedObject &obj);
+    void objectAdded(SlotHandle handle, const SimpleTexturedObject &obj);
 
     /**
      * @brief Emitted when an object is about to be removed.
      *
      * NOTE: This is NOT emitted if sceneCleared() is emitted.
-     * @param obj   The object that was removed (not in the scene).
+     * @param handle    The object's handle, which is already stale.
+     * @param obj       The object that was removed (not in the scene).
+     */
+    void objectRemoved(SlotHandle handle, const SimpleTexturedObject &obj);
+
+    /**
+     * @brief Emitted when a transaction is committed, instead of objectAdded() and
+     * objectRemoved() for each object.
+     * @param delta     The changes. The removed objects stay alive until the signal returns.
      */
-    void objectRemoved(const SimpleTexturedObject &obj);
+    void deltaCommitted(const SimpleTexturedScene::Delta &delta);
 
     /**
-     * @brief Emitted when all objects are removed from the scene.
+     * @brief Emitted when all objects are removed from the scene. Discards the
+     * changes of an open transaction.
      */
     void sceneCleared();
 
@@ -129,7 +215,17 @@ protected:
     QSharedPointer<AbstractRenderer> makeRenderer() override;
 
 
-    QVector<QSharedPointer<SimpleTexturedObject>> mObjects;
+    SlotMap<QSharedPointer<SimpleTexturedObject>> mObjects;
+
+    int mTransactionDepth;
+
+    /// The changes of the open transaction.
+    Delta mDelta;
+
+    /// The objects in mDelta.added, which are not reported as removed if they are removed again.
+    QSet<ObjectHandle> mDeltaAdded;
+
+    QVector<BoundingBox> mOccluders;
 };
 
 
@@ -1,5 +1,8 @@
 #include "simpletexturedshader.h"
 
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+
 SimpleTexturedShader::SimpleTexturedShader()
 {
 
@@ -16,11 +19,9 @@ void SimpleTexturedShader::create()
 
     mAttrPosition = mProgram->attributeLocation("vPosition");
     mAttrNormal = mProgram->attributeLocation("vNormal");
-    mAttrReflSpecular = mProgram->attributeLocation("vReflSpecular");
-    mAttrReflDiffuse = mProgram->attributeLocation("vReflDiffuse");
-    mAttrReflAmbient = mProgram->attributeLocation("vReflAmbient");
-    mAttrShininess = mProgram->attributeLocation("vShininess");
+    mAttrMaterial = mProgram->attributeLocation("vMaterial");
     mAttrTexCoords = mProgram->attributeLocation("vTexCoords");
+    mAttrOffset = mProgram->attributeLocation("vOffset");
 
     mUnifMVP = mProgram->uniformLocation("mvp");
     mUnifPointToLight = mProgram->uniformLocation("uPointToLight");
@@ -29,6 +30,7 @@ void SimpleTexturedShader::create()
     mUnifSourceSpecularColor = mProgram->uniformLocation("uSourceSpecularColor");
     mUnifSourceDiffuseColor = mProgram->uniformLocation("uSourceDiffuseColor");
     mUnifTexture = mProgram->uniformLocation("uTexture");
+    mUnifMaterials = mProgram->uniformLocation("uMaterials");
 }
 
 void SimpleTexturedShader::destroy()
@@ -49,20 +51,14 @@ void SimpleTexturedShader::enableArrays() {
     mProgram->enableAttributeArray(mAttrPosition);
     mProgram->enableAttributeArray(mAttrNormal);
     mProgram->enableAttributeArray(mAttrTexCoords);
-    mProgram->enableAttributeArray(mAttrReflSpecular);
-    mProgram->enableAttributeArray(mAttrReflDiffuse);
-    mProgram->enableAttributeArray(mAttrReflAmbient);
-    mProgram->enableAttributeArray(mAttrShininess);
+    mProgram->enableAttributeArray(mAttrMaterial);
 }
 
 void SimpleTexturedShader::disableArrays() {
     mProgram->disableAttributeArray(mAttrPosition);
     mProgram->disableAttributeArray(mAttrNormal);
     mProgram->disableAttributeArray(mAttrTexCoords);
-    mProgram->disableAttributeArray(mAttrReflSpecular);
-    mProgram->disableAttributeArray(mAttrReflDiffuse);
-    mProgram->disableAttributeArray(mAttrReflAmbient);
-    mProgram->disableAttributeArray(mAttrShininess);
+    mProgram->disableAttributeArray(mAttrMaterial);
 }
 
 
@@ -71,27 +67,35 @@ void SimpleTexturedShader::setAttrPositionBuffer(int offset, int stride) {
 }
 
 void SimpleTexturedShader::setAttrNormalBuffer(int offset, int stride) {
-    mProgram->setAttributeBuffer(mAttrNormal, GL_FLOAT, offset, 3, stride);
+    mProgram->setAttributeBuffer(mAttrNormal, GL_BYTE, offset, 2, stride);
 }
 
-void SimpleTexturedShader::setAttrReflSpecularBuffer(int offset, int stride) {
-    mProgram->setAttributeBuffer(mAttrReflSpecular, GL_FLOAT, offset, 1, stride);
+void SimpleTexturedShader::setAttrMaterialBuffer(int offset, int stride) {
+    // QOpenGLShaderProgram::setAttributeBuffer() always normalizes integers, but the
+    // material index must reach the shader unchanged.
+    QOpenGLContext::currentContext()->extraFunctions()->glVertexAttribIPointer(
+                mAttrMaterial, 1, GL_UNSIGNED_SHORT, stride, reinterpret_cast<const void *>(qintptr(offset)));
 }
 
-void SimpleTexturedShader::setAttrReflDiffuseBuffer(int offset, int stride) {
-    mProgram->setAttributeBuffer(mAttrReflDiffuse, GL_FLOAT, offset, 1, stride);
+void SimpleTexturedShader::setAttrTexCoordsBuffer(int offset, int stride) {
+    mProgram->setAttributeBuffer(mAttrTexCoords, GL_FLOAT, offset, 2, stride);
 }
 
-void SimpleTexturedShader::setAttrReflAmbientBuffer(int offset, int stride) {
-    mProgram->setAttributeBuffer(mAttrReflAmbient, GL_FLOAT, offset, 1, stride);
+void SimpleTexturedShader::setAttrOffsetBuffer(int offset, int stride) {
+    mProgram->setAttributeBuffer(mAttrOffset, GL_FLOAT, offset, 3, stride);
+    QOpenGLContext::currentContext()->extraFunctions()->glVertexAttribDivisor(mAttrOffset, 1);
 }
 
-void SimpleTexturedShader::setAttrShininessBuffer(int offset, int stride) {
-    mProgram->setAttributeBuffer(mAttrShininess, GL_FLOAT, offset, 1, stride);
+void SimpleTexturedShader::setAttrOffsetValue(QVector3D offset) {
+    mProgram->setAttributeValue(mAttrOffset, offset);
 }
 
-void SimpleTexturedShader::setAttrTexCoordsBuffer(int offset, int stride) {
-    mProgram->setAttributeBuffer(mAttrTexCoords, GL_FLOAT, offset, 2, stride);
+void SimpleTexturedShader::enableOffsetArray() {
+    mProgram->enableAttributeArray(mAttrOffset);
+}
+
+void SimpleTexturedShader::disableOffsetArray() {
+    mProgram->disableAttributeArray(mAttrOffset);
 }
 
 
@@ -128,3 +132,12 @@ void SimpleTexturedShader::bindUniformTexture(QOpenGLTexture &texture) {
 void SimpleTexturedShader::releaseUniformTexture(QOpenGLTexture &texture) {
     texture.release(0);
 }
+
+void SimpleTexturedShader::bindUniformMaterials(QOpenGLTexture &materials) {
+    materials.bind(1);
+    mProgram->setUniformValue(mUnifMaterials, (GLuint)1);
+}
+
+void SimpleTexturedShader::releaseUniformMaterials(QOpenGLTexture &materials) {
+    materials.release(1);
+}
@@ -52,14 +52,17 @@ public:
 
 
 
-    /* Methods to bind buffers to attributes */
-    void setAttrPositionBuffer(int offset = 0, int stride = 0);
-    void setAttrNormalBuffer(int offset = 0, int stride = 0);
-    void setAttrReflSpecularBuffer(int offset = 0, int stride = 0);
-    void setAttrReflDiffuseBuffer(int offset = 0, int stride = 0);
-    void setAttrReflAmbientBuffer(int offset = 0, int stride = 0);
-    void setAttrShininessBuffer(int offset = 0, int stride = 0);
-    void setAttrTexCoordsBuffer(int offset = 0, int stride = 0);
+    /* Methods to bind buffers to attributes. The types match PackedVertex. */
+    void setAttrPositionBuffer(int offset = 0, int stride = 0);     ///< Three GLfloats.
+    void setAttrNormalBuffer(int offset = 0, int stride = 0);       ///< Two GLbytes, octahedral encoding.
+    void setAttrMaterialBuffer(int offset = 0, int stride = 0);     ///< One GLushort.
+    void setAttrTexCoordsBuffer(int offset = 0, int stride = 0);    ///< Two GLfloats.
+
+    /// Three GLfloats per instance. The array is only enabled while drawing instances.
+    void setAttrOffsetBuffer(int offset = 0, int stride = 0);
+    void setAttrOffsetValue(QVector3D offset);
+    void enableOffsetArray();
+    void disableOffsetArray();
 
     /* Methods to set uniforms */
     void setUniformMVP(QMatrix4x4 mat);
@@ -73,17 +76,19 @@ public:
     void bindUniformTexture(QOpenGLTexture &texture);
     void releaseUniformTexture(QOpenGLTexture &texture);
 
+    /// Binds the 1D texture that holds the material table (see MaterialTable).
+    void bindUniformMaterials(QOpenGLTexture &materials);
+    void releaseUniformMaterials(QOpenGLTexture &materials);
+
 protected:
     QSharedPointer<QOpenGLShaderProgram> mProgram;
 
     // Vertex attribute locations.
     int mAttrPosition;
     int mAttrNormal;
-    int mAttrReflSpecular;
-    int mAttrReflDiffuse;
-    int mAttrReflAmbient;
-    int mAttrShininess;
+    int mAttrMaterial;
     int mAttrTexCoords;
+    int mAttrOffset;
 
     // Uniform locations.
     int mUnifMVP;
@@ -93,6 +98,7 @@ protected:
     int mUnifSourceSpecularColor;
     int mUnifSourceDiffuseColor;
     int mUnifTexture;
+    int mUnifMaterials;
 };
 
 #endif // SIMPLETEXTUREDSHADER_H
@@ -0,0 +1,184 @@
+#ifndef SLOTMAP_H
+#define SLOTMAP_H
+
+#include <QHash>
+#include <QVector>
+#include <QtGlobal>
+
+/**
+ * @brief A handle to a value in a SlotMap.
+ *
+ * The index is stable for as long as the value is in the map, so other code can keep
+ * data about the value in arrays indexed by it. Indices are reused after a value is
+ * removed, but with a new generation, so handles to removed values never match a
+ * later value. The null handle has generation 0.
+ */
+struct SlotHandle {
+    int index;
+    quint32 generation;
+
+    SlotHandle() : index(-1), generation(0) {}
+    SlotHandle(int index, quint32 generation) : index(index), generation(generation) {}
+
+    bool isNull() const { return generation == 0; }
+
+    bool operator ==(const SlotHandle &other) const
+    {
+        return index == other.index && generation == other.generation;
+    }
+
+    bool operator !=(const SlotHandle &other) const { return !(*this == other); }
+};
+
+Q_DECLARE_TYPEINFO(SlotHandle, Q_PRIMITIVE_TYPE);
+
+inline uint qHash(const SlotHandle &handle, uint seed = 0)
+{
+    return ::qHash((quint64(quint32(handle.index)) << 32) | handle.generation, seed);
+}
+
+
+/**
+ * @brief Stores values under SlotHandles, with constant time insertion, removal and lookup.
+ *
+ * The values are kept contiguous, so iterating over them is as fast as iterating over
+ * a QVector. Removing a value moves the last value into its place, so the order of
+ * iteration is not the order of insertion.
+ */
+template< typename T >
+class SlotMap
+{
+public:
+    using Handle = SlotHandle;
+
+    SlotMap() : mFreeHead(-1) {}
+
+    /// Adds a value and returns its handle.
+    Handle insert(const T &value)
+    {
+        int index;
+        if (mFreeHead >= 0) {
+            index = mFreeHead;
+            mFreeHead = mSlots[index].position;
+        } else {
+            index = mSlots.size();
+            mSlots.append(Slot{-1, 1});
+        }
+
+        Slot &slot = mSlots[index];
+        slot.position = mValues.size();
+
+        mValues.append(value);
+        mValueSlots.append(index);
+
+        return Handle(index, slot.generation);
+    }
+
+    /// Removes the value of the handle. Returns false if the handle is stale.
+    bool remove(Handle handle)
+    {
+        if (!contains(handle))
+            return false;
+
+        Slot &slot = mSlots[handle.index];
+        int position = slot.position;
+        int last = mValues.size() - 1;
+
+        // The last value moves into the gap.
+        if (position != last) {
+            mValues[position] = mValues[last];
+            mValueSlots[position] = mValueSlots[last];
+            mSlots[mValueSlots[position]].position = position;
+        }
+
+        mValues.removeLast();
+        mValueSlots.removeLast();
+
+        // Generation 0 is reserved for the null handle.
+        slot.generation = slot.generation + 1 == 0 ? 1 : slot.generation + 1;
+        slot.position = mFreeHead;
+        mFreeHead = handle.index;
+
+        return true;
+    }
+
+    bool contains(Handle handle) const
+    {
+        // Removing a value changes its slot's generation, so free slots never match.
+        return handle.index >= 0 && handle.index < mSlots.size()
+                && !handle.isNull() && mSlots[handle.index].generation == handle.generation;
+    }
+
+    /// Returns the value of the handle, which must be in the map.
+    T &operator [](Handle handle)
+    {
+        Q_ASSERT(contains(handle));
+        return mValues[mSlots[handle.index].position];
+    }
+
+    const T &operator [](Handle handle) const
+    {
+        Q_ASSERT(contains(handle));
+        return mValues[mSlots[handle.index].position];
+    }
+
+    /// Returns the value of the handle, or a default-constructed value if it is stale.
+    T value(Handle handle) const
+    {
+        return contains(handle) ? mValues[mSlots[handle.index].position] : T();
+    }
+
+    int size() const { return mValues.size(); }
+    bool isEmpty() const { return mValues.isEmpty(); }
+
+    /// One more than the largest index that a handle has had, for sizing parallel arrays.
+    int slotCount() const { return mSlots.size(); }
+
+    /// Returns the handle of the value at a position in the iteration order.
+    Handle handleAt(int position) const
+    {
+        int index = mValueSlots[position];
+        return Handle(index, mSlots[index].generation);
+    }
+
+    const T &valueAt(int position) const { return mValues[position]; }
+
+    /// Removes all values. Existing handles become stale, but indices are kept for reuse.
+    void clear()
+    {
+        for (int index : mValueSlots) {
+            Slot &slot = mSlots[index];
+            slot.generation = slot.generation + 1 == 0 ? 1 : slot.generation + 1;
+            slot.position = mFreeHead;
+            mFreeHead = index;
+        }
+
+        mValues.clear();
+        mValueSlots.clear();
+    }
+
+    typename QVector<T>::iterator begin() { return mValues.begin(); }
+    typename QVector<T>::iterator end() { return mValues.end(); }
+    typename QVector<T>::const_iterator begin() const { return mValues.begin(); }
+    typename QVector<T>::const_iterator end() const { return mValues.end(); }
+
+private:
+    struct Slot {
+        /// The position of the value in mValues, or the next free slot if the slot is free.
+        int position;
+
+        quint32 generation;
+    };
+
+    QVector<Slot> mSlots;
+
+    QVector<T> mValues;
+
+    /// The slot of each value, parallel to mValues.
+    QVector<int> mValueSlots;
+
+    /// The first free slot, or -1.
+    int mFreeHead;
+};
+
+#endif // SLOTMAP_H
@@ -23,9 +23,10 @@ TileMap::TileMap(QSize mapSize,
         }
     }
 
-    // tileChanged() and resized() signals should always be followed by a mapChanged() signal
+    // tileChanged(), resized() and indoorChanged() signals should always be followed by a mapChanged() signal
     connect(this, &TileMap::tileChanged, this, &TileMap::mapChanged);
     connect(this, &TileMap::resized, this, &TileMap::mapChanged);
+    connect(this, &TileMap::indoorChanged, this, &TileMap::mapChanged);
 
     //set up default tile templates. TODO this should be impacted by inital map properties.
     mDefaultTileTemplateSet->addTileTemplate(nullptr); //For an eraser
@@ -115,6 +116,16 @@ void TileMap::resizeMap(QSize newSize)
     emit resized();
 }
 
+void TileMap::setIndoor(bool indoor)
+{
+    if (indoor == mIsIndoors)
+        return;
+
+    mIsIndoors = indoor;
+
+    emit indoorChanged(indoor);
+}
+
 bool TileMap::isTileTemplateUsed(TileTemplate *tileTemplate)
 {
     mPingingMutex.lock();
@@ -48,6 +48,7 @@ public:
     int width() const { return mMap.size().width(); }
     int height() const { return mMap.size().height(); }
     bool isIndoor() const { return mIsIndoors; }
+    void setIndoor(bool indoor);
     bool hasCeiling() const { return mHasCeiling; }
 
     /**
@@ -119,8 +120,12 @@ signals:
     void tileChanged(int x, int y);
     void resized();
 
+    /// Sent out when isIndoor() changes.
+    void indoorChanged(bool indoor);
+
     /**
-     * @brief Sent out whenever the map is changed in any way. Happens after tileChanged() and resized() signals.
+     * @brief Sent out whenever the map is changed in any way. Happens after tileChanged(), resized() and
+     * indoorChanged() signals.
      */
     void mapChanged();
 
@@ -128,11 +128,11 @@ void TileTemplate::setTopMaterial(TileMaterial *material)
 
     mTopMaterial = material;
 
-    // When the material's properties change, a materialChanged() signal will be emitted.
+    // When the material's texture changes, a materialChanged() signal will be emitted.
     // The changed() signal is currently only used for saving purposes, so it does not need to be emitted.
+    // Phong parameter changes only update the material's MaterialTable entry, so tiles do not change.
 
     connect(mTopMaterial, &TileMaterial::textureChanged, this, &TileTemplate::materialChanged);
-    connect(mTopMaterial, &TileMaterial::phongParamsChanged, this, &TileTemplate::materialChanged);
     connect(mTopMaterial, &TileMaterial::aboutToBeRemoved,
             this, [this]() {
         setTopMaterial(TileMaterial::getDefaultMaterial());
@@ -154,11 +154,11 @@ void TileTemplate::setSideMaterial(TileMaterial *material)
 
     mSideMaterial = material;
 
-    // When the material's properties change, a materialChanged() signal will be emitted.
+    // When the material's texture changes, a materialChanged() signal will be emitted.
     // The changed() signal is currently only used for saving purposes, so it does not need to be emitted.
+    // Phong parameter changes only update the material's MaterialTable entry, so tiles do not change.
 
     connect(mSideMaterial, &TileMaterial::textureChanged, this, &TileTemplate::materialChanged);
-    connect(mSideMaterial, &TileMaterial::phongParamsChanged, this, &TileTemplate::materialChanged);
     connect(mSideMaterial, &TileMaterial::aboutToBeRemoved,
             this, [this]() {
         setSideMaterial(TileMaterial::getDefaultMaterial());
@@ -266,14 +266,19 @@ SavableTileTemplateSet *TileTemplateSetsManager::loadTileTemplateSet(bool tryToR
     return loadTileTemplateSet(path, tryToRelocateOnFail);
 }
 
-SavableTileTemplateSet *TileTemplateSetsManager::loadTileTemplateSet(QString path, bool tryToRelocateOnFail)
+SavableTileTemplateSet *TileTemplateSetsManager::loadTileTemplateSet(QString path, bool tryToRelocateOnFail, bool showErrors)
 {
     for (SavableTileTemplateSet *ts : mTileTemplateSets)
         if (path == ts->savePath())
             return ts;
 
     if (!path.isNull()) {
-        SavableTileTemplateSet *newSet = XMLTool::openTileTemplateSet(path);
+        QString error;
+        SavableTileTemplateSet *newSet = XMLTool::openTileTemplateSet(path, showErrors ? &error : nullptr);
+
+        if (!error.isEmpty())
+            QMessageBox::critical(0, "xmlFile.xml Parse Error", error, QMessageBox::Ok);
+
         if (newSet != nullptr) {
             addTileTemplateSet(newSet);
 
@@ -294,3 +299,18 @@ SavableTileTemplateSet *TileTemplateSetsManager::loadTileTemplateSet(QString pat
 
     return nullptr;
 }
+
+TileMap *TileTemplateSetsManager::openTileMap(QString path)
+{
+    auto loadSet = [this] (const QString &setPath) {
+        return loadTileTemplateSet(setPath, true);
+    };
+
+    QString error;
+    TileMap *tileMap = XMLTool::openTileMap(path, loadSet, &error);
+
+    if (!error.isEmpty())
+        QMessageBox::critical(0, "xmlFile.xml Parse Error", error, QMessageBox::Ok);
+
+    return tileMap;
+}
@@ -92,8 +92,18 @@ public:
      * If the file can't be loaded for any reason,
      * the user will be given dialogs to relocate the file.
      * @param path
+     * @param showErrors If false, parse errors are logged instead of shown in a dialog.
      */
-    SavableTileTemplateSet *loadTileTemplateSet(QString path, bool tryToRelocateOnFail = false);
+    SavableTileTemplateSet *loadTileTemplateSet(QString path, bool tryToRelocateOnFail = false, bool showErrors = true);
+
+    /**
+     * @brief openTileMap
+     * Loads the map at the given path, and the tileTemplateSets it uses
+     * into the manager. Parse errors are shown in a dialog.
+     * @param path
+     * @return The map, or nullptr if it could not be loaded.
+     */
+    TileMap *openTileMap(QString path);
 
     SavableTileTemplateSet *tileTemplateSetAt(int i) { return mTileTemplateSets[i]; }
     const QList<SavableTileTemplateSet *> &tileTemplateSets() { return mTileTemplateSets; }
@@ -0,0 +1,395 @@
+/*
+ * The hole elimination and ear cutting below follow mapbox/earcut
+ * (https://github.com/mapbox/earcut), adapted to index-linked nodes in an Arena.
+ * filterPoints, isLocallyInside, sectorContainsSector, findHoleBridge and
+ * eliminateHole keep earcut's names; splitRing is earcut's splitPolygon.
+ *
+ * ISC License
+ *
+ * Copyright (c) 2016, Mapbox
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose
+ * with or without fee is hereby granted, provided that the above copyright notice
+ * and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ * THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS.
+ * IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA
+ * OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "triangulator.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "arena.h"
+
+using namespace Triangulator;
+
+
+namespace {
+
+/// A vertex of the ring that is being triangulated. Rings are doubly linked lists of indices.
+struct Node {
+    QPointF p;
+    int prev;
+    int next;
+};
+
+using Nodes = ArenaVector<Node>;
+
+/// Twice the signed area of the triangle abc. Positive if a, b, c turn left.
+qreal turn(QPointF a, QPointF b, QPointF c)
+{
+    return (b.x() - a.x()) * (c.y() - b.y()) - (b.y() - a.y()) * (c.x() - b.x());
+}
+
+qreal turn(const Nodes &nodes, int a, int b, int c)
+{
+    return turn(nodes[a].p, nodes[b].p, nodes[c].p);
+}
+
+/// Whether p lies in the left-turning triangle abc or on its boundary.
+bool isInTriangle(QPointF a, QPointF b, QPointF c, QPointF p)
+{
+    return turn(a, b, p) >= 0 && turn(b, c, p) >= 0 && turn(c, a, p) >= 0;
+}
+
+void removeNode(Nodes &nodes, int i)
+{
+    nodes[nodes[i].prev].next = nodes[i].next;
+    nodes[nodes[i].next].prev = nodes[i].prev;
+}
+
+/**
+ * @brief Adds the ring to nodes, in the requested orientation.
+ * @return A node of the ring, or -1 if the ring has no area.
+ */
+int linkRing(Nodes &nodes, const QVector<QPointF> &ring, bool turnsLeft)
+{
+    qreal area2 = 0;
+    for (int i = 0; i < ring.size(); ++i)
+        area2 += turn(QPointF(0, 0), ring[i], ring[(i + 1) % ring.size()]);
+
+    if (area2 == 0)
+        return -1;
+
+    bool reverse = (area2 > 0) != turnsLeft;
+
+    int first = nodes.size();
+    for (int i = 0; i < ring.size(); ++i) {
+        QPointF p = ring[reverse ? ring.size() - 1 - i : i];
+
+        // Skip repeated points, including a closing point.
+        if (nodes.size() > first && (nodes.last().p == p || (i == ring.size() - 1 && nodes[first].p == p)))
+            continue;
+
+        nodes.append({p, nodes.size() - 1, nodes.size() + 1});
+    }
+
+    int last = nodes.size() - 1;
+    if (last - first < 2)
+        return -1;
+
+    nodes[first].prev = last;
+    nodes[last].next = first;
+
+    return first;
+}
+
+/**
+ * @brief Removes repeated and collinear points, starting at start and going until end.
+ * @return A node that is still in the ring.
+ */
+int filterPoints(Nodes &nodes, int start, int end = -1)
+{
+    if (end == -1)
+        end = start;
+
+    int p = start;
+    bool again;
+    do {
+        again = false;
+
+        const Node &node = nodes[p];
+        if (node.p == nodes[node.next].p || turn(nodes, node.prev, p, node.next) == 0) {
+            removeNode(nodes, p);
+            p = end = node.prev;
+
+            if (p == nodes[p].next)
+                break;
+
+            again = true;
+        } else {
+            p = node.next;
+        }
+    } while (again || p != end);
+
+    return end;
+}
+
+/// Whether a diagonal from a to b starts off inside the polygon, looking only at a's neighbors.
+bool isLocallyInside(const Nodes &nodes, int a, int b)
+{
+    int prev = nodes[a].prev;
+    int next = nodes[a].next;
+
+    if (turn(nodes, prev, a, next) > 0)
+        return turn(nodes, a, b, next) <= 0 && turn(nodes, a, prev, b) <= 0;
+    else
+        return turn(nodes, a, b, prev) > 0 || turn(nodes, a, next, b) > 0;
+}
+
+/// Whether the angle of the polygon at p lies within the angle at m.
+bool sectorContainsSector(const Nodes &nodes, int m, int p)
+{
+    return turn(nodes, nodes[m].prev, m, nodes[p].prev) > 0
+            && turn(nodes, nodes[p].next, m, nodes[m].next) > 0;
+}
+
+/**
+ * @brief Finds a vertex of the outer ring that can be connected to the leftmost vertex
+ * of a hole without crossing any edge.
+ * @return The vertex, or -1 if there is none.
+ */
+int findHoleBridge(const Nodes &nodes, int hole, int outer)
+{
+    qreal hx = nodes[hole].p.x();
+    qreal hy = nodes[hole].p.y();
+
+    // Cast a ray to the left and find the nearest edge that it hits from the inside.
+    qreal qx = -std::numeric_limits<qreal>::infinity();
+    int m = -1;
+
+    int p = outer;
+    do {
+        QPointF a = nodes[p].p;
+        QPointF b = nodes[nodes[p].next].p;
+
+        if (hy <= a.y() && hy >= b.y() && a.y() != b.y()) {
+            qreal x = a.x() + (hy - a.y()) * (b.x() - a.x()) / (b.y() - a.y());
+
+            if (x <= hx && x > qx) {
+                qx = x;
+                m = a.x() < b.x() ? p : nodes[p].next;
+
+                // The hole touches the edge.
+                if (x == hx)
+                    return m;
+            }
+        }
+
+        p = nodes[p].next;
+    } while (p != outer);
+
+    if (m == -1)
+        return -1;
+
+    // Reflex vertices inside the triangle between the hole, the hit point and m could
+    // block the bridge to m. If there are any, use the one closest in angle to the ray.
+    QPointF mp = nodes[m].p;
+    QPointF a(hy < mp.y() ? hx : qx, hy);
+    QPointF c(hy < mp.y() ? qx : hx, hy);
+
+    qreal tanMin = std::numeric_limits<qreal>::infinity();
+
+    int stop = m;
+    p = m;
+    do {
+        QPointF pp = nodes[p].p;
+
+        if (hx >= pp.x() && pp.x() >= mp.x() && hx != pp.x() && isInTriangle(a, mp, c, pp)) {
+            qreal tan = qAbs(hy - pp.y()) / (hx - pp.x());
+
+            if (isLocallyInside(nodes, p, hole)
+                    && (tan < tanMin
+                        || (tan == tanMin && (pp.x() > nodes[m].p.x()
+                                              || (pp.x() == nodes[m].p.x() && sectorContainsSector(nodes, m, p)))))) {
+                m = p;
+                tanMin = tan;
+            }
+        }
+
+        p = nodes[p].next;
+    } while (p != stop);
+
+    return m;
+}
+
+/**
+ * @brief Connects a and b with a pair of bridge edges, which splits their ring in two
+ * or, if they were on different rings, joins the rings.
+ * @return The copy of b that starts the second half.
+ */
+int splitRing(Nodes &nodes, int a, int b)
+{
+    int a2 = nodes.size();
+    int b2 = a2 + 1;
+    int an = nodes[a].next;
+    int bp = nodes[b].prev;
+
+    nodes.append({nodes[a].p, b2, an});
+    nodes.append({nodes[b].p, bp, a2});
+
+    nodes[a].next = b;
+    nodes[b].prev = a;
+    nodes[an].prev = a2;
+    nodes[bp].next = b2;
+
+    return b2;
+}
+
+int eliminateHole(Nodes &nodes, int hole, int outer)
+{
+    int bridge = findHoleBridge(nodes, hole, outer);
+    if (bridge == -1)
+        return outer;
+
+    int bridgeReverse = splitRing(nodes, bridge, hole);
+
+    filterPoints(nodes, bridgeReverse, nodes[bridgeReverse].next);
+    return filterPoints(nodes, bridge, nodes[bridge].next);
+}
+
+bool isEar(const Nodes &nodes, int ear)
+{
+    int a = nodes[ear].prev;
+    int c = nodes[ear].next;
+
+    QPointF pa = nodes[a].p;
+    QPointF pb = nodes[ear].p;
+    QPointF pc = nodes[c].p;
+
+    if (turn(pa, pb, pc) <= 0)
+        return false;
+
+    qreal x0 = qMin(pa.x(), qMin(pb.x(), pc.x()));
+    qreal x1 = qMax(pa.x(), qMax(pb.x(), pc.x()));
+    qreal y0 = qMin(pa.y(), qMin(pb.y(), pc.y()));
+    qreal y1 = qMax(pa.y(), qMax(pb.y(), pc.y()));
+
+    // Only a reflex vertex can be inside the ear without an edge crossing it. Copies
+    // of a made by bridges are on its boundary without blocking it.
+    for (int p = nodes[c].next; p != a; p = nodes[p].next) {
+        const Node &node = nodes[p];
+
+        if (node.p.x() < x0 || node.p.x() > x1 || node.p.y() < y0 || node.p.y() > y1 || node.p == pa)
+            continue;
+
+        if (turn(nodes, node.prev, p, node.next) <= 0 && isInTriangle(pa, pb, pc, node.p))
+            return false;
+    }
+
+    return true;
+}
+
+void clipEars(Nodes &nodes, int ear, QList<Triangle> &triangles)
+{
+    auto cut = [&nodes, &triangles] (int ear) {
+        const Node &node = nodes[ear];
+
+        // Reversed to the orientation of BetterPolygon.
+        triangles.append(Triangle(nodes[node.next].p, node.p, nodes[node.prev].p));
+        removeNode(nodes, ear);
+    };
+
+    int stop = ear;
+    bool filtered = false;
+
+    while (nodes[ear].prev != nodes[ear].next) {
+        int next = nodes[ear].next;
+
+        if (isEar(nodes, ear)) {
+            cut(ear);
+
+            // Skipping the next vertex gives fewer thin triangles.
+            ear = stop = nodes[next].next;
+            filtered = false;
+            continue;
+        }
+
+        ear = next;
+        if (ear != stop)
+            continue;
+
+        // No ear was found in a whole round. Remove points that may be in the way.
+        if (!filtered) {
+            ear = stop = filterPoints(nodes, ear);
+            filtered = true;
+            continue;
+        }
+
+        // The input is degenerate (for example, self-intersecting). Cut off any convex
+        // vertex so that the remaining ring still gets triangulated.
+        int convex = ear;
+        while (turn(nodes, nodes[convex].prev, convex, nodes[convex].next) <= 0) {
+            convex = nodes[convex].next;
+            if (convex == ear)
+                return;
+        }
+
+        next = nodes[convex].next;
+        cut(convex);
+        ear = stop = next;
+        filtered = false;
+    }
+}
+
+}
+
+
+QList<Triangle> Triangulator::triangulate(const QVector<QPointF> &outer, const QVector<QVector<QPointF>> &holes)
+{
+    QList<Triangle> triangles;
+
+    int numPoints = outer.size();
+    for (const QVector<QPointF> &hole : holes)
+        numPoints += hole.size();
+
+    Arena arena;
+
+    // Every hole adds two copies of bridge vertices.
+    Nodes nodes(arena, numPoints + 2 * holes.size());
+
+    int ring = linkRing(nodes, outer, true);
+    if (ring == -1)
+        return triangles;
+
+    ring = filterPoints(nodes, ring);
+
+    /* BEGIN holes */
+    if (!holes.isEmpty()) {
+        ArenaVector<int> leftmost(arena, holes.size());
+
+        for (const QVector<QPointF> &hole : holes) {
+            int start = linkRing(nodes, hole, false);
+            if (start == -1)
+                continue;
+
+            int left = start;
+            for (int p = nodes[start].next; p != start; p = nodes[p].next) {
+                if (nodes[p].p.x() < nodes[left].p.x()
+                        || (nodes[p].p.x() == nodes[left].p.x() && nodes[p].p.y() < nodes[left].p.y()))
+                    left = p;
+            }
+
+            leftmost.append(left);
+        }
+
+        // Bridging from left to right guarantees that earlier bridges never block later ones.
+        std::sort(leftmost.begin(), leftmost.end(), [&nodes] (int a, int b) {
+            return nodes[a].p.x() < nodes[b].p.x();
+        });
+
+        for (int hole : leftmost)
+            ring = eliminateHole(nodes, hole, ring);
+    }
+    /* END holes */
+
+    clipEars(nodes, ring, triangles);
+
+    return triangles;
+}
@@ -0,0 +1,34 @@
+#ifndef TRIANGULATOR_H
+#define TRIANGULATOR_H
+
+#include <QList>
+#include <QVector>
+#include <QPointF>
+
+#include "triplet.h"
+
+/**
+ * @brief Ear-clipping triangulation of polygons with holes.
+ *
+ * Holes are first joined to the outer boundary with bridge edges, which turns the
+ * polygon into a single (weakly simple) ring. Ears are then cut off that ring. Only
+ * reflex vertices can lie inside an ear, so convex vertices are never tested, and
+ * after cutting an ear the search continues right next to it. This makes the common
+ * case (mostly convex tile polygons) close to linear.
+ */
+namespace Triangulator {
+
+using Triangle = Triplet<QPointF, QPointF, QPointF>;
+
+/**
+ * @brief Triangulates the polygon with the given outer boundary and holes.
+ *
+ * The orientation of the rings does not matter. The returned triangles use the
+ * same orientation as BetterPolygon. Collinear points are skipped, and degenerate
+ * input still terminates, though it may leave out parts that have no area.
+ */
+QList<Triangle> triangulate(const QVector<QPointF> &outer, const QVector<QVector<QPointF>> &holes = {});
+
+}
+
+#endif // TRIANGULATOR_H
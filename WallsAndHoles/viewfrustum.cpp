@@ -0,0 +1,70 @@
+#include "viewfrustum.h"
+
+#include <limits>
+
+
+/* BEGIN BoundingBox */
+BoundingBox BoundingBox::empty()
+{
+    float inf = std::numeric_limits<float>::infinity();
+    return {QVector3D(inf, inf, inf), QVector3D(-inf, -inf, -inf)};
+}
+
+bool BoundingBox::isEmpty() const
+{
+    return min.x() > max.x() || min.y() > max.y() || min.z() > max.z();
+}
+
+void BoundingBox::addPoint(QVector3D p)
+{
+    min = QVector3D(qMin(min.x(), p.x()), qMin(min.y(), p.y()), qMin(min.z(), p.z()));
+    max = QVector3D(qMax(max.x(), p.x()), qMax(max.y(), p.y()), qMax(max.z(), p.z()));
+}
+
+float BoundingBox::distanceTo(QVector3D p) const
+{
+    QVector3D nearest(qBound(min.x(), p.x(), max.x()),
+                      qBound(min.y(), p.y(), max.y()),
+                      qBound(min.z(), p.z(), max.z()));
+
+    return p.distanceToPoint(nearest);
+}
+/* END BoundingBox */
+
+
+/* BEGIN ViewFrustum */
+ViewFrustum::ViewFrustum(const QMatrix4x4 &mvp)
+{
+    // A point is visible if -w <= x, y, z <= w in clip coordinates, and each of
+    // these inequalities is a plane in world coordinates.
+    QVector4D x = mvp.row(0);
+    QVector4D y = mvp.row(1);
+    QVector4D z = mvp.row(2);
+    QVector4D w = mvp.row(3);
+
+    mPlanes[0] = w + x;
+    mPlanes[1] = w - x;
+    mPlanes[2] = w + y;
+    mPlanes[3] = w - y;
+    mPlanes[4] = w + z;
+    mPlanes[5] = w - z;
+}
+
+bool ViewFrustum::intersects(const BoundingBox &box) const
+{
+    if (box.isEmpty())
+        return false;
+
+    for (const QVector4D &plane : mPlanes) {
+        // The corner of the box that is furthest along the plane's normal.
+        QVector3D corner(plane.x() >= 0 ? box.max.x() : box.min.x(),
+                         plane.y() >= 0 ? box.max.y() : box.min.y(),
+                         plane.z() >= 0 ? box.max.z() : box.min.z());
+
+        if (QVector3D::dotProduct(plane.toVector3D(), corner) + plane.w() < 0)
+            return false;
+    }
+
+    return true;
+}
+/* END ViewFrustum */
@@ -0,0 +1,54 @@
+#ifndef VIEWFRUSTUM_H
+#define VIEWFRUSTUM_H
+
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <QVector4D>
+
+/**
+ * @brief An axis-aligned box. A box whose min is greater than its max in some
+ * coordinate is empty.
+ */
+struct BoundingBox {
+    QVector3D min;
+    QVector3D max;
+
+    /// Returns an empty box, which grows to exactly the points that are added to it.
+    static BoundingBox empty();
+
+    bool isEmpty() const;
+
+    void addPoint(QVector3D p);
+
+    QVector3D center() const { return (min + max) / 2; }
+
+    BoundingBox translated(QVector3D offset) const { return {min + offset, max + offset}; }
+
+    /// The distance from p to the nearest point of the box, which is 0 if p is inside.
+    float distanceTo(QVector3D p) const;
+};
+
+
+/**
+ * @brief The region of world space that a model-view-projection matrix maps into
+ * the visible clip volume.
+ */
+class ViewFrustum
+{
+public:
+    explicit ViewFrustum(const QMatrix4x4 &mvp);
+
+    /**
+     * @brief Returns false if the box is certainly outside of the frustum. Boxes
+     * near the frustum's corners may be reported as intersecting it even if they
+     * are outside.
+     */
+    bool intersects(const BoundingBox &box) const;
+
+private:
+    /// The left, right, bottom, top, near and far planes. A point p is on the inner
+    /// side of a plane if dot(plane, (p, 1)) >= 0.
+    QVector4D mPlanes[6];
+};
+
+#endif // VIEWFRUSTUM_H
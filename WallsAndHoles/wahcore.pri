@@ -0,0 +1,116 @@
+# Sources shared by every target that is built from the WallsAndHoles sources:
+# the map model, meshing, the scene and its renderer, and loading and exporting.
+# Nothing here uses QtWidgets, so command-line tools such as WahConvert can
+# include this file on its own. The editor also includes wahui.pri.
+#
+# Include this file from a .pro file; it adds the required Qt modules as well.
+
+QT += core gui xml concurrent
+
+CONFIG += c++14
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+
+SOURCES += \
+    $$PWD/tile.cpp \
+    $$PWD/tilemap.cpp \
+    $$PWD/tiletemplate.cpp \
+    $$PWD/tiletemplateset.cpp \
+    $$PWD/xmltool.cpp \
+    $$PWD/map2mesh.cpp \
+    $$PWD/m2mtilemesher.cpp \
+    $$PWD/m2mpropertyclass.cpp \
+    $$PWD/m2mpropertyinstance.cpp \
+    $$PWD/m2mpropertyset.cpp \
+    $$PWD/map2meshproperties.cpp \
+    $$PWD/simpletexturedrenderer.cpp \
+    $$PWD/simpletexturedscene.cpp \
+    $$PWD/simpletexturedobject.cpp \
+    $$PWD/simpletexturedshader.cpp \
+    $$PWD/savabletiletemplateset.cpp \
+    $$PWD/objtools.cpp \
+    $$PWD/tilematerial.cpp \
+    $$PWD/tilematerialset.cpp \
+    $$PWD/m2mpartialmesh.cpp \
+    $$PWD/m2mtilemesher_private.cpp \
+    $$PWD/polygon.cpp \
+    $$PWD/abstractpolygontilemesher.cpp \
+    $$PWD/blockypolygontilemesher.cpp \
+    $$PWD/groundblockypolygontilemesher.cpp \
+    $$PWD/imageandsource.cpp \
+    $$PWD/m2mparallelmesher.cpp \
+    $$PWD/m2mmapsnapshot.cpp \
+    $$PWD/m2mmeshcache.cpp \
+    $$PWD/m2mremeshscheduler.cpp \
+    $$PWD/m2mtopfacemerger.cpp \
+    $$PWD/m2mhiddenwallremover.cpp \
+    $$PWD/arena.cpp \
+    $$PWD/polygonclipper.cpp \
+    $$PWD/triangulator.cpp \
+    $$PWD/segmentintersection.cpp \
+    $$PWD/materialtable.cpp \
+    $$PWD/packedmesh.cpp \
+    $$PWD/rangeallocator.cpp \
+    $$PWD/gpubufferpool.cpp \
+    $$PWD/viewfrustum.cpp \
+    $$PWD/occlusionculler.cpp
+
+HEADERS += \
+    $$PWD/objtools.h \
+    $$PWD/tile.h \
+    $$PWD/tilemap.h \
+    $$PWD/tiletemplate.h \
+    $$PWD/array2d.h \
+    $$PWD/xmltool.h \
+    $$PWD/map2mesh.h \
+    $$PWD/m2mtilemesher.h \
+    $$PWD/m2mpropertyclass.h \
+    $$PWD/m2mpropertyinstance.h \
+    $$PWD/m2mpropertyset.h \
+    $$PWD/tiletemplateset.h \
+    $$PWD/abstractrenderer.h \
+    $$PWD/simpletexturedrenderer.h \
+    $$PWD/abstractscene.h \
+    $$PWD/simpletexturedscene.h \
+    $$PWD/dereferencingiterator.h \
+    $$PWD/dereferencingconstiterator.h \
+    $$PWD/simpletexturedobject.h \
+    $$PWD/triplet.h \
+    $$PWD/simpletexturedshader.h \
+    $$PWD/savabletiletemplateset.h \
+    $$PWD/tilematerial.h \
+    $$PWD/tilematerialset.h \
+    $$PWD/imageandsource.h \
+    $$PWD/m2mpartialmesh.h \
+    $$PWD/array2dtools.h \
+    $$PWD/array2d_private.h \
+    $$PWD/m2mtilemesher_private.h \
+    $$PWD/polygon.h \
+    $$PWD/geometry.h \
+    $$PWD/abstractpolygontilemesher.h \
+    $$PWD/blockypolygontilemesher.h \
+    $$PWD/groundblockypolygontilemesher.h \
+    $$PWD/m2mparallelmesher.h \
+    $$PWD/m2mmapsnapshot.h \
+    $$PWD/m2mmeshcache.h \
+    $$PWD/m2mremeshscheduler.h \
+    $$PWD/m2mtopfacemerger.h \
+    $$PWD/m2mhiddenwallremover.h \
+    $$PWD/arena.h \
+    $$PWD/polygonclipper.h \
+    $$PWD/triangulator.h \
+    $$PWD/blockymeshertables.h \
+    $$PWD/segmentintersection.h \
+    $$PWD/materialtable.h \
+    $$PWD/packedmesh.h \
+    $$PWD/rangeallocator.h \
+    $$PWD/gpubufferpool.h \
+    $$PWD/viewfrustum.h \
+    $$PWD/occlusionculler.h \
+    $$PWD/slotmap.h
+
+RESOURCES += \
+    $$PWD/shaders.qrc \
+    $$PWD/textures.qrc
@@ -0,0 +1,108 @@
+# The editor's user interface: windows, views, tools, dialogs and undo commands.
+# Only the editor includes this file. It includes wahcore.pri as well.
+#
+# Include this file from a .pro file; it adds the required Qt modules as well.
+
+include($$PWD/wahcore.pri)
+
+QT += widgets
+
+
+SOURCES += \
+    $$PWD/meshview.cpp \
+    $$PWD/meshviewcameralikeblender.cpp \
+    $$PWD/drawableaxes.cpp \
+    $$PWD/toolmanager.cpp \
+    $$PWD/meshviewcontainer.cpp \
+    $$PWD/mapview.cpp \
+    $$PWD/editor.cpp \
+    $$PWD/shaderprogramonelight.cpp \
+    $$PWD/mapcell.cpp \
+    $$PWD/tilemapbrushtool.cpp \
+    $$PWD/tilemaptoolmanager.cpp \
+    $$PWD/tiletemplatesetsview.cpp \
+    $$PWD/newtiletemplatesetdialog.cpp \
+    $$PWD/mapcellgraphicsitem.cpp \
+    $$PWD/abstractshapebrushtool.cpp \
+    $$PWD/linebrushtool.cpp \
+    $$PWD/rectbrushtool.cpp \
+    $$PWD/ellipsebrushtool.cpp \
+    $$PWD/tilemapselectiontool.cpp \
+    $$PWD/filltool.cpp \
+    $$PWD/tiletemplatesetsmanager.cpp \
+    $$PWD/newmapdialog.cpp \
+    $$PWD/tilemappreviewgraphicsitem.cpp \
+    $$PWD/propertybrowser.cpp \
+    $$PWD/tilepropertymanager.cpp \
+    $$PWD/mappropertymanager.cpp \
+    $$PWD/colorpickerbutton.cpp \
+    $$PWD/tiletemplatepropertymanager.cpp \
+    $$PWD/tilematerialview.cpp \
+    $$PWD/tilematerialselectionbar.cpp \
+    $$PWD/materialpropertymanager.cpp \
+    $$PWD/imagefinderbar.cpp \
+    $$PWD/tilematerialselectiondialog.cpp \
+    $$PWD/templatematerialselector.cpp \
+    $$PWD/abstracttileselectiontool.cpp \
+    $$PWD/tilemaphelpers.cpp \
+    $$PWD/shaperegion.cpp \
+    $$PWD/mapviewcontainer.cpp \
+    $$PWD/mapviewmatchercamera.cpp \
+    $$PWD/tiletemplatechangecommand.cpp \
+    $$PWD/dependentundocommand.cpp \
+    $$PWD/emptyparentcommand.cpp
+
+HEADERS += \
+    $$PWD/meshview.h \
+    $$PWD/meshviewcameralikeblender.h \
+    $$PWD/drawableaxes.h \
+    $$PWD/toolmanager.h \
+    $$PWD/abstracttool.h \
+    $$PWD/abstractmeshviewcamera.h \
+    $$PWD/abstractdrawableglobject.h \
+    $$PWD/meshviewcontainer.h \
+    $$PWD/mapview.h \
+    $$PWD/editor.h \
+    $$PWD/shaderprogramonelight.h \
+    $$PWD/shaderprogramonelight.h \
+    $$PWD/mapcell.h \
+    $$PWD/tilemaptoolmanager.h \
+    $$PWD/abstracttilemaptool.h \
+    $$PWD/tilemapbrushtool.h \
+    $$PWD/tiletemplatesetsview.h \
+    $$PWD/newtiletemplatesetdialog.h \
+    $$PWD/mapcellgraphicsitem.h \
+    $$PWD/abstractshapebrushtool.h \
+    $$PWD/linebrushtool.h \
+    $$PWD/rectbrushtool.h \
+    $$PWD/ellipsebrushtool.h \
+    $$PWD/filltool.h \
+    $$PWD/tilemapselectiontool.h \
+    $$PWD/tilemappreviewgraphicsitem.h \
+    $$PWD/tiletemplatesetsmanager.h \
+    $$PWD/newmapdialog.h \
+    $$PWD/propertybrowser.h \
+    $$PWD/tilepropertymanager.h \
+    $$PWD/mappropertymanager.h \
+    $$PWD/colorpickerbutton.h \
+    $$PWD/tiletemplatepropertymanager.h \
+    $$PWD/abstractpropertymanager.h \
+    $$PWD/tilematerialview.h \
+    $$PWD/tilematerialselectionbar.h \
+    $$PWD/materialpropertymanager.h \
+    $$PWD/imagefinderbar.h \
+    $$PWD/tilematerialselectiondialog.h \
+    $$PWD/templatematerialselector.h \
+    $$PWD/abstracttileselectiontool.h \
+    $$PWD/tilemaphelpers.h \
+    $$PWD/shaperegion.h \
+    $$PWD/mapviewcontainer.h \
+    $$PWD/mapviewmatchercamera.h \
+    $$PWD/tiletemplatechangecommand.h \
+    $$PWD/changevaluecommand.h \
+    $$PWD/undocommandfromfunctions.h \
+    $$PWD/dependentundocommand.h \
+    $$PWD/emptyparentcommand.h
+
+RESOURCES += \
+    $$PWD/icons.qrc
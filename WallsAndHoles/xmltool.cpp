@@ -1,10 +1,8 @@
 #include "xmltool.h"
 
-#include "tiletemplatesetsmanager.h"
 #include "tilematerialset.h"
 
 #include <QDebug>
-#include <QMessageBox>
 
 QDomElement tileMapElement(TileMap *tileMap, const QList<SavableTileTemplateSet *> &tileTemplateSets, QDomDocument &doc);
 QDomElement tileTemplateSetElement(TileTemplateSet *templateSet, QDomDocument &doc);
@@ -136,7 +134,7 @@ QDomElement tileMaterialElement(TileMaterial *material, QDomDocument &doc)
     return root;
 }
 
-TileMap *XMLTool::openTileMap(QString tileMapPath, TileTemplateSetsManager *tileTemplateSetsManager)
+TileMap *XMLTool::openTileMap(QString tileMapPath, const TileTemplateSetLoader &loadTileTemplateSet, QString *errorString)
 {
     //load the file
     QFile file(tileMapPath);
@@ -144,7 +142,7 @@ TileMap *XMLTool::openTileMap(QString tileMapPath, TileTemplateSetsManager *tile
         return nullptr;
 
     QXmlStreamReader xmlReader(file.readAll());
-    TileMap *tileMap;
+    TileMap *tileMap = nullptr;
 
     QVector<SavableTileTemplateSet *> loadedTileTemplateSets;
 
@@ -178,7 +176,7 @@ TileMap *XMLTool::openTileMap(QString tileMapPath, TileTemplateSetsManager *tile
             } else if (xmlReader.name() == "TileTemplateSet") {
                 QString path = xmlReader.attributes().first().value().toString();
 
-                SavableTileTemplateSet *templateSet = tileTemplateSetsManager->loadTileTemplateSet(path, true);
+                SavableTileTemplateSet *templateSet = loadTileTemplateSet(path);
 
                 if (templateSet == nullptr)
                     return nullptr;
@@ -234,10 +232,11 @@ TileMap *XMLTool::openTileMap(QString tileMapPath, TileTemplateSetsManager *tile
     }
 
     if(xmlReader.hasError()) {
-            QMessageBox::critical(0,
-            "xmlFile.xml Parse Error",xmlReader.errorString(),
-            QMessageBox::Ok);
-            return nullptr;
+        if (errorString != nullptr)
+            *errorString = xmlReader.errorString();
+        else
+            qWarning() << tileMapPath << "parse error:" << xmlReader.errorString();
+        return nullptr;
     }
 
     //close reader and flush file
@@ -246,7 +245,7 @@ TileMap *XMLTool::openTileMap(QString tileMapPath, TileTemplateSetsManager *tile
     return tileMap;
 }
 
-SavableTileTemplateSet *XMLTool::openTileTemplateSet(QString templateSetPath)
+SavableTileTemplateSet *XMLTool::openTileTemplateSet(QString templateSetPath, QString *errorString)
 {
     //load the file
     QFile file(templateSetPath);
@@ -356,10 +355,11 @@ SavableTileTemplateSet *XMLTool::openTileTemplateSet(QString templateSetPath)
     }
 
     if(xmlReader.hasError()) {
-            QMessageBox::critical(0,
-            "xmlFile.xml Parse Error",xmlReader.errorString(),
-            QMessageBox::Ok);
-            return nullptr;
+        if (errorString != nullptr)
+            *errorString = xmlReader.errorString();
+        else
+            qWarning() << templateSetPath << "parse error:" << xmlReader.errorString();
+        return nullptr;
     }
     //close reader and flush file
     xmlReader.clear();
@@ -9,7 +9,7 @@
 #include <QTextStream>
 #include <QXmlStreamReader>
 
-class TileTemplateSetsManager;
+#include <functional>
 
 namespace XMLTool {
 
@@ -18,8 +18,21 @@ enum SaveErrors {
     OpenFileError
 };
 
-TileMap *openTileMap(QString tileMapPath, TileTemplateSetsManager *tileTemplateSetManager);
-SavableTileTemplateSet *openTileTemplateSet(QString templateSetPath);
+/**
+ * @brief Returns the template set saved at the given path, or nullptr if it cannot be
+ * loaded. The template set has to outlive the map that uses it.
+ */
+using TileTemplateSetLoader = std::function<SavableTileTemplateSet *(const QString &path)>;
+
+/**
+ * @brief Loads a map and the template sets it uses.
+ * @param loadTileTemplateSet   Called for every template set that the map uses.
+ * @param errorString           If not null, receives the parse error, if there is one.
+ *                              Otherwise the error is logged.
+ * @return                      The map, or nullptr if it could not be loaded.
+ */
+TileMap *openTileMap(QString tileMapPath, const TileTemplateSetLoader &loadTileTemplateSet, QString *errorString = nullptr);
+SavableTileTemplateSet *openTileTemplateSet(QString templateSetPath, QString *errorString = nullptr);
 
 int saveTileMap(TileMap *tileMap, const QList<SavableTileTemplateSet *> &tileTemplateSets);
 int saveTileTemplateSet(SavableTileTemplateSet *templateSet);